@@ -126,6 +126,27 @@ public:
     {
         return initialize();
     }
+    /**
+     * Identifies the preferred shard type for this analysis.  This is invoked
+     * by the analyzer prior to parallel_shard_supported() and initialize_stream(),
+     * which allows a tool to only support parallel operation for some shard types.
+     * For #SHARD_BY_CORE, each shard corresponds to one output stream of the
+     * scheduler (a simulated core) and its \p shard_index passed to
+     * parallel_shard_init_stream() is the core ordinal.  For #SHARD_BY_TIME_SLICE,
+     * each shard is one time slice of a single thread, in order, and the tool must
+     * discard the slice's warm-up state in parallel_shard_warmup_end().  Results
+     * kept per shard would be attributed to cores or slices rather than threads
+     * for the other shard types, so the default implementation accepts only
+     * #SHARD_BY_THREAD and a tool must opt in to the others.  The return value is
+     * an error string on failure and "" on success.
+     */
+    virtual std::string
+    initialize_shard_type(shard_type_t shard_type)
+    {
+        if (shard_type != SHARD_BY_THREAD)
+            return "Only thread sharding is supported by this tool";
+        return "";
+    }
     /** Returns whether the tool was created successfully. */
     virtual bool
     operator!()
@@ -386,6 +407,21 @@ public:
     {
         return true;
     }
+    /**
+     * Invoked for #SHARD_BY_TIME_SLICE when a shard other than the first reaches its
+     * first instruction, after every entry of its warm-up prefix has been passed to
+     * parallel_shard_memref().  The warm-up prefix overlaps the end of the prior
+     * slice and is only meant to warm up state such as simulated caches, so the tool
+     * should discard any counts gathered so far for this shard while keeping such
+     * state.  Interval snapshots are not requested during the warm-up prefix.
+     * Return whether this was successful. On failure, parallel_shard_error()
+     * returns a descriptive message.
+     */
+    virtual bool
+    parallel_shard_warmup_end(void *shard_data)
+    {
+        return true;
+    }
     /**
      * The heart of an analysis tool, this routine operates on a single trace entry
      * and takes whatever actions the tool needs to perform its analysis. The \p
@@ -400,6 +436,44 @@ public:
     {
         return false;
     }
+    /**
+     * Returns whether this tool can accept trace entries in batches through
+     * parallel_shard_memref_batch() rather than one at a time through
+     * parallel_shard_memref().  This is only consulted when
+     * parallel_shard_supported() returns true, and batches are only delivered if
+     * every tool in the analysis returns true.  A tool returning true must not rely
+     * on the \p shard_stream passed to parallel_shard_init_stream() matching each
+     * individual entry: see parallel_shard_memref_batch().
+     */
+    virtual bool
+    parallel_shard_batch_supported()
+    {
+        return false;
+    }
+    /**
+     * Operates on \p count consecutive trace entries from a single shard, stored
+     * contiguously at \p entries, exactly as though parallel_shard_memref() were
+     * invoked on each one in order.  This is only called if
+     * parallel_shard_batch_supported() returns true.  It lets lightweight tools
+     * avoid a virtual call per entry and run a tight loop over the batch.  While a
+     * batch is being processed, the shard's #memtrace_stream_t reflects the most
+     * recent entry read by the framework, which may be the last entry in the batch
+     * or a later one.  Batches never span an interval boundary or the end of a
+     * shard, so interval snapshots and parallel_shard_exit() see the state after
+     * every prior entry.  The default implementation calls parallel_shard_memref()
+     * on each entry.  The return value and error reporting match
+     * parallel_shard_memref().
+     */
+    virtual bool
+    parallel_shard_memref_batch(void *shard_data, const RecordType *entries,
+                                size_t count)
+    {
+        for (size_t i = 0; i < count; ++i) {
+            if (!parallel_shard_memref(shard_data, entries[i]))
+                return false;
+        }
+        return true;
+    }
     /** Returns a description of the last error for this shard. */
     virtual std::string
     parallel_shard_error(void *shard_data)
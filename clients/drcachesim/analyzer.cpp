@@ -30,8 +30,12 @@
  * DAMAGE.
  */
 
+#include <algorithm>
 #include <inttypes.h>
 #include <iostream>
+#include <chrono>
+#include <limits>
+#include <mutex>
 #include <thread>
 #include "analysis_tool.h"
 #include "analyzer.h"
@@ -60,6 +64,10 @@ typedef dynamorio::drmemtrace::record_file_reader_t<std::ifstream>
     default_record_file_reader_t;
 #endif
 
+// The number of records handed to tools at once when they all support batches.
+// This keeps a batch of memref_t records well within a typical L1 data cache.
+#define ANALYZER_BATCH_SIZE 256
+
 /****************************************************************
  * Specializations for analyzer_tmpl_t<reader_t>, aka analyzer_t.
  */
@@ -159,6 +167,12 @@ analyzer_tmpl_t<RecordType, ReaderType>::init_scheduler(const std::string &trace
         ERRMSG("Trace file name is empty\n");
         return false;
     }
+    std::vector<typename sched_type_t::input_workload_t> workloads;
+    if (shard_type_ == SHARD_BY_TIME_SLICE) {
+        if (!init_time_slice_workloads(trace_path, only_thread, workloads))
+            return false;
+        return init_scheduler_common(workloads);
+    }
     std::vector<typename sched_type_t::range_t> regions;
     if (skip_instrs_ > 0) {
         // TODO i#5843: For serial mode with multiple inputs this is not doing the
@@ -167,11 +181,79 @@ analyzer_tmpl_t<RecordType, ReaderType>::init_scheduler(const std::string &trace
         // capability in the scheduler we should switch to that.
         regions.emplace_back(skip_instrs_ + 1, 0);
     }
-    typename sched_type_t::input_workload_t workload(trace_path, regions);
+    workloads.emplace_back(trace_path, regions);
     if (only_thread != INVALID_THREAD_ID) {
-        workload.only_threads.insert(only_thread);
+        workloads.back().only_threads.insert(only_thread);
+    }
+    return init_scheduler_common(workloads);
+}
+
+template <typename RecordType, typename ReaderType>
+bool
+analyzer_tmpl_t<RecordType, ReaderType>::init_time_slice_workloads(
+    const std::string &trace_path, memref_tid_t only_thread,
+    std::vector<typename sched_type_t::input_workload_t> &workloads)
+{
+    if (time_slices_ <= 0) {
+        ERRMSG("Time-slice analysis requires a positive slice count\n");
+        return false;
+    }
+    if (skip_instrs_ > 0) {
+        ERRMSG("Time-slice analysis does not support skipping instructions\n");
+        return false;
+    }
+    // We need the thread's length to place the slices.  We open a separate
+    // scheduler just to find it, relying on the reader's fast skipping (which for
+    // chunked archives stops at the start of the final chunk: that is close
+    // enough, as the final slice runs to the end regardless).
+    uint64_t total_instrs;
+    {
+        sched_type_t probe;
+        std::vector<typename sched_type_t::input_workload_t> probe_inputs;
+        probe_inputs.emplace_back(trace_path);
+        if (only_thread != INVALID_THREAD_ID)
+            probe_inputs.back().only_threads.insert(only_thread);
+        if (probe.init(probe_inputs, 1,
+                       sched_type_t::make_scheduler_serial_options(verbosity_)) !=
+            sched_type_t::STATUS_SUCCESS) {
+            ERRMSG("Failed to initialize scheduler: %s\n",
+                   probe.get_error_string().c_str());
+            return false;
+        }
+        if (probe.get_input_stream_count() != 1) {
+            ERRMSG("Time-slice analysis requires a single thread: use -only_thread "
+                   "to select one\n");
+            return false;
+        }
+        ReaderType *reader =
+            dynamic_cast<ReaderType *>(probe.get_input_stream_interface(0));
+        if (reader == nullptr) {
+            ERRMSG("Failed to access the trace reader\n");
+            return false;
+        }
+        reader->skip_instructions(std::numeric_limits<uint64_t>::max() / 2);
+        total_instrs = reader->get_instruction_ordinal();
+    }
+    uint64_t slices = std::max<uint64_t>(
+        1, std::min(static_cast<uint64_t>(time_slices_), total_instrs));
+    uint64_t slice_length = (total_instrs + slices - 1) / slices;
+    VPRINT(this, 1, "Splitting %" PRIu64 " instructions into %" PRIu64 " slices\n",
+           total_instrs, slices);
+    time_slice_starts_.clear();
+    for (uint64_t i = 0; i < slices; ++i) {
+        uint64_t start = i * slice_length + 1;
+        uint64_t stop = i == slices - 1 ? 0 : start + slice_length - 1;
+        uint64_t warmup_start =
+            start > time_slice_warmup_instrs_ ? start - time_slice_warmup_instrs_ : 1;
+        time_slice_starts_.push_back(start);
+        workloads.emplace_back(
+            trace_path,
+            std::vector<typename sched_type_t::range_t>(
+                1, typename sched_type_t::range_t(warmup_start, stop)));
+        if (only_thread != INVALID_THREAD_ID)
+            workloads.back().only_threads.insert(only_thread);
     }
-    return init_scheduler_common(workload);
+    return true;
 }
 
 template <typename RecordType, typename ReaderType>
@@ -185,32 +267,70 @@ analyzer_tmpl_t<RecordType, ReaderType>::init_scheduler(
         ERRMSG("Readers are empty\n");
         return false;
     }
+    if (shard_type_ == SHARD_BY_TIME_SLICE) {
+        ERRMSG("Time-slice analysis requires an offline trace\n");
+        return false;
+    }
     std::vector<typename sched_type_t::input_reader_t> readers;
     // With no modifiers or only_threads the tid doesn't matter.
     readers.emplace_back(std::move(reader), std::move(reader_end), /*tid=*/1);
     std::vector<typename sched_type_t::range_t> regions;
     if (skip_instrs_ > 0)
         regions.emplace_back(skip_instrs_ + 1, 0);
-    typename sched_type_t::input_workload_t workload(std::move(readers), regions);
-    return init_scheduler_common(workload);
+    std::vector<typename sched_type_t::input_workload_t> workloads;
+    workloads.emplace_back(std::move(readers), regions);
+    return init_scheduler_common(workloads);
 }
 
 template <typename RecordType, typename ReaderType>
 bool
 analyzer_tmpl_t<RecordType, ReaderType>::init_scheduler_common(
-    typename sched_type_t::input_workload_t &workload)
+    std::vector<typename sched_type_t::input_workload_t> &workloads)
 {
+    for (int i = 0; i < num_tools_; ++i) {
+        std::string error = tools_[i]->initialize_shard_type(shard_type_);
+        if (!error.empty()) {
+            ERRMSG("Tool does not support the requested shard type: %s\n",
+                   error.c_str());
+            return false;
+        }
+    }
     for (int i = 0; i < num_tools_; ++i) {
         if (parallel_ && !tools_[i]->parallel_shard_supported()) {
             parallel_ = false;
             break;
         }
     }
-    std::vector<typename sched_type_t::input_workload_t> sched_inputs(1);
-    sched_inputs[0] = std::move(workload);
+    if (parallel_) {
+        batch_size_ = ANALYZER_BATCH_SIZE;
+        for (int i = 0; i < num_tools_; ++i) {
+            if (!tools_[i]->parallel_shard_batch_supported()) {
+                batch_size_ = 0;
+                break;
+            }
+        }
+    }
     typename sched_type_t::scheduler_options_t sched_ops;
     int output_count;
-    if (parallel_) {
+    if (shard_type_ == SHARD_BY_CORE) {
+        // Each output stream is a simulated core, with its own worker thread.
+        if (!parallel_) {
+            ERRMSG("Core-sharded analysis requires parallel support in every tool\n");
+            return false;
+        }
+        if (worker_count_ <= 0) {
+            ERRMSG("Core-sharded analysis requires a positive core count\n");
+            return false;
+        }
+        sched_ops = typename sched_type_t::scheduler_options_t(
+            sched_type_t::MAP_TO_ANY_OUTPUT, sched_type_t::DEPENDENCY_TIMESTAMPS,
+            sched_type_t::SCHEDULER_DEFAULTS, verbosity_);
+        if (sched_quantum_ > 0)
+            sched_ops.quantum_duration = sched_quantum_;
+    } else if (shard_type_ == SHARD_BY_TIME_SLICE && !parallel_) {
+        ERRMSG("Time-slice analysis requires parallel support in every tool\n");
+        return false;
+    } else if (parallel_) {
         sched_ops = sched_type_t::make_scheduler_parallel_options(verbosity_);
         if (worker_count_ <= 0)
             worker_count_ = std::thread::hardware_concurrency();
@@ -219,7 +339,7 @@ analyzer_tmpl_t<RecordType, ReaderType>::init_scheduler_common(
         worker_count_ = 1;
     }
     output_count = worker_count_;
-    if (scheduler_.init(sched_inputs, output_count, sched_ops) !=
+    if (scheduler_.init(workloads, output_count, sched_ops) !=
         sched_type_t::STATUS_SUCCESS) {
         ERRMSG("Failed to initialize scheduler: %s\n",
                scheduler_.get_error_string().c_str());
@@ -409,10 +529,28 @@ analyzer_tmpl_t<RecordType, ReaderType>::process_tasks(analyzer_worker_data_t *w
     for (int i = 0; i < num_tools_; ++i)
         user_worker_data[i] = tools_[i]->parallel_worker_init(worker->index);
     RecordType record;
+    std::vector<RecordType> batch;
+    batch.reserve(batch_size_);
+    int batch_shard = -1;
+    int prev_input = -1;
     for (typename sched_type_t::stream_status_t status =
              worker->stream->next_record(record);
          status != sched_type_t::STATUS_EOF;
          status = worker->stream->next_record(record)) {
+        if (status == sched_type_t::STATUS_WAIT) {
+            // Do not hold back what we have while idle.
+            if (!process_batch(worker, batch_shard, batch))
+                return;
+            // A dynamic schedule can leave this core idle while it waits on
+            // dependences in the other cores' inputs.  Those can only be resolved by
+            // another core switching inputs, so we block until one does.  The wait
+            // is bounded as timestamp dependences also advance within an input.
+            std::unique_lock<std::mutex> lock(progress_mutex_);
+            uint64_t epoch = progress_epoch_;
+            progress_cond_.wait_for(lock, std::chrono::milliseconds(1),
+                                    [&] { return progress_epoch_ != epoch; });
+            continue;
+        }
         if (status != sched_type_t::STATUS_OK) {
             if (status == sched_type_t::STATUS_REGION_INVALID) {
                 worker->error =
@@ -423,13 +561,35 @@ analyzer_tmpl_t<RecordType, ReaderType>::process_tasks(analyzer_worker_data_t *w
             }
             return;
         }
-        int shard_index = worker->stream->get_input_stream_ordinal();
+        int shard_index = shard_type_ == SHARD_BY_CORE
+            ? worker->index
+            : worker->stream->get_input_stream_ordinal();
+        if (shard_type_ == SHARD_BY_CORE) {
+            int input = worker->stream->get_input_stream_ordinal();
+            if (input != prev_input) {
+                prev_input = input;
+                notify_progress();
+            }
+        }
+        // A batch holds records from just one shard.
+        if (shard_index != batch_shard && !process_batch(worker, batch_shard, batch))
+            return;
         if (worker->shard_data.find(shard_index) == worker->shard_data.end()) {
             VPRINT(this, 1, "Worker %d starting on trace shard %d stream is %p\n",
                    worker->index, shard_index, worker->stream);
             worker->shard_data[shard_index].tool_data.resize(num_tools_);
             if (interval_microseconds_ != 0)
                 worker->shard_data[shard_index].cur_interval_index = 1;
+            if (shard_type_ == SHARD_BY_CORE)
+                worker->shard_data[shard_index].shard_id = worker->index;
+            if (shard_type_ == SHARD_BY_TIME_SLICE) {
+                analyzer_shard_data_t &shard = worker->shard_data[shard_index];
+                shard.shard_id = shard_index;
+                shard.slice_instr_base = time_slice_starts_[shard_index] - 1;
+                // Every slice but the first starts with a warm-up prefix (even if
+                // empty, it holds the headers and the timestamp we skipped to).
+                shard.in_warmup = shard.slice_instr_base > 0;
+            }
             for (int i = 0; i < num_tools_; ++i) {
                 worker->shard_data[shard_index].tool_data[i].shard_data =
                     tools_[i]->parallel_shard_init_stream(
@@ -437,54 +597,69 @@ analyzer_tmpl_t<RecordType, ReaderType>::process_tasks(analyzer_worker_data_t *w
             }
         }
         memref_tid_t tid;
-        // Currently shards map only to threads, so the shard_id is the same as
-        // the thread id.
-        if (worker->shard_data[shard_index].shard_id == 0 &&
+        // For thread shards the shard_id is the same as the thread id.
+        if (shard_type_ == SHARD_BY_THREAD &&
+            worker->shard_data[shard_index].shard_id == 0 &&
             record_has_tid(record, tid)) {
             worker->shard_data[shard_index].shard_id = tid;
         }
+        if (worker->shard_data[shard_index].in_warmup &&
+            worker->stream->get_instruction_ordinal() >
+                worker->shard_data[shard_index].slice_instr_base &&
+            !process_warmup_end(worker, shard_index, batch))
+            return;
         uint64_t prev_interval_index;
         uint64_t prev_interval_init_instr_count;
         if (record_is_timestamp(record) &&
+            !worker->shard_data[shard_index].in_warmup &&
             advance_interval_id(worker->stream, &worker->shard_data[shard_index],
-                                prev_interval_index, prev_interval_init_instr_count) &&
-            !process_interval(prev_interval_index, prev_interval_init_instr_count, worker,
-                              /*parallel=*/true, shard_index)) {
-            return;
-        }
-        for (int i = 0; i < num_tools_; ++i) {
-            if (!tools_[i]->parallel_shard_memref(
-                    worker->shard_data[shard_index].tool_data[i].shard_data, record)) {
-                worker->error = tools_[i]->parallel_shard_error(
-                    worker->shard_data[shard_index].tool_data[i].shard_data);
-                VPRINT(this, 1, "Worker %d hit shard memref error %s on trace shard %s\n",
-                       worker->index, worker->error.c_str(),
-                       worker->stream->get_stream_name().c_str());
+                                prev_interval_index, prev_interval_init_instr_count)) {
+            // The snapshot must include every record prior to this timestamp.
+            if (!process_batch(worker, shard_index, batch) ||
+                !process_interval(prev_interval_index, prev_interval_init_instr_count,
+                                  worker, /*parallel=*/true, shard_index))
                 return;
-            }
         }
-        if (record_is_thread_final(record)) {
-            VPRINT(this, 1, "Worker %d finished trace shard %s\n", worker->index,
-                   worker->stream->get_stream_name().c_str());
-            if (interval_microseconds_ != 0 &&
-                !process_interval(
-                    worker->shard_data[shard_index].cur_interval_index,
-                    worker->shard_data[shard_index].cur_interval_init_instr_count, worker,
-                    /*parallel=*/true, shard_index))
+        if (batch_size_ > 0) {
+            batch.push_back(record);
+            batch_shard = shard_index;
+            if (batch.size() >= batch_size_ && !process_batch(worker, shard_index, batch))
                 return;
+        } else {
             for (int i = 0; i < num_tools_; ++i) {
-                if (!tools_[i]->parallel_shard_exit(
-                        worker->shard_data[shard_index].tool_data[i].shard_data)) {
+                if (!tools_[i]->parallel_shard_memref(
+                        worker->shard_data[shard_index].tool_data[i].shard_data,
+                        record)) {
                     worker->error = tools_[i]->parallel_shard_error(
                         worker->shard_data[shard_index].tool_data[i].shard_data);
                     VPRINT(this, 1,
-                           "Worker %d hit shard exit error %s on trace shard %s\n",
+                           "Worker %d hit shard memref error %s on trace shard %s\n",
                            worker->index, worker->error.c_str(),
                            worker->stream->get_stream_name().c_str());
                     return;
                 }
             }
         }
+        if (shard_type_ != SHARD_BY_CORE && record_is_thread_final(record)) {
+            VPRINT(this, 1, "Worker %d finished trace shard %s\n", worker->index,
+                   worker->stream->get_stream_name().c_str());
+            if (!process_batch(worker, shard_index, batch) ||
+                !process_shard_exit(worker, shard_index))
+                return;
+        }
+    }
+    if (shard_type_ == SHARD_BY_CORE) {
+        // Our inputs are all finished, which may unblock other cores.
+        notify_progress();
+    }
+    if (!process_batch(worker, batch_shard, batch))
+        return;
+    if (shard_type_ == SHARD_BY_CORE &&
+        worker->shard_data.find(worker->index) != worker->shard_data.end()) {
+        // A core shard lasts until its output stream is exhausted.
+        VPRINT(this, 1, "Worker %d finished core shard\n", worker->index);
+        if (!process_shard_exit(worker, worker->index))
+            return;
     }
     for (int i = 0; i < num_tools_; ++i) {
         const std::string error = tools_[i]->parallel_worker_exit(user_worker_data[i]);
@@ -497,6 +672,97 @@ analyzer_tmpl_t<RecordType, ReaderType>::process_tasks(analyzer_worker_data_t *w
     }
 }
 
+template <typename RecordType, typename ReaderType>
+void
+analyzer_tmpl_t<RecordType, ReaderType>::notify_progress()
+{
+    {
+        std::lock_guard<std::mutex> guard(progress_mutex_);
+        ++progress_epoch_;
+    }
+    progress_cond_.notify_all();
+}
+
+template <typename RecordType, typename ReaderType>
+bool
+analyzer_tmpl_t<RecordType, ReaderType>::process_shard_exit(
+    analyzer_worker_data_t *worker, int shard_index)
+{
+    if (interval_microseconds_ != 0 &&
+        !process_interval(worker->shard_data[shard_index].cur_interval_index,
+                          worker->shard_data[shard_index].cur_interval_init_instr_count,
+                          worker,
+                          /*parallel=*/true, shard_index))
+        return false;
+    for (int i = 0; i < num_tools_; ++i) {
+        if (!tools_[i]->parallel_shard_exit(
+                worker->shard_data[shard_index].tool_data[i].shard_data)) {
+            worker->error = tools_[i]->parallel_shard_error(
+                worker->shard_data[shard_index].tool_data[i].shard_data);
+            VPRINT(this, 1, "Worker %d hit shard exit error %s on trace shard %s\n",
+                   worker->index, worker->error.c_str(),
+                   worker->stream->get_stream_name().c_str());
+            return false;
+        }
+    }
+    return true;
+}
+
+template <typename RecordType, typename ReaderType>
+bool
+analyzer_tmpl_t<RecordType, ReaderType>::process_warmup_end(
+    analyzer_worker_data_t *worker, int shard_index, std::vector<RecordType> &batch)
+{
+    if (!process_batch(worker, shard_index, batch))
+        return false;
+    analyzer_shard_data_t &shard = worker->shard_data[shard_index];
+    VPRINT(this, 1, "Worker %d finished warm-up for slice %d\n", worker->index,
+           shard_index);
+    shard.in_warmup = false;
+    // Intervals start over from the slice's first instruction.
+    if (interval_microseconds_ != 0) {
+        shard.cur_interval_index =
+            compute_interval_id(worker->stream->get_first_timestamp(),
+                                worker->stream->get_last_timestamp());
+        shard.cur_interval_init_instr_count = shard.slice_instr_base;
+    }
+    for (int i = 0; i < num_tools_; ++i) {
+        if (!tools_[i]->parallel_shard_warmup_end(shard.tool_data[i].shard_data)) {
+            worker->error =
+                tools_[i]->parallel_shard_error(shard.tool_data[i].shard_data);
+            VPRINT(this, 1, "Worker %d hit warm-up end error %s on trace shard %s\n",
+                   worker->index, worker->error.c_str(),
+                   worker->stream->get_stream_name().c_str());
+            return false;
+        }
+    }
+    return true;
+}
+
+template <typename RecordType, typename ReaderType>
+bool
+analyzer_tmpl_t<RecordType, ReaderType>::process_batch(analyzer_worker_data_t *worker,
+                                                       int shard_index,
+                                                       std::vector<RecordType> &batch)
+{
+    if (batch.empty())
+        return true;
+    for (int i = 0; i < num_tools_; ++i) {
+        if (!tools_[i]->parallel_shard_memref_batch(
+                worker->shard_data[shard_index].tool_data[i].shard_data, batch.data(),
+                batch.size())) {
+            worker->error = tools_[i]->parallel_shard_error(
+                worker->shard_data[shard_index].tool_data[i].shard_data);
+            VPRINT(this, 1, "Worker %d hit shard memref error %s on trace shard %s\n",
+                   worker->index, worker->error.c_str(),
+                   worker->stream->get_stream_name().c_str());
+            return false;
+        }
+    }
+    batch.clear();
+    return true;
+}
+
 template <typename RecordType, typename ReaderType>
 bool
 analyzer_tmpl_t<RecordType, ReaderType>::combine_interval_snapshots(
@@ -771,9 +1037,12 @@ analyzer_tmpl_t<RecordType, ReaderType>::process_interval(
             snapshot->interval_id = interval_id;
             snapshot->interval_end_timestamp = compute_interval_end_timestamp(
                 worker->stream->get_first_timestamp(), interval_id);
-            snapshot->instr_count_cumulative = worker->stream->get_instruction_ordinal();
+            // Time slices count only their own instructions so that the
+            // cumulative counts of all slices add up.
+            snapshot->instr_count_cumulative = worker->stream->get_instruction_ordinal() -
+                worker->shard_data[shard_idx].slice_instr_base;
             snapshot->instr_count_delta =
-                snapshot->instr_count_cumulative - interval_init_instr_count;
+                worker->stream->get_instruction_ordinal() - interval_init_instr_count;
             worker->shard_data[shard_idx].tool_data[tool_idx].interval_snapshot_data.push(
                 snapshot);
         }
@@ -43,8 +43,10 @@
  * @brief DrMemtrace top-level trace analysis driver.
  */
 
+#include <condition_variable>
 #include <iterator>
 #include <memory>
+#include <mutex>
 #include <queue>
 #include <string>
 #include <vector>
@@ -154,9 +156,14 @@ protected:
 
         uint64_t cur_interval_index;
         uint64_t cur_interval_init_instr_count;
-        // Identifier for the shard. Currently, shards map only to threads, so this is
-        // the thread id.
+        // Identifier for the shard: the thread id for #SHARD_BY_THREAD, the
+        // core ordinal for #SHARD_BY_CORE, or the slice ordinal for
+        // #SHARD_BY_TIME_SLICE.
         int64_t shard_id;
+        // For #SHARD_BY_TIME_SLICE, the instruction ordinal just prior to the
+        // slice's own instructions, and whether we are still in its warm-up prefix.
+        uint64_t slice_instr_base = 0;
+        bool in_warmup = false;
         std::vector<analyzer_tool_shard_data_t> tool_data;
 
     private:
@@ -208,7 +215,16 @@ protected:
         int verbosity = 0);
 
     bool
-    init_scheduler_common(typename sched_type_t::input_workload_t &workload);
+    init_scheduler_common(
+        std::vector<typename sched_type_t::input_workload_t> &workloads);
+
+    // Splits the single thread at trace_path (or the only_thread thread in it) into
+    // time_slices_ workloads, each covering one slice plus its warm-up prefix, and
+    // records each slice's first instruction in time_slice_starts_.
+    bool
+    init_time_slice_workloads(
+        const std::string &trace_path, memref_tid_t only_thread,
+        std::vector<typename sched_type_t::input_workload_t> &workloads);
 
     // Used for std::thread so we need an rvalue (so no &worker).
     void
@@ -217,6 +233,29 @@ protected:
     void
     process_serial(analyzer_worker_data_t &worker);
 
+    // Wakes up #SHARD_BY_CORE workers waiting for another core to make progress.
+    void
+    notify_progress();
+
+    // Finalizes the shard at shard_index in the given worker, invoking the tools'
+    // parallel_shard_exit().  Returns false on error, with worker->error set.
+    bool
+    process_shard_exit(analyzer_worker_data_t *worker, int shard_index);
+
+    // Ends the warm-up prefix of the time slice at shard_index: flushes batch,
+    // restarts the slice's intervals, and invokes the tools'
+    // parallel_shard_warmup_end().  Returns false on error, with worker->error set.
+    bool
+    process_warmup_end(analyzer_worker_data_t *worker, int shard_index,
+                       std::vector<RecordType> &batch);
+
+    // Hands the records accumulated in batch for the shard at shard_index to each
+    // tool's parallel_shard_memref_batch() and empties it.  Returns false on error,
+    // with worker->error set.
+    bool
+    process_batch(analyzer_worker_data_t *worker, int shard_index,
+                  std::vector<RecordType> &batch);
+
     bool
     record_has_tid(RecordType record, memref_tid_t &tid);
 
@@ -312,6 +351,27 @@ protected:
     uint64_t skip_instrs_ = 0;
     uint64_t interval_microseconds_ = 0;
     int verbosity_ = 0;
+    // For #SHARD_BY_CORE, worker_count_ is the number of simulated cores and each
+    // worker drives one dynamically scheduled output stream.
+    shard_type_t shard_type_ = SHARD_BY_THREAD;
+    // The scheduling quantum for #SHARD_BY_CORE, in instructions.  0 selects the
+    // scheduler's default.
+    uint64_t sched_quantum_ = 0;
+    // For #SHARD_BY_CORE, bumped whenever a core switches inputs or runs out of
+    // them, to wake up cores waiting on dependences.
+    std::mutex progress_mutex_;
+    std::condition_variable progress_cond_;
+    uint64_t progress_epoch_ = 0;
+    // For #SHARD_BY_TIME_SLICE, the requested number of slices and the number of
+    // instructions before each slice (other than the first) used to warm it up.
+    int time_slices_ = 0;
+    uint64_t time_slice_warmup_instrs_ = 0;
+    // The first instruction ordinal of each slice, indexed by input ordinal.
+    std::vector<uint64_t> time_slice_starts_;
+    // The number of records delivered together to
+    // analysis_tool_tmpl_t::parallel_shard_memref_batch(), or 0 if not every tool
+    // supports batches and records are delivered one at a time.
+    size_t batch_size_ = 0;
 
 private:
     bool
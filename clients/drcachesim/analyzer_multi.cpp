@@ -47,6 +47,7 @@
 #    include "common/zipfile_istream.h"
 #endif
 #include "reader/ipc_reader.h"
+#include "reader/shm_reader.h"
 #include "tools/invariant_checker.h"
 
 analyzer_multi_t::analyzer_multi_t()
@@ -60,6 +61,23 @@ analyzer_multi_t::analyzer_multi_t()
     // we still keep the serial vs parallel split for 0.
     if (worker_count_ == 0)
         parallel_ = false;
+    if (op_core_sharded.get_value()) {
+        if (op_indir.get_value().empty() && op_infile.get_value().empty()) {
+            error_string_ = "Usage error: -core_sharded is not supported for online "
+                            "analysis";
+            success_ = false;
+            return;
+        }
+        shard_type_ = SHARD_BY_CORE;
+        worker_count_ = op_num_cores.get_value();
+        sched_quantum_ = op_sched_quantum.get_value();
+        parallel_ = true;
+    } else if (op_time_slices.get_value() > 0) {
+        shard_type_ = SHARD_BY_TIME_SLICE;
+        time_slices_ = op_time_slices.get_value();
+        time_slice_warmup_instrs_ = op_time_slice_warmup_instrs.get_value();
+        parallel_ = true;
+    }
     if (!op_indir.get_value().empty() || !op_infile.get_value().empty())
         op_offline.set_value(true); // Some tools check this on post-proc runs.
     // XXX: add a "required" flag to droption to avoid needing this here
@@ -135,9 +153,20 @@ analyzer_multi_t::analyzer_multi_t()
     } else if (op_infile.get_value().empty()) {
         // XXX i#3323: Add parallel analysis support for online tools.
         parallel_ = false;
-        auto reader = std::unique_ptr<reader_t>(
-            new ipc_reader_t(op_ipc_name.get_value().c_str(), op_verbose.get_value()));
-        auto end = std::unique_ptr<reader_t>(new ipc_reader_t());
+        std::unique_ptr<reader_t> reader;
+        std::unique_ptr<reader_t> end;
+        if (op_ipc_shm.get_value()) {
+            // The rings are merged into one serial stream.  A ring is handed to a
+            // new thread once its thread exits, so a ring is not a thread shard.
+            reader = std::unique_ptr<reader_t>(new shm_reader_t(
+                op_ipc_name.get_value().c_str(), op_ipc_shm_rings.get_value(),
+                op_ipc_shm_ring_size.get_value(), op_verbose.get_value()));
+            end = std::unique_ptr<reader_t>(new shm_reader_t());
+        } else {
+            reader = std::unique_ptr<reader_t>(new ipc_reader_t(
+                op_ipc_name.get_value().c_str(), op_verbose.get_value()));
+            end = std::unique_ptr<reader_t>(new ipc_reader_t());
+        }
         if (!init_scheduler(std::move(reader), std::move(end), op_verbose.get_value())) {
             success_ = false;
         }
@@ -0,0 +1,371 @@
+/* **********************************************************
+ * Copyright (c) 2023 Google, Inc.  All rights reserved.
+ * **********************************************************/
+
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of Google, Inc. nor the names of its contributors may be
+ *   used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL VMWARE, INC. OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+
+/* flat_hash_map.h: an open-addressing hash table for the integer- and pointer-keyed
+ * per-shard state kept by the analysis tools.
+ */
+
+#ifndef _FLAT_HASH_MAP_H_
+#define _FLAT_HASH_MAP_H_ 1
+
+#include <stddef.h>
+#include <stdint.h>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Converts a key to the 64 bits that are hashed.
+template <typename Key> struct flat_hash_key_bits_t {
+    static uint64_t
+    bits(Key key)
+    {
+        return static_cast<uint64_t>(key);
+    }
+};
+
+template <typename T> struct flat_hash_key_bits_t<T *> {
+    static uint64_t
+    bits(T *key)
+    {
+        return static_cast<uint64_t>(reinterpret_cast<uintptr_t>(key));
+    }
+};
+
+// A hash map from an integer or pointer key to a value, intended for the
+// frequently-updated maps keyed by cache line tags, pcs, or opcodes.  Unlike
+// std::unordered_map, entries live inline in a single power-of-2-sized array which
+// is searched by linear probing, so an insertion does not allocate a node and a
+// lookup usually touches a single cache line.  The value-initialized key (0 or
+// nullptr) marks an empty slot; an entry with that key is kept to the side.
+//
+// The interface is the subset of std::unordered_map used by the tools.  Insertions
+// and erasures invalidate all iterators and references, and iteration order is
+// unspecified.
+template <typename Key, typename Value> class flat_hash_map_t {
+public:
+    typedef Key key_type;
+    typedef Value mapped_type;
+    typedef std::pair<Key, Value> value_type;
+
+    template <bool IsConst> class iterator_base_t {
+    public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef typename flat_hash_map_t::value_type value_type;
+        typedef ptrdiff_t difference_type;
+        typedef typename std::conditional<IsConst, const value_type *,
+                                          value_type *>::type pointer;
+        typedef typename std::conditional<IsConst, const value_type &,
+                                          value_type &>::type reference;
+        typedef typename std::conditional<IsConst, const flat_hash_map_t *,
+                                          flat_hash_map_t *>::type map_pointer;
+
+        iterator_base_t()
+            : map_(nullptr)
+            , index_(0)
+        {
+        }
+        iterator_base_t(map_pointer map, size_t index)
+            : map_(map)
+            , index_(index)
+        {
+            skip_empty();
+        }
+        reference
+        operator*() const
+        {
+            return index_ == map_->slots_.size() ? map_->zero_entry_
+                                                 : map_->slots_[index_];
+        }
+        pointer
+        operator->() const
+        {
+            return &**this;
+        }
+        iterator_base_t &
+        operator++()
+        {
+            ++index_;
+            skip_empty();
+            return *this;
+        }
+        iterator_base_t
+        operator++(int)
+        {
+            iterator_base_t old = *this;
+            ++*this;
+            return old;
+        }
+        bool
+        operator==(const iterator_base_t &rhs) const
+        {
+            return index_ == rhs.index_;
+        }
+        bool
+        operator!=(const iterator_base_t &rhs) const
+        {
+            return index_ != rhs.index_;
+        }
+
+    private:
+        friend class flat_hash_map_t;
+        // Index slots_.size() refers to zero_entry_ and slots_.size() + 1 is end().
+        void
+        skip_empty()
+        {
+            while (index_ < map_->slots_.size() && map_->slots_[index_].first == Key())
+                ++index_;
+            if (index_ == map_->slots_.size() && !map_->has_zero_)
+                ++index_;
+        }
+        map_pointer map_;
+        size_t index_;
+    };
+    typedef iterator_base_t<false> iterator;
+    typedef iterator_base_t<true> const_iterator;
+
+    flat_hash_map_t()
+        : size_(0)
+        , shift_(64)
+        , has_zero_(false)
+        , zero_entry_(Key(), Value())
+    {
+    }
+
+    size_t
+    size() const
+    {
+        return size_;
+    }
+    bool
+    empty() const
+    {
+        return size_ == 0;
+    }
+
+    iterator
+    begin()
+    {
+        return iterator(this, 0);
+    }
+    iterator
+    end()
+    {
+        return iterator(this, slots_.size() + 1);
+    }
+    const_iterator
+    begin() const
+    {
+        return const_iterator(this, 0);
+    }
+    const_iterator
+    end() const
+    {
+        return const_iterator(this, slots_.size() + 1);
+    }
+
+    iterator
+    find(Key key)
+    {
+        return iterator(this, find_index(key));
+    }
+    const_iterator
+    find(Key key) const
+    {
+        return const_iterator(this, find_index(key));
+    }
+    size_t
+    count(Key key) const
+    {
+        return find_index(key) == slots_.size() + 1 ? 0 : 1;
+    }
+
+    // Returns the value for "key", inserting a value-initialized one if absent.
+    Value &
+    operator[](Key key)
+    {
+        if (key == Key()) {
+            if (!has_zero_) {
+                has_zero_ = true;
+                ++size_;
+            }
+            return zero_entry_.second;
+        }
+        if (slots_.empty())
+            rehash(MIN_SLOTS);
+        else if ((slots_count() + 1) * MAX_LOAD_DENOMINATOR >
+                 slots_.size() * MAX_LOAD_NUMERATOR)
+            rehash(slots_.size() * 2);
+        size_t mask = slots_.size() - 1;
+        for (size_t i = home_index(key);; i = (i + 1) & mask) {
+            if (slots_[i].first == key)
+                return slots_[i].second;
+            if (slots_[i].first == Key()) {
+                slots_[i].first = key;
+                ++size_;
+                return slots_[i].second;
+            }
+        }
+    }
+
+    // Removes "key" if present, returning the number of entries removed.
+    size_t
+    erase(Key key)
+    {
+        size_t index = find_index(key);
+        if (index == slots_.size() + 1)
+            return 0;
+        --size_;
+        if (index == slots_.size()) {
+            has_zero_ = false;
+            zero_entry_.second = Value();
+            return 1;
+        }
+        // Shift later members of the probe sequence back so that no lookup stops
+        // early at the hole.
+        size_t mask = slots_.size() - 1;
+        size_t hole = index;
+        for (size_t i = (hole + 1) & mask; slots_[i].first != Key(); i = (i + 1) & mask) {
+            size_t home = home_index(slots_[i].first);
+            if (((i - home) & mask) >= ((i - hole) & mask)) {
+                slots_[hole] = std::move(slots_[i]);
+                hole = i;
+            }
+        }
+        slots_[hole] = value_type(Key(), Value());
+        return 1;
+    }
+
+    void
+    clear()
+    {
+        slots_.clear();
+        shift_ = 64;
+        size_ = 0;
+        has_zero_ = false;
+        zero_entry_.second = Value();
+    }
+
+    // Sizes the table to hold "count" entries without growing.
+    void
+    reserve(size_t count)
+    {
+        size_t want = MIN_SLOTS;
+        while (count * MAX_LOAD_DENOMINATOR > want * MAX_LOAD_NUMERATOR)
+            want *= 2;
+        if (want > slots_.size())
+            rehash(want);
+    }
+
+    // Adds each value in "other" to the value for the same key in this map: the
+    // reduction used to combine per-shard counters.
+    void
+    merge_add(const flat_hash_map_t &other)
+    {
+        if (empty()) {
+            *this = other;
+            return;
+        }
+        reserve(size_ + other.size_);
+        for (const auto &entry : other)
+            (*this)[entry.first] += entry.second;
+    }
+
+private:
+    static constexpr size_t MIN_SLOTS = 16;
+    // The table grows once more than 3/4 of its slots are in use.
+    static constexpr size_t MAX_LOAD_NUMERATOR = 3;
+    static constexpr size_t MAX_LOAD_DENOMINATOR = 4;
+
+    size_t
+    slots_count() const
+    {
+        return has_zero_ ? size_ - 1 : size_;
+    }
+
+    // Fibonacci hashing: the multiply mixes the low bits of sequential keys such as
+    // line tags into the top bits, which select the slot.
+    size_t
+    home_index(Key key) const
+    {
+        return static_cast<size_t>(
+            (flat_hash_key_bits_t<Key>::bits(key) * 0x9e3779b97f4a7c15ULL) >> shift_);
+    }
+
+    // Returns the slot holding "key", slots_.size() for the zero key, or
+    // slots_.size() + 1 if absent.
+    size_t
+    find_index(Key key) const
+    {
+        if (key == Key())
+            return has_zero_ ? slots_.size() : slots_.size() + 1;
+        if (slots_.empty())
+            return slots_.size() + 1;
+        size_t mask = slots_.size() - 1;
+        for (size_t i = home_index(key);; i = (i + 1) & mask) {
+            if (slots_[i].first == key)
+                return i;
+            if (slots_[i].first == Key())
+                return slots_.size() + 1;
+        }
+    }
+
+    void
+    rehash(size_t new_slots)
+    {
+        std::vector<value_type> old(new_slots, value_type(Key(), Value()));
+        old.swap(slots_);
+        shift_ = 64;
+        for (size_t n = new_slots; n > 1; n >>= 1)
+            --shift_;
+        size_t mask = new_slots - 1;
+        for (auto &entry : old) {
+            if (entry.first == Key())
+                continue;
+            size_t i = home_index(entry.first);
+            while (slots_[i].first != Key())
+                i = (i + 1) & mask;
+            slots_[i] = std::move(entry);
+        }
+    }
+
+    std::vector<value_type> slots_;
+    size_t size_;
+    // The hash is shifted right by this to produce a slot index.
+    int shift_;
+    bool has_zero_;
+    value_type zero_entry_;
+};
+
+#endif /* _FLAT_HASH_MAP_H_ */
@@ -51,6 +51,21 @@
  * tools on the full stream of memory reference records.
  */
 
+/**
+ * Identifies the type of shard.
+ */
+enum shard_type_t {
+    /** Sharded by software thread. */
+    SHARD_BY_THREAD,
+    /** Sharded by hardware core. */
+    SHARD_BY_CORE,
+    /**
+     * Sharded by instruction ordinal: a single software thread is split into
+     * consecutive time slices, each preceded by a warm-up prefix.
+     */
+    SHARD_BY_TIME_SLICE,
+};
+
 /**
  * This is an interface for obtaining information from analysis tools
  * on the full stream of memory reference records.
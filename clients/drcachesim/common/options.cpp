@@ -53,6 +53,27 @@ droption_t<std::string> op_ipc_name(
     "for each instance of the simulator being run at any one time.  On Windows, the name "
     "is limited to 247 characters.");
 
+droption_t<bool> op_ipc_shm(
+    DROPTION_SCOPE_ALL, "ipc_shm", false, "Use shared memory for online tracing",
+    "Linux-only.  For online tracing and simulation, sends the trace through shared "
+    "memory instead of the named pipe given by -ipc_name (whose name is still used to "
+    "name the shared memory).  Each traced thread writes into its own ring, so threads "
+    "neither contend on a single pipe nor split their buffers into atomic pipe-sized "
+    "writes.  A thread waits when its ring is full.  The analysis itself is still "
+    "serial.");
+
+droption_t<unsigned int> op_ipc_shm_rings(
+    DROPTION_SCOPE_FRONTEND, "ipc_shm_rings", 64, "Number of -ipc_shm rings",
+    "For -ipc_shm, the number of rings.  This bounds how many traced threads, across "
+    "all processes, can be live at once: a thread starting when all rings are in use "
+    "waits until another thread exits and the analyzer drains its ring.");
+
+droption_t<bytesize_t> op_ipc_shm_ring_size(
+    DROPTION_SCOPE_FRONTEND, "ipc_shm_ring_size", 4 * 1024 * 1024,
+    "Size of each -ipc_shm ring",
+    "For -ipc_shm, the size in bytes of each thread's ring.  It must hold at least one "
+    "full trace buffer.  Pages of the shared memory only take up space once used.");
+
 droption_t<std::string> op_outdir(
     DROPTION_SCOPE_ALL, "outdir", ".", "Target directory for offline trace files",
     "For the offline analysis mode (when -offline is requested), specifies the path "
@@ -370,6 +391,17 @@ droption_t<std::string> op_raw_compress(
     "for an SSD, zlib and gzip typically add overhead and would only be used if space is "
     "at a premium; snappy_nocrc and lz4 are nearly always performance wins.");
 
+droption_t<unsigned int> op_async_writers(
+    DROPTION_SCOPE_CLIENT, "async_writers", 0,
+    "Number of background threads writing offline files",
+    "For offline traces, if non-zero, full trace buffers are handed off to this many "
+    "background threads which compress and write them out while the application thread "
+    "continues tracing into a fresh buffer taken from a recycled pool.  This removes "
+    "compression and file i/o latency from the application threads at the cost of "
+    "extra memory for the buffers in flight.  Each traced thread is assigned to one "
+    "writer so its buffers are written in order.  This is not supported with "
+    "-use_physical or with a buffer handoff callback, where it is ignored.");
+
 droption_t<bool> op_online_instr_types(
     DROPTION_SCOPE_CLIENT, "online_instr_types", false,
     "Whether online traces should distinguish instr types",
@@ -379,18 +411,55 @@ droption_t<bool> op_online_instr_types(
 
 droption_t<std::string> op_replace_policy(
     DROPTION_SCOPE_FRONTEND, "replace_policy", REPLACE_POLICY_LRU,
-    "Cache replacement policy (LRU, LFU, FIFO)",
+    "Cache replacement policy (LRU, LFU, FIFO, TREE_PLRU, BIT_PLRU, SRRIP, BRRIP, "
+    "DRRIP, RANDOM)",
     "Specifies the replacement policy for "
     "caches. Supported policies: LRU (Least Recently Used), LFU (Least Frequently Used), "
-    "FIFO (First-In-First-Out).");
+    "FIFO (First-In-First-Out), TREE_PLRU (tree pseudo-LRU; requires a power-of-two "
+    "associativity of at most 64), BIT_PLRU (one recently-used bit per way; requires "
+    "an associativity of at most 64), SRRIP, BRRIP, and DRRIP (static, bimodal, and "
+    "set-dueling dynamic Re-Reference Interval Prediction with 2-bit predictions), "
+    "and RANDOM (pseudo-random with a fixed seed).");
 
 droption_t<std::string> op_data_prefetcher(
     DROPTION_SCOPE_FRONTEND, "data_prefetcher", PREFETCH_POLICY_NEXTLINE,
-    "Hardware data prefetcher policy (nextline, none)",
+    "Hardware data prefetcher policy (nextline, stride, stream, ip_delta, none)",
     "Specifies the hardware data "
     "prefetcher policy.  The currently supported policies are 'nextline' (fetch the "
-    "subsequent cache line) and 'none' (disables hardware prefetching).  The prefetcher "
-    "is located between the L1D and LL caches.");
+    "subsequent cache line), 'stride' (a PC-indexed table of strides with "
+    "confidence counters), 'stream' (detects up to 16 ascending or descending "
+    "streams of lines regardless of PC), 'ip_delta' (a PC-indexed history of line "
+    "deltas which replays the deltas that followed the latest pair of deltas the "
+    "last time it occurred), and 'none' (disables hardware prefetching).  The "
+    "prefetcher is located between the L1D and LL caches.  All but 'nextline' "
+    "train on cache hits as well as misses.  Prefetch usefulness is reported for "
+    "each cache: prefetched lines that were used, those that were evicted unused, "
+    "and demand misses likely caused by prefetches evicting lines.");
+droption_t<unsigned int> op_data_prefetch_degree(
+    DROPTION_SCOPE_FRONTEND, "data_prefetch_degree", 1,
+    "Number of lines the data prefetcher fetches per trigger",
+    "Specifies how many lines the -data_prefetcher requests each time it "
+    "triggers: how many subsequent lines for 'nextline', how many strides ahead "
+    "for 'stride', how far ahead of a stream for 'stream', and how many recorded "
+    "deltas to replay for 'ip_delta'.");
+
+droption_t<unsigned int> op_set_sampling(
+    DROPTION_SCOPE_FRONTEND, "set_sampling", 1,
+    "Simulate only 1 in this many cache sets",
+    "Specifies a power of 2 N to simulate only about 1 in N of each cache's sets, "
+    "dropping accesses to the rest, for faster approximate cache simulation.  "
+    "The sets are chosen from the set index bits shared by every cache in the "
+    "hierarchy, so a sampled set in a smaller cache only feeds sampled sets in "
+    "larger caches.  N may be no larger than the smallest cache's number of sets.  "
+    "Miss rates are reported for the sampled sets along with a 95% confidence "
+    "interval, and hit and miss counts are additionally reported scaled up to "
+    "estimates for the whole cache.  The value 1 disables sampling.");
+droption_t<bool> op_set_sampling_hashed(
+    DROPTION_SCOPE_FRONTEND, "set_sampling_hashed", true,
+    "Choose the -set_sampling sets by hashing",
+    "When -set_sampling is enabled, chooses the sampled sets by hashing the set "
+    "index, which avoids the aliasing with power-of-2 strided data that the "
+    "alternative, simulating every Nth set, is prone to.");
 
 droption_t<bytesize_t> op_page_size(DROPTION_SCOPE_FRONTEND, "page_size",
                                     bytesize_t(4 * 1024), "Virtual/physical page size",
@@ -500,6 +569,47 @@ droption_t<int>
                    "Limits analyis to the single "
                    "thread with the given identifier.  0 enables all threads.");
 
+droption_t<bool> op_core_sharded(
+    DROPTION_SCOPE_FRONTEND, "core_sharded", false,
+    "Analyze per-core shards in parallel",
+    "By default, parallel analysis operates on one shard per traced software thread.  "
+    "This option instead dynamically schedules the traced threads onto -cores "
+    "simulated cores and analyzes each core's sequence of records as its own shard "
+    "on its own worker thread.  Every tool must support parallel operation for this "
+    "mode; for the cache simulator it lets each core's private caches be simulated "
+    "concurrently.  The -jobs option is ignored in favor of -cores.  Online analysis "
+    "is not supported.");
+
+droption_t<bytesize_t> op_sched_quantum(
+    DROPTION_SCOPE_FRONTEND, "sched_quantum", 0,
+    "Scheduling quantum for -core_sharded",
+    "Specifies the number of instructions a software thread runs on a simulated core "
+    "before it may be switched out when -core_sharded is enabled.  0 uses the "
+    "scheduler's default quantum.");
+
+droption_t<unsigned int> op_time_slices(
+    DROPTION_SCOPE_FRONTEND, "time_slices", 0,
+    "Analyze one thread as this many parallel time slices",
+    "By default, parallel analysis operates on one shard per traced software thread, "
+    "so a single-threaded trace is analyzed by a single worker.  A non-zero value "
+    "instead splits the one thread in the trace (see -only_thread for selecting one "
+    "from a multi-threaded trace) by instruction ordinal into this many consecutive "
+    "slices which are analyzed concurrently on up to -jobs workers and then "
+    "combined.  Each slice but the first is preceded by -time_slice_warmup_instrs "
+    "instructions which warm up state such as simulated caches but are otherwise "
+    "not counted.  Finding the slice boundaries and reaching each slice use the "
+    "trace reader's skipping, which is only fast for zipfile and zstd traces.  "
+    "Supported by the " BASIC_COUNTS ", " OPCODE_MIX ", and " CPU_CACHE " tools.  "
+    "Online analysis is not supported.");
+
+droption_t<bytesize_t> op_time_slice_warmup_instrs(
+    DROPTION_SCOPE_FRONTEND, "time_slice_warmup_instrs", 0,
+    "Warm-up instructions before each time slice",
+    "For -time_slices, the number of instructions preceding each slice other than "
+    "the first that are passed to the tools only to warm up their state.  For the "
+    "cache simulator this should be large enough to fill the last-level cache, as "
+    "each slice otherwise starts with empty caches.");
+
 droption_t<bytesize_t> op_skip_instrs(
     DROPTION_SCOPE_FRONTEND, "skip_instrs", 0, "Number of instructions to skip",
     "Specifies the number of instructions to skip in the beginning of the trace "
@@ -555,6 +665,14 @@ droption_t<std::string>
                    "Cache hierarchy configuration file",
                    "The full path to the cache hierarchy configuration file.");
 
+droption_t<unsigned int> op_sweep_threads(
+    DROPTION_SCOPE_FRONTEND, "sweep_threads", 1,
+    "Threads simulating a multi-hierarchy -config_file",
+    "When -config_file lists several independent cache hierarchies in hierarchy blocks, "
+    "the trace is read and decoded only once and every record is fed to each "
+    "hierarchy.  This many threads share the work, each simulating a subset of the "
+    "hierarchies.");
+
 // XXX: if we separate histogram + reuse_distance we should move this with them.
 droption_t<unsigned int>
     op_report_top(DROPTION_SCOPE_FRONTEND, "report_top", 10,
@@ -589,9 +707,38 @@ droption_t<unsigned int> op_reuse_distance_limit(
 droption_t<bool> op_reuse_verify_skip(
     DROPTION_SCOPE_FRONTEND, "reuse_verify_skip", false,
     "Use full list walks to verify the skip list results.",
-    "Verifies every skip list-calculated reuse distance with a full list walk. "
+    "Verifies every skip list-calculated reuse distance with a full list walk, or "
+    "with -reuse_fenwick_tree every tree-calculated distance with a full walk of "
+    "the tracked lines. "
     "This incurs significant additional overhead.  This option is only available "
     "in debug builds.");
+droption_t<bool> op_reuse_fenwick_tree(
+    DROPTION_SCOPE_FRONTEND, "reuse_fenwick_tree", false,
+    "Compute reuse distances with a Fenwick tree instead of a skip list.",
+    "Computes each reuse distance with a Fenwick tree over access times in time "
+    "logarithmic in the number of distinct cache lines, instead of walking a list to "
+    "the nearest skip node.  This is faster for traces with large footprints and "
+    "long reuse distances, and does not need -reuse_skip_dist to be tuned.  Combine "
+    "with -reuse_distance_limit 0 (the default) for exact results on any footprint.");
+droption_t<double> op_reuse_sample_rate(
+    DROPTION_SCOPE_FRONTEND, "reuse_sample_rate", 1.0,
+    "Fraction of cache lines to sample for approximate reuse distances.",
+    "If below 1.0, only the cache lines whose address hashes into a fixed subset "
+    "are tracked, and each sampled reuse distance and histogram count is scaled up "
+    "by the inverse of the rate to estimate the full histogram, in the style of "
+    "SHARDS.  The rate is rounded to the nearest power of two (1/2, 1/4, ...).  This "
+    "trades accuracy for much lower time and memory on traces with large "
+    "footprints; the error bound of the cumulative histogram percentages is "
+    "reported with the results.  Sampling implies -reuse_fenwick_tree.  The "
+    "per-line counts reported are for the sampled lines only.");
+droption_t<unsigned int> op_reuse_sample_max_lines(
+    DROPTION_SCOPE_FRONTEND, "reuse_sample_max_lines", 0,
+    "If nonzero, bounds the sampled cache lines tracked per shard.",
+    "Specifies the maximum number of sampled cache lines tracked per shard.  "
+    "Whenever a shard exceeds this count its sampling rate is halved and the lines "
+    "no longer sampled are dropped, bounding memory regardless of the trace "
+    "footprint.  The starting rate is given by -reuse_sample_rate.  Sampling "
+    "implies -reuse_fenwick_tree.");
 droption_t<double> op_reuse_histogram_bin_multiplier(
     DROPTION_SCOPE_FRONTEND, "reuse_histogram_bin_multiplier", 1.00,
     "When reporting histograms, grow bins geometrically by this multiplier.",
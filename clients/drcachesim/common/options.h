@@ -39,8 +39,17 @@
 #define REPLACE_POLICY_LRU "LRU"
 #define REPLACE_POLICY_LFU "LFU"
 #define REPLACE_POLICY_FIFO "FIFO"
+#define REPLACE_POLICY_TREE_PLRU "TREE_PLRU"
+#define REPLACE_POLICY_BIT_PLRU "BIT_PLRU"
+#define REPLACE_POLICY_SRRIP "SRRIP"
+#define REPLACE_POLICY_BRRIP "BRRIP"
+#define REPLACE_POLICY_DRRIP "DRRIP"
+#define REPLACE_POLICY_RANDOM "RANDOM"
 #define PREFETCH_POLICY_NEXTLINE "nextline"
 #define PREFETCH_POLICY_NONE "none"
+#define PREFETCH_POLICY_STRIDE "stride"
+#define PREFETCH_POLICY_STREAM "stream"
+#define PREFETCH_POLICY_IP_DELTA "ip_delta"
 #define CPU_CACHE "cache"
 #define MISS_ANALYZER "miss_analyzer"
 #define TLB "TLB"
@@ -62,6 +71,9 @@
 
 extern droption_t<bool> op_offline;
 extern droption_t<std::string> op_ipc_name;
+extern droption_t<bool> op_ipc_shm;
+extern droption_t<unsigned int> op_ipc_shm_rings;
+extern droption_t<bytesize_t> op_ipc_shm_ring_size;
 extern droption_t<std::string> op_outdir;
 extern droption_t<std::string> op_subdir_prefix;
 extern droption_t<std::string> op_infile;
@@ -99,9 +111,13 @@ extern droption_t<bytesize_t> op_retrace_every_instrs;
 extern droption_t<bool> op_split_windows;
 extern droption_t<bytesize_t> op_exit_after_tracing;
 extern droption_t<std::string> op_raw_compress;
+extern droption_t<unsigned int> op_async_writers;
 extern droption_t<bool> op_online_instr_types;
 extern droption_t<std::string> op_replace_policy;
 extern droption_t<std::string> op_data_prefetcher;
+extern droption_t<unsigned int> op_data_prefetch_degree;
+extern droption_t<unsigned int> op_set_sampling;
+extern droption_t<bool> op_set_sampling_hashed;
 extern droption_t<bytesize_t> op_page_size;
 extern droption_t<unsigned int> op_TLB_L1I_entries;
 extern droption_t<unsigned int> op_TLB_L1D_entries;
@@ -125,18 +141,26 @@ extern droption_t<std::string> op_tracer_alt;
 extern droption_t<std::string> op_tracer_ops;
 extern droption_t<bytesize_t> op_interval_microseconds;
 extern droption_t<int> op_only_thread;
+extern droption_t<bool> op_core_sharded;
+extern droption_t<bytesize_t> op_sched_quantum;
+extern droption_t<unsigned int> op_time_slices;
+extern droption_t<bytesize_t> op_time_slice_warmup_instrs;
 extern droption_t<bytesize_t> op_skip_instrs;
 extern droption_t<bytesize_t> op_skip_refs;
 extern droption_t<bytesize_t> op_warmup_refs;
 extern droption_t<double> op_warmup_fraction;
 extern droption_t<bytesize_t> op_sim_refs;
 extern droption_t<std::string> op_config_file;
+extern droption_t<unsigned int> op_sweep_threads;
 extern droption_t<unsigned int> op_report_top;
 extern droption_t<unsigned int> op_reuse_distance_threshold;
 extern droption_t<bool> op_reuse_distance_histogram;
 extern droption_t<unsigned int> op_reuse_skip_dist;
 extern droption_t<unsigned int> op_reuse_distance_limit;
 extern droption_t<bool> op_reuse_verify_skip;
+extern droption_t<bool> op_reuse_fenwick_tree;
+extern droption_t<double> op_reuse_sample_rate;
+extern droption_t<unsigned int> op_reuse_sample_max_lines;
 extern droption_t<double> op_reuse_histogram_bin_multiplier;
 extern droption_t<std::string> op_view_syntax;
 extern droption_t<std::string> op_record_function;
@@ -0,0 +1,262 @@
+/* **********************************************************
+ * Copyright (c) 2023 Google, Inc.  All rights reserved.
+ * **********************************************************/
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of Google, Inc. nor the names of its contributors may be
+ *   used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL VMWARE, INC. OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+
+#include "shm_ring.h"
+
+#include <string.h>
+
+namespace {
+
+const uint64_t SHM_RINGS_MAGIC = 0x73676e6972726d64ULL; // "drmrings"
+const uint32_t SHM_RINGS_VERSION = 1;
+const size_t SHM_RINGS_DATA_ALIGN = 4096;
+
+enum : uint32_t {
+    RING_FREE,
+    RING_CLAIMED,
+    // Released by its writer but not yet drained by the reader.
+    RING_CLOSED,
+};
+
+size_t
+align_forward(size_t value, size_t alignment)
+{
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+} // namespace
+
+struct shm_rings_t::header_t {
+    // Set last by create() so writers never see a partial layout.
+    std::atomic<uint64_t> magic;
+    uint32_t version;
+    uint32_t num_rings;
+    uint64_t ring_size;
+    std::atomic<uint32_t> num_writers;
+    std::atomic<uint32_t> ever_attached;
+};
+
+// The writer and reader each update their own cache line.
+struct shm_rings_t::ring_t {
+    alignas(64) std::atomic<uint32_t> state;
+    // Total bytes ever written and read.
+    alignas(64) std::atomic<uint64_t> head;
+    alignas(64) std::atomic<uint64_t> tail;
+};
+
+shm_rings_t::shm_rings_t()
+{
+    // Empty.
+}
+
+std::string
+shm_rings_t::get_path(const std::string &ipc_name)
+{
+    if (!ipc_name.empty() && ipc_name[0] == '/')
+        return ipc_name + ".shm";
+#ifdef ANDROID
+    return "/data/local/tmp/" + ipc_name + ".shm";
+#else
+    // A tmpfs directory keeps the pages from ever being written back to disk.
+    return "/dev/shm/" + ipc_name + ".shm";
+#endif
+}
+
+size_t
+shm_rings_t::get_data_offset(uint32_t num_rings)
+{
+    return align_forward(align_forward(sizeof(header_t), 64) + num_rings * sizeof(ring_t),
+                         SHM_RINGS_DATA_ALIGN);
+}
+
+size_t
+shm_rings_t::get_region_size(uint32_t num_rings, uint64_t ring_size)
+{
+    return get_data_offset(num_rings) + num_rings * static_cast<size_t>(ring_size);
+}
+
+shm_rings_t::ring_t *
+shm_rings_t::get_ring(uint32_t index) const
+{
+    return reinterpret_cast<ring_t *>(reinterpret_cast<char *>(header_) +
+                                      align_forward(sizeof(header_t), 64)) +
+        index;
+}
+
+char *
+shm_rings_t::get_data(uint32_t index) const
+{
+    return reinterpret_cast<char *>(header_) + get_data_offset(header_->num_rings) +
+        index * static_cast<size_t>(header_->ring_size);
+}
+
+bool
+shm_rings_t::create(void *base, size_t size, uint32_t num_rings, uint64_t ring_size)
+{
+    if (num_rings == 0 || ring_size == 0 || size < get_region_size(num_rings, ring_size))
+        return false;
+    header_ = static_cast<header_t *>(base);
+    header_->version = SHM_RINGS_VERSION;
+    header_->num_rings = num_rings;
+    header_->ring_size = ring_size;
+    header_->num_writers.store(0, std::memory_order_relaxed);
+    header_->ever_attached.store(0, std::memory_order_relaxed);
+    for (uint32_t i = 0; i < num_rings; ++i) {
+        ring_t *ring = get_ring(i);
+        ring->state.store(RING_FREE, std::memory_order_relaxed);
+        ring->head.store(0, std::memory_order_relaxed);
+        ring->tail.store(0, std::memory_order_relaxed);
+    }
+    header_->magic.store(SHM_RINGS_MAGIC, std::memory_order_release);
+    return true;
+}
+
+bool
+shm_rings_t::attach(void *base, size_t size)
+{
+    header_t *header = static_cast<header_t *>(base);
+    if (size < sizeof(header_t) ||
+        header->magic.load(std::memory_order_acquire) != SHM_RINGS_MAGIC ||
+        header->version != SHM_RINGS_VERSION ||
+        size < get_region_size(header->num_rings, header->ring_size))
+        return false;
+    header_ = header;
+    header_->num_writers.fetch_add(1);
+    header_->ever_attached.store(1);
+    return true;
+}
+
+void
+shm_rings_t::detach()
+{
+    if (header_ == nullptr)
+        return;
+    header_->num_writers.fetch_sub(1);
+    header_ = nullptr;
+}
+
+uint64_t
+shm_rings_t::get_ring_size() const
+{
+    return header_ == nullptr ? 0 : header_->ring_size;
+}
+
+int
+shm_rings_t::claim_ring()
+{
+    for (uint32_t i = 0; i < header_->num_rings; ++i) {
+        uint32_t expected = RING_FREE;
+        if (get_ring(i)->state.compare_exchange_strong(expected, RING_CLAIMED,
+                                                       std::memory_order_acq_rel))
+            return static_cast<int>(i);
+    }
+    return -1;
+}
+
+bool
+shm_rings_t::try_write(int index, const void *buf, size_t size)
+{
+    ring_t *ring = get_ring(index);
+    uint64_t ring_size = header_->ring_size;
+    uint64_t head = ring->head.load(std::memory_order_relaxed);
+    uint64_t tail = ring->tail.load(std::memory_order_acquire);
+    if (ring_size - (head - tail) < size)
+        return false;
+    char *data = get_data(index);
+    size_t offs = static_cast<size_t>(head % ring_size);
+    size_t first = static_cast<size_t>(ring_size) - offs;
+    if (first > size)
+        first = size;
+    memcpy(data + offs, buf, first);
+    memcpy(data, static_cast<const char *>(buf) + first, size - first);
+    ring->head.store(head + size, std::memory_order_release);
+    return true;
+}
+
+void
+shm_rings_t::release_ring(int index)
+{
+    get_ring(index)->state.store(RING_CLOSED, std::memory_order_release);
+}
+
+size_t
+shm_rings_t::read(void *buf, size_t size, bool *finished)
+{
+    *finished = false;
+    if (header_ == nullptr)
+        return 0;
+    uint32_t num_rings = header_->num_rings;
+    if (cur_ring_ < 0 ||
+        get_ring(cur_ring_)->tail.load(std::memory_order_relaxed) == cur_limit_) {
+        // Check for exited writers before looking for data so that we cannot
+        // miss a final write.
+        bool writers_gone = header_->ever_attached.load() != 0 &&
+            header_->num_writers.load() == 0;
+        int next = -1;
+        for (uint32_t i = 1; i <= num_rings; ++i) {
+            uint32_t index = (static_cast<uint32_t>(cur_ring_ + 1) + i - 1) % num_rings;
+            ring_t *ring = get_ring(index);
+            uint32_t state = ring->state.load(std::memory_order_acquire);
+            if (state == RING_FREE)
+                continue;
+            uint64_t head = ring->head.load(std::memory_order_acquire);
+            if (head != ring->tail.load(std::memory_order_relaxed)) {
+                next = static_cast<int>(index);
+                // Stop at the current end of this ring's writes.
+                cur_limit_ = head;
+                break;
+            }
+            if (state == RING_CLOSED)
+                ring->state.store(RING_FREE, std::memory_order_release);
+        }
+        if (next < 0) {
+            *finished = writers_gone;
+            return 0;
+        }
+        cur_ring_ = next;
+    }
+    ring_t *ring = get_ring(cur_ring_);
+    uint64_t ring_size = header_->ring_size;
+    uint64_t tail = ring->tail.load(std::memory_order_relaxed);
+    if (size > cur_limit_ - tail)
+        size = static_cast<size_t>(cur_limit_ - tail);
+    const char *data = get_data(cur_ring_);
+    size_t offs = static_cast<size_t>(tail % ring_size);
+    size_t first = static_cast<size_t>(ring_size) - offs;
+    if (first > size)
+        first = size;
+    memcpy(buf, data + offs, first);
+    memcpy(static_cast<char *>(buf) + first, data, size - first);
+    ring->tail.store(tail + size, std::memory_order_release);
+    return size;
+}
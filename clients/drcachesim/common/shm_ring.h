@@ -0,0 +1,112 @@
+/* **********************************************************
+ * Copyright (c) 2023 Google, Inc.  All rights reserved.
+ * **********************************************************/
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of Google, Inc. nor the names of its contributors may be
+ *   used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL VMWARE, INC. OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+
+/* shm_ring: single-producer single-consumer byte rings in a memory region
+ * shared between traced processes and an online analyzer.
+ */
+
+#ifndef _SHM_RING_H_
+#define _SHM_RING_H_ 1
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+// Usage is as follows:
+// + The reader lays out a new region of get_region_size() bytes with
+//   create() and keeps it mapped until it has consumed everything.
+// + Each writer process maps the same region, calls attach() up front and
+//   detach() at exit.
+// + Each writer thread claims its own ring with claim_ring(), writes to it
+//   with try_write(), and hands it back with release_ring() when it exits.
+// A write is never split: the reader only switches rings at write boundaries,
+// so each write must be self-describing (e.g., start with a unit header).
+class shm_rings_t {
+public:
+    shm_rings_t();
+
+    // Returns the path of the file backing the region for the given
+    // -ipc_name, which is treated like a named_pipe_t name.
+    static std::string
+    get_path(const std::string &ipc_name);
+
+    static size_t
+    get_region_size(uint32_t num_rings, uint64_t ring_size);
+
+    // Lays out a new region.  The region must be zeroed.
+    bool
+    create(void *base, size_t size, uint32_t num_rings, uint64_t ring_size);
+    // Validates an existing region created by another process.
+    bool
+    attach(void *base, size_t size);
+    void
+    detach();
+
+    uint64_t
+    get_ring_size() const;
+
+    // Writer side.  Returns the claimed ring or -1 if all rings are in use.
+    int
+    claim_ring();
+    // Returns false without writing if the ring lacks space, in which case the
+    // caller should wait for the reader.
+    bool
+    try_write(int ring, const void *buf, size_t size);
+    void
+    release_ring(int ring);
+
+    // Reader side.  Copies up to "size" bytes from the current write of some
+    // ring, visiting the rings round-robin.  Returns 0 if there is nothing to
+    // read right now, and sets "finished" if nothing more will ever arrive.
+    size_t
+    read(void *buf, size_t size, bool *finished);
+
+private:
+    struct header_t;
+    struct ring_t;
+
+    static size_t
+    get_data_offset(uint32_t num_rings);
+    ring_t *
+    get_ring(uint32_t index) const;
+    char *
+    get_data(uint32_t index) const;
+
+    header_t *header_ = nullptr;
+    // Reader state.
+    int cur_ring_ = -1;
+    uint64_t cur_limit_ = 0;
+};
+
+#endif /* _SHM_RING_H_ */
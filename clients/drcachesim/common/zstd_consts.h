@@ -0,0 +1,81 @@
+/* **********************************************************
+ * Copyright (c) 2023 Google, Inc.  All rights reserved.
+ * **********************************************************/
+
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of Google, Inc. nor the names of its contributors may be
+ *   used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL VMWARE, INC. OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+
+/*
+ * zstd_consts: the layout shared between the reader and writer of seekable zstd
+ * trace files.
+ *
+ * A file is a sequence of independent zstd frames, each holding whole trace_entry_t
+ * records and normally one trace chunk, followed by a zstd skippable frame holding
+ * an index of the data frames.  Since the index is in a skippable frame, the stock
+ * zstd tool decompresses the file into the plain sequence of records.  The
+ * skippable frame's payload is an array of zstd_frame_entry_t, one per data frame
+ * in file order, followed by a zstd_index_footer_t which thus ends the file.
+ */
+
+#ifndef _ZSTD_CONSTS_H_
+#define _ZSTD_CONSTS_H_ 1
+
+#include <stdint.h>
+
+// Describes one data frame.  All fields are in host byte order, like the records.
+struct zstd_frame_entry_t {
+    // The file offset of the start of the frame.
+    uint64_t offset;
+    uint64_t compressed_size;
+    uint64_t uncompressed_size;
+    // The number of instructions in the file prior to this frame.
+    uint64_t first_instr;
+    // The first timestamp in the frame, or if it has none the last one before it.
+    uint64_t first_timestamp;
+};
+
+struct zstd_index_footer_t {
+    uint64_t num_frames;
+    uint32_t version;
+    uint32_t magic;
+};
+
+class zstd_consts_t {
+protected:
+    // Skippable frames start with a magic number in [0x184D2A50, 0x184D2A5F]
+    // followed by the 32-bit payload size.
+    static constexpr uint32_t skippable_magic_ = 0x184D2A5E;
+    static constexpr uint32_t skippable_header_size_ = 2 * sizeof(uint32_t);
+    // "DRZS" in little-endian byte order.
+    static constexpr uint32_t index_magic_ = 0x535a5244;
+    static constexpr uint32_t index_version_ = 1;
+};
+
+#endif /* _ZSTD_CONSTS_H_ */
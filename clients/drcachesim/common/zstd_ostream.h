@@ -0,0 +1,269 @@
+/* **********************************************************
+ * Copyright (c) 2023 Google, Inc.  All rights reserved.
+ * **********************************************************/
+
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of Google, Inc. nor the names of its contributors may be
+ *   used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL VMWARE, INC. OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+
+// zstd_ostream_t: an instance of archive_ostream_t writing seekable zstd trace
+// files, as described in zstd_consts.h.  The docs for the zstd streaming API are
+// in the header file: https://github.com/facebook/zstd/blob/dev/lib/zstd.h
+
+#ifndef _ZSTD_OSTREAM_H_
+#define _ZSTD_OSTREAM_H_ 1
+
+#ifndef HAS_ZSTD
+#    error HAS_ZSTD is required
+#endif
+
+#include <string.h>
+#include <fstream>
+#include <iostream>
+#include <vector>
+#include <zstd.h>
+#include "archive_ostream.h"
+#include "trace_entry.h"
+#include "zstd_consts.h"
+
+// Like zipfile_streambuf_t, this overrides the stream buffer where the file
+// writes happen.  Each component becomes its own zstd frame.  Since the writer
+// may not know about components, as with record_filter output, a frame is also
+// ended after each chunk footer record.  The records are examined as they go by to
+// fill in the instruction and timestamp fields of the index.
+class zstd_streambuf_t : public std::basic_streambuf<char, std::char_traits<char>>,
+                         public zstd_consts_t {
+public:
+    zstd_streambuf_t(const std::string &path, int level)
+    {
+        file_.open(path, std::ofstream::binary);
+        if (!file_)
+            return;
+        cctx_ = ZSTD_createCCtx();
+        if (cctx_ == nullptr ||
+            ZSTD_isError(ZSTD_CCtx_setParameter(cctx_, ZSTD_c_compressionLevel, level)))
+            return;
+        out_buf_.resize(ZSTD_CStreamOutSize());
+        buf_ = new char[buffer_size_];
+        // We leave an extra slot for extra_char on overflow.
+        setp(buf_, buf_ + buffer_size_ - 1);
+    }
+    ~zstd_streambuf_t() override
+    {
+        if (buf_ != nullptr) {
+            sync();
+            if (!end_frame() || !write_index()) {
+#ifdef DEBUG
+                // Let's at least have something visible in debug build.
+                std::cerr << "zstd_ostream failed to finish file\n";
+#endif
+            }
+        }
+        delete[] buf_;
+        ZSTD_freeCCtx(cctx_);
+    }
+    bool
+    is_open() const
+    {
+        return buf_ != nullptr;
+    }
+    int
+    overflow(int extra_char) override
+    {
+        if (buf_ == nullptr)
+            return traits_type::eof();
+        if (extra_char != traits_type::eof()) {
+            // Put the extra char into the buffer.  We left an extra slot for it.
+            *pptr() = traits_type::to_char_type(extra_char);
+            pbump(1);
+        }
+        int res = traits_type::not_eof(extra_char);
+        const char *data = pbase();
+        size_t size = pptr() - pbase();
+        while (size > 0) {
+            bool at_chunk_end;
+            size_t len = scan_records(data, size, &at_chunk_end);
+            if (!compress(data, len, ZSTD_e_continue) || (at_chunk_end && !end_frame())) {
+                res = traits_type::eof();
+                break;
+            }
+            data += len;
+            size -= len;
+        }
+        setp(buf_, buf_ + buffer_size_ - 1);
+        return res;
+    }
+    int
+    sync() override
+    {
+        return overflow(traits_type::eof());
+    }
+    std::string
+    open_new_component(const std::string &name)
+    {
+        // The name is not recorded: frames are identified by their position.
+        if (sync() == traits_type::eof() || !end_frame())
+            return "Failed to end prior zstd frame";
+        return "";
+    }
+
+private:
+    // Feeds trace_entry_t records to observe_record(), carrying a partial record
+    // over to the next call.  Returns the length of the prefix of data up to and
+    // including the first chunk footer, setting *at_chunk_end, or else size.
+    size_t
+    scan_records(const char *data, size_t size, bool *at_chunk_end)
+    {
+        *at_chunk_end = false;
+        size_t pos = 0;
+        while (pos < size) {
+            size_t take = sizeof(trace_entry_t) - carry_size_;
+            if (take > size - pos)
+                take = size - pos;
+            memcpy(carry_ + carry_size_, data + pos, take);
+            carry_size_ += take;
+            pos += take;
+            if (carry_size_ < sizeof(trace_entry_t))
+                break;
+            carry_size_ = 0;
+            trace_entry_t entry;
+            memcpy(&entry, carry_, sizeof(entry));
+            if (type_is_instr(static_cast<trace_type_t>(entry.type)))
+                ++instr_count_;
+            else if (entry.type == TRACE_TYPE_INSTR_BUNDLE)
+                instr_count_ += entry.size;
+            else if (entry.type == TRACE_TYPE_MARKER) {
+                if (entry.size == TRACE_MARKER_TYPE_TIMESTAMP) {
+                    last_timestamp_ = entry.addr;
+                    if (!frame_has_timestamp_) {
+                        frame_has_timestamp_ = true;
+                        frame_.first_timestamp = entry.addr;
+                    }
+                } else if (entry.size == TRACE_MARKER_TYPE_CHUNK_FOOTER) {
+                    *at_chunk_end = true;
+                    return pos;
+                }
+            }
+        }
+        return pos;
+    }
+    bool
+    compress(const char *data, size_t size, ZSTD_EndDirective mode)
+    {
+        frame_.uncompressed_size += size;
+        ZSTD_inBuffer input = { data, size, 0 };
+        size_t remaining;
+        do {
+            ZSTD_outBuffer output = { out_buf_.data(), out_buf_.size(), 0 };
+            remaining = ZSTD_compressStream2(cctx_, &output, &input, mode);
+            if (ZSTD_isError(remaining))
+                return false;
+            if (output.pos > 0 &&
+                !file_.write(out_buf_.data(), static_cast<std::streamsize>(output.pos)))
+                return false;
+            written_ += output.pos;
+            // With ZSTD_e_end we loop until the frame is entirely flushed.
+        } while (mode == ZSTD_e_end ? remaining != 0 : input.pos < input.size);
+        return true;
+    }
+    // Closes the current frame and adds it to the index, unless it is empty.
+    bool
+    end_frame()
+    {
+        if (frame_.uncompressed_size == 0)
+            return true;
+        if (!compress(nullptr, 0, ZSTD_e_end))
+            return false;
+        frame_.compressed_size = written_ - frame_.offset;
+        frames_.push_back(frame_);
+        frame_.offset = written_;
+        frame_.uncompressed_size = 0;
+        frame_.first_instr = instr_count_;
+        frame_.first_timestamp = last_timestamp_;
+        frame_has_timestamp_ = false;
+        return true;
+    }
+    bool
+    write_index()
+    {
+        zstd_index_footer_t footer;
+        footer.num_frames = frames_.size();
+        footer.version = index_version_;
+        footer.magic = index_magic_;
+        uint32_t header[2];
+        header[0] = skippable_magic_;
+        header[1] = static_cast<uint32_t>(frames_.size() * sizeof(zstd_frame_entry_t) +
+                                          sizeof(footer));
+        return file_.write(reinterpret_cast<const char *>(header), sizeof(header)) &&
+            (frames_.empty() ||
+             file_.write(reinterpret_cast<const char *>(frames_.data()),
+                         frames_.size() * sizeof(zstd_frame_entry_t))) &&
+            file_.write(reinterpret_cast<const char *>(&footer), sizeof(footer)) &&
+            file_.flush();
+    }
+
+    static const int buffer_size_ = 4096 * sizeof(trace_entry_t);
+    std::ofstream file_;
+    ZSTD_CCtx *cctx_ = nullptr;
+    char *buf_ = nullptr;
+    std::vector<char> out_buf_;
+    uint64_t written_ = 0;
+    char carry_[sizeof(trace_entry_t)];
+    size_t carry_size_ = 0;
+    uint64_t instr_count_ = 0;
+    uint64_t last_timestamp_ = 0;
+    // The frame being written.
+    zstd_frame_entry_t frame_ = {};
+    bool frame_has_timestamp_ = false;
+    std::vector<zstd_frame_entry_t> frames_;
+};
+
+class zstd_ostream_t : public archive_ostream_t {
+public:
+    explicit zstd_ostream_t(const std::string &path,
+                            int level = ZSTD_CLEVEL_DEFAULT)
+        : archive_ostream_t(new zstd_streambuf_t(path, level))
+    {
+        zstd_streambuf_t *zbuf = reinterpret_cast<zstd_streambuf_t *>(rdbuf());
+        if (!zbuf->is_open())
+            setstate(std::ios::badbit);
+    }
+    ~zstd_ostream_t() override
+    {
+        delete rdbuf();
+    }
+    std::string
+    open_new_component(const std::string &name) override
+    {
+        zstd_streambuf_t *zbuf = reinterpret_cast<zstd_streambuf_t *>(rdbuf());
+        return zbuf->open_new_component(name);
+    }
+};
+
+#endif /* _ZSTD_OSTREAM_H_ */
@@ -45,8 +45,48 @@ config_reader_t::configure(std::istream *config_file, cache_simulator_knobs_t &k
                            std::map<std::string, cache_params_t> &caches)
 {
     fin_ = config_file;
+    std::vector<cache_hierarchy_params_t> hierarchies;
+    if (!configure_hierarchy(knobs, caches, &hierarchies))
+        return false;
+    if (!hierarchies.empty()) {
+        ERRMSG("Hierarchy blocks require a simulator that supports multiple "
+               "hierarchies\n");
+        return false;
+    }
+
+    // Check cache configuration.
+    return check_cache_config(knobs.num_cores, caches);
+}
+
+bool
+config_reader_t::configure(std::istream *config_file,
+                           std::vector<cache_hierarchy_params_t> &hierarchies)
+{
+    fin_ = config_file;
+    hierarchies.clear();
+    cache_simulator_knobs_t knobs;
+    std::map<std::string, cache_params_t> caches;
+    if (!configure_hierarchy(knobs, caches, &hierarchies))
+        return false;
+    if (hierarchies.empty()) {
+        // A plain single-hierarchy file.
+        if (!check_cache_config(knobs.num_cores, caches))
+            return false;
+        cache_hierarchy_params_t hierarchy;
+        hierarchy.knobs = knobs;
+        hierarchy.caches = caches;
+        hierarchies.push_back(hierarchy);
+    }
+    return true;
+}
 
-    // Walk through the configuration file.
+bool
+config_reader_t::configure_hierarchy(cache_simulator_knobs_t &knobs,
+                                     std::map<std::string, cache_params_t> &caches,
+                                     std::vector<cache_hierarchy_params_t> *hierarchies)
+{
+    // Walk through the configuration file, or through one hierarchy block
+    // if hierarchies is nullptr.
     while (!fin_->eof()) {
         std::string param;
 
@@ -55,6 +95,14 @@ config_reader_t::configure(std::istream *config_file, cache_simulator_knobs_t &k
             return false;
         }
 
+        if (hierarchies == nullptr && param == "}")
+            return true;
+        if (hierarchies != nullptr && !hierarchies->empty() && param != "//" &&
+            param != "hierarchy") {
+            ERRMSG("Global settings must precede the first hierarchy block\n");
+            return false;
+        }
+
         if (param == "//") {
             // A comment.
             if (!getline(*fin_, param)) {
@@ -145,6 +193,29 @@ config_reader_t::configure(std::istream *config_file, cache_simulator_knobs_t &k
             } else {
                 knobs.model_coherence = false;
             }
+        } else if (param == "set_sampling") {
+            // Simulate only 1 in this many cache sets.
+            if (!(*fin_ >> knobs.set_sampling)) {
+                ERRMSG("Error reading set_sampling from the configuration file\n");
+                return false;
+            }
+            if (!IS_POWER_OF_2(knobs.set_sampling)) {
+                ERRMSG("Set sampling rate must be a power of 2\n");
+                return false;
+            }
+        } else if (param == "set_sampling_hashed") {
+            // Whether to choose the sampled sets by hashing.
+            std::string bool_val;
+            if (!(*fin_ >> bool_val)) {
+                ERRMSG("Error reading set_sampling_hashed from "
+                       "the configuration file\n");
+                return false;
+            }
+            if (is_true(bool_val)) {
+                knobs.set_sampling_hashed = true;
+            } else {
+                knobs.set_sampling_hashed = false;
+            }
         } else if (param == "use_physical") {
             // Whether to use physical addresses
             std::string bool_val;
@@ -157,6 +228,37 @@ config_reader_t::configure(std::istream *config_file, cache_simulator_knobs_t &k
             } else {
                 knobs.use_physical = false;
             }
+        } else if (param == "hierarchy") {
+            // An independent hierarchy, starting from the global settings so far.
+            if (hierarchies == nullptr) {
+                ERRMSG("Hierarchy blocks cannot be nested\n");
+                return false;
+            }
+            if (!caches.empty()) {
+                ERRMSG("Caches must be inside hierarchy blocks when any are used\n");
+                return false;
+            }
+            cache_hierarchy_params_t hierarchy;
+            if (!(*fin_ >> hierarchy.name)) {
+                ERRMSG("Error reading hierarchy name from the configuration file\n");
+                return false;
+            }
+            for (const auto &other : *hierarchies) {
+                if (other.name == hierarchy.name) {
+                    ERRMSG("Duplicate hierarchy name %s\n", hierarchy.name.c_str());
+                    return false;
+                }
+            }
+            char c;
+            if (!(*fin_ >> ws >> c) || c != '{') {
+                ERRMSG("Expected '{' before hierarchy params\n");
+                return false;
+            }
+            hierarchy.knobs = knobs;
+            if (!configure_hierarchy(hierarchy.knobs, hierarchy.caches, nullptr) ||
+                !check_cache_config(hierarchy.knobs.num_cores, hierarchy.caches))
+                return false;
+            hierarchies->push_back(hierarchy);
         } else {
             // A cache unit.
             cache_params_t cache;
@@ -173,8 +275,11 @@ config_reader_t::configure(std::istream *config_file, cache_simulator_knobs_t &k
         }
     }
 
-    // Check cache configuration.
-    return check_cache_config(knobs.num_cores, caches);
+    if (hierarchies == nullptr) {
+        ERRMSG("Expected '}' at the end of hierarchy params\n");
+        return false;
+    }
+    return true;
 }
 
 bool
@@ -278,7 +383,9 @@ config_reader_t::configure_cache(cache_params_t &cache)
             }
         } else if (param == "replace_policy") {
             // Cache replacement policy: REPLACE_POLICY_LRU (default),
-            // REPLACE_POLICY_LFU or REPLACE_POLICY_FIFO.
+            // REPLACE_POLICY_LFU, REPLACE_POLICY_FIFO, REPLACE_POLICY_TREE_PLRU,
+            // REPLACE_POLICY_BIT_PLRU, REPLACE_POLICY_SRRIP, REPLACE_POLICY_BRRIP,
+            // REPLACE_POLICY_DRRIP, or REPLACE_POLICY_RANDOM.
             if (!(*fin_ >> cache.replace_policy)) {
                 ERRMSG("Error reading cache replace_policy from "
                        "the configuration file\n");
@@ -287,12 +394,19 @@ config_reader_t::configure_cache(cache_params_t &cache)
             if (cache.replace_policy != REPLACE_POLICY_NON_SPECIFIED &&
                 cache.replace_policy != REPLACE_POLICY_LRU &&
                 cache.replace_policy != REPLACE_POLICY_LFU &&
-                cache.replace_policy != REPLACE_POLICY_FIFO) {
+                cache.replace_policy != REPLACE_POLICY_FIFO &&
+                cache.replace_policy != REPLACE_POLICY_TREE_PLRU &&
+                cache.replace_policy != REPLACE_POLICY_BIT_PLRU &&
+                cache.replace_policy != REPLACE_POLICY_SRRIP &&
+                cache.replace_policy != REPLACE_POLICY_BRRIP &&
+                cache.replace_policy != REPLACE_POLICY_DRRIP &&
+                cache.replace_policy != REPLACE_POLICY_RANDOM) {
                 ERRMSG("Unknown replacement policy: %s\n", cache.replace_policy.c_str());
                 return false;
             }
         } else if (param == "prefetcher") {
-            // Type of prefetcher: PREFETCH_POLICY_NEXTLINE
+            // Type of prefetcher: PREFETCH_POLICY_NEXTLINE, PREFETCH_POLICY_STRIDE,
+            // PREFETCH_POLICY_STREAM, PREFETCH_POLICY_IP_DELTA,
             // or PREFETCH_POLICY_NONE.
             if (!(*fin_ >> cache.prefetcher)) {
                 ERRMSG("Error reading cache prefetcher from "
@@ -300,10 +414,24 @@ config_reader_t::configure_cache(cache_params_t &cache)
                 return false;
             }
             if (cache.prefetcher != PREFETCH_POLICY_NEXTLINE &&
+                cache.prefetcher != PREFETCH_POLICY_STRIDE &&
+                cache.prefetcher != PREFETCH_POLICY_STREAM &&
+                cache.prefetcher != PREFETCH_POLICY_IP_DELTA &&
                 cache.prefetcher != PREFETCH_POLICY_NONE) {
                 ERRMSG("Unknown prefetcher type: %s\n", cache.prefetcher.c_str());
                 return false;
             }
+        } else if (param == "prefetch_degree") {
+            // Number of lines the prefetcher fetches per trigger.
+            if (!(*fin_ >> cache.prefetch_degree)) {
+                ERRMSG("Error reading cache prefetch_degree from "
+                       "the configuration file\n");
+                return false;
+            }
+            if (cache.prefetch_degree <= 0) {
+                ERRMSG("Cache prefetch_degree (%u) must be >0\n", cache.prefetch_degree);
+                return false;
+            }
         } else if (param == "miss_file") {
             // Name of the file to use to dump cache misses info.
             if (!(*fin_ >> cache.miss_file)) {
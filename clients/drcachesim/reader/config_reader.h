@@ -40,6 +40,7 @@
 #include <fstream>
 #include <map>
 #include <string>
+#include <vector>
 
 #include "../common/options.h"
 #include "../simulator/cache.h"
@@ -58,6 +59,7 @@ struct cache_params_t {
         , parent(CACHE_PARENT_MEMORY)
         , replace_policy(REPLACE_POLICY_LRU)
         , prefetcher(PREFETCH_POLICY_NONE)
+        , prefetch_degree(1)
         , miss_file("")
     {
     }
@@ -86,20 +88,47 @@ struct cache_params_t {
     // Type of prefetcher as described by the runtime option
     // op_data_prefetcher (see ../common/options.cpp).
     std::string prefetcher;
+    // Number of lines the prefetcher fetches per trigger, as described by the
+    // runtime option op_data_prefetch_degree.
+    unsigned int prefetch_degree;
     // Name of the file to use to dump cache misses info.
     std::string miss_file;
 };
 
+// One of several independent cache hierarchies in a configuration file.
+struct cache_hierarchy_params_t {
+    // Name given by the file's "hierarchy <name> { ... }" block, or empty for a
+    // file describing a single hierarchy without any block.
+    std::string name;
+    // Global settings preceding the first block, as overridden inside the block.
+    cache_simulator_knobs_t knobs;
+    std::map<std::string, cache_params_t> caches;
+};
+
 class config_reader_t {
 public:
     config_reader_t();
+    // Reads a file describing a single hierarchy.
     bool
     configure(std::istream *config_file, cache_simulator_knobs_t &knobs,
               std::map<std::string, cache_params_t> &caches);
+    // Reads a file that may list several independent hierarchies, each in its
+    // own "hierarchy <name> { ... }" block.  A file without blocks yields a
+    // single unnamed hierarchy.
+    bool
+    configure(std::istream *config_file,
+              std::vector<cache_hierarchy_params_t> &hierarchies);
 
 private:
     std::istream *fin_;
 
+    // Reads settings and caches until the end of the file or, if hierarchies
+    // is nullptr, until the '}' closing a hierarchy block.
+    bool
+    configure_hierarchy(cache_simulator_knobs_t &knobs,
+                        std::map<std::string, cache_params_t> &caches,
+                        std::vector<cache_hierarchy_params_t> *hierarchies);
+
     bool
     configure_cache(cache_params_t &cache);
     bool
@@ -0,0 +1,194 @@
+/* **********************************************************
+ * Copyright (c) 2023 Google, Inc.  All rights reserved.
+ * **********************************************************/
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of Google, Inc. nor the names of its contributors may be
+ *   used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL VMWARE, INC. OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "mmap_file_reader.h"
+
+bool
+mmap_region_t::map(const std::string &path)
+{
+    unmap();
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return false;
+    }
+    // An empty file is an empty stream, but mmap rejects a zero length.
+    if (st.st_size == 0) {
+        close(fd);
+        return true;
+    }
+    // The mapping remains valid after we close the descriptor.
+    void *map = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+        return false;
+    // Traces are consumed front to back: ask for aggressive read-ahead and for
+    // pages behind us to be dropped early.
+    madvise(map, st.st_size, MADV_SEQUENTIAL);
+    base = static_cast<char *>(map);
+    size = st.st_size;
+    return true;
+}
+
+void
+mmap_region_t::unmap()
+{
+    if (base != nullptr) {
+        munmap(base, size);
+        base = nullptr;
+        size = 0;
+    }
+}
+
+namespace {
+
+/**************************************************************************
+ * Common logic used in the mmap_reader_t specializations for file_reader_t
+ * and record_file_reader_t.
+ */
+
+bool
+open_single_file_common(const std::string &path, mmap_reader_t *reader)
+{
+    if (!reader->region.map(path))
+        return false;
+    reader->cur = reinterpret_cast<const trace_entry_t *>(reader->region.base);
+    // A partial trailing record is treated as truncation and ignored.
+    reader->end = reader->cur + reader->region.size / sizeof(trace_entry_t);
+    return true;
+}
+
+} // namespace
+
+/**************************************************************************
+ * mmap_reader_t specializations for file_reader_t.
+ */
+
+/* clang-format off */ /* (make vera++ newline-after-type check happy) */
+template <>
+/* clang-format on */
+file_reader_t<mmap_reader_t>::file_reader_t()
+{
+}
+
+/* clang-format off */ /* (make vera++ newline-after-type check happy) */
+template <>
+/* clang-format on */
+file_reader_t<mmap_reader_t>::~file_reader_t()
+{
+}
+
+template <>
+bool
+file_reader_t<mmap_reader_t>::open_single_file(const std::string &path)
+{
+    if (!open_single_file_common(path, &input_file_))
+        return false;
+    VPRINT(this, 1, "Opened input file %s\n", path.c_str());
+    return true;
+}
+
+template <>
+trace_entry_t *
+file_reader_t<mmap_reader_t>::read_next_entry()
+{
+    trace_entry_t *from_queue = read_queued_entry();
+    if (from_queue != nullptr)
+        return from_queue;
+    const trace_entry_t *entry = input_file_.next_entry();
+    if (entry == nullptr) {
+        VPRINT(this, 2, "Hit EOF\n");
+        at_eof_ = true;
+        return nullptr;
+    }
+    VPRINT(this, 4, "Read: type=%s (%d), size=%d, addr=%zu\n",
+           trace_type_names[entry->type], entry->type, entry->size, entry->addr);
+    if (mmap_needs_copy(entry)) {
+        entry_copy_ = *entry;
+        return &entry_copy_;
+    }
+    // We hand out a pointer into the mapping rather than a copy.  reader_t only
+    // reads it unless mmap_needs_copy() says otherwise.
+    return const_cast<trace_entry_t *>(entry);
+}
+
+namespace dynamorio {
+namespace drmemtrace {
+
+/**************************************************************************
+ * mmap_reader_t specializations for record_file_reader_t.
+ */
+
+/* clang-format off */ /* (make vera++ newline-after-type check happy) */
+template <>
+/* clang-format on */
+record_file_reader_t<mmap_reader_t>::~record_file_reader_t<mmap_reader_t>()
+{
+}
+
+template <>
+bool
+record_file_reader_t<mmap_reader_t>::open_single_file(const std::string &path)
+{
+    std::unique_ptr<mmap_reader_t> reader(new mmap_reader_t());
+    if (!open_single_file_common(path, reader.get()))
+        return false;
+    VPRINT(this, 1, "Opened input file %s\n", path.c_str());
+    input_file_ = std::move(reader);
+    return true;
+}
+
+template <>
+bool
+record_file_reader_t<mmap_reader_t>::read_next_entry()
+{
+    const trace_entry_t *entry = input_file_->next_entry();
+    if (entry == nullptr) {
+        eof_ = true;
+        return false;
+    }
+    cur_entry_ = *entry;
+    VPRINT(this, 4, "Read from file: type=%s (%d), size=%d, addr=%zu\n",
+           trace_type_names[cur_entry_.type], cur_entry_.type, cur_entry_.size,
+           cur_entry_.addr);
+    return true;
+}
+
+} // namespace drmemtrace
+} // namespace dynamorio
@@ -0,0 +1,105 @@
+/* **********************************************************
+ * Copyright (c) 2023 Google, Inc.  All rights reserved.
+ * **********************************************************/
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of Google, Inc. nor the names of its contributors may be
+ *   used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL VMWARE, INC. OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+/* mmap_file_reader: reads uncompressed files containing memory traces by mapping
+ * them into memory and handing out records in place.
+ */
+
+#ifndef _MMAP_FILE_READER_H_
+#define _MMAP_FILE_READER_H_ 1
+
+#include <string>
+#include "file_reader.h"
+#include "record_file_reader.h"
+
+/**
+ * A read-only view of an entire file mapped into memory.  An empty file maps
+ * successfully with a null base and zero size.  Readers handing out records in
+ * place must copy any record that reader_t will modify (see
+ * mmap_needs_copy()).
+ */
+struct mmap_region_t {
+    mmap_region_t()
+        : base(nullptr)
+        , size(0)
+    {
+    }
+    ~mmap_region_t()
+    {
+        unmap();
+    }
+    bool
+    map(const std::string &path);
+    void
+    unmap();
+    char *base;
+    size_t size;
+
+private:
+    mmap_region_t(const mmap_region_t &) = delete;
+    mmap_region_t &
+    operator=(const mmap_region_t &) = delete;
+};
+
+struct mmap_reader_t {
+    mmap_reader_t()
+        : cur(nullptr)
+        , end(nullptr)
+    {
+    }
+    // Returns the next record in place, or nullptr at the end of the file.  The
+    // record remains valid until this reader is destroyed.
+    const trace_entry_t *
+    next_entry()
+    {
+        if (cur >= end)
+            return nullptr;
+        return cur++;
+    }
+    mmap_region_t region;
+    const trace_entry_t *cur;
+    const trace_entry_t *end;
+};
+
+// Returns whether reader_t rewrites this type of record in place, in which case
+// it cannot be handed out from a read-only mapping.
+static inline bool
+mmap_needs_copy(const trace_entry_t *entry)
+{
+    return entry->type == TRACE_TYPE_INSTR_MAYBE_FETCH;
+}
+
+typedef file_reader_t<mmap_reader_t> mmap_file_reader_t;
+typedef dynamorio::drmemtrace::record_file_reader_t<mmap_reader_t>
+    mmap_record_file_reader_t;
+
+#endif /* _MMAP_FILE_READER_H_ */
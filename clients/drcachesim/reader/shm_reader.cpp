@@ -0,0 +1,155 @@
+/* **********************************************************
+ * Copyright (c) 2023 Google, Inc.  All rights reserved.
+ * **********************************************************/
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of Google, Inc. nor the names of its contributors may be
+ *   used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL VMWARE, INC. OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+
+#include "shm_reader.h"
+
+#include <chrono>
+#include <thread>
+#ifdef UNIX
+#    include <fcntl.h>
+#    include <sys/mman.h>
+#    include <sys/stat.h>
+#    include <unistd.h>
+#endif
+#include "../common/utils.h"
+
+shm_reader_t::shm_reader_t()
+{
+    /* Empty. */
+}
+
+shm_reader_t::shm_reader_t(const char *ipc_name, uint32_t num_rings, uint64_t ring_size,
+                           int verbosity)
+    : reader_t(verbosity, "SHM")
+    , path_(shm_rings_t::get_path(ipc_name))
+{
+#ifdef UNIX
+    // We create the region here so the user can start the traced application
+    // *before* calling the blocking analyzer_t::run().
+    region_size_ = shm_rings_t::get_region_size(num_rings, ring_size);
+    umask(0);
+    int fd = open(path_.c_str(), O_RDWR | O_CREAT | O_EXCL, 0666);
+    if (fd < 0) {
+        ERRMSG("Failed to create %s: is another instance using this -ipc_name?\n",
+               path_.c_str());
+        return;
+    }
+    // The file is sparse: only ring pages that are written to take up memory.
+    if (ftruncate(fd, region_size_) == 0) {
+        region_ = mmap(nullptr, region_size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (region_ == MAP_FAILED)
+            region_ = nullptr;
+    }
+    close(fd);
+    creation_success_ =
+        region_ != nullptr && rings_.create(region_, region_size_, num_rings, ring_size);
+#endif
+}
+
+// Work around clang-format bug: no newline after return type for single-char operator.
+// clang-format off
+bool
+shm_reader_t::operator!()
+// clang-format on
+{
+    return !creation_success_;
+}
+
+std::string
+shm_reader_t::get_stream_name() const
+{
+    return path_;
+}
+
+bool
+shm_reader_t::init()
+{
+    at_eof_ = false;
+    if (!creation_success_)
+        return false;
+    cur_buf_ = buf_;
+    end_buf_ = buf_;
+    ++*this;
+    return true;
+}
+
+shm_reader_t::~shm_reader_t()
+{
+#ifdef UNIX
+    if (region_ != nullptr) {
+        munmap(region_, region_size_);
+        unlink(path_.c_str());
+    }
+#endif
+}
+
+trace_entry_t *
+shm_reader_t::read_next_entry()
+{
+    trace_entry_t *from_queue = read_queued_entry();
+    if (from_queue != nullptr)
+        return from_queue;
+    ++cur_buf_;
+    if (cur_buf_ >= end_buf_) {
+        size_t sz;
+        int idle = 0;
+        while (true) {
+            bool finished;
+            sz = rings_.read(buf_, sizeof(buf_), &finished);
+            if (sz > 0 || finished)
+                break;
+            // Spin briefly for low latency, then back off so an idle tracee
+            // does not cost us a core.
+            if (++idle < 1024)
+                std::this_thread::yield();
+            else
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+        if (sz == 0 || sz % sizeof(*end_buf_) != 0) {
+            // If called again at eof, do not return the footer: return an error.
+            if (at_eof_)
+                return nullptr;
+            cur_buf_ = buf_;
+            cur_buf_->type = TRACE_TYPE_FOOTER;
+            cur_buf_->size = 0;
+            cur_buf_->addr = 0;
+            at_eof_ = true;
+            return cur_buf_;
+        }
+        cur_buf_ = buf_;
+        end_buf_ = buf_ + (sz / sizeof(*end_buf_));
+    }
+    if (cur_buf_->type == TRACE_TYPE_FOOTER)
+        at_eof_ = true;
+    return cur_buf_;
+}
@@ -0,0 +1,83 @@
+/* **********************************************************
+ * Copyright (c) 2023 Google, Inc.  All rights reserved.
+ * **********************************************************/
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of Google, Inc. nor the names of its contributors may be
+ *   used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL VMWARE, INC. OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+
+/* shm_reader: obtains memory streams from DR clients running in application
+ * processes through per-thread shared memory rings (see -ipc_shm) and
+ * presents them via an iterator interface to the cache simulator.
+ * The rings are merged into a single stream at whole-buffer boundaries, so the
+ * analysis is serial as with ipc_reader_t.
+ */
+
+#ifndef _SHM_READER_H_
+#define _SHM_READER_H_ 1
+
+#include <string>
+#include "reader.h"
+#include "../common/memref.h"
+#include "../common/shm_ring.h"
+#include "../common/trace_entry.h"
+
+class shm_reader_t : public reader_t {
+public:
+    shm_reader_t();
+    // Creates the shared region for -ipc_name "ipc_name" with "num_rings" rings
+    // of "ring_size" bytes each.
+    shm_reader_t(const char *ipc_name, uint32_t num_rings, uint64_t ring_size,
+                 int verbosity);
+    virtual ~shm_reader_t();
+    bool
+    operator!() override;
+    // This potentially blocks.
+    bool
+    init() override;
+    std::string
+    get_stream_name() const override;
+
+protected:
+    trace_entry_t *
+    read_next_entry() override;
+
+private:
+    std::string path_;
+    void *region_ = nullptr;
+    size_t region_size_ = 0;
+    shm_rings_t rings_;
+    bool creation_success_ = false;
+
+    static const int BUF_SIZE = 16 * 1024;
+    trace_entry_t buf_[BUF_SIZE];
+    trace_entry_t *cur_buf_;
+    trace_entry_t *end_buf_;
+};
+
+#endif /* _SHM_READER_H_ */
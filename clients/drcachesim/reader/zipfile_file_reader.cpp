@@ -37,6 +37,43 @@
 // sources.  The docs are the header files:
 // https://github.com/madler/zlib/blob/master/contrib/minizip/unzip.h
 
+namespace {
+
+// Opens the archive's current component.  A component stored without compression
+// is served in place from the mapping of the archive, when we have one, rather
+// than copied through zipfile->buf.
+bool
+open_current_component(zipfile_reader_t *zipfile)
+{
+    if (unzOpenCurrentFile(zipfile->file) != UNZ_OK)
+        return false;
+    zipfile->in_place = false;
+    zipfile->cur_buf = zipfile->buf;
+    zipfile->max_buf = zipfile->buf;
+#ifdef UNIX
+    if (zipfile->region.base == nullptr)
+        return true;
+    unz_file_info64 info;
+    if (unzGetCurrentFileInfo64(zipfile->file, &info, nullptr, 0, nullptr, 0, nullptr,
+                                0) != UNZ_OK)
+        return true;
+    // Bit 0 of the general purpose flags indicates encryption.
+    if (info.compression_method != 0 || (info.flag & 1) != 0 ||
+        info.uncompressed_size < sizeof(trace_entry_t))
+        return true;
+    ZPOS64_T offset = unzGetCurrentFileZStreamPos64(zipfile->file);
+    if (offset == 0 || offset + info.uncompressed_size > zipfile->region.size)
+        return true;
+    // trace_entry_t is packed so there is no alignment requirement.
+    zipfile->in_place = true;
+    zipfile->cur_buf = reinterpret_cast<trace_entry_t *>(zipfile->region.base + offset);
+    zipfile->max_buf = zipfile->cur_buf + info.uncompressed_size / sizeof(trace_entry_t);
+#endif
+    return true;
+}
+
+} // namespace
+
 /* clang-format off */ /* (make vera++ newline-after-type check happy) */
 template <>
 /* clang-format on */
@@ -63,8 +100,13 @@ file_reader_t<zipfile_reader_t>::open_single_file(const std::string &path)
     unzFile file = unzOpen(path.c_str());
     if (file == nullptr)
         return false;
-    input_file_ = zipfile_reader_t(file);
-    if (unzGoToFirstFile(file) != UNZ_OK || unzOpenCurrentFile(file) != UNZ_OK)
+    input_file_.file = file;
+#ifdef UNIX
+    // A failure here just means that stored components are copied like any other.
+    if (!input_file_.region.map(path))
+        VPRINT(this, 2, "Failed to map %s; reading without it\n", path.c_str());
+#endif
+    if (unzGoToFirstFile(file) != UNZ_OK || !open_current_component(&input_file_))
         return false;
     VPRINT(this, 1, "Opened input file %s\n", path.c_str());
     return true;
@@ -79,8 +121,10 @@ file_reader_t<zipfile_reader_t>::read_next_entry()
         return from_queue;
     zipfile_reader_t *zipfile = &input_file_;
     if (zipfile->cur_buf >= zipfile->max_buf) {
-        int num_read =
-            unzReadCurrentFile(zipfile->file, zipfile->buf, sizeof(zipfile->buf));
+        // An in-place component has been entirely consumed once we get here.
+        int num_read = zipfile->in_place
+            ? 0
+            : unzReadCurrentFile(zipfile->file, zipfile->buf, sizeof(zipfile->buf));
         if (num_read == 0) {
 #ifdef DEBUG
             if (verbosity_ >= 3) {
@@ -93,10 +137,13 @@ file_reader_t<zipfile_reader_t>::read_next_entry()
                        name);
             }
 #endif
-            // read_next_entry() stored the last-read entry into entry_copy_.
-            if ((entry_copy_.type != TRACE_TYPE_MARKER ||
-                 entry_copy_.size != TRACE_MARKER_TYPE_CHUNK_FOOTER) &&
-                entry_copy_.type != TRACE_TYPE_FOOTER) {
+            // read_next_entry() stored the last-read entry into entry_copy_, unless
+            // it handed it out in place.
+            const trace_entry_t *last =
+                zipfile->in_place ? zipfile->max_buf - 1 : &entry_copy_;
+            if ((last->type != TRACE_TYPE_MARKER ||
+                 last->size != TRACE_MARKER_TYPE_CHUNK_FOOTER) &&
+                last->type != TRACE_TYPE_FOOTER) {
                 VPRINT(this, 1, "Chunk is missing footer: truncation detected\n");
                 return nullptr;
             }
@@ -110,18 +157,36 @@ file_reader_t<zipfile_reader_t>::read_next_entry()
                 }
                 return nullptr;
             }
-            if (unzOpenCurrentFile(zipfile->file) != UNZ_OK)
+            if (!open_current_component(zipfile))
+                return nullptr;
+            if (!zipfile->in_place) {
+                num_read = unzReadCurrentFile(zipfile->file, zipfile->buf,
+                                              sizeof(zipfile->buf));
+            }
+        }
+        if (!zipfile->in_place) {
+            if (num_read < static_cast<int>(sizeof(entry_copy_))) {
+                VPRINT(this, 1, "Failed to read: returned %d\n", num_read);
                 return nullptr;
-            num_read =
-                unzReadCurrentFile(zipfile->file, zipfile->buf, sizeof(zipfile->buf));
+            }
+            zipfile->cur_buf = zipfile->buf;
+            zipfile->max_buf = zipfile->buf + (num_read / sizeof(*zipfile->max_buf));
         }
-        if (num_read < static_cast<int>(sizeof(entry_copy_))) {
-            VPRINT(this, 1, "Failed to read: returned %d\n", num_read);
-            return nullptr;
+    }
+#ifdef UNIX
+    if (zipfile->in_place) {
+        trace_entry_t *entry = zipfile->cur_buf;
+        ++zipfile->cur_buf;
+        VPRINT(this, 4, "Read in place: type=%s (%d), size=%d, addr=%zu\n",
+               trace_type_names[entry->type], entry->type, entry->size, entry->addr);
+        // The mapping is read-only.
+        if (mmap_needs_copy(entry)) {
+            entry_copy_ = *entry;
+            return &entry_copy_;
         }
-        zipfile->cur_buf = zipfile->buf;
-        zipfile->max_buf = zipfile->buf + (num_read / sizeof(*zipfile->max_buf));
+        return entry;
     }
+#endif
     entry_copy_ = *zipfile->cur_buf;
     ++zipfile->cur_buf;
     VPRINT(this, 4, "Read: type=%s (%d), size=%d, addr=%zu\n",
@@ -171,7 +236,7 @@ file_reader_t<zipfile_reader_t>::skip_instructions(uint64_t instruction_count)
             at_eof_ = true;
             return *this;
         }
-        if (unzOpenCurrentFile(zipfile->file) != UNZ_OK) {
+        if (!open_current_component(zipfile)) {
             VPRINT(this, 1, "Failed to open zip subfile\n");
             at_eof_ = true;
             return *this;
@@ -185,8 +250,6 @@ file_reader_t<zipfile_reader_t>::skip_instructions(uint64_t instruction_count)
                stop_count, cur_instr_count_, chunk_instr_count_,
                cur_instr_count_ +
                    (chunk_instr_count_ - (cur_instr_count_ % chunk_instr_count_)));
-        // Clear cached data from the prior chunk.
-        zipfile->cur_buf = zipfile->max_buf;
     }
     // Now do a linear walk the rest of the way, remembering timestamps (we have
     // duplicated timestamps at the start of the chunk to cover any skipped in
@@ -38,6 +38,9 @@
 #include <zlib.h>
 #include "minizip/unzip.h"
 #include "file_reader.h"
+#ifdef UNIX
+#    include "mmap_file_reader.h"
+#endif
 
 struct zipfile_reader_t {
     zipfile_reader_t()
@@ -55,6 +58,12 @@ struct zipfile_reader_t {
     trace_entry_t buf[4096];
     trace_entry_t *cur_buf = buf;
     trace_entry_t *max_buf = buf;
+    // Components stored without compression are read in place from a mapping of
+    // the whole archive, with cur_buf and max_buf pointing into it rather than buf.
+    bool in_place = false;
+#ifdef UNIX
+    mmap_region_t region;
+#endif
 };
 
 typedef file_reader_t<zipfile_reader_t> zipfile_file_reader_t;
@@ -0,0 +1,246 @@
+/* **********************************************************
+ * Copyright (c) 2023 Google, Inc.  All rights reserved.
+ * **********************************************************/
+
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of Google, Inc. nor the names of its contributors may be
+ *   used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL VMWARE, INC. OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+
+#include "zstd_file_reader.h"
+#include <inttypes.h>
+#include <algorithm>
+
+// The docs for the zstd streaming API are in the header file:
+// https://github.com/facebook/zstd/blob/dev/lib/zstd.h
+
+namespace {
+
+class zstd_index_reader_t : public zstd_consts_t {
+public:
+    // Reads the frame index at the end of the file, if there is one, and sets
+    // zstd->frames and zstd->data_end.  A file without a valid index is still
+    // readable, just without fast seeking.
+    static void
+    read_index(zstd_reader_t *zstd, uint64_t file_size)
+    {
+        zstd->frames.clear();
+        zstd->data_end = file_size;
+        zstd_index_footer_t footer;
+        if (file_size < skippable_header_size_ + sizeof(footer))
+            return;
+        zstd->file.seekg(file_size - sizeof(footer));
+        if (!zstd->file.read(reinterpret_cast<char *>(&footer), sizeof(footer)) ||
+            footer.magic != index_magic_ || footer.version != index_version_ ||
+            footer.num_frames >
+                (file_size - skippable_header_size_ - sizeof(footer)) /
+                    sizeof(zstd_frame_entry_t))
+            return;
+        uint64_t payload_size =
+            footer.num_frames * sizeof(zstd_frame_entry_t) + sizeof(footer);
+        uint64_t index_start = file_size - payload_size - skippable_header_size_;
+        uint32_t header[2];
+        zstd->file.seekg(index_start);
+        if (!zstd->file.read(reinterpret_cast<char *>(header), sizeof(header)) ||
+            header[0] != skippable_magic_ || header[1] != payload_size)
+            return;
+        std::vector<zstd_frame_entry_t> frames(footer.num_frames);
+        if (!frames.empty() &&
+            !zstd->file.read(reinterpret_cast<char *>(frames.data()),
+                             frames.size() * sizeof(zstd_frame_entry_t)))
+            return;
+        zstd->frames = std::move(frames);
+        zstd->data_end = index_start;
+    }
+};
+
+// Positions the reader at the start of the frame at "offset".
+bool
+seek_to_frame(zstd_reader_t *zstd, uint64_t offset)
+{
+    zstd->file.clear();
+    if (!zstd->file.seekg(offset))
+        return false;
+    if (ZSTD_isError(ZSTD_DCtx_reset(zstd->dctx, ZSTD_reset_session_only)))
+        return false;
+    zstd->in_offset = offset;
+    zstd->input.src = zstd->in_buf.data();
+    zstd->input.size = 0;
+    zstd->input.pos = 0;
+    zstd->pending_output = false;
+    zstd->frame_done = true;
+    zstd->buf_bytes = 0;
+    zstd->cur_buf = zstd->buf;
+    zstd->max_buf = zstd->buf;
+    return true;
+}
+
+} // namespace
+
+/* clang-format off */ /* (make vera++ newline-after-type check happy) */
+template <>
+/* clang-format on */
+file_reader_t<zstd_reader_t>::file_reader_t()
+{
+}
+
+/* clang-format off */ /* (make vera++ newline-after-type check happy) */
+template <>
+/* clang-format on */
+file_reader_t<zstd_reader_t>::~file_reader_t<zstd_reader_t>()
+{
+}
+
+template <>
+bool
+file_reader_t<zstd_reader_t>::open_single_file(const std::string &path)
+{
+    zstd_reader_t *zstd = &input_file_;
+    zstd->file.open(path, std::ifstream::binary);
+    if (!zstd->file)
+        return false;
+    zstd->file.seekg(0, std::ios::end);
+    std::streamoff file_size = zstd->file.tellg();
+    if (file_size < 0)
+        return false;
+    zstd_index_reader_t::read_index(zstd, static_cast<uint64_t>(file_size));
+    VPRINT(this, 2, "Found %zu indexed frames\n", zstd->frames.size());
+    zstd->dctx = ZSTD_createDCtx();
+    if (zstd->dctx == nullptr)
+        return false;
+    zstd->in_buf.resize(ZSTD_DStreamInSize());
+    if (!seek_to_frame(zstd, 0))
+        return false;
+    VPRINT(this, 1, "Opened input file %s\n", path.c_str());
+    return true;
+}
+
+template <>
+trace_entry_t *
+file_reader_t<zstd_reader_t>::read_next_entry()
+{
+    trace_entry_t *from_queue = read_queued_entry();
+    if (from_queue != nullptr)
+        return from_queue;
+    zstd_reader_t *zstd = &input_file_;
+    if (zstd->cur_buf >= zstd->max_buf) {
+        // Keep any partial record at the end of the buffer.
+        size_t consumed = (zstd->max_buf - zstd->buf) * sizeof(trace_entry_t);
+        size_t partial = zstd->buf_bytes - consumed;
+        char *bytes = reinterpret_cast<char *>(zstd->buf);
+        memmove(bytes, bytes + consumed, partial);
+        zstd->buf_bytes = partial;
+        while (zstd->buf_bytes < sizeof(trace_entry_t)) {
+            if (zstd->input.pos == zstd->input.size && !zstd->pending_output) {
+                if (zstd->in_offset >= zstd->data_end) {
+                    if (!zstd->frame_done || zstd->buf_bytes > 0) {
+                        VPRINT(this, 1, "Frame is incomplete: truncation detected\n");
+                        return nullptr;
+                    }
+                    VPRINT(this, 2, "Hit EOF\n");
+                    at_eof_ = true;
+                    return nullptr;
+                }
+                size_t want = zstd->in_buf.size();
+                if (want > zstd->data_end - zstd->in_offset)
+                    want = static_cast<size_t>(zstd->data_end - zstd->in_offset);
+                if (!zstd->file.read(zstd->in_buf.data(), want)) {
+                    VPRINT(this, 1, "Failed to read %zu bytes\n", want);
+                    return nullptr;
+                }
+                zstd->in_offset += want;
+                zstd->input.src = zstd->in_buf.data();
+                zstd->input.size = want;
+                zstd->input.pos = 0;
+            }
+            ZSTD_outBuffer output = { zstd->buf, sizeof(zstd->buf), zstd->buf_bytes };
+            size_t res = ZSTD_decompressStream(zstd->dctx, &output, &zstd->input);
+            if (ZSTD_isError(res)) {
+                VPRINT(this, 1, "Failed to decompress: %s\n", ZSTD_getErrorName(res));
+                return nullptr;
+            }
+            zstd->frame_done = (res == 0);
+            zstd->pending_output = (output.pos == output.size);
+            zstd->buf_bytes = output.pos;
+        }
+        zstd->cur_buf = zstd->buf;
+        zstd->max_buf = zstd->buf + zstd->buf_bytes / sizeof(trace_entry_t);
+    }
+    entry_copy_ = *zstd->cur_buf;
+    ++zstd->cur_buf;
+    VPRINT(this, 4, "Read: type=%s (%d), size=%d, addr=%zu\n",
+           trace_type_names[entry_copy_.type], entry_copy_.type, entry_copy_.size,
+           entry_copy_.addr);
+    return &entry_copy_;
+}
+
+template <>
+reader_t &
+file_reader_t<zstd_reader_t>::skip_instructions(uint64_t instruction_count)
+{
+    if (instruction_count == 0)
+        return *this;
+    VPRINT(this, 2, "Skipping %" PRIi64 " instrs\n", instruction_count);
+    if (!pre_skip_instructions())
+        return *this;
+    zstd_reader_t *zstd = &input_file_;
+    uint64_t stop_count = cur_instr_count_ + instruction_count + 1;
+    // Find the last frame starting at or before the target instruction, which is
+    // preceded by stop_count - 1 others.
+    auto frame = std::upper_bound(
+        zstd->frames.begin(), zstd->frames.end(), stop_count - 1,
+        [](uint64_t count, const zstd_frame_entry_t &entry) {
+            return count < entry.first_instr;
+        });
+    if (frame != zstd->frames.begin()) {
+        --frame;
+        // Jump there unless we are already in or past it.  Like a zipfile chunk,
+        // a frame starts with a chunk header whose timestamp and cpu the linear
+        // walk below picks up.
+        if (frame->first_instr > cur_instr_count_) {
+            if (!seek_to_frame(zstd, frame->offset)) {
+                VPRINT(this, 1, "Failed to seek to frame\n");
+                at_eof_ = true;
+                return *this;
+            }
+            // Anything read ahead, such as the target of a prior skip, is from
+            // before the new position, as is any pending chunk header to elide or
+            // synthetic record to not count: the walk below accounts for the new
+            // frame's header itself.
+            while (!queue_.empty())
+                queue_.pop();
+            skip_chunk_header_.clear();
+            suppress_ref_count_ = -1;
+            cur_instr_count_ = frame->first_instr;
+            VPRINT(this, 2, "At %" PRIi64 " instrs at start of frame @%" PRIu64 "\n",
+                   cur_instr_count_, frame->offset);
+        }
+    }
+    // Subtract 1 to pass the target instr itself.
+    return skip_instructions_with_timestamp(stop_count - 1);
+}
@@ -0,0 +1,92 @@
+/* **********************************************************
+ * Copyright (c) 2023 Google, Inc.  All rights reserved.
+ * **********************************************************/
+
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of Google, Inc. nor the names of its contributors may be
+ *   used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL VMWARE, INC. OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+
+/* zstd_file_reader: reads seekable zstd files containing memory traces. */
+
+#ifndef _ZSTD_FILE_READER_H_
+#define _ZSTD_FILE_READER_H_ 1
+
+#include <fstream>
+#include <vector>
+#include <zstd.h>
+#include "file_reader.h"
+#include "zstd_consts.h"
+
+struct zstd_reader_t {
+    zstd_reader_t()
+    {
+    }
+    ~zstd_reader_t()
+    {
+        ZSTD_freeDCtx(dctx);
+    }
+    std::ifstream file;
+    ZSTD_DCtx *dctx = nullptr;
+    // The index of the data frames, or empty if the file has none, in which case
+    // the whole file is read sequentially.
+    std::vector<zstd_frame_entry_t> frames;
+    // The end of the data frames: where the index frame starts.
+    uint64_t data_end = 0;
+    // The file offset of the next compressed bytes to read into in_buf.
+    uint64_t in_offset = 0;
+    std::vector<char> in_buf;
+    ZSTD_inBuffer input = { nullptr, 0, 0 };
+    // Whether the decompressor may hold output it could not fit last time.
+    bool pending_output = false;
+    // Whether the last decompression call completed a frame.
+    bool frame_done = true;
+    // As for zipfile_reader_t, reading through a buffer of records is much faster
+    // than one record at a time.  buf holds buf_bytes of decompressed data, which
+    // may end in a partial record.
+    trace_entry_t buf[4096];
+    size_t buf_bytes = 0;
+    trace_entry_t *cur_buf = buf;
+    trace_entry_t *max_buf = buf;
+
+private:
+    zstd_reader_t(const zstd_reader_t &) = delete;
+    zstd_reader_t &
+    operator=(const zstd_reader_t &) = delete;
+};
+
+typedef file_reader_t<zstd_reader_t> zstd_file_reader_t;
+
+/* Declare this so the compiler knows not to use the default implementation in the
+ * class declaration.
+ */
+template <>
+reader_t &
+file_reader_t<zstd_reader_t>::skip_instructions(uint64_t instruction_count);
+
+#endif /* _ZSTD_FILE_READER_H_ */
@@ -35,6 +35,9 @@
 
 #include "scheduler.h"
 #include "file_reader.h"
+#ifdef UNIX
+#    include "mmap_file_reader.h"
+#endif
 #ifdef HAS_ZLIB
 #    include "compressed_file_reader.h"
 #endif
@@ -44,6 +47,9 @@
 #ifdef HAS_SNAPPY
 #    include "snappy_file_reader.h"
 #endif
+#ifdef HAS_ZSTD
+#    include "zstd_file_reader.h"
+#endif
 #include "directory_iterator.h"
 #include "utils.h"
 #ifdef UNIX
@@ -87,6 +93,11 @@ typedef dynamorio::drmemtrace::record_file_reader_t<std::ifstream>
     default_record_file_reader_t;
 #endif
 
+#ifdef UNIX
+// The name raw2trace gives final trace files when it does not compress them.
+#    define UNCOMPRESSED_TRACE_SUFFIX ".trace"
+#endif
+
 /****************************************************************
  * Specializations for scheduler_tmpl_t<reader_t>, aka scheduler_t.
  */
@@ -102,7 +113,7 @@ template <>
 std::unique_ptr<reader_t>
 scheduler_tmpl_t<memref_t, reader_t>::get_reader(const std::string &path, int verbosity)
 {
-#if defined(HAS_SNAPPY) || defined(HAS_ZIP)
+#if defined(HAS_SNAPPY) || defined(HAS_ZIP) || defined(HAS_ZSTD)
 #    ifdef HAS_SNAPPY
     if (ends_with(path, ".sz"))
         return std::unique_ptr<reader_t>(new snappy_file_reader_t(path, verbosity));
@@ -110,6 +121,10 @@ scheduler_tmpl_t<memref_t, reader_t>::get_reader(const std::string &path, int ve
 #    ifdef HAS_ZIP
     if (ends_with(path, ".zip"))
         return std::unique_ptr<reader_t>(new zipfile_file_reader_t(path, verbosity));
+#    endif
+#    ifdef HAS_ZSTD
+    if (ends_with(path, ".zst"))
+        return std::unique_ptr<reader_t>(new zstd_file_reader_t(path, verbosity));
 #    endif
     // If path is a directory, and any file in it ends in .sz, return a snappy reader.
     if (directory_iterator_t::is_directory(path)) {
@@ -142,11 +157,23 @@ scheduler_tmpl_t<memref_t, reader_t>::get_reader(const std::string &path, int ve
                 return std::unique_ptr<reader_t>(
                     new zipfile_file_reader_t(path, verbosity));
             }
+#    endif
+#    ifdef HAS_ZSTD
+            if (ends_with(*iter, ".zst")) {
+                return std::unique_ptr<reader_t>(
+                    new zstd_file_reader_t(path, verbosity));
+            }
 #    endif
         }
     }
 #endif
-    // No snappy/zlib support, or didn't find a .sz/.zip file.
+#ifdef UNIX
+    // Uncompressed files are mapped and read in place, avoiding both the stream
+    // layers and a copy of every record.
+    if (ends_with(path, UNCOMPRESSED_TRACE_SUFFIX))
+        return std::unique_ptr<reader_t>(new mmap_file_reader_t(path, verbosity));
+#endif
+    // No snappy/zlib/zstd support, or didn't find a .sz/.zip/.zst file.
     return std::unique_ptr<reader_t>(new default_file_reader_t(path, verbosity));
 }
 
@@ -251,8 +278,14 @@ scheduler_tmpl_t<trace_entry_t, record_reader_t>::get_reader(const std::string &
 {
     // TODO i#5675: Add support for other file formats, particularly
     // .zip files.
-    if (ends_with(path, ".sz") || ends_with(path, ".zip"))
+    if (ends_with(path, ".sz") || ends_with(path, ".zip") || ends_with(path, ".zst"))
         return nullptr;
+#ifdef UNIX
+    if (ends_with(path, UNCOMPRESSED_TRACE_SUFFIX)) {
+        return std::unique_ptr<dynamorio::drmemtrace::record_reader_t>(
+            new mmap_record_file_reader_t(path, verbosity));
+    }
+#endif
     return std::unique_ptr<dynamorio::drmemtrace::record_reader_t>(
         new default_record_file_reader_t(path, verbosity));
 }
@@ -599,6 +632,13 @@ scheduler_tmpl_t<RecordType, ReaderType>::set_initial_schedule(
         // TODO i#5843: Implement time-based quanta.
         if (options_.quantum_unit != QUANTUM_INSTRUCTIONS)
             return STATUS_ERROR_NOT_IMPLEMENTED;
+        for (size_t i = 0; i < outputs_.size(); ++i)
+            ready_queues_.emplace_back(new ready_queue_t);
+        strict_ready_order_ = options_.deps == DEPENDENCY_TIMESTAMPS;
+        for (const input_info_t &input : inputs_) {
+            if (input.priority != 0)
+                strict_ready_order_ = true;
+        }
         // Assign initial inputs.
         // TODO i#5843: Once we support core bindings and priorities we'll want
         // to consider that here.
@@ -632,19 +672,27 @@ scheduler_tmpl_t<RecordType, ReaderType>::set_initial_schedule(
                 }
             }
             // Pick the starting inputs by sorting by relative time from each workload's
-            // base_timestamp, which our queue does for us.  We want the rest of the
-            // inputs in the queue in any case so it is simplest to insert all and
-            // remove the first N rather than sorting the first N separately.
+            // base_timestamp, which a queue does for us.  We then deal out the rest
+            // of the inputs in that order across the outputs' queues.
+            std::priority_queue<input_info_t *, std::vector<input_info_t *>,
+                                InputTimestampComparator>
+                sorted;
             for (int i = 0; i < static_cast<input_ordinal_t>(inputs_.size()); ++i) {
-                add_to_ready_queue(&inputs_[i]);
+                set_ready_key(&inputs_[i]);
+                sorted.push(&inputs_[i]);
             }
             for (int i = 0; i < static_cast<output_ordinal_t>(outputs_.size()); ++i) {
-                if (i < static_cast<input_ordinal_t>(inputs_.size())) {
-                    input_info_t *queue_next = pop_from_ready_queue();
-                    set_cur_input(i, queue_next->index);
+                if (!sorted.empty()) {
+                    set_cur_input(i, sorted.top()->index);
+                    sorted.pop();
                 } else
                     set_cur_input(i, INVALID_INPUT_ORDINAL);
             }
+            for (int i = 0; !sorted.empty(); ++i) {
+                add_to_ready_queue(i % static_cast<output_ordinal_t>(outputs_.size()),
+                                   sorted.top());
+                sorted.pop();
+            }
         } else {
             // Just take the 1st N inputs (even if all from the same workload).
             for (int i = 0; i < static_cast<output_ordinal_t>(outputs_.size()); ++i) {
@@ -655,7 +703,8 @@ scheduler_tmpl_t<RecordType, ReaderType>::set_initial_schedule(
             }
             for (int i = static_cast<output_ordinal_t>(outputs_.size());
                  i < static_cast<input_ordinal_t>(inputs_.size()); ++i) {
-                add_to_ready_queue(&inputs_[i]);
+                add_to_ready_queue(i % static_cast<output_ordinal_t>(outputs_.size()),
+                                   &inputs_[i]);
             }
         }
     }
@@ -1220,35 +1269,100 @@ scheduler_tmpl_t<RecordType, ReaderType>::close_schedule_segment(output_ordinal_
 }
 
 template <typename RecordType, typename ReaderType>
-bool
-scheduler_tmpl_t<RecordType, ReaderType>::ready_queue_empty()
+void
+scheduler_tmpl_t<RecordType, ReaderType>::set_ready_key(input_info_t *input)
 {
-    return ready_priority_.empty();
+    input->queue_key.priority = input->priority;
+    input->queue_key.order_by_timestamp = input->order_by_timestamp;
+    input->queue_key.timestamp =
+        input->reader->get_last_timestamp() - input->base_timestamp;
+    input->queue_key.counter = ++ready_counter_;
 }
 
 template <typename RecordType, typename ReaderType>
 void
-scheduler_tmpl_t<RecordType, ReaderType>::add_to_ready_queue(input_info_t *input)
+scheduler_tmpl_t<RecordType, ReaderType>::add_to_ready_queue(output_ordinal_t output,
+                                                             input_info_t *input)
 {
     VPRINT(this, 4,
-           "add_to_ready_queue: input %d priority %d timestamp delta %" PRIu64 "\n",
-           input->index, input->priority,
+           "add_to_ready_queue[%d]: input %d priority %d timestamp delta %" PRIu64 "\n",
+           output, input->index, input->priority,
            input->reader->get_last_timestamp() - input->base_timestamp);
-    input->queue_counter = ++ready_counter_;
-    ready_priority_.push(input);
+    set_ready_key(input);
+    ready_queue_t &queue = *ready_queues_[output];
+    std::lock_guard<std::mutex> guard(queue.lock);
+    queue.queue.push(input);
+    queue.size.store(static_cast<int>(queue.queue.size()), std::memory_order_release);
 }
 
 template <typename RecordType, typename ReaderType>
 typename scheduler_tmpl_t<RecordType, ReaderType>::input_info_t *
-scheduler_tmpl_t<RecordType, ReaderType>::pop_from_ready_queue()
+scheduler_tmpl_t<RecordType, ReaderType>::pop_from_ready_queue(output_ordinal_t output,
+                                                               input_info_t *prev)
 {
-    input_info_t *res = ready_priority_.top();
-    ready_priority_.pop();
-    VPRINT(this, 4,
-           "pop_from_ready_queue: input %d priority %d timestamp delta %" PRIu64 "\n",
-           res->index, res->priority,
-           res->reader->get_last_timestamp() - res->base_timestamp);
-    return res;
+    const output_ordinal_t num_queues = static_cast<output_ordinal_t>(outputs_.size());
+    while (true) {
+        // Pick a queue and the best input in it, under only that queue's lock.
+        output_ordinal_t source = -1;
+        input_info_t *best = nullptr;
+        ready_key_t best_key;
+        if (strict_ready_order_) {
+            for (output_ordinal_t i = 0; i < num_queues; ++i) {
+                ready_queue_t &queue = *ready_queues_[i];
+                if (queue.size.load(std::memory_order_acquire) == 0)
+                    continue;
+                std::lock_guard<std::mutex> guard(queue.lock);
+                if (queue.queue.empty())
+                    continue;
+                input_info_t *top = queue.queue.top();
+                if (best == nullptr || best_key.after(top->queue_key)) {
+                    source = i;
+                    best = top;
+                    best_key = top->queue_key;
+                }
+            }
+        } else {
+            // Prefer our own queue, for affinity.  Otherwise, steal from the fullest
+            // queue, to spread the load.
+            int max_size = ready_queues_[output]->size.load(std::memory_order_acquire);
+            if (max_size > 0)
+                source = output;
+            else {
+                for (output_ordinal_t i = 0; i < num_queues; ++i) {
+                    int size = ready_queues_[i]->size.load(std::memory_order_acquire);
+                    if (size > max_size) {
+                        source = i;
+                        max_size = size;
+                    }
+                }
+            }
+            if (source >= 0) {
+                ready_queue_t &queue = *ready_queues_[source];
+                std::lock_guard<std::mutex> guard(queue.lock);
+                if (queue.queue.empty())
+                    continue; // Another output emptied it: try again.
+                best = queue.queue.top();
+                best_key = best->queue_key;
+            }
+        }
+        if (best == nullptr)
+            return nullptr;
+        // We prefer to keep running "prev" if it beats the best queued input.
+        if (prev != nullptr && best_key.after(prev->queue_key))
+            return nullptr;
+        ready_queue_t &queue = *ready_queues_[source];
+        std::lock_guard<std::mutex> guard(queue.lock);
+        if (queue.queue.empty() || queue.queue.top() != best ||
+            queue.queue.top()->queue_key.counter != best_key.counter)
+            continue; // Another output took it or queued something better.
+        queue.queue.pop();
+        queue.size.store(static_cast<int>(queue.queue.size()), std::memory_order_release);
+        VPRINT(this, 4,
+               "pop_from_ready_queue[%d]: input %d from queue %d priority %d "
+               "timestamp delta %" PRIu64 "\n",
+               output, best->index, source, best_key.priority, best_key.timestamp);
+        return best;
+    }
 }
 
 template <typename RecordType, typename ReaderType>
@@ -1261,8 +1375,6 @@ scheduler_tmpl_t<RecordType, ReaderType>::set_cur_input(output_ordinal_t output,
     assert(input < static_cast<input_ordinal_t>(inputs_.size()));
     int prev_input = outputs_[output].cur_input;
     if (prev_input >= 0) {
-        if (options_.mapping == MAP_TO_ANY_OUTPUT && prev_input != input)
-            add_to_ready_queue(&inputs_[prev_input]);
         if (prev_input != input && options_.schedule_record_ostream != nullptr) {
             input_info_t &prev_info = inputs_[prev_input];
             std::lock_guard<std::mutex> lock(*prev_info.lock);
@@ -1271,6 +1383,10 @@ scheduler_tmpl_t<RecordType, ReaderType>::set_cur_input(output_ordinal_t output,
             if (status != sched_type_t::STATUS_OK)
                 return status;
         }
+        // We queue the prior input only once we are done with it, as another output
+        // can take it as soon as it is queued.
+        if (options_.mapping == MAP_TO_ANY_OUTPUT && prev_input != input)
+            add_to_ready_queue(output, &inputs_[prev_input]);
     }
     outputs_[output].cur_input = input;
     if (input < 0)
@@ -1304,8 +1420,7 @@ template <typename RecordType, typename ReaderType>
 typename scheduler_tmpl_t<RecordType, ReaderType>::stream_status_t
 scheduler_tmpl_t<RecordType, ReaderType>::pick_next_input(output_ordinal_t output)
 {
-    bool need_lock =
-        options_.mapping == MAP_TO_ANY_OUTPUT || options_.mapping == MAP_AS_PREVIOUSLY;
+    bool need_lock = options_.mapping == MAP_AS_PREVIOUSLY;
     auto scoped_lock = need_lock ? std::unique_lock<std::mutex>(sched_lock_)
                                  : std::unique_lock<std::mutex>();
     int prev_index = outputs_[output].cur_input;
@@ -1410,20 +1525,28 @@ scheduler_tmpl_t<RecordType, ReaderType>::pick_next_input(output_ordinal_t outpu
                 }
                 ++outputs_[output].record_index;
             } else if (options_.mapping == MAP_TO_ANY_OUTPUT) {
-                if (ready_queue_empty()) {
-                    std::lock_guard<std::mutex> lock(*inputs_[prev_index].lock);
-                    if (inputs_[prev_index].at_eof)
+                // The current input, unless finished, competes with the queued
+                // inputs.  If we're the highest priority we shouldn't switch.  A new
+                // FIFO counter puts it behind any same-priority queued inputs so we
+                // will switch if someone of equal priority is waiting.
+                input_ordinal_t cur_index = outputs_[output].cur_input;
+                input_info_t *prev = nullptr;
+                if (cur_index >= 0) {
+                    std::lock_guard<std::mutex> lock(*inputs_[cur_index].lock);
+                    if (!inputs_[cur_index].at_eof) {
+                        prev = &inputs_[cur_index];
+                        set_ready_key(prev);
+                    }
+                }
+                // TODO i#5843: Add core binding support.
+                input_info_t *queue_next = pop_from_ready_queue(output, prev);
+                if (queue_next == nullptr) {
+                    if (prev == nullptr)
                         return sched_type_t::STATUS_EOF;
-                    else
-                        index = prev_index; // Go back to prior.
+                    index = cur_index; // Go back to prior.
                 } else {
-                    // Give up the input before we go to the queue so we can add
-                    // ourselves to the queue.  If we're the highest priority we
-                    // shouldn't switch.  The queue preserves FIFO for same-priority
-                    // cases so we will switch if someone of equal priority is waiting.
+                    // Give up the input, which queues it.
                     set_cur_input(output, INVALID_INPUT_ORDINAL);
-                    // TODO i#5843: Add core binding support.
-                    input_info_t *queue_next = pop_from_ready_queue();
                     index = queue_next->index;
                 }
             } else if (options_.deps == DEPENDENCY_TIMESTAMPS) {
@@ -42,6 +42,7 @@
 
 #define NOMINMAX // Avoid windows.h messing up std::max.
 #include <assert.h>
+#include <atomic>
 #include <deque>
 #include <limits>
 #include <mutex>
@@ -802,6 +803,31 @@ protected:
     typedef scheduler_tmpl_t<RecordType, ReaderType> sched_type_t;
     typedef speculator_tmpl_t<RecordType> spec_type_t;
 
+    // The sort key for the ready queues, computed when an input is queued.  An
+    // output looking to steal compares the keys of inputs in other outputs' queues,
+    // so it copies the key out under that queue's lock rather than examining the
+    // input itself, which another output might pick up at any time.
+    struct ready_key_t {
+        int priority = 0;
+        // Whether to order by timestamp after priority; see
+        // input_info_t.order_by_timestamp.
+        bool order_by_timestamp = false;
+        // The delta from the first timestamp in the input's workload.
+        uint64_t timestamp = 0;
+        // Global ready queue counter used to provide FIFO for same-priority inputs.
+        uint64_t counter = 0;
+        // Returns whether this key should be scheduled after "other".
+        bool
+        after(const ready_key_t &other) const
+        {
+            if (priority != other.priority)
+                return priority < other.priority; // Higher is better.
+            if (order_by_timestamp && timestamp != other.timestamp)
+                return timestamp > other.timestamp; // Lower is better.
+            return counter > other.counter; // Lower is better.
+        }
+    };
+
     struct input_info_t {
         input_info_t()
             : lock(new std::mutex)
@@ -846,8 +872,8 @@ protected:
         // with schedule_t "this" access for the comparator to compile: it is not
         // simple to do so, however.)
         bool order_by_timestamp = false;
-        // Global ready queue counter used to provide FIFO for same-priority inputs.
-        uint64_t queue_counter = 0;
+        // Set by set_ready_key() for the ready queues.
+        ready_key_t queue_key;
     };
 
     // Format for recording a schedule to disk.  A separate sequence of these records
@@ -928,8 +954,8 @@ protected:
         // queueing a read-ahead instruction record for start_speculation().
         addr_t prev_speculate_pc = 0;
         RecordType last_record;
-        // A list of schedule segments.  These are accessed only while holding
-        // sched_lock_.
+        // A list of schedule segments.  When replaying, these are accessed only while
+        // holding sched_lock_.  When recording, each output appends only to its own.
         std::vector<schedule_record_t> record;
         int record_index = 0;
         bool waiting = false;
@@ -1005,7 +1031,8 @@ protected:
     std::string
     recorded_schedule_component_name(output_ordinal_t output);
 
-    // The sched_lock_ must be held when this is called.
+    // For MAP_AS_PREVIOUSLY, the sched_lock_ must be held when this is called.
+    // No input_info_t lock can be held on entry.
     stream_status_t
     set_cur_input(output_ordinal_t output, input_ordinal_t input);
 
@@ -1079,31 +1106,44 @@ protected:
         bool
         operator()(input_info_t *a, input_info_t *b) const
         {
-            if (a->priority != b->priority)
-                return a->priority < b->priority; // Higher is better.
-            if (a->order_by_timestamp &&
-                (a->reader->get_last_timestamp() - a->base_timestamp) !=
-                    (b->reader->get_last_timestamp() - b->base_timestamp)) {
-                // Lower is better.
-                return (a->reader->get_last_timestamp() - a->base_timestamp) >
-                    (b->reader->get_last_timestamp() - b->base_timestamp);
-            }
-            // We use a counter to provide FIFO order for same-priority inputs.
-            return a->queue_counter > b->queue_counter; // Lower is better.
+            return a->queue_key.after(b->queue_key);
         }
     };
 
-    // sched_lock_ must be held by the caller.
-    bool
-    ready_queue_empty();
+    // Each output has its own queue of inputs ready to be scheduled, sorted by
+    // priority and then timestamp if timestamp dependencies are requested.  We use
+    // the timestamp delta from the first observed timestamp in each workload in order
+    // to mix inputs from different workloads in the same queue.  FIFO ordering is
+    // used for same-priority entries.
+    struct ready_queue_t {
+        std::mutex lock;
+        std::priority_queue<input_info_t *, std::vector<input_info_t *>,
+                            InputTimestampComparator>
+            queue;
+        // Mirrors queue.size() so other outputs can skip empty queues without
+        // acquiring the lock.
+        std::atomic<int> size { 0 };
+    };
 
-    // sched_lock_ must be held by the caller.
+    // Computes the queue_key for "input" with a new FIFO counter.  The caller must
+    // own "input": it must be the current input of the caller's output or not yet
+    // handed to any output.
     void
-    add_to_ready_queue(input_info_t *input);
+    set_ready_key(input_info_t *input);
 
-    // sched_lock_ must be held by the caller.
+    // Adds "input" to the ready queue of "output", which should be the output that
+    // last ran it.
+    void
+    add_to_ready_queue(output_ordinal_t output, input_info_t *input);
+
+    // Removes and returns the queued input that "output" should run next, or nullptr
+    // if there is none or none should replace "prev", which may be nullptr and
+    // otherwise must have an up-to-date key from set_ready_key().
+    // If strict_ready_order_ is set this is the best input across all queues.
+    // Otherwise, this is the best input in "output"'s own queue or, if that is empty,
+    // the best input in the fullest other queue.
     input_info_t *
-    pop_from_ready_queue();
+    pop_from_ready_queue(output_ordinal_t output, input_info_t *prev);
     ///
     ///////////////////////////////////////////////////////////////////////////
 
@@ -1115,22 +1155,22 @@ protected:
     // Each vector element has a mutex which should be held when accessing its fields.
     std::vector<input_info_t> inputs_;
     // Each vector element is accessed only by its owning thread, except the
-    // record and record_index fields which are accessed under sched_lock_.
+    // record and record_index fields which are accessed under sched_lock_ when
+    // replaying.
     std::vector<output_info_t> outputs_;
-    // We use a central lock for global scheduling.  We assume the synchronization
-    // cost is outweighed by the simulator's overhead.  This protects concurrent
-    // access to inputs_.size(), outputs_.size(), ready_priority_, and
-    // ready_counter_.
+    // We use a central lock for replaying a recorded schedule, where each output
+    // consults the others' progress.  Dynamic scheduling instead synchronizes on the
+    // per-output ready queue locks so that outputs do not serialize on each switch.
     std::mutex sched_lock_;
-    // Inputs ready to be scheduled, sorted by priority and then timestamp if timestamp
-    // dependencies are requested.  We use the timestamp delta from the first observed
-    // timestamp in each workload in order to mix inputs from different workloads in the
-    // same queue.  FIFO ordering is used for same-priority entries.
-    std::priority_queue<input_info_t *, std::vector<input_info_t *>,
-                        InputTimestampComparator>
-        ready_priority_;
+    // Indexed by output ordinal.  Used only for MAP_TO_ANY_OUTPUT.
+    std::vector<std::unique_ptr<ready_queue_t>> ready_queues_;
     // Global ready queue counter used to provide FIFO for same-priority inputs.
-    uint64_t ready_counter_ = 0;
+    std::atomic<uint64_t> ready_counter_ { 0 };
+    // Whether the order of inputs matters across outputs: with timestamp
+    // dependencies or priorities, every switch picks the best input across all
+    // ready queues, exactly as with a single queue.  Otherwise, an output prefers
+    // the inputs in its own queue and steals only when that queue is empty.
+    bool strict_ready_order_ = false;
 };
 
 /** See #dynamorio::drmemtrace::scheduler_tmpl_t. */
@@ -122,6 +122,9 @@ get_cache_simulator_knobs()
     knobs->model_coherence = op_coherence.get_value();
     knobs->replace_policy = op_replace_policy.get_value();
     knobs->data_prefetcher = op_data_prefetcher.get_value();
+    knobs->data_prefetch_degree = op_data_prefetch_degree.get_value();
+    knobs->set_sampling = op_set_sampling.get_value();
+    knobs->set_sampling_hashed = op_set_sampling_hashed.get_value();
     knobs->skip_refs = op_skip_refs.get_value();
     knobs->warmup_refs = op_warmup_refs.get_value();
     knobs->warmup_fraction = op_warmup_fraction.get_value();
@@ -138,7 +141,7 @@ drmemtrace_analysis_tool_create()
     if (op_simulator_type.get_value() == CPU_CACHE) {
         const std::string &config_file = op_config_file.get_value();
         if (!config_file.empty()) {
-            return cache_simulator_create(config_file);
+            return cache_simulator_create(config_file, op_sweep_threads.get_value());
         } else {
             cache_simulator_knobs_t *knobs = get_cache_simulator_knobs();
             return cache_simulator_create(*knobs);
@@ -179,6 +182,13 @@ drmemtrace_analysis_tool_create()
         knobs.skip_list_distance = op_reuse_skip_dist.get_value();
         knobs.distance_limit = op_reuse_distance_limit.get_value();
         knobs.verify_skip = op_reuse_verify_skip.get_value();
+        knobs.use_fenwick_tree = op_reuse_fenwick_tree.get_value();
+        knobs.sample_rate = op_reuse_sample_rate.get_value();
+        if (knobs.sample_rate <= 0.0 || knobs.sample_rate > 1.0) {
+            ERRMSG("Usage error: reuse_sample_rate must be in (0, 1]\n");
+            return nullptr;
+        }
+        knobs.sample_max_lines = op_reuse_sample_max_lines.get_value();
         knobs.histogram_bin_multiplier = op_reuse_histogram_bin_multiplier.get_value();
         if (knobs.histogram_bin_multiplier < 1.0) {
             ERRMSG("Usage error: reuse_histogram_bin_multiplier must be >= 1.0\n");
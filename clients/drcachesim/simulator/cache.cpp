@@ -80,8 +80,23 @@ cache_t::flush(const memref_t &memref)
     }
     // We flush parent_'s code cache here.
     // XXX: should L1 data cache be flushed when L1 instr cache is flushed?
-    if (parent_ != NULL)
-        ((cache_t *)parent_)->flush(memref);
+    if (parent_ != NULL) {
+        if (defer_to_parent_)
+            deferred_parent_requests_.push_back(memref);
+        else
+            ((cache_t *)parent_)->flush(memref);
+    }
     if (stats_ != NULL)
         ((cache_stats_t *)stats_)->flush(memref);
 }
+
+void
+cache_t::apply_deferred_parent_request(const memref_t &memref)
+{
+    // Flushes are queued alongside accesses to preserve their relative order.
+    if (memref.flush.type == TRACE_TYPE_INSTR_FLUSH ||
+        memref.flush.type == TRACE_TYPE_DATA_FLUSH)
+        ((cache_t *)parent_)->flush(memref);
+    else
+        caching_device_t::apply_deferred_parent_request(memref);
+}
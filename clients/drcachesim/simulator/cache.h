@@ -60,6 +60,8 @@ public:
 protected:
     void
     init_blocks() override;
+    void
+    apply_deferred_parent_request(const memref_t &memref) override;
 };
 
 #endif /* _CACHE_H_ */
@@ -0,0 +1,87 @@
+/* **********************************************************
+ * Copyright (c) 2023 Google, Inc.  All rights reserved.
+ * **********************************************************/
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of Google, Inc. nor the names of its contributors may be
+ *   used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL VMWARE, INC. OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+
+#include "cache_bit_plru.h"
+
+bool
+cache_bit_plru_t::init(int associativity, int block_size, int total_size,
+                       caching_device_t *parent, caching_device_stats_t *stats,
+                       prefetcher_t *prefetcher, bool inclusive, bool coherent_cache,
+                       int id, snoop_filter_t *snoop_filter,
+                       const std::vector<caching_device_t *> &children)
+{
+    // The bits of a set must fit in one word.
+    if (associativity > 64)
+        return false;
+    bool ret_val =
+        cache_t::init(associativity, block_size, total_size, parent, stats, prefetcher,
+                      inclusive, coherent_cache, id, snoop_filter, children);
+    if (ret_val == false)
+        return false;
+    all_ways_mask_ = associativity_ == 64 ? ~0ULL : (1ULL << associativity_) - 1;
+    used_bits_.assign(blocks_per_way_, 0);
+    return true;
+}
+
+void
+cache_bit_plru_t::access_update(int block_idx, int way)
+{
+    uint64_t &bits = used_bits_[block_idx / associativity_];
+    bits |= 1ULL << way;
+    // Once every way has been used, start a new epoch with only this way used.
+    if (bits == all_ways_mask_)
+        bits = 1ULL << way;
+}
+
+int
+cache_bit_plru_t::replace_which_way(int block_idx)
+{
+    // The caller's access_update() of the new block sets its bit.
+    return get_next_way_to_replace(block_idx);
+}
+
+int
+cache_bit_plru_t::get_next_way_to_replace(const int block_idx) const
+{
+    uint64_t bits = used_bits_[block_idx / associativity_];
+    for (int way = 0; way < associativity_; ++way) {
+        if (get_caching_device_block(block_idx, way).tag_ == TAG_INVALID)
+            return way;
+    }
+    // There is always a clear bit as a full set of bits is reset on access.
+    for (int way = 0; way < associativity_; ++way) {
+        if ((bits & (1ULL << way)) == 0)
+            return way;
+    }
+    return 0;
+}
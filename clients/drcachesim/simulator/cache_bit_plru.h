@@ -0,0 +1,71 @@
+/* **********************************************************
+ * Copyright (c) 2023 Google, Inc.  All rights reserved.
+ * **********************************************************/
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of Google, Inc. nor the names of its contributors may be
+ *   used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL VMWARE, INC. OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+
+/* cache_bit_plru: represents a single hardware cache with bit pseudo-LRU algo.
+ */
+
+#ifndef _CACHE_BIT_PLRU_H_
+#define _CACHE_BIT_PLRU_H_ 1
+
+#include <stdint.h>
+#include <vector>
+
+#include "cache.h"
+
+// Bit pseudo-LRU (also known as MRU-bit or not-recently-used) keeps one bit per
+// way, set on access.  When the last clear bit would be set, all the other bits
+// are cleared.  The victim is the lowest way with a clear bit.  The associativity
+// must be no larger than 64.
+class cache_bit_plru_t : public cache_t {
+public:
+    bool
+    init(int associativity, int line_size, int total_size, caching_device_t *parent,
+         caching_device_stats_t *stats, prefetcher_t *prefetcher = nullptr,
+         bool inclusive = false, bool coherent_cache = false, int id_ = -1,
+         snoop_filter_t *snoop_filter_ = nullptr,
+         const std::vector<caching_device_t *> &children = {}) override;
+
+protected:
+    void
+    access_update(int block_idx, int way) override;
+    int
+    replace_which_way(int block_idx) override;
+    int
+    get_next_way_to_replace(const int block_idx) const override;
+
+    // The recently-used bits of each set, with way i at bit i.
+    std::vector<uint64_t> used_bits_;
+    uint64_t all_ways_mask_;
+};
+
+#endif /* _CACHE_BIT_PLRU_H_ */
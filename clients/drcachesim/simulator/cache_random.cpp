@@ -0,0 +1,75 @@
+/* **********************************************************
+ * Copyright (c) 2023 Google, Inc.  All rights reserved.
+ * **********************************************************/
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of Google, Inc. nor the names of its contributors may be
+ *   used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL VMWARE, INC. OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+
+#include "cache_random.h"
+
+bool
+cache_random_t::init(int associativity, int block_size, int total_size,
+                     caching_device_t *parent, caching_device_stats_t *stats,
+                     prefetcher_t *prefetcher, bool inclusive, bool coherent_cache,
+                     int id, snoop_filter_t *snoop_filter,
+                     const std::vector<caching_device_t *> &children)
+{
+    random_state_ = 0x2545f4914f6cdd1dULL;
+    return cache_t::init(associativity, block_size, total_size, parent, stats,
+                         prefetcher, inclusive, coherent_cache, id, snoop_filter,
+                         children);
+}
+
+void
+cache_random_t::access_update(int block_idx, int way)
+{
+    // Random replacement ignores the access history.
+    return;
+}
+
+int
+cache_random_t::replace_which_way(int block_idx)
+{
+    int victim_way = get_next_way_to_replace(block_idx);
+    // Advance the xorshift64 generator for the next victim.
+    random_state_ ^= random_state_ << 13;
+    random_state_ ^= random_state_ >> 7;
+    random_state_ ^= random_state_ << 17;
+    return victim_way;
+}
+
+int
+cache_random_t::get_next_way_to_replace(const int block_idx) const
+{
+    for (int way = 0; way < associativity_; ++way) {
+        if (get_caching_device_block(block_idx, way).tag_ == TAG_INVALID)
+            return way;
+    }
+    return static_cast<int>(random_state_ % associativity_);
+}
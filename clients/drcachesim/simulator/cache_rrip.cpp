@@ -0,0 +1,131 @@
+/* **********************************************************
+ * Copyright (c) 2023 Google, Inc.  All rights reserved.
+ * **********************************************************/
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of Google, Inc. nor the names of its contributors may be
+ *   used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL VMWARE, INC. OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+
+#include "cache_rrip.h"
+
+bool
+cache_rrip_t::init(int associativity, int block_size, int total_size,
+                   caching_device_t *parent, caching_device_stats_t *stats,
+                   prefetcher_t *prefetcher, bool inclusive, bool coherent_cache, int id,
+                   snoop_filter_t *snoop_filter,
+                   const std::vector<caching_device_t *> &children)
+{
+    bool ret_val =
+        cache_t::init(associativity, block_size, total_size, parent, stats, prefetcher,
+                      inclusive, coherent_cache, id, snoop_filter, children);
+    if (ret_val == false)
+        return false;
+    // Spread the leader sets evenly, falling back to every set leading for
+    // caches with too few sets for any followers.
+    leader_stride_ = blocks_per_way_ / LEADER_SETS;
+    if (leader_stride_ < 2)
+        leader_stride_ = 2;
+    return true;
+}
+
+cache_rrip_t::rrip_mode_t
+cache_rrip_t::get_set_mode(int block_idx) const
+{
+    if (mode_ != RRIP_DYNAMIC)
+        return mode_;
+    int set = block_idx / associativity_;
+    if (set % leader_stride_ == 0)
+        return RRIP_STATIC;
+    if (set % leader_stride_ == 1)
+        return RRIP_BIMODAL;
+    // Followers use whichever leader policy has been missing less.
+    return psel_ > PSEL_MAX / 2 ? RRIP_BIMODAL : RRIP_STATIC;
+}
+
+void
+cache_rrip_t::access_update(int block_idx, int way)
+{
+    caching_device_block_t &block = get_caching_device_block(block_idx, way);
+    if (block_idx == insert_block_idx_ && way == insert_way_) {
+        block.counter_ = insert_rrpv_;
+        insert_block_idx_ = -1;
+        return;
+    }
+    block.counter_ = 0;
+}
+
+int
+cache_rrip_t::replace_which_way(int block_idx)
+{
+    int victim_way = get_next_way_to_replace(block_idx);
+    // Age the set so that the victim predicts a distant re-reference.
+    if (get_caching_device_block(block_idx, victim_way).tag_ != TAG_INVALID) {
+        int age = RRPV_MAX - get_caching_device_block(block_idx, victim_way).counter_;
+        if (age > 0) {
+            for (int way = 0; way < associativity_; ++way)
+                get_caching_device_block(block_idx, way).counter_ += age;
+        }
+    }
+    if (mode_ == RRIP_DYNAMIC) {
+        int set = block_idx / associativity_;
+        if (set % leader_stride_ == 0 && psel_ < PSEL_MAX)
+            ++psel_;
+        else if (set % leader_stride_ == 1 && psel_ > 0)
+            --psel_;
+    }
+    insert_block_idx_ = block_idx;
+    insert_way_ = victim_way;
+    if (get_set_mode(block_idx) == RRIP_STATIC) {
+        insert_rrpv_ = RRPV_MAX - 1;
+    } else {
+        if (++bimodal_count_ >= BIMODAL_INTERVAL) {
+            bimodal_count_ = 0;
+            insert_rrpv_ = RRPV_MAX - 1;
+        } else
+            insert_rrpv_ = RRPV_MAX;
+    }
+    return victim_way;
+}
+
+int
+cache_rrip_t::get_next_way_to_replace(const int block_idx) const
+{
+    // The victim is the first block with the most distant prediction, which is
+    // the first to reach RRPV_MAX as the set ages.
+    int max_rrpv = -1;
+    int max_way = 0;
+    for (int way = 0; way < associativity_; ++way) {
+        if (get_caching_device_block(block_idx, way).tag_ == TAG_INVALID)
+            return way;
+        if (get_caching_device_block(block_idx, way).counter_ > max_rrpv) {
+            max_rrpv = get_caching_device_block(block_idx, way).counter_;
+            max_way = way;
+        }
+    }
+    return max_way;
+}
@@ -0,0 +1,129 @@
+/* **********************************************************
+ * Copyright (c) 2023 Google, Inc.  All rights reserved.
+ * **********************************************************/
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of Google, Inc. nor the names of its contributors may be
+ *   used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL VMWARE, INC. OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+
+/* cache_rrip: represents a single hardware cache with re-reference interval
+ * prediction (RRIP) algos.
+ */
+
+#ifndef _CACHE_RRIP_H_
+#define _CACHE_RRIP_H_ 1
+
+#include "cache.h"
+
+// RRIP (Jaleel et al., ISCA 2010) keeps a 2-bit re-reference prediction value
+// (RRPV) per block in its counter_.  Hits predict a near re-reference (0), and the
+// victim is a block predicting a distant one (RRPV_MAX), aging the set until one
+// does.  The variants differ in the prediction given to new blocks:
+// + Static RRIP (SRRIP) inserts with a long prediction (RRPV_MAX - 1).
+// + Bimodal RRIP (BRRIP) inserts with a distant prediction, except for one in
+//   every BIMODAL_INTERVAL insertions, which protects against thrashing.
+// + Dynamic RRIP (DRRIP) dedicates some leader sets to each of the above and
+//   uses set dueling to pick the policy with fewer misses for the other sets.
+class cache_rrip_t : public cache_t {
+public:
+    enum rrip_mode_t {
+        RRIP_STATIC,
+        RRIP_BIMODAL,
+        RRIP_DYNAMIC,
+    };
+
+    bool
+    init(int associativity, int line_size, int total_size, caching_device_t *parent,
+         caching_device_stats_t *stats, prefetcher_t *prefetcher = nullptr,
+         bool inclusive = false, bool coherent_cache = false, int id_ = -1,
+         snoop_filter_t *snoop_filter_ = nullptr,
+         const std::vector<caching_device_t *> &children = {}) override;
+
+protected:
+    explicit cache_rrip_t(rrip_mode_t mode)
+        : mode_(mode)
+    {
+    }
+
+    void
+    access_update(int block_idx, int way) override;
+    int
+    replace_which_way(int block_idx) override;
+    int
+    get_next_way_to_replace(const int block_idx) const override;
+
+    // Returns the insertion policy for the set starting at block_idx: either
+    // RRIP_STATIC or RRIP_BIMODAL.
+    rrip_mode_t
+    get_set_mode(int block_idx) const;
+
+    static const int RRPV_MAX = 3;
+    static const int BIMODAL_INTERVAL = 32;
+    static const int LEADER_SETS = 32;
+    static const int PSEL_MAX = 1023;
+
+    const rrip_mode_t mode_;
+    // Bimodal insertions since the last long prediction.
+    int bimodal_count_ = 0;
+    // Under DRRIP, sets whose index is 0 modulo leader_stride_ lead for SRRIP, and
+    // sets whose index is 1 modulo leader_stride_ lead for BRRIP.
+    int leader_stride_ = 0;
+    // Saturating policy selector: SRRIP leader misses count up, BRRIP down.
+    int psel_ = (PSEL_MAX + 1) / 2;
+    // The block filled by the last replace_which_way(), which access_update()
+    // gives its insertion prediction rather than the hit prediction.
+    int insert_block_idx_ = -1;
+    int insert_way_ = -1;
+    int insert_rrpv_ = 0;
+};
+
+class cache_srrip_t : public cache_rrip_t {
+public:
+    cache_srrip_t()
+        : cache_rrip_t(RRIP_STATIC)
+    {
+    }
+};
+
+class cache_brrip_t : public cache_rrip_t {
+public:
+    cache_brrip_t()
+        : cache_rrip_t(RRIP_BIMODAL)
+    {
+    }
+};
+
+class cache_drrip_t : public cache_rrip_t {
+public:
+    cache_drrip_t()
+        : cache_rrip_t(RRIP_DYNAMIC)
+    {
+    }
+};
+
+#endif /* _CACHE_RRIP_H_ */
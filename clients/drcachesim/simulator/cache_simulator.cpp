@@ -30,6 +30,7 @@
  * DAMAGE.
  */
 
+#include <algorithm>
 #include <iostream>
 #include <iterator>
 #include <string>
@@ -46,7 +47,15 @@
 #include "cache.h"
 #include "cache_lru.h"
 #include "cache_fifo.h"
+#include "cache_tree_plru.h"
+#include "cache_bit_plru.h"
+#include "cache_rrip.h"
+#include "cache_random.h"
+#include "prefetcher_stride.h"
+#include "prefetcher_stream.h"
+#include "prefetcher_ip_delta.h"
 #include "cache_simulator.h"
+#include "cache_sweep.h"
 #include "droption.h"
 
 #include "snoop_filter.h"
@@ -59,6 +68,12 @@ cache_simulator_create(const cache_simulator_knobs_t &knobs)
 
 analysis_tool_t *
 cache_simulator_create(const std::string &config_file)
+{
+    return cache_simulator_create(config_file, 1);
+}
+
+analysis_tool_t *
+cache_simulator_create(const std::string &config_file, unsigned int sweep_threads)
 {
     std::ifstream fin;
     fin.open(config_file);
@@ -66,9 +81,17 @@ cache_simulator_create(const std::string &config_file)
         ERRMSG("Failed to open the config file '%s'\n", config_file.c_str());
         return nullptr;
     }
-    analysis_tool_t *sim = new cache_simulator_t(&fin);
+    std::vector<cache_hierarchy_params_t> hierarchies;
+    config_reader_t config_reader;
+    bool parsed = config_reader.configure(&fin, hierarchies);
     fin.close();
-    return sim;
+    if (!parsed) {
+        ERRMSG("Failed to read/parse the config file '%s'\n", config_file.c_str());
+        return nullptr;
+    }
+    if (hierarchies.size() > 1)
+        return new cache_sweep_t(hierarchies, sweep_threads);
+    return new cache_simulator_t(hierarchies[0].knobs, hierarchies[0].caches);
 }
 
 cache_simulator_t::cache_simulator_t(const cache_simulator_knobs_t &knobs)
@@ -94,13 +117,17 @@ cache_simulator_t::cache_simulator_t(const cache_simulator_knobs_t &knobs)
     all_caches_[cache_name] = llc;
     llcaches_[cache_name] = llc;
 
-    if (knobs_.data_prefetcher != PREFETCH_POLICY_NEXTLINE &&
-        knobs_.data_prefetcher != PREFETCH_POLICY_NONE) {
+    if (!is_valid_prefetcher(knobs_.data_prefetcher)) {
         // Unknown value.
         error_string_ = " unknown data_prefetcher: '" + knobs_.data_prefetcher + "'";
         success_ = false;
         return;
     }
+    if (knobs_.data_prefetch_degree == 0) {
+        error_string_ = "Usage error: data_prefetch_degree must be >0";
+        success_ = false;
+        return;
+    }
 
     bool warmup_enabled_ = ((knobs_.warmup_refs > 0) || (knobs_.warmup_fraction > 0.0));
 
@@ -149,9 +176,8 @@ cache_simulator_t::cache_simulator_t(const cache_simulator_knobs_t &knobs)
                 knobs_.L1D_assoc, (int)knobs_.line_size, (int)knobs_.L1D_size, llc,
                 new cache_stats_t((int)knobs_.line_size, "", warmup_enabled_,
                                   knobs_.model_coherence),
-                knobs_.data_prefetcher == PREFETCH_POLICY_NEXTLINE
-                    ? new prefetcher_t((int)knobs_.line_size)
-                    : nullptr,
+                create_prefetcher(knobs_.data_prefetcher,
+                                  (int)knobs_.data_prefetch_degree),
                 false /*inclusive*/, knobs_.model_coherence, (2 * i) + 1,
                 snoop_filter_)) {
             error_string_ = "Usage error: failed to initialize L1 caches.  Ensure sizes "
@@ -173,6 +199,10 @@ cache_simulator_t::cache_simulator_t(const cache_simulator_knobs_t &knobs)
         success_ = false;
         return;
     }
+    if (!init_set_sampling()) {
+        success_ = false;
+        return;
+    }
 }
 
 cache_simulator_t::cache_simulator_t(std::istream *config_file)
@@ -190,13 +220,33 @@ cache_simulator_t::cache_simulator_t(std::istream *config_file)
         success_ = false;
         return;
     }
+    init_from_config(cache_params);
+}
 
+cache_simulator_t::cache_simulator_t(
+    const cache_simulator_knobs_t &knobs,
+    const std::map<std::string, cache_params_t> &cache_params)
+    : simulator_t()
+    , knobs_(knobs)
+    , l1_icaches_(NULL)
+    , l1_dcaches_(NULL)
+    , snooped_caches_(NULL)
+    , snoop_filter_(NULL)
+    , is_warmed_up_(false)
+{
+    init_from_config(cache_params);
+}
+
+void
+cache_simulator_t::init_from_config(
+    const std::map<std::string, cache_params_t> &cache_params)
+{
+    from_config_file_ = true;
     init_knobs(knobs_.num_cores, knobs_.skip_refs, knobs_.warmup_refs,
                knobs_.warmup_fraction, knobs_.sim_refs, knobs_.cpu_scheduling,
                knobs_.use_physical, knobs_.verbose);
 
-    if (knobs_.data_prefetcher != PREFETCH_POLICY_NEXTLINE &&
-        knobs_.data_prefetcher != PREFETCH_POLICY_NONE) {
+    if (!is_valid_prefetcher(knobs_.data_prefetcher)) {
         // Unknown prefetcher type.
         success_ = false;
         return;
@@ -293,7 +343,7 @@ cache_simulator_t::cache_simulator_t(std::istream *config_file)
         // Locate the cache's children.
         std::vector<caching_device_t *> children;
         children.clear();
-        for (std::string &child_name : cache_config.children) {
+        for (const std::string &child_name : cache_config.children) {
             const auto &child_it = all_caches_.find(child_name);
             if (child_it == all_caches_.end()) {
                 error_string_ =
@@ -319,15 +369,16 @@ cache_simulator_t::cache_simulator_t(std::istream *config_file)
                          (int)cache_config.size, parent_,
                          new cache_stats_t((int)knobs_.line_size, cache_config.miss_file,
                                            warmup_enabled_, is_coherent_),
-                         cache_config.prefetcher == PREFETCH_POLICY_NEXTLINE
-                             ? new prefetcher_t((int)knobs_.line_size)
-                             : nullptr,
+                         create_prefetcher(cache_config.prefetcher,
+                                           (int)cache_config.prefetch_degree),
                          cache_config.inclusive, is_coherent_, is_snooped ? snoop_id : -1,
                          is_snooped ? snoop_filter_ : nullptr, children)) {
             error_string_ = "Usage error: failed to initialize the cache " + cache_name;
             success_ = false;
             return;
         }
+        if (cache_config.inclusive)
+            has_inclusive_cache_ = true;
 
         // Next snooped cache should have a different ID.
         if (is_snooped) {
@@ -366,6 +417,10 @@ cache_simulator_t::cache_simulator_t(std::istream *config_file)
         success_ = false;
         return;
     }
+    if (!init_set_sampling()) {
+        success_ = false;
+        return;
+    }
     // For larger hierarchies, especially with coherence, using hashtables
     // for faster lookups provides performance wins as high as 15%.
     // However, hashtables can slow down smaller hierarchies, so we only
@@ -459,40 +514,8 @@ cache_simulator_t::process_memref(const memref_t &memref)
         simref = &phys_memref;
     }
 
-    if (type_is_instr(simref->instr.type) ||
-        simref->instr.type == TRACE_TYPE_PREFETCH_INSTR) {
-        if (knobs_.verbose >= 3) {
-            std::cerr << "::" << simref->data.pid << "." << simref->data.tid << ":: "
-                      << " @" << (void *)simref->instr.addr << " instr x"
-                      << simref->instr.size << "\n";
-        }
-        l1_icaches_[core]->request(*simref);
-    } else if (simref->data.type == TRACE_TYPE_READ ||
-               simref->data.type == TRACE_TYPE_WRITE ||
-               // We may potentially handle prefetches differently.
-               // TRACE_TYPE_PREFETCH_INSTR is handled above.
-               type_is_prefetch(simref->data.type)) {
-        if (knobs_.verbose >= 3) {
-            std::cerr << "::" << simref->data.pid << "." << simref->data.tid << ":: "
-                      << " @" << (void *)simref->data.pc << " "
-                      << trace_type_names[simref->data.type] << " "
-                      << (void *)simref->data.addr << " x" << simref->data.size << "\n";
-        }
-        l1_dcaches_[core]->request(*simref);
-    } else if (simref->flush.type == TRACE_TYPE_INSTR_FLUSH) {
-        if (knobs_.verbose >= 3) {
-            std::cerr << "::" << simref->data.pid << "." << simref->data.tid << ":: "
-                      << " @" << (void *)simref->data.pc << " iflush "
-                      << (void *)simref->data.addr << " x" << simref->data.size << "\n";
-        }
-        l1_icaches_[core]->flush(*simref);
-    } else if (simref->flush.type == TRACE_TYPE_DATA_FLUSH) {
-        if (knobs_.verbose >= 3) {
-            std::cerr << "::" << simref->data.pid << "." << simref->data.tid << ":: "
-                      << " @" << (void *)simref->data.pc << " dflush "
-                      << (void *)simref->data.addr << " x" << simref->data.size << "\n";
-        }
-        l1_dcaches_[core]->flush(*simref);
+    if (request_l1(core, *simref)) {
+        // Handled.
     } else if (simref->exit.type == TRACE_TYPE_THREAD_EXIT) {
         handle_thread_exit(simref->exit.tid);
         last_thread_ = 0;
@@ -527,6 +550,232 @@ cache_simulator_t::process_memref(const memref_t &memref)
     return true;
 }
 
+bool
+cache_simulator_t::request_l1(int core, const memref_t &simref)
+{
+    if (type_is_instr(simref.instr.type) ||
+        simref.instr.type == TRACE_TYPE_PREFETCH_INSTR) {
+        if (knobs_.verbose >= 3) {
+            std::cerr << "::" << simref.data.pid << "." << simref.data.tid << ":: "
+                      << " @" << (void *)simref.instr.addr << " instr x"
+                      << simref.instr.size << "\n";
+        }
+        l1_icaches_[core]->request(simref);
+    } else if (simref.data.type == TRACE_TYPE_READ ||
+               simref.data.type == TRACE_TYPE_WRITE ||
+               // We may potentially handle prefetches differently.
+               // TRACE_TYPE_PREFETCH_INSTR is handled above.
+               type_is_prefetch(simref.data.type)) {
+        if (knobs_.verbose >= 3) {
+            std::cerr << "::" << simref.data.pid << "." << simref.data.tid << ":: "
+                      << " @" << (void *)simref.data.pc << " "
+                      << trace_type_names[simref.data.type] << " "
+                      << (void *)simref.data.addr << " x" << simref.data.size << "\n";
+        }
+        l1_dcaches_[core]->request(simref);
+    } else if (simref.flush.type == TRACE_TYPE_INSTR_FLUSH) {
+        if (knobs_.verbose >= 3) {
+            std::cerr << "::" << simref.data.pid << "." << simref.data.tid << ":: "
+                      << " @" << (void *)simref.data.pc << " iflush "
+                      << (void *)simref.data.addr << " x" << simref.data.size << "\n";
+        }
+        l1_icaches_[core]->flush(simref);
+    } else if (simref.flush.type == TRACE_TYPE_DATA_FLUSH) {
+        if (knobs_.verbose >= 3) {
+            std::cerr << "::" << simref.data.pid << "." << simref.data.tid << ":: "
+                      << " @" << (void *)simref.data.pc << " dflush "
+                      << (void *)simref.data.addr << " x" << simref.data.size << "\n";
+        }
+        l1_dcaches_[core]->flush(simref);
+    } else
+        return false;
+    return true;
+}
+
+std::string
+cache_simulator_t::initialize_shard_type(shard_type_t shard_type)
+{
+    shard_type_ = shard_type;
+    if (shard_type_ == SHARD_BY_TIME_SLICE) {
+        // Each slice builds its own hierarchy from knobs_ and only its stats are
+        // combined, so anything else carrying state across the trace is unsupported.
+        if (from_config_file_)
+            return "Time-slice sharding requires a knob-configured cache hierarchy";
+        if (knobs_.model_coherence)
+            return "Coherence modeling is not supported with time-slice sharding";
+        if (knobs_.use_physical)
+            return "Physical addresses are not supported with time-slice sharding";
+        if (!knobs_.LL_miss_file.empty())
+            return "Miss files are not supported with time-slice sharding";
+        if (knobs_.skip_refs > 0 || knobs_.warmup_refs > 0 ||
+            knobs_.warmup_fraction > 0.0 ||
+            knobs_.sim_refs != cache_simulator_knobs_t().sim_refs) {
+            return "Reference skipping, warmup, and limits are not supported with "
+                   "time-slice sharding: use -time_slice_warmup_instrs";
+        }
+        return "";
+    }
+    if (shard_type_ == SHARD_BY_THREAD)
+        return "";
+    if (shard_type_ != SHARD_BY_CORE)
+        return "Unsupported shard type";
+    // Only the L1 caches are private to a core's worker.  Anything that reaches
+    // into another core's L1 caches, or that counts references globally, would
+    // need cross-worker synchronization on every access and is not supported.
+    if (knobs_.model_coherence)
+        return "Coherence modeling is not supported with core sharding";
+    if (has_inclusive_cache_)
+        return "Inclusive caches are not supported with core sharding";
+    if (knobs_.use_physical)
+        return "Physical addresses are not supported with core sharding";
+    if (knobs_.skip_refs > 0 || knobs_.warmup_refs > 0 || knobs_.warmup_fraction > 0.0 ||
+        knobs_.sim_refs != cache_simulator_knobs_t().sim_refs) {
+        return "Reference skipping, warmup, and limits are not supported with "
+               "core sharding";
+    }
+    // The scheduler decides which core each thread runs on.
+    knob_cpu_scheduling_ = false;
+    for (unsigned int i = 0; i < knobs_.num_cores; i++) {
+        l1_icaches_[i]->set_parent_deferral(true);
+        l1_dcaches_[i]->set_parent_deferral(true);
+    }
+    return "";
+}
+
+bool
+cache_simulator_t::parallel_shard_supported()
+{
+    return shard_type_ == SHARD_BY_CORE || shard_type_ == SHARD_BY_TIME_SLICE;
+}
+
+void *
+cache_simulator_t::parallel_shard_init_stream(int shard_index, void *worker_data,
+                                              memtrace_stream_t *shard_stream)
+{
+    if (shard_type_ == SHARD_BY_TIME_SLICE) {
+        per_slice_t *per_slice = new per_slice_t;
+        per_slice->sim.reset(new cache_simulator_t(knobs_));
+        if (!*per_slice->sim)
+            per_slice->error = per_slice->sim->get_error_string();
+        return reinterpret_cast<void *>(per_slice);
+    }
+    per_core_t *per_core = new per_core_t;
+    if (shard_index < 0 || shard_index >= static_cast<int>(knobs_.num_cores)) {
+        per_core->error = "Core shard " + std::to_string(shard_index) +
+            " is beyond the configured core count";
+    } else
+        per_core->core = shard_index;
+    return reinterpret_cast<void *>(per_core);
+}
+
+bool
+cache_simulator_t::parallel_shard_exit(void *shard_data)
+{
+    if (shard_type_ == SHARD_BY_TIME_SLICE) {
+        per_slice_t *per_slice = reinterpret_cast<per_slice_t *>(shard_data);
+        merge_slice(*per_slice->sim);
+        delete per_slice;
+        return true;
+    }
+    per_core_t *per_core = reinterpret_cast<per_core_t *>(shard_data);
+    if (per_core->core >= 0) {
+        apply_core_deferrals(per_core, true);
+        // Each core is written only by its own shard.
+        thread_ever_counts_[per_core->core] = static_cast<int>(per_core->tids.size());
+    }
+    delete per_core;
+    return true;
+}
+
+std::string
+cache_simulator_t::parallel_shard_error(void *shard_data)
+{
+    if (shard_type_ == SHARD_BY_TIME_SLICE)
+        return reinterpret_cast<per_slice_t *>(shard_data)->error;
+    per_core_t *per_core = reinterpret_cast<per_core_t *>(shard_data);
+    return per_core->error;
+}
+
+bool
+cache_simulator_t::parallel_shard_memref(void *shard_data, const memref_t &memref)
+{
+    if (shard_type_ == SHARD_BY_TIME_SLICE) {
+        per_slice_t *per_slice = reinterpret_cast<per_slice_t *>(shard_data);
+        if (!per_slice->error.empty())
+            return false;
+        if (!per_slice->sim->process_memref(memref)) {
+            per_slice->error = per_slice->sim->get_error_string();
+            return false;
+        }
+        return true;
+    }
+    per_core_t *per_core = reinterpret_cast<per_core_t *>(shard_data);
+    if (per_core->core < 0)
+        return false;
+    if (memref.marker.type == TRACE_TYPE_MARKER)
+        return true;
+    if (memref.data.tid != per_core->last_tid) {
+        per_core->tids.insert(memref.data.tid);
+        per_core->last_tid = memref.data.tid;
+    }
+    if (!request_l1(per_core->core, memref)) {
+        if (memref.exit.type == TRACE_TYPE_THREAD_EXIT ||
+            memref.marker.type == TRACE_TYPE_INSTR_NO_FETCH)
+            return true;
+        per_core->error = "Unhandled memref type " + std::to_string(memref.data.type);
+        return false;
+    }
+    apply_core_deferrals(per_core, false);
+    return true;
+}
+
+void
+cache_simulator_t::apply_core_deferrals(per_core_t *per_core, bool force)
+{
+    cache_t *icache = l1_icaches_[per_core->core];
+    cache_t *dcache = l1_dcaches_[per_core->core];
+    size_t pending = icache->get_deferred_parent_request_count();
+    if (dcache != icache)
+        pending += dcache->get_deferred_parent_request_count();
+    if (!force && pending < CORE_DEFERRAL_BATCH)
+        return;
+    std::unique_lock<std::mutex> lock(shared_caches_mutex_, std::defer_lock);
+    if (force || pending >= CORE_DEFERRAL_MAX)
+        lock.lock();
+    else if (!lock.try_lock())
+        return; // Keep simulating and try again later.
+    icache->apply_deferred_parent_requests();
+    if (dcache != icache)
+        dcache->apply_deferred_parent_requests();
+}
+
+bool
+cache_simulator_t::parallel_shard_warmup_end(void *shard_data)
+{
+    per_slice_t *per_slice = reinterpret_cast<per_slice_t *>(shard_data);
+    // Keep the warmed-up cache contents but count only the slice itself.
+    for (auto &cache_it : per_slice->sim->all_caches_)
+        cache_it.second->get_stats()->reset();
+    return true;
+}
+
+void
+cache_simulator_t::merge_slice(const cache_simulator_t &slice)
+{
+    std::lock_guard<std::mutex> guard(shared_caches_mutex_);
+    for (const auto &cache_it : slice.all_caches_) {
+        auto ours = all_caches_.find(cache_it.first);
+        assert(ours != all_caches_.end());
+        ours->second->get_stats()->merge(*cache_it.second->get_stats());
+    }
+    // Every slice runs the same thread(s), so we take the maximum rather than
+    // the sum.
+    for (unsigned int i = 0; i < knobs_.num_cores; i++) {
+        thread_ever_counts_[i] =
+            std::max(thread_ever_counts_[i], slice.thread_ever_counts_[i]);
+    }
+}
+
 // Return true if the number of warmup references have been executed or if
 // specified fraction of the llcaches_ has been loaded. Also return true if the
 // cache has already been warmed up. When there are multiple last level caches
@@ -568,6 +817,40 @@ cache_simulator_t::check_warmed_up()
     return false;
 }
 
+bool
+cache_simulator_t::init_set_sampling()
+{
+    if (knobs_.set_sampling <= 1)
+        return true;
+    // With a common line size, the smallest cache's set index bits are the low
+    // bits of every other cache's set index, so sampling on just those bits keeps
+    // the same whole sets of the smaller caches feeding the larger ones.
+    int index_bits = -1;
+    for (auto &caches_it : all_caches_) {
+        int bits = compute_log2(caches_it.second->get_num_sets());
+        if (index_bits == -1 || bits < index_bits)
+            index_bits = bits;
+    }
+    if (!IS_POWER_OF_2(knobs_.set_sampling) ||
+        knobs_.set_sampling > (1U << index_bits)) {
+        error_string_ = "Usage error: set_sampling must be a power of 2 no larger "
+                        "than the smallest cache's number of sets (" +
+            std::to_string(1U << index_bits) + ")";
+        return false;
+    }
+    for (auto &caches_it : all_caches_) {
+        cache_t *cache = caches_it.second;
+        int sampled_sets = cache->set_set_sampling(
+            (int)knobs_.set_sampling, index_bits, knobs_.set_sampling_hashed);
+        if (sampled_sets == 0) {
+            error_string_ = "Failed to enable set sampling for " + caches_it.first;
+            return false;
+        }
+        cache->get_stats()->set_set_sampling(sampled_sets, cache->get_num_sets());
+    }
+    return true;
+}
+
 bool
 cache_simulator_t::print_results()
 {
@@ -658,9 +941,48 @@ cache_simulator_t::create_cache(const std::string &policy)
         return new cache_t;
     if (policy == REPLACE_POLICY_FIFO) // set to FIFO
         return new cache_fifo_t;
+    if (policy == REPLACE_POLICY_TREE_PLRU)
+        return new cache_tree_plru_t;
+    if (policy == REPLACE_POLICY_BIT_PLRU)
+        return new cache_bit_plru_t;
+    if (policy == REPLACE_POLICY_SRRIP)
+        return new cache_srrip_t;
+    if (policy == REPLACE_POLICY_BRRIP)
+        return new cache_brrip_t;
+    if (policy == REPLACE_POLICY_DRRIP)
+        return new cache_drrip_t;
+    if (policy == REPLACE_POLICY_RANDOM)
+        return new cache_random_t;
 
     // undefined replacement policy
     ERRMSG("Usage error: undefined replacement policy. "
-           "Please choose " REPLACE_POLICY_LRU " or " REPLACE_POLICY_LFU ".\n");
+           "Please choose " REPLACE_POLICY_LRU ", " REPLACE_POLICY_LFU
+           ", " REPLACE_POLICY_FIFO ", " REPLACE_POLICY_TREE_PLRU
+           ", " REPLACE_POLICY_BIT_PLRU ", " REPLACE_POLICY_SRRIP
+           ", " REPLACE_POLICY_BRRIP ", " REPLACE_POLICY_DRRIP
+           ", or " REPLACE_POLICY_RANDOM ".\n");
     return NULL;
 }
+
+bool
+cache_simulator_t::is_valid_prefetcher(const std::string &policy)
+{
+    return policy == PREFETCH_POLICY_NEXTLINE || policy == PREFETCH_POLICY_STRIDE ||
+        policy == PREFETCH_POLICY_STREAM || policy == PREFETCH_POLICY_IP_DELTA ||
+        policy == PREFETCH_POLICY_NONE;
+}
+
+prefetcher_t *
+cache_simulator_t::create_prefetcher(const std::string &policy, int degree)
+{
+    int line_size = (int)knobs_.line_size;
+    if (policy == PREFETCH_POLICY_NEXTLINE)
+        return new prefetcher_t(line_size, degree);
+    if (policy == PREFETCH_POLICY_STRIDE)
+        return new prefetcher_stride_t(line_size, degree);
+    if (policy == PREFETCH_POLICY_STREAM)
+        return new prefetcher_stream_t(line_size, degree);
+    if (policy == PREFETCH_POLICY_IP_DELTA)
+        return new prefetcher_ip_delta_t(line_size, degree);
+    return nullptr;
+}
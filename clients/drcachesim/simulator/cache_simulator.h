@@ -36,7 +36,12 @@
 #ifndef _CACHE_SIMULATOR_H_
 #define _CACHE_SIMULATOR_H_ 1
 
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
 #include <unordered_map>
+#include <unordered_set>
 #include "simulator.h"
 #include "cache_simulator_create.h"
 #include "cache_stats.h"
@@ -46,6 +51,8 @@
 
 enum class cache_split_t { DATA, INSTRUCTION };
 
+struct cache_params_t;
+
 // Error codes returned when passing wrong parameters to the
 // get_cache_metric function.
 typedef enum {
@@ -68,12 +75,38 @@ public:
     // defined in a configuration file.
     cache_simulator_t(std::istream *config_file);
 
+    // This constructor is used for one hierarchy of a configuration file that
+    // was already parsed by config_reader_t.
+    cache_simulator_t(const cache_simulator_knobs_t &knobs,
+                      const std::map<std::string, cache_params_t> &cache_params);
+
     virtual ~cache_simulator_t();
     bool
     process_memref(const memref_t &memref) override;
     bool
     print_results() override;
 
+    // With #SHARD_BY_CORE, each simulated core's private L1 caches are simulated
+    // in parallel by that core's worker, while accesses to the shared caches are
+    // handed off in batches (see caching_device_t::set_parent_deferral()).
+    // With #SHARD_BY_TIME_SLICE, each slice simulates its own copy of the whole
+    // hierarchy and its stats are added to ours when the slice ends.
+    std::string
+    initialize_shard_type(shard_type_t shard_type) override;
+    bool
+    parallel_shard_supported() override;
+    void *
+    parallel_shard_init_stream(int shard_index, void *worker_data,
+                               memtrace_stream_t *shard_stream) override;
+    bool
+    parallel_shard_exit(void *shard_data) override;
+    bool
+    parallel_shard_warmup_end(void *shard_data) override;
+    bool
+    parallel_shard_memref(void *shard_data, const memref_t &memref) override;
+    std::string
+    parallel_shard_error(void *shard_data) override;
+
     int_least64_t
     get_cache_metric(metric_name_t metric, unsigned level, unsigned core = 0,
                      cache_split_t split = cache_split_t::DATA) const;
@@ -88,10 +121,57 @@ public:
     get_knobs() const;
 
 protected:
+    // Builds the hierarchy described by cache_params using knobs_.
+    void
+    init_from_config(const std::map<std::string, cache_params_t> &cache_params);
+
     // Create a cache_t object with a specific replacement policy.
     virtual cache_t *
     create_cache(const std::string &policy);
 
+    // Create a prefetcher_t object of a specific type, or nullptr for
+    // PREFETCH_POLICY_NONE or an unknown type.
+    virtual prefetcher_t *
+    create_prefetcher(const std::string &policy, int degree);
+
+    // Returns whether policy names a known prefetcher type.
+    static bool
+    is_valid_prefetcher(const std::string &policy);
+
+    // Applies knobs_.set_sampling to every cache, choosing the sampled sets from
+    // the index bits common to all of them.  Returns false and sets error_string_
+    // on an invalid sampling rate.
+    bool
+    init_set_sampling();
+
+    // Sends an instruction fetch, data access, or flush to the given core's
+    // L1 caches.  Returns false if the memref is of any other type.
+    bool
+    request_l1(int core, const memref_t &simref);
+
+    // Per-core state for #SHARD_BY_CORE.
+    struct per_core_t {
+        int core = -1;
+        memref_tid_t last_tid = 0;
+        std::unordered_set<memref_tid_t> tids;
+        std::string error;
+    };
+
+    // Applies the core's queued shared-cache accesses once enough have built up,
+    // or unconditionally if "force" is set.
+    void
+    apply_core_deferrals(per_core_t *per_core, bool force);
+
+    // Per-slice state for #SHARD_BY_TIME_SLICE.
+    struct per_slice_t {
+        std::unique_ptr<cache_simulator_t> sim;
+        std::string error;
+    };
+
+    // Adds the stats of a finished slice's hierarchy to ours.
+    void
+    merge_slice(const cache_simulator_t &slice);
+
     cache_simulator_knobs_t knobs_;
 
     // Implement a set of ICaches and DCaches with pointer arrays.
@@ -112,6 +192,22 @@ protected:
     // Snoop filter tracks ownership of cache lines across private caches.
     snoop_filter_t *snoop_filter_ = nullptr;
 
+    // Whether any cache was configured as inclusive of its children.
+    bool has_inclusive_cache_ = false;
+
+    // Whether the hierarchy came from a config file rather than from knobs_.
+    bool from_config_file_ = false;
+
+    shard_type_t shard_type_ = SHARD_BY_THREAD;
+    // For #SHARD_BY_CORE, serializes all access to the caches above the L1 caches.
+    // For #SHARD_BY_TIME_SLICE, serializes merging slice stats into our caches.
+    std::mutex shared_caches_mutex_;
+    // A core tries to apply its queued shared-cache accesses once it has this many,
+    // but without waiting on another core that holds the lock.
+    static constexpr size_t CORE_DEFERRAL_BATCH = 1024;
+    // Once this many are queued the core waits for the lock.
+    static constexpr size_t CORE_DEFERRAL_MAX = 16 * CORE_DEFERRAL_BATCH;
+
 private:
     bool is_warmed_up_;
 };
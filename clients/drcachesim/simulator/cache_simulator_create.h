@@ -62,6 +62,9 @@ struct cache_simulator_knobs_t {
         , model_coherence(false)
         , replace_policy("LRU")
         , data_prefetcher("nextline")
+        , data_prefetch_degree(1)
+        , set_sampling(1)
+        , set_sampling_hashed(true)
         , skip_refs(0)
         , warmup_refs(0)
         , warmup_fraction(0.0)
@@ -83,6 +86,9 @@ struct cache_simulator_knobs_t {
     bool model_coherence;
     std::string replace_policy;
     std::string data_prefetcher;
+    unsigned int data_prefetch_degree;
+    unsigned int set_sampling;
+    bool set_sampling_hashed;
     uint64_t skip_refs;
     uint64_t warmup_refs;
     double warmup_fraction;
@@ -103,6 +109,15 @@ cache_simulator_create(const cache_simulator_knobs_t &knobs);
 analysis_tool_t *
 cache_simulator_create(const std::string &config_file);
 
+/**
+ * Creates an instance of a cache simulator using the cache hierarchy or
+ * hierarchies defined in a configuration file.  When the file lists several
+ * independent hierarchies, each trace entry is fed to all of them, with the
+ * hierarchies split across \p sweep_threads threads.
+ */
+analysis_tool_t *
+cache_simulator_create(const std::string &config_file, unsigned int sweep_threads);
+
 /** Creates an instance of a cache miss analyzer. */
 analysis_tool_t *
 cache_miss_analyzer_create(const cache_simulator_knobs_t &knobs,
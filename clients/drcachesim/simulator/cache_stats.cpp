@@ -87,6 +87,7 @@ cache_stats_t::print_counts(std::string prefix)
         std::cerr << prefix << std::setw(18) << std::left
                   << "Prefetch misses:" << std::setw(20) << std::right
                   << num_prefetch_misses_ << std::endl;
+        print_prefetch_usage(prefix);
     }
 }
 
@@ -98,3 +99,15 @@ cache_stats_t::reset()
     num_prefetch_hits_ = 0;
     num_prefetch_misses_ = 0;
 }
+
+void
+cache_stats_t::merge(const caching_device_stats_t &other)
+{
+    caching_device_stats_t::merge(other);
+    const cache_stats_t *cache_other = dynamic_cast<const cache_stats_t *>(&other);
+    if (cache_other == nullptr)
+        return;
+    num_flushes_ += cache_other->num_flushes_;
+    num_prefetch_hits_ += cache_other->num_prefetch_hits_;
+    num_prefetch_misses_ += cache_other->num_prefetch_misses_;
+}
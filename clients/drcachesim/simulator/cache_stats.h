@@ -57,6 +57,9 @@ public:
     void
     reset() override;
 
+    void
+    merge(const caching_device_stats_t &other) override;
+
 protected:
     // In addition to caching_device_stats_t::print_counts,
     // cache_stats_t::print_counts prints stats for flushes and
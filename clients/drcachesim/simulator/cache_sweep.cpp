@@ -0,0 +1,193 @@
+/* **********************************************************
+ * Copyright (c) 2023 Google, Inc.  All rights reserved.
+ * **********************************************************/
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of Google, Inc. nor the names of its contributors may be
+ *   used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL VMWARE, INC. OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+
+#include "cache_sweep.h"
+
+#include <algorithm>
+#include <iostream>
+
+cache_sweep_t::cache_sweep_t(const std::vector<cache_hierarchy_params_t> &hierarchies,
+                             unsigned int num_threads)
+{
+    for (const auto &params : hierarchies) {
+        hierarchy_t hierarchy;
+        hierarchy.name = params.name;
+        hierarchy.sim.reset(new cache_simulator_t(params.knobs, params.caches));
+        if (!*hierarchy.sim) {
+            error_string_ =
+                "Hierarchy " + params.name + ": " + hierarchy.sim->get_error_string();
+            success_ = false;
+            return;
+        }
+        hierarchies_.push_back(std::move(hierarchy));
+    }
+    batch_.reserve(BATCH_SIZE);
+    num_threads = std::max(1u, std::min(num_threads, (unsigned int)hierarchies_.size()));
+    worker_errors_.resize(num_threads);
+    for (unsigned int i = 1; i < num_threads; ++i)
+        threads_.emplace_back(&cache_sweep_t::worker_loop, this, i);
+}
+
+cache_sweep_t::~cache_sweep_t()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        exiting_ = true;
+    }
+    batch_ready_.notify_all();
+    for (auto &thread : threads_)
+        thread.join();
+}
+
+std::string
+cache_sweep_t::initialize_shard_type(shard_type_t shard_type)
+{
+    if (shard_type != SHARD_BY_THREAD)
+        return "Only thread sharding is supported with multiple cache hierarchies";
+    return "";
+}
+
+std::string
+cache_sweep_t::initialize_stream(memtrace_stream_t *serial_stream)
+{
+    for (auto &hierarchy : hierarchies_) {
+        std::string error = hierarchy.sim->initialize_stream(serial_stream);
+        if (!error.empty())
+            return "Hierarchy " + hierarchy.name + ": " + error;
+    }
+    return "";
+}
+
+bool
+cache_sweep_t::process_memref(const memref_t &memref)
+{
+    batch_.push_back(memref);
+    if (batch_.size() < BATCH_SIZE)
+        return true;
+    return flush_batch();
+}
+
+bool
+cache_sweep_t::flush_batch()
+{
+    if (batch_.empty())
+        return true;
+    if (!threads_.empty()) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            workers_pending_ = (unsigned int)threads_.size();
+            ++batch_generation_;
+        }
+        batch_ready_.notify_all();
+    }
+    simulate_batch(0);
+    if (!threads_.empty()) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        batch_done_.wait(lock, [this] { return workers_pending_ == 0; });
+    }
+    batch_.clear();
+    for (const std::string &error : worker_errors_) {
+        if (!error.empty()) {
+            error_string_ = error;
+            return false;
+        }
+    }
+    return true;
+}
+
+void
+cache_sweep_t::simulate_batch(unsigned int worker)
+{
+    if (!worker_errors_[worker].empty())
+        return;
+    for (size_t i = worker; i < hierarchies_.size(); i += worker_errors_.size()) {
+        hierarchy_t &hierarchy = hierarchies_[i];
+        for (const memref_t &memref : batch_) {
+            if (!hierarchy.sim->process_memref(memref)) {
+                worker_errors_[worker] = "Hierarchy " + hierarchy.name + ": " +
+                    hierarchy.sim->get_error_string();
+                return;
+            }
+        }
+    }
+}
+
+void
+cache_sweep_t::worker_loop(unsigned int worker)
+{
+    uint64_t generation = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            batch_ready_.wait(lock, [this, generation] {
+                return exiting_ || batch_generation_ != generation;
+            });
+            if (exiting_)
+                return;
+            generation = batch_generation_;
+        }
+        simulate_batch(worker);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (--workers_pending_ == 0)
+                batch_done_.notify_one();
+        }
+    }
+}
+
+bool
+cache_sweep_t::print_results()
+{
+    if (!flush_batch())
+        return false;
+    for (auto &hierarchy : hierarchies_) {
+        std::cerr << "Hierarchy " << hierarchy.name << ":\n";
+        if (!hierarchy.sim->print_results())
+            return false;
+    }
+    return true;
+}
+
+size_t
+cache_sweep_t::num_hierarchies() const
+{
+    return hierarchies_.size();
+}
+
+const cache_simulator_t &
+cache_sweep_t::get_hierarchy(size_t index)
+{
+    // Make sure the hierarchy has seen everything delivered so far.
+    flush_batch();
+    return *hierarchies_[index].sim;
+}
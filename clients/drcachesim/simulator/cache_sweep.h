@@ -0,0 +1,106 @@
+/* **********************************************************
+ * Copyright (c) 2023 Google, Inc.  All rights reserved.
+ * **********************************************************/
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of Google, Inc. nor the names of its contributors may be
+ *   used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL VMWARE, INC. OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+
+/* cache_sweep: simulates several independent cache hierarchies from one pass
+ * over the trace.
+ */
+
+#ifndef _CACHE_SWEEP_H_
+#define _CACHE_SWEEP_H_ 1
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "analysis_tool.h"
+#include "cache_simulator.h"
+#include "memref.h"
+#include "../reader/config_reader.h"
+
+class cache_sweep_t : public analysis_tool_t {
+public:
+    // The hierarchies are split across num_threads threads, one of which is
+    // the thread delivering the trace.
+    cache_sweep_t(const std::vector<cache_hierarchy_params_t> &hierarchies,
+                  unsigned int num_threads);
+    virtual ~cache_sweep_t();
+    std::string
+    initialize_shard_type(shard_type_t shard_type) override;
+    std::string
+    initialize_stream(memtrace_stream_t *serial_stream) override;
+    bool
+    process_memref(const memref_t &memref) override;
+    bool
+    print_results() override;
+
+    // Exposed to make it easy to test.
+    size_t
+    num_hierarchies() const;
+    const cache_simulator_t &
+    get_hierarchy(size_t index);
+
+protected:
+    struct hierarchy_t {
+        std::string name;
+        std::unique_ptr<cache_simulator_t> sim;
+    };
+
+    // Hands the queued memrefs to every hierarchy and waits for them all.
+    bool
+    flush_batch();
+    // Runs the queued memrefs through the hierarchies owned by "worker".
+    void
+    simulate_batch(unsigned int worker);
+    void
+    worker_loop(unsigned int worker);
+
+    std::vector<hierarchy_t> hierarchies_;
+    // Each hierarchy consumes a whole batch at a time, which keeps its caches
+    // hot and keeps the threads from synchronizing on every memref.
+    std::vector<memref_t> batch_;
+    static constexpr size_t BATCH_SIZE = 4096;
+
+    // Workers 1 and up; worker 0 is the thread calling process_memref().
+    std::vector<std::thread> threads_;
+    std::vector<std::string> worker_errors_;
+    std::mutex mutex_;
+    std::condition_variable batch_ready_;
+    std::condition_variable batch_done_;
+    uint64_t batch_generation_ = 0;
+    unsigned int workers_pending_ = 0;
+    bool exiting_ = false;
+};
+
+#endif /* _CACHE_SWEEP_H_ */
@@ -84,6 +84,7 @@ caching_device_t::init(int associativity, int block_size, int num_blocks,
     if (blocks_per_way_ * associativity_ != num_blocks_)
         return false;
     blocks_per_way_mask_ = blocks_per_way_ - 1;
+    sampled_sets_ = blocks_per_way_;
     block_size_bits_ = compute_log2(block_size);
     // Non-power-of-two associativities and total cache sizes are allowed, so
     // long as the number blocks per cache way is a power of two.
@@ -147,8 +148,21 @@ caching_device_t::request(const memref_t &memref_in)
         assert(tag != TAG_INVALID && tag == cache_block->tag_);
         record_access_stats(memref_in, true /*hit*/, cache_block);
         access_update(last_block_idx_, last_way_);
+        if (!type_is_prefetch(memref_in.data.type)) {
+            cache_block->prefetched_ = false;
+            if (prefetcher_ != nullptr && prefetcher_->trains_on_hits()) {
+                prefetcher_->observe_hit(this, memref_in);
+                // The prefetches may have replaced this block.
+                if (cache_block->tag_ != tag)
+                    last_tag_ = TAG_INVALID;
+            }
+        }
         return;
     }
+    // With set sampling, drop accesses to unsampled sets as early as possible.
+    // The last tag above is always in a sampled set.
+    if (set_sampling_ && tag == final_tag && !is_set_sampled(tag))
+        return;
 
     memref = memref_in;
     for (; tag <= final_tag; ++tag) {
@@ -156,6 +170,13 @@ caching_device_t::request(const memref_t &memref_in)
         int block_idx = compute_block_idx(tag);
         bool missed = false;
 
+        if (set_sampling_ && !is_set_sampled(tag)) {
+            if (tag + 1 <= final_tag) {
+                memref.data.addr = (tag + 1) << block_size_bits_;
+                memref.data.size = final_addr - memref.data.addr + 1 /*undo the -1*/;
+            }
+            continue;
+        }
         if (tag + 1 <= final_tag)
             memref.data.size = ((tag + 1) << block_size_bits_) - memref.data.addr;
 
@@ -165,6 +186,8 @@ caching_device_t::request(const memref_t &memref_in)
             caching_device_block_t *cache_block = block_way.first;
             way = block_way.second;
             record_access_stats(memref, true /*hit*/, cache_block);
+            if (!type_is_prefetch(memref.data.type))
+                cache_block->prefetched_ = false;
             if (coherent_cache_ && memref.data.type == TRACE_TYPE_WRITE) {
                 // On a hit, we must notify the snoop filter of the write or propagate
                 // the write to a snooped cache.
@@ -186,7 +209,7 @@ caching_device_t::request(const memref_t &memref_in)
             missed = true;
             // If no parent we assume we get the data from main memory
             if (parent_ != NULL)
-                parent_->request(memref);
+                request_parent(memref);
             if (snoop_filter_ != NULL) {
                 // Update snoop filter, other private caches invalidated on write.
                 snoop_filter_->snoop(tag, id_, (memref.data.type == TRACE_TYPE_WRITE));
@@ -230,14 +253,19 @@ caching_device_t::request(const memref_t &memref_in)
                 }
             }
             update_tag(cache_block, way, tag);
+            cache_block->prefetched_ = memref.data.type == TRACE_TYPE_HARDWARE_PREFETCH;
         }
 
         access_update(block_idx, way);
 
         // Issue a hardware prefetch, if any, before we remember the last tag,
         // so we remember this line and not the prefetched line.
-        if (missed && !type_is_prefetch(memref.data.type) && prefetcher_ != nullptr)
-            prefetcher_->prefetch(this, memref);
+        if (prefetcher_ != nullptr && !type_is_prefetch(memref.data.type)) {
+            if (missed)
+                prefetcher_->prefetch(this, memref);
+            else if (prefetcher_->trains_on_hits())
+                prefetcher_->observe_hit(this, memref);
+        }
 
         if (tag + 1 <= final_tag) {
             addr_t next_addr = (tag + 1) << block_size_bits_;
@@ -245,13 +273,45 @@ caching_device_t::request(const memref_t &memref_in)
             memref.data.size = final_addr - next_addr + 1 /*undo the -1*/;
         }
 
-        // Optimization: remember last tag
-        last_tag_ = tag;
+        // Optimization: remember last tag, unless the prefetches replaced it.
+        last_tag_ =
+            get_caching_device_block(block_idx, way).tag_ == tag ? tag : TAG_INVALID;
         last_way_ = way;
         last_block_idx_ = block_idx;
     }
 }
 
+int
+caching_device_t::set_set_sampling(int sample_rate, int index_bits, bool hashed)
+{
+    if (!IS_POWER_OF_2(sample_rate) || index_bits < 0 ||
+        (1 << index_bits) > blocks_per_way_)
+        return 0;
+    int rate_bits = compute_log2(sample_rate);
+    if (rate_bits > index_bits)
+        return 0;
+    set_sampling_ = sample_rate > 1;
+    sampled_sets_ = blocks_per_way_;
+    if (!set_sampling_)
+        return sampled_sets_;
+    set_sample_hashed_ = hashed;
+    set_sample_index_mask_ = (static_cast<addr_t>(1) << index_bits) - 1;
+    set_sample_select_mask_ = sample_rate - 1;
+    set_sample_hash_shift_ = 64 - rate_bits;
+    sampled_sets_ = 0;
+    for (int set = 0; set < blocks_per_way_; ++set) {
+        if (is_set_sampled(set))
+            ++sampled_sets_;
+    }
+    if (sampled_sets_ == 0) {
+        // Unlucky hashing: fall back to the fixed choice, which always samples
+        // set 0.
+        set_sample_hashed_ = false;
+        return set_set_sampling(sample_rate, index_bits, false);
+    }
+    return sampled_sets_;
+}
+
 void
 caching_device_t::access_update(int block_idx, int way)
 {
@@ -390,6 +450,16 @@ caching_device_t::record_access_stats(const memref_t &memref, bool hit,
                                       caching_device_block_t *cache_block)
 {
     stats_->access(memref, hit, cache_block);
+    if (!prefetch_seen_ && memref.data.type == TRACE_TYPE_HARDWARE_PREFETCH)
+        prefetch_seen_ = true;
+    if (prefetch_seen_)
+        stats_->record_prefetch_usage(memref, hit, cache_block);
+    if (defer_to_parent_) {
+        // The ancestors may be shared: hand off a count instead.
+        if (hit && parent_ != nullptr)
+            ++deferred_child_hits_;
+        return;
+    }
     // We propagate hits all the way up the hierachy.
     // But to avoid over-counting we only propagate misses one level up.
     if (hit) {
@@ -398,3 +468,24 @@ caching_device_t::record_access_stats(const memref_t &memref, bool hit,
     } else if (parent_ != nullptr)
         parent_->stats_->child_access(memref, hit, cache_block);
 }
+
+void
+caching_device_t::apply_deferred_parent_request(const memref_t &memref)
+{
+    parent_->request(memref);
+}
+
+void
+caching_device_t::apply_deferred_parent_requests()
+{
+    if (parent_ == nullptr)
+        return;
+    if (deferred_child_hits_ > 0) {
+        for (caching_device_t *up = parent_; up != nullptr; up = up->parent_)
+            up->stats_->child_hits(deferred_child_hits_);
+        deferred_child_hits_ = 0;
+    }
+    for (const memref_t &memref : deferred_parent_requests_)
+        apply_deferred_parent_request(memref);
+    deferred_parent_requests_.clear();
+}
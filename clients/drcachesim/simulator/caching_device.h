@@ -99,8 +99,23 @@ public:
     inline double
     get_loaded_fraction() const
     {
-        return double(loaded_blocks_) / num_blocks_;
+        return double(loaded_blocks_) / (sampled_sets_ * associativity_);
     }
+    int
+    get_num_sets() const
+    {
+        return blocks_per_way_;
+    }
+    // Restricts simulation to roughly 1 in sample_rate sets, chosen by the
+    // low index_bits bits of the set index: either those with the bits all zero
+    // or, if hashed is true, those whose hashed bits select them.  Accesses to
+    // other sets are dropped without being recorded or forwarded to parent_.
+    // Using the same index_bits, no larger than the smallest number of index bits
+    // in the hierarchy, for every device keeps whole sets sampled at every level.
+    // Returns the number of sets sampled, which is 0 on invalid parameters.
+    // Must be called prior to any call to request().
+    int
+    set_set_sampling(int sample_rate, int index_bits, bool hashed);
     // Must be called prior to any call to request().
     virtual inline void
     set_hashtable_use(bool use_hashtable)
@@ -122,6 +137,26 @@ public:
         int block_idx = compute_block_idx(tag);
         return block_idx;
     }
+    // When deferral is enabled, accesses that would be forwarded to parent_ are
+    // queued in this device instead, and hits are counted rather than being
+    // propagated into the ancestors' stats.  This allows a private device to be
+    // driven by one thread while its shared ancestors are updated in batches by
+    // apply_deferred_parent_requests() under the caller's synchronization.
+    // Must be called prior to any call to request().
+    void
+    set_parent_deferral(bool defer)
+    {
+        defer_to_parent_ = defer;
+    }
+    size_t
+    get_deferred_parent_request_count() const
+    {
+        return deferred_parent_requests_.size();
+    }
+    // Replays the queued accesses into parent_ and its ancestors.  The caller must
+    // ensure no other thread is accessing the ancestors.
+    void
+    apply_deferred_parent_requests();
 
 protected:
     virtual void
@@ -133,12 +168,34 @@ protected:
     virtual void
     record_access_stats(const memref_t &memref, bool hit,
                         caching_device_block_t *cache_block);
+    // Forwards one access to parent_, or queues it if deferral is enabled.
+    void
+    request_parent(const memref_t &memref)
+    {
+        if (defer_to_parent_)
+            deferred_parent_requests_.push_back(memref);
+        else
+            parent_->request(memref);
+    }
+    // Replays one queued access into parent_.
+    virtual void
+    apply_deferred_parent_request(const memref_t &memref);
 
     inline addr_t
     compute_tag(addr_t addr) const
     {
         return addr >> block_size_bits_;
     }
+    inline bool
+    is_set_sampled(addr_t tag) const
+    {
+        addr_t bits = tag & set_sample_index_mask_;
+        if (set_sample_hashed_) {
+            // A Fibonacci hash: the top bits of the product are well mixed.
+            return ((bits * 0x9e3779b97f4a7c15ULL) >> set_sample_hash_shift_) == 0;
+        }
+        return (bits & set_sample_select_mask_) == 0;
+    }
     inline int
     compute_block_idx(addr_t tag) const
     {
@@ -158,6 +215,7 @@ protected:
         block->tag_ = TAG_INVALID;
         // Xref cache_block_t constructor about why we set counter to 0.
         block->counter_ = 0;
+        block->prefetched_ = false;
     }
 
     inline void
@@ -225,6 +283,24 @@ protected:
                        std::function<unsigned long(addr_t)>>
         tag2block;
     bool use_tag2block_table_ = false;
+
+    // State for set_set_sampling().
+    bool set_sampling_ = false;
+    bool set_sample_hashed_ = false;
+    addr_t set_sample_index_mask_ = 0;
+    addr_t set_sample_select_mask_ = 0;
+    int set_sample_hash_shift_ = 0;
+    int sampled_sets_ = 0;
+
+    // State for set_parent_deferral().
+    bool defer_to_parent_ = false;
+    std::vector<memref_t> deferred_parent_requests_;
+    int_least64_t deferred_child_hits_ = 0;
+
+    // Set once a prefetch fill reaches this device, from its own prefetcher or a
+    // child's.  Until then no block can be prefetched, so the usage tracking in
+    // record_access_stats() is skipped.
+    bool prefetch_seen_ = false;
 };
 
 #endif /* _CACHING_DEVICE_H_ */
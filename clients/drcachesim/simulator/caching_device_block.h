@@ -54,6 +54,7 @@ public:
     caching_device_block_t()
         : tag_(TAG_INVALID)
         , counter_(0)
+        , prefetched_(false)
     {
     }
     // Destructor must be virtual and default is not.
@@ -67,6 +68,10 @@ public:
     // A 32-bit counter should be sufficient but we may want to revisit.
     // We already have stdint.h so we can reinstate int_least64_t easily.
     int counter_; // for use by replacement policies
+
+    // Whether the block was filled by a hardware prefetch and has not yet been
+    // accessed on demand, for prefetch usefulness statistics.
+    bool prefetched_;
 };
 
 #endif /* _CACHING_DEVICE_BLOCK_H_ */
@@ -30,9 +30,12 @@
  * DAMAGE.
  */
 
+#include <algorithm>
 #include <assert.h>
+#include <cmath>
 #include <iostream>
 #include <iomanip>
+#include <sstream>
 #include "../common/options.h"
 #include "caching_device_stats.h"
 
@@ -46,6 +49,12 @@ caching_device_stats_t::caching_device_stats_t(const std::string &miss_file,
     , num_child_hits_(0)
     , num_inclusive_invalidates_(0)
     , num_coherence_invalidates_(0)
+    , num_prefetches_used_(0)
+    , num_prefetches_unused_(0)
+    , num_prefetch_pollution_(0)
+    , block_size_bits_(compute_log2(block_size))
+    , pollution_filter_(POLLUTION_FILTER_SIZE, false)
+    , sampled_sets_(0)
     , num_hits_at_reset_(0)
     , num_misses_at_reset_(0)
     , num_child_hits_at_reset_(0)
@@ -78,6 +87,9 @@ caching_device_stats_t::caching_device_stats_t(const std::string &miss_file,
     stats_map_.emplace(metric_name_t::CHILD_HITS, num_child_hits_);
     stats_map_.emplace(metric_name_t::INCLUSIVE_INVALIDATES, num_inclusive_invalidates_);
     stats_map_.emplace(metric_name_t::COHERENCE_INVALIDATES, num_coherence_invalidates_);
+    stats_map_.emplace(metric_name_t::PREFETCHES_USED, num_prefetches_used_);
+    stats_map_.emplace(metric_name_t::PREFETCHES_UNUSED, num_prefetches_unused_);
+    stats_map_.emplace(metric_name_t::PREFETCH_POLLUTION, num_prefetch_pollution_);
 }
 
 caching_device_stats_t::~caching_device_stats_t()
@@ -106,6 +118,27 @@ caching_device_stats_t::access(const memref_t &memref, bool hit,
 
         check_compulsory_miss(memref.data.addr);
     }
+    if (sampled_sets_ > 0) {
+        size_t set = (memref.data.addr >> block_size_bits_) & (set_hits_.size() - 1);
+        if (hit)
+            set_hits_[set]++;
+        else
+            set_misses_[set]++;
+    }
+}
+
+void
+caching_device_stats_t::set_set_sampling(int sampled_sets, int total_sets)
+{
+    if (sampled_sets >= total_sets) {
+        sampled_sets_ = 0;
+        set_hits_.clear();
+        set_misses_.clear();
+        return;
+    }
+    sampled_sets_ = sampled_sets;
+    set_hits_.assign(total_sets, 0);
+    set_misses_.assign(total_sets, 0);
 }
 
 void
@@ -117,6 +150,12 @@ caching_device_stats_t::child_access(const memref_t &memref, bool hit,
     // else being computed in access()
 }
 
+void
+caching_device_stats_t::child_hits(int_least64_t count)
+{
+    num_child_hits_ += count;
+}
+
 void
 caching_device_stats_t::check_compulsory_miss(addr_t addr)
 {
@@ -183,6 +222,61 @@ caching_device_stats_t::print_counts(std::string prefix)
     }
 }
 
+void
+caching_device_stats_t::print_prefetch_usage(std::string prefix)
+{
+    std::cerr << prefix << std::setw(18) << std::left
+              << "Prefetches used:" << std::setw(20) << std::right
+              << num_prefetches_used_ << std::endl;
+    std::cerr << prefix << std::setw(18) << std::left
+              << "Prefetches unused:" << std::setw(20) << std::right
+              << num_prefetches_unused_ << std::endl;
+    std::cerr << prefix << std::setw(19) << std::left
+              << "Prefetch pollution:" << std::setw(19) << std::right
+              << num_prefetch_pollution_ << std::endl;
+}
+
+void
+caching_device_stats_t::print_set_sampling(std::string prefix)
+{
+    if (sampled_sets_ == 0)
+        return;
+    int total_sets = static_cast<int>(set_hits_.size());
+    double scale = static_cast<double>(total_sets) / sampled_sets_;
+    std::cerr << prefix << std::setw(18) << std::left << "Sampled sets:" << std::setw(20)
+              << std::right
+              << (std::to_string(sampled_sets_) + "/" + std::to_string(total_sets))
+              << std::endl;
+    std::cerr << prefix << std::setw(18) << std::left << "Estimated hits:"
+              << std::setw(20) << std::right
+              << static_cast<int_least64_t>(num_hits_ * scale) << std::endl;
+    std::cerr << prefix << std::setw(18) << std::left << "Estimated misses:"
+              << std::setw(20) << std::right
+              << static_cast<int_least64_t>(num_misses_ * scale) << std::endl;
+    int_least64_t accesses = num_hits_ + num_misses_;
+    if (accesses == 0 || sampled_sets_ < 2)
+        return;
+    // The miss rate is a ratio estimator over a simple random sample of sets
+    // (each set is a cluster of accesses), so its variance comes from the
+    // residuals of the per-set miss counts against the overall rate.
+    double rate = static_cast<double>(num_misses_) / accesses;
+    double sum_sq = 0.;
+    for (size_t set = 0; set < set_hits_.size(); ++set) {
+        int_least64_t set_accesses = set_hits_[set] + set_misses_[set];
+        double residual = set_misses_[set] - rate * set_accesses;
+        sum_sq += residual * residual;
+    }
+    // Unsampled sets contribute zero residuals, as they have no accesses.
+    double mean_accesses = static_cast<double>(accesses) / sampled_sets_;
+    double variance = (1. - 1. / scale) * (sum_sq / (sampled_sets_ - 1)) /
+        (sampled_sets_ * mean_accesses * mean_accesses);
+    std::ostringstream bound;
+    bound << "+/-" << std::fixed << std::setprecision(2)
+          << (1.96 * std::sqrt(variance) * 100);
+    std::cerr << prefix << std::setw(18) << std::left << "Miss rate 95% CI:"
+              << std::setw(20) << std::right << bound.str() << "%" << std::endl;
+}
+
 void
 caching_device_stats_t::print_rates(std::string prefix)
 {
@@ -223,6 +317,7 @@ caching_device_stats_t::print_stats(std::string prefix)
     print_counts(prefix);
     print_rates(prefix);
     print_child_stats(prefix);
+    print_set_sampling(prefix);
     std::cerr.imbue(std::locale("C")); // Reset to avoid affecting later prints.
 }
 
@@ -238,6 +333,29 @@ caching_device_stats_t::reset()
     num_child_hits_ = 0;
     num_inclusive_invalidates_ = 0;
     num_coherence_invalidates_ = 0;
+    num_prefetches_used_ = 0;
+    num_prefetches_unused_ = 0;
+    num_prefetch_pollution_ = 0;
+    std::fill(set_hits_.begin(), set_hits_.end(), 0);
+    std::fill(set_misses_.begin(), set_misses_.end(), 0);
+}
+
+void
+caching_device_stats_t::merge(const caching_device_stats_t &other)
+{
+    num_hits_ += other.num_hits_;
+    num_misses_ += other.num_misses_;
+    num_compulsory_misses_ += other.num_compulsory_misses_;
+    num_child_hits_ += other.num_child_hits_;
+    num_inclusive_invalidates_ += other.num_inclusive_invalidates_;
+    num_coherence_invalidates_ += other.num_coherence_invalidates_;
+    num_prefetches_used_ += other.num_prefetches_used_;
+    num_prefetches_unused_ += other.num_prefetches_unused_;
+    num_prefetch_pollution_ += other.num_prefetch_pollution_;
+    for (size_t i = 0; i < set_hits_.size() && i < other.set_hits_.size(); ++i) {
+        set_hits_[i] += other.set_hits_[i];
+        set_misses_[i] += other.set_misses_[i];
+    }
 }
 
 void
@@ -41,6 +41,7 @@
 #include <map>
 #include <stdint.h>
 #include <limits>
+#include <vector>
 #ifdef HAS_ZLIB
 #    include <zlib.h>
 #endif
@@ -63,7 +64,10 @@ enum class metric_name_t {
     COHERENCE_INVALIDATES,
     PREFETCH_HITS,
     PREFETCH_MISSES,
-    FLUSHES
+    FLUSHES,
+    PREFETCHES_USED,
+    PREFETCHES_UNUSED,
+    PREFETCH_POLLUTION
 };
 
 struct bound {
@@ -166,12 +170,59 @@ public:
     virtual void
     child_access(const memref_t &memref, bool hit, caching_device_block_t *cache_block);
 
+    // Called on each access after access(), while cache_block still holds the
+    // victim's state on a miss, to track hardware prefetch usefulness.  A prefetched
+    // block is used if a demand access hits it and unused if it is evicted first.
+    // A demand miss on a block recently evicted by a prefetch fill counts as
+    // pollution, as tracked by a small hashed filter in the style of hardware
+    // pollution filters.
+    void
+    record_prefetch_usage(const memref_t &memref, bool hit,
+                          caching_device_block_t *cache_block)
+    {
+        if (hit) {
+            if (cache_block->prefetched_ && !type_is_prefetch(memref.data.type))
+                num_prefetches_used_++;
+            return;
+        }
+        if (cache_block->tag_ != TAG_INVALID) {
+            if (cache_block->prefetched_)
+                num_prefetches_unused_++;
+            if (memref.data.type == TRACE_TYPE_HARDWARE_PREFETCH)
+                pollution_filter_[pollution_filter_index(cache_block->tag_)] = true;
+        }
+        if (!type_is_prefetch(memref.data.type)) {
+            size_t index = pollution_filter_index(memref.data.addr >> block_size_bits_);
+            if (pollution_filter_[index]) {
+                num_prefetch_pollution_++;
+                pollution_filter_[index] = false;
+            }
+        }
+    }
+
+    // Enables per-set accounting for a device simulating only sampled_sets of its
+    // total_sets sets (see caching_device_t::set_set_sampling()).  The printed
+    // stats then include estimated totals and a confidence interval for the miss
+    // rate, computed from the spread of the per-set miss rates.
+    void
+    set_set_sampling(int sampled_sets, int total_sets);
+
+    // Called with a batch of child hits whose child_access() calls were deferred
+    // (see caching_device_t::set_parent_deferral()).
+    virtual void
+    child_hits(int_least64_t count);
+
     virtual void
     print_stats(std::string prefix);
 
     virtual void
     reset();
 
+    // Adds the counts in other, which must describe a device of the same geometry,
+    // to ours.  Used to combine separately simulated time slices.
+    virtual void
+    merge(const caching_device_stats_t &other);
+
     virtual bool operator!()
     {
         return !success_;
@@ -211,6 +262,21 @@ protected:
     void
     check_compulsory_miss(addr_t addr);
 
+    // Prints the prefetch usefulness counts.  Callers print these alongside the
+    // prefetch hit and miss counts so the two sets of lines always appear together.
+    void
+    print_prefetch_usage(std::string prefix);
+    // Prints the set sampling estimates, if set sampling is enabled.
+    void
+    print_set_sampling(std::string prefix);
+
+    static const size_t POLLUTION_FILTER_SIZE = 4096;
+    static size_t
+    pollution_filter_index(addr_t tag)
+    {
+        return (tag ^ (tag >> 12)) & (POLLUTION_FILTER_SIZE - 1);
+    }
+
     int_least64_t num_hits_;
     int_least64_t num_misses_;
     int_least64_t num_compulsory_misses_;
@@ -219,6 +285,17 @@ protected:
     int_least64_t num_inclusive_invalidates_;
     int_least64_t num_coherence_invalidates_;
 
+    int_least64_t num_prefetches_used_;
+    int_least64_t num_prefetches_unused_;
+    int_least64_t num_prefetch_pollution_;
+    int block_size_bits_;
+    std::vector<bool> pollution_filter_;
+
+    // State for set_set_sampling(): per-set demand hits and misses, indexed by set.
+    int sampled_sets_;
+    std::vector<int_least64_t> set_hits_;
+    std::vector<int_least64_t> set_misses_;
+
     // Stats saved when the last reset was called. This helps us get insight
     // into what the stats were when the cache was warmed up.
     int_least64_t num_hits_at_reset_;
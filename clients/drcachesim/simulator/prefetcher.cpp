@@ -35,9 +35,13 @@
 
 #include "caching_device.h"
 #include "../common/memref.h"
+#include "../common/utils.h"
 
-prefetcher_t::prefetcher_t(int block_size)
+prefetcher_t::prefetcher_t(int block_size, int degree, bool trains_on_hits)
     : block_size_(block_size)
+    , block_size_bits_(compute_log2(block_size))
+    , degree_(degree)
+    , trains_on_hits_(trains_on_hits)
 {
     // Nothing else to do.
 }
@@ -47,7 +51,20 @@ prefetcher_t::prefetch(caching_device_t *cache, const memref_t &memref_in)
 {
     // We implement a simple next-line prefetcher.
     memref_t memref = memref_in;
-    memref.data.addr += block_size_;
     memref.data.type = TRACE_TYPE_HARDWARE_PREFETCH;
+    for (int i = 0; i < degree_; ++i) {
+        memref.data.addr += block_size_;
+        cache->request(memref);
+    }
+}
+
+void
+prefetcher_t::issue_prefetch(caching_device_t *cache, const memref_t &memref_in,
+                             addr_t addr)
+{
+    memref_t memref = memref_in;
+    memref.data.type = TRACE_TYPE_HARDWARE_PREFETCH;
+    memref.data.addr = addr & ~static_cast<addr_t>(block_size_ - 1);
+    memref.data.size = 1;
     cache->request(memref);
 }
@@ -36,22 +36,45 @@
 #ifndef _PREFETCHER_H_
 #define _PREFETCHER_H_ 1
 
-#include "caching_device.h"
 #include "memref.h"
 
 class caching_device_t;
 
+// The base class implements a next-line prefetcher.  Subclasses model other
+// prefetchers by overriding prefetch() and, if they train on every access rather
+// than just on misses, observe_hit().
 class prefetcher_t {
 public:
-    prefetcher_t(int block_size);
+    // The degree is the number of lines prefetched per trigger.
+    prefetcher_t(int block_size, int degree = 1, bool trains_on_hits = false);
     virtual ~prefetcher_t()
     {
     }
+    // Called on each demand access that misses in the cache.
     virtual void
     prefetch(caching_device_t *cache, const memref_t &memref);
+    // Called on each demand access that hits in the cache, if trains_on_hits().
+    virtual void
+    observe_hit(caching_device_t *cache, const memref_t &memref)
+    {
+    }
+    bool
+    trains_on_hits() const
+    {
+        return trains_on_hits_;
+    }
+
+protected:
+    // Requests the line containing addr from the cache as a hardware prefetch.
+    void
+    issue_prefetch(caching_device_t *cache, const memref_t &memref, addr_t addr);
 
-private:
     int block_size_;
+    int block_size_bits_;
+    int degree_;
+
+private:
+    bool trains_on_hits_;
 };
 
 #endif /* _PREFETCHER_H_ */
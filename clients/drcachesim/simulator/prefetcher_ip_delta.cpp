@@ -0,0 +1,105 @@
+/* **********************************************************
+ * Copyright (c) 2023 Google, Inc.  All rights reserved.
+ * **********************************************************/
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of Google, Inc. nor the names of its contributors may be
+ *   used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL VMWARE, INC. OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+
+#include <limits>
+
+#include "prefetcher_ip_delta.h"
+#include "caching_device.h"
+
+prefetcher_ip_delta_t::prefetcher_ip_delta_t(int block_size, int degree)
+    : prefetcher_t(block_size, degree, true /*trains_on_hits*/)
+    , table_(TABLE_SIZE)
+{
+}
+
+void
+prefetcher_ip_delta_t::prefetch(caching_device_t *cache, const memref_t &memref)
+{
+    train(cache, memref);
+}
+
+void
+prefetcher_ip_delta_t::observe_hit(caching_device_t *cache, const memref_t &memref)
+{
+    train(cache, memref);
+}
+
+void
+prefetcher_ip_delta_t::train(caching_device_t *cache, const memref_t &memref)
+{
+    // Instruction fetches have no separate PC to index by.
+    if (type_is_instr(memref.data.type))
+        return;
+    addr_t pc = memref.data.pc;
+    int64_t line = static_cast<int64_t>(memref.data.addr >> block_size_bits_);
+    entry_t &entry = table_[(pc ^ (pc >> 8)) % TABLE_SIZE];
+    if (entry.pc != pc) {
+        entry.pc = pc;
+        entry.last_line = line;
+        entry.count = 0;
+        return;
+    }
+    int64_t delta = line - entry.last_line;
+    if (delta == 0)
+        return;
+    entry.last_line = line;
+    // A delta too large to store breaks any pattern, so restart the history.
+    if (delta > std::numeric_limits<int32_t>::max() ||
+        delta < std::numeric_limits<int32_t>::min()) {
+        entry.count = 0;
+        return;
+    }
+    if (entry.count == HISTORY) {
+        for (int i = 1; i < HISTORY; ++i)
+            entry.deltas[i - 1] = entry.deltas[i];
+        --entry.count;
+    }
+    entry.deltas[entry.count++] = static_cast<int32_t>(delta);
+    if (entry.count < 3)
+        return;
+    // Find the most recent earlier occurrence of the latest pair of deltas.
+    int32_t first = entry.deltas[entry.count - 2];
+    int32_t second = entry.deltas[entry.count - 1];
+    for (int i = entry.count - 3; i >= 1; --i) {
+        if (entry.deltas[i - 1] != first || entry.deltas[i] != second)
+            continue;
+        // Replay the deltas that followed it.
+        int64_t target = line;
+        for (int j = i + 1; j < entry.count && j - i <= degree_; ++j) {
+            target += entry.deltas[j];
+            issue_prefetch(cache, memref, static_cast<addr_t>(target)
+                               << block_size_bits_);
+        }
+        return;
+    }
+}
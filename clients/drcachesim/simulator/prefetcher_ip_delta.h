@@ -0,0 +1,76 @@
+/* **********************************************************
+ * Copyright (c) 2023 Google, Inc.  All rights reserved.
+ * **********************************************************/
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of Google, Inc. nor the names of its contributors may be
+ *   used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL VMWARE, INC. OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+
+/* prefetcher_ip_delta: represents a PC-indexed delta-correlating prefetcher.
+ */
+
+#ifndef _PREFETCHER_IP_DELTA_H_
+#define _PREFETCHER_IP_DELTA_H_ 1
+
+#include <stdint.h>
+#include <vector>
+
+#include "prefetcher.h"
+
+// Delta-correlating prediction tables (Grannaes et al., 2011) indexed by the PC
+// of each access.  Each entry keeps a short history of the line deltas between its
+// instruction's accesses.  When the latest pair of deltas occurred earlier in the
+// history, the deltas that followed it then are replayed from the current line,
+// up to degree_ of them.  This captures repeating irregular patterns that a single
+// stride cannot.  Trains on every access.
+class prefetcher_ip_delta_t : public prefetcher_t {
+public:
+    prefetcher_ip_delta_t(int block_size, int degree);
+    void
+    prefetch(caching_device_t *cache, const memref_t &memref) override;
+    void
+    observe_hit(caching_device_t *cache, const memref_t &memref) override;
+
+protected:
+    void
+    train(caching_device_t *cache, const memref_t &memref);
+
+    static const int TABLE_SIZE = 256;
+    static const int HISTORY = 8;
+
+    struct entry_t {
+        addr_t pc = 0;
+        int64_t last_line = 0;
+        // The most recent deltas, oldest first, of which count are valid.
+        int32_t deltas[HISTORY];
+        int count = 0;
+    };
+    std::vector<entry_t> table_;
+};
+
+#endif /* _PREFETCHER_IP_DELTA_H_ */
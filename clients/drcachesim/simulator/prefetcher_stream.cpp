@@ -0,0 +1,110 @@
+/* **********************************************************
+ * Copyright (c) 2023 Google, Inc.  All rights reserved.
+ * **********************************************************/
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of Google, Inc. nor the names of its contributors may be
+ *   used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL VMWARE, INC. OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+
+#include "prefetcher_stream.h"
+#include "caching_device.h"
+
+prefetcher_stream_t::prefetcher_stream_t(int block_size, int degree)
+    : prefetcher_t(block_size, degree, true /*trains_on_hits*/)
+    , streams_(NUM_STREAMS)
+{
+}
+
+void
+prefetcher_stream_t::prefetch(caching_device_t *cache, const memref_t &memref)
+{
+    train(cache, memref, true);
+}
+
+void
+prefetcher_stream_t::observe_hit(caching_device_t *cache, const memref_t &memref)
+{
+    train(cache, memref, false);
+}
+
+void
+prefetcher_stream_t::train(caching_device_t *cache, const memref_t &memref,
+                           bool missed)
+{
+    int64_t line = static_cast<int64_t>(memref.data.addr >> block_size_bits_);
+    ++use_count_;
+    stream_t *lru = &streams_[0];
+    for (stream_t &stream : streams_) {
+        if (!stream.valid) {
+            if (lru->valid)
+                lru = &stream;
+            continue;
+        }
+        int64_t delta = line - stream.last_line;
+        if (delta == 0) {
+            stream.last_use = use_count_;
+            return;
+        }
+        if (delta >= -WINDOW && delta <= WINDOW) {
+            int direction = delta > 0 ? 1 : -1;
+            stream.last_use = use_count_;
+            stream.last_line = line;
+            if (direction != stream.direction) {
+                stream.direction = direction;
+                stream.confidence = 1;
+                stream.next_line = line + direction;
+                return;
+            }
+            if (stream.confidence < CONFIDENCE_MAX)
+                ++stream.confidence;
+            if (stream.confidence < CONFIDENCE_THRESHOLD)
+                return;
+            if ((stream.next_line - line) * direction <= 0)
+                stream.next_line = line + direction;
+            int64_t end_line = line + direction * (degree_ + 1);
+            for (; (end_line - stream.next_line) * direction > 0;
+                 stream.next_line += direction) {
+                issue_prefetch(cache, memref,
+                               static_cast<addr_t>(stream.next_line) << block_size_bits_);
+            }
+            return;
+        }
+        if (lru->valid && stream.last_use < lru->last_use)
+            lru = &stream;
+    }
+    // Only misses start new streams, so that hits in unrelated regions do not
+    // displace streams that are being followed.
+    if (!missed)
+        return;
+    lru->valid = true;
+    lru->last_line = line;
+    lru->next_line = line;
+    lru->direction = 0;
+    lru->confidence = 0;
+    lru->last_use = use_count_;
+}
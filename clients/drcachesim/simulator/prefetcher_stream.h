@@ -0,0 +1,82 @@
+/* **********************************************************
+ * Copyright (c) 2023 Google, Inc.  All rights reserved.
+ * **********************************************************/
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of Google, Inc. nor the names of its contributors may be
+ *   used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL VMWARE, INC. OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+
+/* prefetcher_stream: represents a multi-stream sequential prefetcher.
+ */
+
+#ifndef _PREFETCHER_STREAM_H_
+#define _PREFETCHER_STREAM_H_ 1
+
+#include <stdint.h>
+#include <vector>
+
+#include "prefetcher.h"
+
+// Detects ascending or descending streams of lines independently of the PC, in
+// the style of IBM POWER stream prefetchers.  A miss outside every tracked stream
+// allocates a new stream, replacing the least recently used one.  An access within
+// WINDOW lines of a stream in its direction confirms it, and a confirmed stream
+// keeps degree_ lines ahead of its latest access prefetched.  Trains on every
+// access.
+class prefetcher_stream_t : public prefetcher_t {
+public:
+    prefetcher_stream_t(int block_size, int degree);
+    void
+    prefetch(caching_device_t *cache, const memref_t &memref) override;
+    void
+    observe_hit(caching_device_t *cache, const memref_t &memref) override;
+
+protected:
+    void
+    train(caching_device_t *cache, const memref_t &memref, bool missed);
+
+    static const int NUM_STREAMS = 16;
+    static const int64_t WINDOW = 16;
+    // Prefetching starts at this confidence.
+    static const int CONFIDENCE_THRESHOLD = 2;
+    static const int CONFIDENCE_MAX = 4;
+
+    struct stream_t {
+        bool valid = false;
+        int64_t last_line = 0;
+        // The next line to prefetch, so each line is requested once.
+        int64_t next_line = 0;
+        int direction = 0;
+        int confidence = 0;
+        uint64_t last_use = 0;
+    };
+    std::vector<stream_t> streams_;
+    uint64_t use_count_ = 0;
+};
+
+#endif /* _PREFETCHER_STREAM_H_ */
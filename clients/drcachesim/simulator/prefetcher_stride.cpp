@@ -0,0 +1,96 @@
+/* **********************************************************
+ * Copyright (c) 2023 Google, Inc.  All rights reserved.
+ * **********************************************************/
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of Google, Inc. nor the names of its contributors may be
+ *   used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL VMWARE, INC. OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+
+#include "prefetcher_stride.h"
+#include "caching_device.h"
+
+prefetcher_stride_t::prefetcher_stride_t(int block_size, int degree)
+    : prefetcher_t(block_size, degree, true /*trains_on_hits*/)
+    , table_(TABLE_SIZE)
+{
+}
+
+void
+prefetcher_stride_t::prefetch(caching_device_t *cache, const memref_t &memref)
+{
+    train(cache, memref);
+}
+
+void
+prefetcher_stride_t::observe_hit(caching_device_t *cache, const memref_t &memref)
+{
+    train(cache, memref);
+}
+
+void
+prefetcher_stride_t::train(caching_device_t *cache, const memref_t &memref)
+{
+    // Instruction fetches have no separate PC to index by.
+    if (type_is_instr(memref.data.type))
+        return;
+    addr_t pc = memref.data.pc;
+    addr_t addr = memref.data.addr;
+    entry_t &entry = table_[(pc ^ (pc >> 8)) % TABLE_SIZE];
+    if (entry.pc != pc) {
+        entry.pc = pc;
+        entry.last_addr = addr;
+        entry.stride = 0;
+        entry.confidence = 0;
+        return;
+    }
+    int64_t stride = static_cast<int64_t>(addr - entry.last_addr);
+    if (stride == 0)
+        return;
+    entry.last_addr = addr;
+    if (stride == entry.stride) {
+        if (entry.confidence < CONFIDENCE_MAX)
+            ++entry.confidence;
+    } else if (entry.confidence > 0) {
+        --entry.confidence;
+        return;
+    } else {
+        entry.stride = stride;
+        return;
+    }
+    if (entry.confidence < CONFIDENCE_THRESHOLD)
+        return;
+    // Skip targets within a line already requested, for strides smaller than a line.
+    addr_t last_line = addr >> block_size_bits_;
+    for (int i = 1; i <= degree_; ++i) {
+        addr_t target = addr + static_cast<addr_t>(entry.stride * i);
+        if ((target >> block_size_bits_) == last_line)
+            continue;
+        last_line = target >> block_size_bits_;
+        issue_prefetch(cache, memref, target);
+    }
+}
@@ -0,0 +1,75 @@
+/* **********************************************************
+ * Copyright (c) 2023 Google, Inc.  All rights reserved.
+ * **********************************************************/
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of Google, Inc. nor the names of its contributors may be
+ *   used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL VMWARE, INC. OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+
+/* prefetcher_stride: represents a PC-indexed stride prefetcher.
+ */
+
+#ifndef _PREFETCHER_STRIDE_H_
+#define _PREFETCHER_STRIDE_H_ 1
+
+#include <stdint.h>
+#include <vector>
+
+#include "prefetcher.h"
+
+// A reference prediction table (Chen and Baer, 1995) indexed by the PC of each
+// access.  Each entry tracks the last address and stride of its instruction, with a
+// saturating confidence counter; once a stride repeats, degree_ strides ahead of the
+// current address are prefetched.  Trains on every access.
+class prefetcher_stride_t : public prefetcher_t {
+public:
+    prefetcher_stride_t(int block_size, int degree);
+    void
+    prefetch(caching_device_t *cache, const memref_t &memref) override;
+    void
+    observe_hit(caching_device_t *cache, const memref_t &memref) override;
+
+protected:
+    void
+    train(caching_device_t *cache, const memref_t &memref);
+
+    static const int TABLE_SIZE = 256;
+    static const int CONFIDENCE_MAX = 3;
+    // Prefetching starts at this confidence.
+    static const int CONFIDENCE_THRESHOLD = 2;
+
+    struct entry_t {
+        addr_t pc = 0;
+        addr_t last_addr = 0;
+        int64_t stride = 0;
+        int confidence = 0;
+    };
+    std::vector<entry_t> table_;
+};
+
+#endif /* _PREFETCHER_STRIDE_H_ */
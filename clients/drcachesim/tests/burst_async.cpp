@@ -0,0 +1,196 @@
+/* **********************************************************
+ * Copyright (c) 2024 Google, Inc.  All rights reserved.
+ * **********************************************************/
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of Google, Inc. nor the names of its contributors may be
+ *   used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL GOOGLE, INC. OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+
+/* Tests -async_writers by collecting two traces of an identical code region, one
+ * written synchronously by the app thread and one by background writers, and
+ * comparing their record counts.  The region fills many trace buffers so that
+ * some are still queued or in flight on a writer when tracing stops.
+ */
+
+#include "dr_api.h"
+#include "drmemtrace/drmemtrace.h"
+#include "scheduler.h"
+#include "trace_entry.h"
+#include "tracer/raw2trace.h"
+#include "tracer/raw2trace_directory.h"
+#include <assert.h>
+#include <iostream>
+#include <stdlib.h>
+#include <string.h>
+
+using namespace dynamorio::drmemtrace;
+
+struct record_counts_t {
+    int64 instrs = 0;
+    int64 loads = 0;
+    int64 stores = 0;
+};
+
+bool
+my_setenv(const char *var, const char *value)
+{
+#ifdef UNIX
+    return setenv(var, value, 1 /*override*/) == 0;
+#else
+    return SetEnvironmentVariable(var, value) == TRUE;
+#endif
+}
+
+static int
+do_some_work()
+{
+    // We need repeatable addresses, so no heap allocation.
+    constexpr int size = 1024;
+    static volatile int array[size];
+    int sum = 0;
+    for (int iter = 0; iter < 200; ++iter) {
+        for (int i = 1; i < size - 1; ++i) {
+            array[i] += array[i - 1] + array[i + 1];
+            sum += array[i];
+        }
+    }
+    return sum;
+}
+
+static std::string
+post_process(const std::string &out_subdir)
+{
+    const char *raw_dir;
+    drmemtrace_status_t mem_res = drmemtrace_get_output_path(&raw_dir);
+    assert(mem_res == DRMEMTRACE_SUCCESS);
+    std::string outdir = std::string(raw_dir) + DIRSEP + out_subdir;
+    void *dr_context = dr_standalone_init();
+    // Use a new scope to free raw2trace_directory_t before dr_standalone_exit().
+    {
+        raw2trace_directory_t dir;
+        if (!dr_create_dir(outdir.c_str())) {
+            std::cerr << "Failed to create output dir";
+            assert(false);
+        }
+        std::string dir_err = dir.initialize(raw_dir, outdir);
+        assert(dir_err.empty());
+        raw2trace_t raw2trace(dir.modfile_bytes_, dir.in_files_, dir.out_files_,
+                              dir.out_archives_, dir.encoding_file_,
+                              dir.serial_schedule_file_, dir.cpu_schedule_file_,
+                              dr_context,
+                              0
+#ifdef WINDOWS
+                              /* FIXME i#3983: Creating threads in standalone mode
+                               * causes problems.  We disable the pool for now.
+                               */
+                              ,
+                              0
+#endif
+        );
+        std::string error = raw2trace.do_conversion();
+        if (!error.empty()) {
+            std::cerr << "raw2trace failed: " << error << "\n";
+            assert(false);
+        }
+    }
+    dr_standalone_exit();
+    return outdir;
+}
+
+static std::string
+gather_trace(const std::string &tracer_ops, const std::string &out_subdir)
+{
+    std::string dr_ops("-stderr_mask 0xc -client_lib ';;-offline " + tracer_ops + "'");
+    if (!my_setenv("DYNAMORIO_OPTIONS", dr_ops.c_str()))
+        std::cerr << "failed to set env var!\n";
+    dr_app_setup();
+    assert(!dr_app_running_under_dynamorio());
+    dr_app_start();
+    assert(dr_app_running_under_dynamorio());
+    do_some_work();
+    dr_app_stop_and_cleanup();
+    assert(!dr_app_running_under_dynamorio());
+
+    return post_process(out_subdir);
+}
+
+static record_counts_t
+count_records(const std::string &dir)
+{
+    record_counts_t counts;
+    scheduler_t scheduler;
+    std::vector<scheduler_t::input_workload_t> sched_inputs;
+    sched_inputs.emplace_back(dir);
+    if (scheduler.init(sched_inputs, 1, scheduler_t::make_scheduler_serial_options()) !=
+        scheduler_t::STATUS_SUCCESS) {
+        std::cerr << "Failed to initialize scheduler " << scheduler.get_error_string()
+                  << "\n";
+        assert(false);
+    }
+    auto *stream = scheduler.get_stream(0);
+    memref_t memref;
+    for (scheduler_t::stream_status_t status = stream->next_record(memref);
+         status != scheduler_t::STATUS_EOF; status = stream->next_record(memref)) {
+        assert(status == scheduler_t::STATUS_OK);
+        if (type_is_instr(memref.instr.type) ||
+            memref.instr.type == TRACE_TYPE_INSTR_NO_FETCH)
+            ++counts.instrs;
+        else if (memref.data.type == TRACE_TYPE_READ)
+            ++counts.loads;
+        else if (memref.data.type == TRACE_TYPE_WRITE)
+            ++counts.stores;
+    }
+    return counts;
+}
+
+int
+main(int argc, const char *argv[])
+{
+    // Run once natively so lazy binding does not differ between the traces.
+    do_some_work();
+
+    std::string dir_sync = gather_trace("", "sync");
+    std::string dir_async = gather_trace("-async_writers 2", "async");
+
+    dr_standalone_init();
+    record_counts_t sync = count_records(dir_sync);
+    record_counts_t async = count_records(dir_async);
+    dr_standalone_exit();
+
+    if (sync.instrs != async.instrs || sync.loads != async.loads ||
+        sync.stores != async.stores) {
+        std::cerr << "Record count mismatch: sync " << sync.instrs << " instrs, "
+                  << sync.loads << " loads, " << sync.stores << " stores vs async "
+                  << async.instrs << " instrs, " << async.loads << " loads, "
+                  << async.stores << " stores\n";
+    }
+    // Make sure the region spanned many buffers.
+    assert(sync.loads > 100000);
+    std::cerr << "all done\n";
+    return 0;
+}
@@ -37,6 +37,10 @@
 #include "cache_replacement_policy_unit_test.h"
 #include "simulator/cache_fifo.h"
 #include "simulator/cache_lru.h"
+#include "simulator/cache_random.h"
+#include "simulator/cache_rrip.h"
+#include "simulator/cache_tree_plru.h"
+#include "simulator/cache_bit_plru.h"
 
 // Indices for test address vector.
 enum {
@@ -240,6 +244,124 @@ unit_test_cache_fifo_eight_way()
     cache_fifo_test.access_and_check_cache(addr_vec[ADDR_L], 4); // I  J  K  L  e  F  G  H
 }
 
+void
+unit_test_cache_tree_plru_four_way()
+{
+    cache_policy_test_t<cache_tree_plru_t> cache_plru_test(/*associativity=*/4,
+                                                           /*line_size=*/32,
+                                                           /*total_size=*/256);
+    cache_plru_test.initialize_cache();
+
+    assert(cache_plru_test.block_indices_are_identical(addr_vec));
+    assert(cache_plru_test.tags_are_different(addr_vec));
+
+    // Lower-case letter shows the way the tree points at.  Unlike LRU, after E
+    // replaces C the tree points at B rather than the older D.
+    cache_plru_test.access_and_check_cache(addr_vec[ADDR_A], 1); // A x X X
+    cache_plru_test.access_and_check_cache(addr_vec[ADDR_B], 2); // A B x X
+    cache_plru_test.access_and_check_cache(addr_vec[ADDR_C], 3); // A B C x
+    cache_plru_test.access_and_check_cache(addr_vec[ADDR_D], 0); // a B C D
+    cache_plru_test.access_and_check_cache(addr_vec[ADDR_A], 2); // A B c D
+    cache_plru_test.access_and_check_cache(addr_vec[ADDR_E], 1); // A b E D
+    cache_plru_test.access_and_check_cache(addr_vec[ADDR_B], 3); // A B E d
+}
+
+void
+unit_test_cache_bit_plru_four_way()
+{
+    cache_policy_test_t<cache_bit_plru_t> cache_plru_test(/*associativity=*/4,
+                                                          /*line_size=*/32,
+                                                          /*total_size=*/256);
+    cache_plru_test.initialize_cache();
+
+    assert(cache_plru_test.block_indices_are_identical(addr_vec));
+    assert(cache_plru_test.tags_are_different(addr_vec));
+
+    // Lower-case letter shows the victim: the first way whose bit is clear.
+    cache_plru_test.access_and_check_cache(addr_vec[ADDR_A], 1); // A x X X
+    cache_plru_test.access_and_check_cache(addr_vec[ADDR_B], 2); // A B x X
+    cache_plru_test.access_and_check_cache(addr_vec[ADDR_C], 3); // A B C x
+    // All bits would be set, so only D's remains set.
+    cache_plru_test.access_and_check_cache(addr_vec[ADDR_D], 0); // a B C D
+    cache_plru_test.access_and_check_cache(addr_vec[ADDR_A], 1); // A b C D
+    cache_plru_test.access_and_check_cache(addr_vec[ADDR_E], 2); // A E c D
+    // All bits would be set, so only C's remains set.
+    cache_plru_test.access_and_check_cache(addr_vec[ADDR_C], 0); // a E C D
+    cache_plru_test.access_and_check_cache(addr_vec[ADDR_F], 1); // F e C D
+}
+
+template <class T>
+void
+unit_test_cache_srrip_four_way()
+{
+    cache_policy_test_t<T> cache_rrip_test(/*associativity=*/4,
+                                           /*line_size=*/32,
+                                           /*total_size=*/256);
+    cache_rrip_test.initialize_cache();
+
+    assert(cache_rrip_test.block_indices_are_identical(addr_vec));
+    assert(cache_rrip_test.tags_are_different(addr_vec));
+
+    // The comments show each way's RRPV.  New lines are inserted with 2 and hits
+    // reset to 0.
+    cache_rrip_test.access_and_check_cache(addr_vec[ADDR_A], 1); // A:2 x X X
+    cache_rrip_test.access_and_check_cache(addr_vec[ADDR_B], 2); // A:2 B:2 x X
+    cache_rrip_test.access_and_check_cache(addr_vec[ADDR_C], 3); // A:2 B:2 C:2 x
+    cache_rrip_test.access_and_check_cache(addr_vec[ADDR_D], 0); // A:2 B:2 C:2 D:2
+    cache_rrip_test.access_and_check_cache(addr_vec[ADDR_A], 1); // A:0 B:2 C:2 D:2
+    // Replacing B ages every way by 1 first.
+    cache_rrip_test.access_and_check_cache(addr_vec[ADDR_E], 2); // A:1 E:2 C:3 D:3
+    cache_rrip_test.access_and_check_cache(addr_vec[ADDR_E], 2); // A:1 E:0 C:3 D:3
+    cache_rrip_test.access_and_check_cache(addr_vec[ADDR_F], 3); // A:1 E:0 F:2 D:3
+    cache_rrip_test.access_and_check_cache(addr_vec[ADDR_G], 2); // A:1 E:0 F:2 G:2
+}
+
+void
+unit_test_cache_brrip_four_way()
+{
+    cache_policy_test_t<cache_brrip_t> cache_rrip_test(/*associativity=*/4,
+                                                       /*line_size=*/32,
+                                                       /*total_size=*/256);
+    cache_rrip_test.initialize_cache();
+
+    assert(cache_rrip_test.block_indices_are_identical(addr_vec));
+    assert(cache_rrip_test.tags_are_different(addr_vec));
+
+    // The comments show each way's RRPV.  New lines are mostly inserted with 3, so
+    // a stream of new lines keeps replacing the same way rather than evicting A.
+    cache_rrip_test.access_and_check_cache(addr_vec[ADDR_A], 1); // A:3 x X X
+    cache_rrip_test.access_and_check_cache(addr_vec[ADDR_B], 2); // A:3 B:3 x X
+    cache_rrip_test.access_and_check_cache(addr_vec[ADDR_C], 3); // A:3 B:3 C:3 x
+    cache_rrip_test.access_and_check_cache(addr_vec[ADDR_D], 0); // A:3 B:3 C:3 D:3
+    cache_rrip_test.access_and_check_cache(addr_vec[ADDR_A], 1); // A:0 B:3 C:3 D:3
+    cache_rrip_test.access_and_check_cache(addr_vec[ADDR_E], 1); // A:0 E:3 C:3 D:3
+    cache_rrip_test.access_and_check_cache(addr_vec[ADDR_F], 1); // A:0 F:3 C:3 D:3
+    cache_rrip_test.access_and_check_cache(addr_vec[ADDR_G], 1); // A:0 G:3 C:3 D:3
+}
+
+void
+unit_test_cache_random_four_way()
+{
+    cache_policy_test_t<cache_random_t> cache_random_test(/*associativity=*/4,
+                                                          /*line_size=*/32,
+                                                          /*total_size=*/256);
+    cache_random_test.initialize_cache();
+
+    assert(cache_random_test.block_indices_are_identical(addr_vec));
+    assert(cache_random_test.tags_are_different(addr_vec));
+
+    // Invalid ways are filled first; after that the fixed seed determines the
+    // victims, which only change on a miss.
+    cache_random_test.access_and_check_cache(addr_vec[ADDR_A], 1);
+    cache_random_test.access_and_check_cache(addr_vec[ADDR_B], 2);
+    cache_random_test.access_and_check_cache(addr_vec[ADDR_C], 3);
+    cache_random_test.access_and_check_cache(addr_vec[ADDR_D], 2);
+    cache_random_test.access_and_check_cache(addr_vec[ADDR_E], 2);
+    cache_random_test.access_and_check_cache(addr_vec[ADDR_F], 1);
+    cache_random_test.access_and_check_cache(addr_vec[ADDR_A], 1);
+    cache_random_test.access_and_check_cache(addr_vec[ADDR_G], 0);
+}
+
 void
 unit_test_cache_replacement_policy()
 {
@@ -247,5 +369,12 @@ unit_test_cache_replacement_policy()
     unit_test_cache_lru_eight_way();
     unit_test_cache_fifo_four_way();
     unit_test_cache_fifo_eight_way();
+    unit_test_cache_tree_plru_four_way();
+    unit_test_cache_bit_plru_four_way();
+    unit_test_cache_srrip_four_way<cache_srrip_t>();
+    // The test cache's set 0 is an SRRIP leader set.
+    unit_test_cache_srrip_four_way<cache_drrip_t>();
+    unit_test_cache_brrip_four_way();
+    unit_test_cache_random_four_way();
     // XXX i#4842: Add more test sequences.
 }
@@ -0,0 +1,131 @@
+/* **********************************************************
+ * Copyright (c) 2023 Google, Inc.  All rights reserved.
+ * **********************************************************/
+
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of Google, Inc. nor the names of its contributors may be
+ *   used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL VMWARE, INC. OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+
+/* Unit tests for decode_cache_t. */
+
+#include <iostream>
+
+#include "dr_api.h"
+#include "../tools/decode_cache.h"
+
+namespace {
+
+#define CHECK(cond, msg)                            \
+    do {                                            \
+        if (!(cond)) {                              \
+            std::cerr << "FAILED: " << msg << "\n"; \
+            return false;                           \
+        }                                           \
+    } while (0)
+
+// call rel32 with a zero displacement: its target is the next instruction.
+const unsigned char kCall[] = { 0xe8, 0x00, 0x00, 0x00, 0x00 };
+const unsigned char kNop[] = { 0x90 };
+
+bool
+test_hit_and_miss()
+{
+    decode_cache_t cache;
+    app_pc pc = reinterpret_cast<app_pc>(0x401000);
+    const decode_info_t *info = cache.lookup(GLOBAL_DCONTEXT, pc, kCall, sizeof(kCall));
+    CHECK(info->valid && info->length == sizeof(kCall), "call decode failed");
+    CHECK(info->branch_type == DECODE_BRANCH_DIRECT_CALL, "call branch type");
+    CHECK(info->branch_target == pc + sizeof(kCall), "call target");
+    // The same bytes at the same pc hit, even from a different copy.
+    unsigned char copy[sizeof(kCall)];
+    memcpy(copy, kCall, sizeof(copy));
+    CHECK(cache.lookup(GLOBAL_DCONTEXT, pc, copy, sizeof(copy)) == info, "missed hit");
+    // The same bytes at another pc miss, as the target differs.
+    const decode_info_t *moved =
+        cache.lookup(GLOBAL_DCONTEXT, pc + 0x100, kCall, sizeof(kCall));
+    CHECK(moved != info && moved->branch_target == pc + 0x100 + sizeof(kCall),
+          "pc not part of the key");
+    // Different bytes at the same pc miss, as for modified code.
+    const decode_info_t *nop = cache.lookup(GLOBAL_DCONTEXT, pc, kNop, sizeof(kNop));
+    CHECK(nop != info && nop->valid && nop->length == 1, "encoding not part of the key");
+    CHECK(nop->branch_type == DECODE_BRANCH_NONE && !nop->reads_memory,
+          "nop properties");
+    // Earlier entries are unaffected by the new ones.
+    CHECK(cache.lookup(GLOBAL_DCONTEXT, pc, kCall, sizeof(kCall)) == info,
+          "entry replaced");
+    return true;
+}
+
+bool
+test_mode_change()
+{
+#ifdef X64
+    // 48 89 c3 is "mov %rax,%rbx" in 64-bit mode but 48 alone is "dec %eax" in
+    // 32-bit mode, so the two modes must not share an entry.
+    const unsigned char kMov[] = { 0x48, 0x89, 0xc3 };
+    decode_cache_t cache;
+    app_pc pc = reinterpret_cast<app_pc>(0x1000);
+    dr_isa_mode_t old_mode;
+    dr_set_isa_mode(GLOBAL_DCONTEXT, DR_ISA_AMD64, &old_mode);
+    const decode_info_t *wide = cache.lookup(GLOBAL_DCONTEXT, pc, kMov, sizeof(kMov));
+    CHECK(wide->valid && wide->length == 3, "64-bit decode");
+    dr_set_isa_mode(GLOBAL_DCONTEXT, DR_ISA_IA32, nullptr);
+    const decode_info_t *narrow =
+        cache.lookup(GLOBAL_DCONTEXT, pc, kMov, sizeof(kMov));
+    CHECK(narrow != wide && narrow->valid && narrow->length == 1,
+          "mode not part of the key");
+    CHECK(cache.lookup(GLOBAL_DCONTEXT, pc, kMov, sizeof(kMov)) == narrow,
+          "32-bit entry missed");
+    dr_set_isa_mode(GLOBAL_DCONTEXT, DR_ISA_AMD64, nullptr);
+    CHECK(cache.lookup(GLOBAL_DCONTEXT, pc, kMov, sizeof(kMov)) == wide,
+          "64-bit entry missed after mode change");
+    dr_set_isa_mode(GLOBAL_DCONTEXT, old_mode, nullptr);
+#endif
+    return true;
+}
+
+bool
+test_shared()
+{
+    CHECK(&decode_cache_t::shared() == &decode_cache_t::shared(), "shared instance");
+    return true;
+}
+
+} // namespace
+
+int
+main(int argc, const char *argv[])
+{
+    if (test_hit_and_miss() && test_mode_change() && test_shared()) {
+        std::cerr << "decode_cache_test passed\n";
+        return 0;
+    }
+    std::cerr << "decode_cache_test FAILED\n";
+    exit(1);
+}
@@ -33,14 +33,23 @@
 // Unit tests for drcachesim
 #include <iostream>
 #include <cstdlib>
+#include <thread>
+#include <vector>
 #undef NDEBUG
 #include <assert.h>
+#include "analysis_tool.h"
 #include "config_reader_unit_test.h"
 #include "cache_replacement_policy_unit_test.h"
 #include "simulator/cache.h"
 #include "simulator/cache_lru.h"
 #include "simulator/cache_simulator.h"
+#include "simulator/cache_sweep.h"
+#include "simulator/cache_stats.h"
+#include "simulator/prefetcher_ip_delta.h"
+#include "simulator/prefetcher_stream.h"
+#include "simulator/prefetcher_stride.h"
 #include "../common/memref.h"
+#include "../reader/config_reader.h"
 
 static cache_simulator_knobs_t
 make_test_knobs()
@@ -547,6 +556,326 @@ unit_test_cache_bad_configs()
     }
 }
 
+class thread_sharded_tool_t : public analysis_tool_t {
+public:
+    bool
+    process_memref(const memref_t &memref) override
+    {
+        return true;
+    }
+    bool
+    print_results() override
+    {
+        return true;
+    }
+};
+
+void
+unit_test_core_sharded()
+{
+    cache_simulator_knobs_t knobs = make_test_knobs();
+    knobs.num_cores = 2;
+    {
+        // Tools must opt in to shard types other than threads.
+        thread_sharded_tool_t tool;
+        assert(tool.initialize_shard_type(SHARD_BY_THREAD).empty());
+        assert(!tool.initialize_shard_type(SHARD_BY_CORE).empty());
+        assert(!tool.initialize_shard_type(SHARD_BY_TIME_SLICE).empty());
+    }
+    {
+        // Thread sharding keeps the simulator serial.
+        cache_simulator_t cache_sim(knobs);
+        assert(cache_sim.initialize_shard_type(SHARD_BY_THREAD).empty());
+        assert(!cache_sim.parallel_shard_supported());
+    }
+    {
+        cache_simulator_knobs_t coherent_knobs = knobs;
+        coherent_knobs.model_coherence = true;
+        cache_simulator_t cache_sim(coherent_knobs);
+        assert(!cache_sim.initialize_shard_type(SHARD_BY_CORE).empty());
+    }
+    cache_simulator_t cache_sim(knobs);
+    assert(cache_sim.initialize_shard_type(SHARD_BY_CORE).empty());
+    assert(cache_sim.parallel_shard_supported());
+    // Each core reads its own 16 lines twice, concurrently with the other core.
+    // The second pass hits in the L1 while the first pass misses all the way to
+    // memory.  Enough passes are made to exercise batched hand-offs.
+    const int num_lines = 16;
+    const int num_passes = 4096;
+    auto run_core = [&](int core) {
+        void *shard = cache_sim.parallel_shard_init_stream(core, nullptr, nullptr);
+        for (int pass = 0; pass < num_passes; ++pass) {
+            for (int i = 0; i < num_lines; ++i) {
+                memref_t ref = {};
+                ref.data.type = TRACE_TYPE_READ;
+                ref.data.tid = core + 1;
+                ref.data.size = 8;
+                ref.data.addr = (core * num_lines + i) * 64;
+                if (!cache_sim.parallel_shard_memref(shard, ref)) {
+                    std::cerr << "drcachesim unit_test_core_sharded failed: "
+                              << cache_sim.parallel_shard_error(shard) << "\n";
+                    exit(1);
+                }
+            }
+        }
+        assert(cache_sim.parallel_shard_exit(shard));
+    };
+    std::vector<std::thread> threads;
+    for (int core = 0; core < 2; ++core)
+        threads.emplace_back(run_core, core);
+    for (std::thread &thread : threads)
+        thread.join();
+    for (unsigned int core = 0; core < 2; ++core) {
+        assert(cache_sim.get_cache_metric(metric_name_t::MISSES, 1, core) == num_lines);
+        assert(cache_sim.get_cache_metric(metric_name_t::HITS, 1, core) ==
+               num_lines * (num_passes - 1));
+    }
+    assert(cache_sim.get_cache_metric(metric_name_t::MISSES, 2) == 2 * num_lines);
+    assert(cache_sim.get_cache_metric(metric_name_t::HITS, 2) == 0);
+    assert(cache_sim.get_cache_metric(metric_name_t::CHILD_HITS, 2) ==
+           2 * num_lines * (num_passes - 1));
+}
+
+void
+unit_test_time_sliced()
+{
+    cache_simulator_knobs_t knobs = make_test_knobs();
+    {
+        cache_simulator_knobs_t coherent_knobs = knobs;
+        coherent_knobs.model_coherence = true;
+        cache_simulator_t cache_sim(coherent_knobs);
+        assert(!cache_sim.initialize_shard_type(SHARD_BY_TIME_SLICE).empty());
+    }
+    {
+        cache_simulator_knobs_t warmup_knobs = knobs;
+        warmup_knobs.warmup_refs = 1;
+        cache_simulator_t cache_sim(warmup_knobs);
+        assert(!cache_sim.initialize_shard_type(SHARD_BY_TIME_SLICE).empty());
+    }
+    cache_simulator_t cache_sim(knobs);
+    assert(cache_sim.initialize_shard_type(SHARD_BY_TIME_SLICE).empty());
+    assert(cache_sim.parallel_shard_supported());
+    // Each slice reads the same lines num_passes times.  The second slice first
+    // makes a warm-up pass, so it starts with warm caches and sees no misses.
+    const int num_lines = 16;
+    const int num_passes = 4;
+    auto run_passes = [&](void *shard, int passes) {
+        for (int pass = 0; pass < passes; ++pass) {
+            for (int i = 0; i < num_lines; ++i) {
+                memref_t ref = {};
+                ref.data.type = TRACE_TYPE_READ;
+                ref.data.tid = 1;
+                ref.data.size = 8;
+                ref.data.addr = i * 64;
+                if (!cache_sim.parallel_shard_memref(shard, ref)) {
+                    std::cerr << "drcachesim unit_test_time_sliced failed: "
+                              << cache_sim.parallel_shard_error(shard) << "\n";
+                    exit(1);
+                }
+            }
+        }
+    };
+    void *first = cache_sim.parallel_shard_init_stream(0, nullptr, nullptr);
+    void *second = cache_sim.parallel_shard_init_stream(1, nullptr, nullptr);
+    run_passes(first, num_passes);
+    run_passes(second, 1);
+    assert(cache_sim.parallel_shard_warmup_end(second));
+    run_passes(second, num_passes);
+    assert(cache_sim.parallel_shard_exit(second));
+    assert(cache_sim.parallel_shard_exit(first));
+    assert(cache_sim.get_cache_metric(metric_name_t::MISSES, 1) == num_lines);
+    assert(cache_sim.get_cache_metric(metric_name_t::HITS, 1) ==
+           num_lines * (2 * num_passes - 1));
+    assert(cache_sim.get_cache_metric(metric_name_t::MISSES, 2) == num_lines);
+}
+
+void
+unit_test_cache_sweep()
+{
+    // Two hierarchies differing in line size and L1 geometry.
+    std::string config = R"MYCONFIG(// Sweep config.
+num_cores       1
+line_size       64
+hierarchy base {
+  L1I { type instruction core 0 size 1K assoc 2 prefetcher none parent LLC }
+  L1D { type data core 0 size 1K assoc 2 prefetcher none parent LLC }
+  LLC { size 64K assoc 8 prefetcher none parent memory }
+}
+hierarchy wide {
+  line_size       128
+  L1I { type instruction core 0 size 4K assoc 4 prefetcher none parent LLC }
+  L1D { type data core 0 size 4K assoc 4 prefetcher none parent LLC }
+  LLC { size 64K assoc 8 prefetcher none parent memory }
+}
+)MYCONFIG";
+    std::vector<cache_hierarchy_params_t> hierarchies;
+    {
+        std::istringstream config_in(config);
+        config_reader_t config_reader;
+        assert(config_reader.configure(&config_in, hierarchies));
+    }
+    assert(hierarchies.size() == 2);
+    assert(hierarchies[0].knobs.line_size == 64);
+    assert(hierarchies[1].knobs.line_size == 128);
+    {
+        // A multi-hierarchy file is not a single hierarchy.
+        std::istringstream config_in(config);
+        config_reader_t config_reader;
+        cache_simulator_knobs_t knobs;
+        std::map<std::string, cache_params_t> caches;
+        assert(!config_reader.configure(&config_in, knobs, caches));
+    }
+    {
+        std::istringstream config_in(config + "line_size 32\n");
+        config_reader_t config_reader;
+        std::vector<cache_hierarchy_params_t> bad;
+        assert(!config_reader.configure(&config_in, bad));
+    }
+    // Each hierarchy of the sweep must match a standalone simulation of it.
+    cache_sweep_t sweep(hierarchies, 2);
+    assert(!!sweep);
+    assert(sweep.num_hierarchies() == 2);
+    cache_simulator_t base(hierarchies[0].knobs, hierarchies[0].caches);
+    cache_simulator_t wide(hierarchies[1].knobs, hierarchies[1].caches);
+    // Enough strided reads to span several batches.
+    const int num_refs = 20000;
+    for (int i = 0; i < num_refs; ++i) {
+        memref_t ref = {};
+        ref.data.type = TRACE_TYPE_READ;
+        ref.data.tid = 1;
+        ref.data.size = 8;
+        ref.data.addr = (i * 72) % (16 * 1024);
+        if (!sweep.process_memref(ref) || !base.process_memref(ref) ||
+            !wide.process_memref(ref)) {
+            std::cerr << "drcachesim unit_test_cache_sweep failed\n";
+            exit(1);
+        }
+    }
+    for (unsigned level = 1; level <= 2; ++level) {
+        for (metric_name_t metric : { metric_name_t::HITS, metric_name_t::MISSES }) {
+            assert(sweep.get_hierarchy(0).get_cache_metric(metric, level) ==
+                   base.get_cache_metric(metric, level));
+            assert(sweep.get_hierarchy(1).get_cache_metric(metric, level) ==
+                   wide.get_cache_metric(metric, level));
+        }
+    }
+    assert(base.get_cache_metric(metric_name_t::MISSES, 1) !=
+           wide.get_cache_metric(metric_name_t::MISSES, 1));
+}
+
+// Runs a single-PC pattern of line deltas through a cache with the given prefetcher
+// and returns its stats.
+static void
+run_prefetch_pattern(prefetcher_t *prefetcher, const std::vector<int> &line_deltas,
+                     int_least64_t *misses, int_least64_t *used, int_least64_t *unused)
+{
+    static constexpr int LINE_SIZE = 64;
+    static constexpr int NUM_ACCESSES = 4000;
+    cache_lru_t cache;
+    cache_stats_t stats(LINE_SIZE);
+    bool initialized = cache.init(/*associativity=*/4, LINE_SIZE, /*total_size=*/4096,
+                                  /*parent=*/nullptr, &stats, prefetcher);
+    assert(initialized);
+    memref_t ref;
+    ref.data.type = TRACE_TYPE_READ;
+    ref.data.size = 8;
+    ref.data.pc = 0x1234;
+    addr_t line = 1000;
+    for (int i = 0; i < NUM_ACCESSES; ++i) {
+        line += line_deltas[i % line_deltas.size()];
+        ref.data.addr = line * LINE_SIZE;
+        cache.request(ref);
+    }
+    *misses = stats.get_metric(metric_name_t::MISSES);
+    *used = stats.get_metric(metric_name_t::PREFETCHES_USED);
+    *unused = stats.get_metric(metric_name_t::PREFETCHES_UNUSED);
+    delete prefetcher;
+}
+
+void
+unit_test_prefetchers()
+{
+    static constexpr int LINE_SIZE = 64;
+    int_least64_t baseline, misses, used, unused;
+    // A constant stride of 3 lines is covered by the stride and stream prefetchers.
+    const std::vector<int> stride = { 3 };
+    run_prefetch_pattern(nullptr, stride, &baseline, &used, &unused);
+    assert(used == 0 && unused == 0);
+    run_prefetch_pattern(new prefetcher_stride_t(LINE_SIZE, 2), stride, &misses, &used,
+                         &unused);
+    assert(misses < baseline / 10);
+    assert(used > baseline * 9 / 10);
+    run_prefetch_pattern(new prefetcher_stream_t(LINE_SIZE, 8), stride, &misses, &used,
+                         &unused);
+    assert(misses < baseline / 10);
+    // The stream prefetcher fetches the skipped lines too.
+    assert(unused > 0);
+    // An alternating pattern defeats a stride prefetcher but not delta correlation.
+    const std::vector<int> alternating = { 1, 7 };
+    run_prefetch_pattern(nullptr, alternating, &baseline, &used, &unused);
+    run_prefetch_pattern(new prefetcher_stride_t(LINE_SIZE, 2), alternating, &misses,
+                         &used, &unused);
+    assert(misses > baseline * 9 / 10);
+    run_prefetch_pattern(new prefetcher_ip_delta_t(LINE_SIZE, 2), alternating, &misses,
+                         &used, &unused);
+    assert(misses < baseline / 10);
+    assert(used > baseline * 9 / 10);
+}
+
+void
+unit_test_set_sampling()
+{
+    static constexpr int LINE_SIZE = 64;
+    static constexpr int ASSOC = 4;
+    static constexpr int NUM_SETS = 16;
+    static constexpr int NUM_LOOPS = 3;
+    {
+        // Every 4th set is simulated and the rest are dropped.
+        cache_lru_t cache;
+        caching_device_stats_t stats(/*miss_file=*/"", LINE_SIZE);
+        bool initialized = cache.init(ASSOC, LINE_SIZE, LINE_SIZE * ASSOC * NUM_SETS,
+                                      /*parent=*/nullptr, &stats);
+        assert(initialized);
+        assert(cache.set_set_sampling(3, 4, false) == 0);
+        assert(cache.set_set_sampling(2 * NUM_SETS, 4, false) == 0);
+        assert(cache.set_set_sampling(4, 4, false) == NUM_SETS / 4);
+        stats.set_set_sampling(NUM_SETS / 4, NUM_SETS);
+        // Two lines in each set.
+        generate_1D_accesses(cache, 0, LINE_SIZE, 2 * NUM_SETS, NUM_LOOPS);
+        cache_stats_snapshot_t c_stats = get_cache_stats(stats);
+        assert(c_stats.misses == 2 * NUM_SETS / 4);
+        assert(c_stats.hits == (NUM_LOOPS - 1) * 2 * NUM_SETS / 4);
+        // Only the sampled line of a multi-line access is simulated.
+        memref_t ref;
+        ref.data.type = TRACE_TYPE_READ;
+        ref.data.addr = 0;
+        ref.data.size = 4 * LINE_SIZE;
+        cache.request(ref);
+        assert(get_cache_stats(stats).hits == c_stats.hits + 1);
+    }
+    {
+        // Hashing picks some other subset of the sets.
+        cache_lru_t cache;
+        caching_device_stats_t stats(/*miss_file=*/"", LINE_SIZE);
+        bool initialized = cache.init(ASSOC, LINE_SIZE, LINE_SIZE * ASSOC * NUM_SETS,
+                                      /*parent=*/nullptr, &stats);
+        assert(initialized);
+        int sampled_sets = cache.set_set_sampling(4, 4, true);
+        assert(sampled_sets > 0 && sampled_sets < NUM_SETS);
+        generate_1D_accesses(cache, 0, LINE_SIZE, 2 * NUM_SETS, NUM_LOOPS);
+        cache_stats_snapshot_t c_stats = get_cache_stats(stats);
+        assert(c_stats.misses == 2 * sampled_sets);
+        assert(c_stats.hits + c_stats.misses == NUM_LOOPS * 2 * sampled_sets);
+    }
+    {
+        // The test knobs' caches have a single set, so sampling is not possible.
+        cache_simulator_knobs_t knobs = make_test_knobs();
+        knobs.set_sampling = 2;
+        cache_simulator_t cache_sim(knobs);
+        assert(!cache_sim);
+    }
+}
+
 int
 main(int argc, const char *argv[])
 {
@@ -564,6 +893,11 @@ main(int argc, const char *argv[])
     unit_test_warmup_refs();
     unit_test_sim_refs();
     unit_test_child_hits();
+    unit_test_core_sharded();
+    unit_test_time_sliced();
+    unit_test_cache_sweep();
     unit_test_cache_replacement_policy();
+    unit_test_prefetchers();
+    unit_test_set_sampling();
     return 0;
 }
@@ -0,0 +1,161 @@
+/* **********************************************************
+ * Copyright (c) 2023 Google, Inc.  All rights reserved.
+ * **********************************************************/
+
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of Google, Inc. nor the names of its contributors may be
+ *   used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL VMWARE, INC. OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+
+/* Unit tests for flat_hash_map_t, checked against std::unordered_map. */
+
+#include <iostream>
+#include <random>
+#include <unordered_map>
+
+#include "../common/flat_hash_map.h"
+
+namespace {
+
+#define CHECK(cond, msg)                            \
+    do {                                            \
+        if (!(cond)) {                              \
+            std::cerr << "FAILED: " << msg << "\n"; \
+            return false;                           \
+        }                                           \
+    } while (0)
+
+template <typename Key>
+bool
+same_contents(const flat_hash_map_t<Key, int> &flat,
+              const std::unordered_map<Key, int> &expect)
+{
+    CHECK(flat.size() == expect.size(), "size mismatch");
+    size_t visited = 0;
+    for (const auto &entry : flat) {
+        auto it = expect.find(entry.first);
+        CHECK(it != expect.end() && it->second == entry.second, "entry mismatch");
+        ++visited;
+    }
+    CHECK(visited == expect.size(), "iteration count mismatch");
+    for (const auto &entry : expect) {
+        auto it = flat.find(entry.first);
+        CHECK(it != flat.end() && it->second == entry.second, "lookup mismatch");
+    }
+    return true;
+}
+
+bool
+test_random_ops()
+{
+    flat_hash_map_t<uint64_t, int> flat;
+    std::unordered_map<uint64_t, int> expect;
+    std::mt19937_64 rng(42);
+    // A small key range, including the zero key, forces collisions, probe chains
+    // that wrap around the table, and erasures from the middle of chains.
+    for (int i = 0; i < 200000; ++i) {
+        uint64_t key = rng() % 4096;
+        switch (rng() % 4) {
+        case 0:
+            CHECK(flat.erase(key) == expect.erase(key), "erase mismatch");
+            break;
+        case 1:
+            CHECK(flat.count(key) == expect.count(key), "count mismatch");
+            break;
+        default:
+            ++flat[key];
+            ++expect[key];
+            break;
+        }
+    }
+    if (!same_contents(flat, expect))
+        return false;
+    flat.clear();
+    expect.clear();
+    return same_contents(flat, expect);
+}
+
+bool
+test_line_tags()
+{
+    // Sequential tags are the common case for cache lines.
+    flat_hash_map_t<uint64_t, int> flat;
+    std::unordered_map<uint64_t, int> expect;
+    flat.reserve(1000);
+    for (uint64_t tag = 0x7f0000000000ULL; tag < 0x7f0000000000ULL + 100000; ++tag) {
+        flat[tag] = static_cast<int>(tag & 0xffff);
+        expect[tag] = static_cast<int>(tag & 0xffff);
+    }
+    return same_contents(flat, expect);
+}
+
+bool
+test_pointer_keys()
+{
+    static char buf[64];
+    flat_hash_map_t<char *, int> flat;
+    flat[nullptr] = 1;
+    flat[&buf[0]] = 2;
+    flat[&buf[63]] = 3;
+    CHECK(flat.size() == 3, "pointer size mismatch");
+    CHECK(flat.find(nullptr)->second == 1, "null key lookup failed");
+    CHECK(flat.find(&buf[63])->second == 3, "pointer lookup failed");
+    CHECK(flat.find(&buf[1]) == flat.end(), "missing pointer found");
+    CHECK(flat.erase(nullptr) == 1 && flat.size() == 2, "null key erase failed");
+    return true;
+}
+
+bool
+test_merge_add()
+{
+    flat_hash_map_t<uint64_t, int> total, shard1, shard2;
+    std::unordered_map<uint64_t, int> expect;
+    for (uint64_t key = 0; key < 1000; ++key) {
+        shard1[key] += 1;
+        expect[key] += 1;
+        shard2[key * 2] += 2;
+        expect[key * 2] += 2;
+    }
+    total.merge_add(shard1);
+    total.merge_add(shard2);
+    return same_contents(total, expect);
+}
+
+} // namespace
+
+int
+main(int argc, const char *argv[])
+{
+    if (test_random_ops() && test_line_tags() && test_pointer_keys() &&
+        test_merge_add()) {
+        std::cerr << "flat_hash_map_test passed\n";
+        return 0;
+    }
+    std::cerr << "flat_hash_map_test FAILED\n";
+    exit(1);
+}
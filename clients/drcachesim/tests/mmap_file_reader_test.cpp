@@ -0,0 +1,250 @@
+/* **********************************************************
+ * Copyright (c) 2024 Google, Inc.  All rights reserved.
+ * **********************************************************/
+
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of Google, Inc. nor the names of its contributors may be
+ *   used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL VMWARE, INC. OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+/* Unit tests for reading uncompressed trace files through a memory mapping. */
+
+#include "droption.h"
+#include "file_reader.h"
+#include "mmap_file_reader.h"
+#include "record_file_reader.h"
+
+#include <fstream>
+#include <iostream>
+#include <string.h>
+#include <vector>
+
+#define CHECK(cond, msg, ...)             \
+    do {                                  \
+        if (!(cond)) {                    \
+            fprintf(stderr, "%s\n", msg); \
+            return false;                 \
+        }                                 \
+    } while (0)
+
+static droption_t<std::string> op_trace_file(DROPTION_SCOPE_FRONTEND, "trace_file", "",
+                                             "[Required] Uncompressed trace file",
+                                             "Specifies an uncompressed .trace file to "
+                                             "read with and without a mapping.");
+
+static droption_t<std::string>
+    op_tmp_output_dir(DROPTION_SCOPE_FRONTEND, "tmp_output_dir", "",
+                      "[Required] Output directory for the test files",
+                      "Specifies the directory where the test trace files are written.");
+
+namespace {
+
+using ::dynamorio::drmemtrace::record_file_reader_t;
+
+typedef file_reader_t<std::ifstream *> stream_file_reader_t;
+typedef record_file_reader_t<std::ifstream> stream_record_file_reader_t;
+
+trace_entry_t
+make_entry(unsigned short type, unsigned short size, addr_t addr)
+{
+    trace_entry_t entry;
+    entry.type = type;
+    entry.size = size;
+    entry.addr = addr;
+    return entry;
+}
+
+bool
+write_file(const std::string &path, const std::vector<trace_entry_t> &trace)
+{
+    std::ofstream out(path, std::ofstream::binary);
+    CHECK(!!out, "failed to open output file");
+    out.write(reinterpret_cast<const char *>(trace.data()),
+              trace.size() * sizeof(trace_entry_t));
+    CHECK(!!out, "failed to write output file");
+    return true;
+}
+
+// A trace with records which reader_t rewrites, which must not fault on the
+// read-only mapping.
+std::vector<trace_entry_t>
+make_maybe_fetch_trace()
+{
+    std::vector<trace_entry_t> trace;
+    trace.push_back(make_entry(TRACE_TYPE_HEADER, 0, TRACE_ENTRY_VERSION));
+    trace.push_back(make_entry(TRACE_TYPE_THREAD, sizeof(int), 42));
+    trace.push_back(make_entry(TRACE_TYPE_PID, sizeof(int), 7));
+    trace.push_back(make_entry(TRACE_TYPE_MARKER, TRACE_MARKER_TYPE_VERSION,
+                               TRACE_ENTRY_VERSION));
+    trace.push_back(make_entry(TRACE_TYPE_MARKER, TRACE_MARKER_TYPE_FILETYPE,
+                               OFFLINE_FILE_TYPE_DEFAULT));
+    trace.push_back(make_entry(TRACE_TYPE_MARKER, TRACE_MARKER_TYPE_TIMESTAMP, 1000));
+    for (int i = 0; i < 3; ++i) {
+        // A repeated pc is a rep string iteration without a fetch.
+        trace.push_back(make_entry(TRACE_TYPE_INSTR_MAYBE_FETCH, 2, 0x1000));
+        trace.push_back(make_entry(TRACE_TYPE_READ, 4, 0x10000 + i * 4));
+    }
+    trace.push_back(make_entry(TRACE_TYPE_INSTR, 1, 0x1002));
+    trace.push_back(make_entry(TRACE_TYPE_THREAD_EXIT, sizeof(int), 42));
+    trace.push_back(make_entry(TRACE_TYPE_FOOTER, 0, 0));
+    return trace;
+}
+
+bool
+memrefs_match(const memref_t &memref1, const memref_t &memref2)
+{
+    if (memref1.data.type != memref2.data.type || memref1.data.pid != memref2.data.pid ||
+        memref1.data.tid != memref2.data.tid)
+        return false;
+    if (memref1.marker.type == TRACE_TYPE_MARKER) {
+        return memref1.marker.marker_type == memref2.marker.marker_type &&
+            memref1.marker.marker_value == memref2.marker.marker_value;
+    }
+    return memref1.data.addr == memref2.data.addr &&
+        memref1.data.size == memref2.data.size;
+}
+
+// The mapped reader must produce exactly what the stream reader does.
+bool
+test_memrefs(const std::string &path)
+{
+    stream_file_reader_t stream_reader(path);
+    stream_file_reader_t stream_end;
+    mmap_file_reader_t mmap_reader(path);
+    mmap_file_reader_t mmap_end;
+    CHECK(stream_reader.init(), "failed to initialize stream reader");
+    CHECK(mmap_reader.init(), "failed to initialize mmap reader");
+    uint64_t count = 0;
+    for (; stream_reader != stream_end; ++stream_reader, ++mmap_reader) {
+        CHECK(mmap_reader != mmap_end, "mmap reader ended early");
+        CHECK(memrefs_match(*stream_reader, *mmap_reader), "memref mismatch");
+        ++count;
+    }
+    CHECK(mmap_reader == mmap_end, "mmap reader has extra records");
+    CHECK(count > 0, "no memrefs read");
+    CHECK(mmap_reader.get_record_ordinal() == stream_reader.get_record_ordinal() &&
+              mmap_reader.get_instruction_ordinal() ==
+                  stream_reader.get_instruction_ordinal(),
+          "ordinal mismatch");
+    return true;
+}
+
+// The record readers must provide the exact on-disk records.
+bool
+test_records(const std::string &path)
+{
+    std::ifstream file(path, std::ifstream::binary);
+    std::vector<char> bytes((std::istreambuf_iterator<char>(file)),
+                            std::istreambuf_iterator<char>());
+    CHECK(!bytes.empty() && bytes.size() % sizeof(trace_entry_t) == 0,
+          "unexpected file size");
+    const trace_entry_t *expect = reinterpret_cast<const trace_entry_t *>(bytes.data());
+    size_t num_records = bytes.size() / sizeof(trace_entry_t);
+    mmap_record_file_reader_t mmap_reader(path);
+    mmap_record_file_reader_t mmap_end;
+    CHECK(mmap_reader.init(), "failed to initialize mmap record reader");
+    // The stream reader does not detect EOF itself so we stop at the footer.
+    stream_record_file_reader_t stream_reader(path);
+    CHECK(stream_reader.init(), "failed to initialize stream record reader");
+    size_t count = 0;
+    for (; mmap_reader != mmap_end; ++mmap_reader) {
+        CHECK(count < num_records, "mmap record reader has extra records");
+        CHECK(memcmp(&*mmap_reader, &expect[count], sizeof(trace_entry_t)) == 0,
+              "mmap record mismatch");
+        CHECK(memcmp(&*mmap_reader, &*stream_reader, sizeof(trace_entry_t)) == 0,
+              "stream record mismatch");
+        ++count;
+        if (count < num_records)
+            ++stream_reader;
+    }
+    CHECK(count == num_records, "mmap record reader ended early");
+    CHECK(mmap_reader.get_record_ordinal() == stream_reader.get_record_ordinal(),
+          "record ordinal mismatch");
+    return true;
+}
+
+// An empty file is an empty stream rather than a failure to open.
+bool
+test_empty(const std::string &dir)
+{
+    std::string path = dir + DIRSEP + "empty.trace";
+    CHECK(write_file(path, {}), "failed to create empty file");
+    mmap_record_file_reader_t record_reader(path);
+    mmap_record_file_reader_t record_end;
+    CHECK(record_reader.init(), "failed to open empty file");
+    CHECK(record_reader == record_end, "empty file has records");
+    CHECK(record_reader.get_record_ordinal() == 0, "empty file has an ordinal");
+    // Without a header an empty file is not a valid memref stream, but both
+    // readers must reject it the same way.
+    stream_file_reader_t stream_reader(path);
+    mmap_file_reader_t mmap_reader(path);
+    CHECK(!stream_reader.init() && !mmap_reader.init(),
+          "empty file accepted as a memref stream");
+    return true;
+}
+
+bool
+test_maybe_fetch(const std::string &dir)
+{
+    std::string path = dir + DIRSEP + "maybe_fetch.trace";
+    CHECK(write_file(path, make_maybe_fetch_trace()), "failed to create trace file");
+    if (!test_memrefs(path) || !test_records(path))
+        return false;
+    mmap_file_reader_t reader(path);
+    mmap_file_reader_t reader_end;
+    CHECK(reader.init(), "failed to initialize reader");
+    int fetched = 0, no_fetch = 0;
+    for (; reader != reader_end; ++reader) {
+        if ((*reader).instr.type == TRACE_TYPE_INSTR)
+            ++fetched;
+        else if ((*reader).instr.type == TRACE_TYPE_INSTR_NO_FETCH)
+            ++no_fetch;
+    }
+    CHECK(fetched == 2 && no_fetch == 2, "wrong fetch conversion");
+    return true;
+}
+
+} // namespace
+
+int
+main(int argc, const char *argv[])
+{
+    std::string parse_err;
+    if (!droption_parser_t::parse_argv(DROPTION_SCOPE_FRONTEND, argc, (const char **)argv,
+                                       &parse_err, NULL) ||
+        op_trace_file.get_value().empty() || op_tmp_output_dir.get_value().empty()) {
+        std::cerr << "Usage error: " << parse_err << "\nUsage:\n"
+                  << droption_parser_t::usage_short(DROPTION_SCOPE_ALL);
+        return 1;
+    }
+    if (!test_memrefs(op_trace_file.get_value()) ||
+        !test_records(op_trace_file.get_value()) ||
+        !test_empty(op_tmp_output_dir.get_value()) ||
+        !test_maybe_fetch(op_tmp_output_dir.get_value()))
+        return 1;
+    std::cerr << "all done\n";
+    return 0;
+}
@@ -98,12 +98,12 @@ class raw2trace_test_t : public raw2trace_t {
 public:
     raw2trace_test_t(const std::vector<std::istream *> &input,
                      const std::vector<std::ostream *> &output, instrlist_t &instrs,
-                     void *drcontext)
+                     void *drcontext, int worker_count = -1)
         : raw2trace_t(nullptr, input, output, {}, INVALID_FILE, nullptr, nullptr,
                       drcontext,
                       // The sequences are small so we print everything for easier
                       // debugging and viewing of what's going on.
-                      4)
+                      4, worker_count)
     {
         module_mapper_ = std::unique_ptr<module_mapper_t>(
             new test_module_mapper_t(&instrs, drcontext));
@@ -179,11 +179,11 @@ make_pid()
 }
 
 offline_entry_t
-make_tid()
+make_tid(thread_id_t tid = 1)
 {
     offline_entry_t entry;
     entry.tid.type = OFFLINE_TYPE_THREAD;
-    entry.tid.tid = 1;
+    entry.tid.tid = tid;
     return entry;
 }
 
@@ -1860,6 +1860,83 @@ test_xfer_absolute(void *drcontext)
         check_entry(entries, idx, TRACE_TYPE_FOOTER, -1));
 }
 
+bool
+test_unequal_thread_files(void *drcontext)
+{
+    std::cerr << "\n===============\nTesting unequal thread files\n";
+    instrlist_t *ilist = instrlist_create(drcontext);
+    // raw2trace doesn't like offsets of 0 so we shift with a nop.
+    instr_t *nop = XINST_CREATE_nop(drcontext);
+    instr_t *move =
+        XINST_CREATE_move(drcontext, opnd_create_reg(REG1), opnd_create_reg(REG2));
+    instrlist_append(ilist, nop);
+    instrlist_append(ilist, move);
+    size_t offs_mov = instr_length(drcontext, nop);
+
+    // Workers claim thread files dynamically, so with files of very different sizes
+    // they finish in a different order than they started.  Each output must still
+    // match what a serial conversion produces.  We build the raw files once so the
+    // timestamps are identical for both conversions.
+    const int block_counts[] = { 3, 400, 1, 90, 1200, 17, 250 };
+    std::vector<std::string> raw_files;
+    for (size_t i = 0; i < sizeof(block_counts) / sizeof(block_counts[0]); ++i) {
+        std::vector<offline_entry_t> raw;
+        raw.push_back(make_header());
+        raw.push_back(make_tid(static_cast<thread_id_t>(i + 1)));
+        raw.push_back(make_pid());
+        raw.push_back(make_line_size());
+        raw.push_back(make_timestamp());
+        raw.push_back(make_core());
+        for (int j = 0; j < block_counts[i]; ++j) {
+            raw.push_back(make_block(offs_mov, 1));
+            if (j % 64 == 63) {
+                raw.push_back(make_timestamp());
+                raw.push_back(make_core());
+            }
+        }
+        raw.push_back(make_exit());
+        std::ostringstream raw_out;
+        for (const auto &entry : raw) {
+            raw_out << std::string(reinterpret_cast<const char *>(&entry),
+                                   reinterpret_cast<const char *>(&entry + 1));
+        }
+        raw_files.push_back(raw_out.str());
+    }
+
+    auto convert = [&](int worker_count, std::vector<std::string> &results) {
+        std::vector<std::unique_ptr<std::istringstream>> in_streams;
+        std::vector<std::unique_ptr<std::ostringstream>> out_streams;
+        std::vector<std::istream *> input;
+        std::vector<std::ostream *> output;
+        for (const std::string &raw : raw_files) {
+            in_streams.emplace_back(new std::istringstream(raw));
+            out_streams.emplace_back(new std::ostringstream());
+            input.push_back(in_streams.back().get());
+            output.push_back(out_streams.back().get());
+        }
+        raw2trace_test_t raw2trace(input, output, *ilist, drcontext, worker_count);
+        std::string error = raw2trace.do_conversion();
+        CHECK(error.empty(), error);
+        for (const auto &out : out_streams)
+            results.push_back(out->str());
+        return true;
+    };
+    std::vector<std::string> serial, parallel;
+    bool res = convert(/*worker_count=*/0, serial) &&
+        // More files than workers, so each worker claims several.
+        convert(/*worker_count=*/3, parallel);
+    instrlist_clear_and_destroy(drcontext, ilist);
+    if (!res)
+        return false;
+    CHECK(serial.size() == parallel.size(), "output count mismatch");
+    for (size_t i = 0; i < serial.size(); ++i) {
+        CHECK(!serial[i].empty(), "empty output");
+        CHECK(serial[i] == parallel[i],
+              "parallel output differs for thread file " + std::to_string(i));
+    }
+    return true;
+}
+
 int
 main(int argc, const char *argv[])
 {
@@ -1876,7 +1953,8 @@ main(int argc, const char *argv[])
         !test_rseq_side_exit_signal(drcontext) ||
         !test_rseq_side_exit_inverted(drcontext) ||
         !test_rseq_side_exit_inverted_with_timestamp(drcontext) ||
-        !test_xfer_modoffs(drcontext) || !test_xfer_absolute(drcontext))
+        !test_xfer_modoffs(drcontext) || !test_xfer_absolute(drcontext) ||
+        !test_unequal_thread_files(drcontext))
         return 1;
     return 0;
 }
@@ -30,6 +30,7 @@
  * DAMAGE.
  */
 
+#include <cmath>
 #include <iostream>
 #undef NDEBUG
 #include <assert.h>
@@ -501,6 +502,121 @@ data_histogram_test()
     }
 }
 
+// Test that the Fenwick tree engine produces the same results as the skip list.
+void
+fenwick_tree_test()
+{
+    std::cerr << "fenwick_tree_test()\n";
+    constexpr uint32_t LINE_SIZE = 64;
+    constexpr int NUM_LINES = 5000;
+    constexpr int NUM_REFS = 200000;
+
+    for (unsigned int distance_limit : { 0, 1000 }) {
+        reuse_distance_knobs_t knobs;
+        knobs.line_size = LINE_SIZE;
+        knobs.distance_threshold = 50;
+        knobs.distance_limit = distance_limit;
+        reuse_distance_test_t list_reuse(knobs);
+        knobs.use_fenwick_tree = true;
+        // Enable the brute-force cross-check in debug builds.
+        knobs.verify_skip = true;
+        reuse_distance_test_t tree_reuse(knobs);
+
+        // A simple deterministic pseudo-random sequence mixing short and long
+        // distances, including enough distinct lines to renumber the tree's slots.
+        uint32_t seed = 42;
+        for (int i = 0; i < NUM_REFS; ++i) {
+            seed = seed * 1103515245 + 12345;
+            int line = (seed >> 8) % ((seed & 1) != 0 ? 64 : NUM_LINES);
+            memref_t memref = generate_memref(line * LINE_SIZE,
+                                              (i % 3) == 0 ? TRACE_TYPE_INSTR
+                                                           : TRACE_TYPE_READ);
+            bool success = list_reuse.process_memref(memref);
+            assert(success);
+            success = tree_reuse.process_memref(memref);
+            assert(success);
+        }
+
+        auto *list_shard = list_reuse.get_aggregated_results();
+        auto *tree_shard = tree_reuse.get_aggregated_results();
+        assert(list_shard->dist_map == tree_shard->dist_map);
+        assert(list_shard->dist_map_data == tree_shard->dist_map_data);
+        assert(list_shard->pruned_address_count == tree_shard->pruned_address_count);
+        assert(list_shard->pruned_address_hits == tree_shard->pruned_address_hits);
+        assert(list_shard->ref_list->cur_time_ == tree_shard->ref_list->cur_time_);
+        assert(list_shard->cache_map.size() == tree_shard->cache_map.size());
+        for (const auto &entry : list_shard->cache_map) {
+            const auto &other = tree_shard->cache_map.find(entry.first);
+            assert(other != tree_shard->cache_map.end());
+            assert(entry.second->total_refs == other->second->total_refs);
+            if (distance_limit == 0)
+                assert(entry.second->distant_refs == other->second->distant_refs);
+        }
+    }
+}
+
+void
+sampled_reuse_distance_test()
+{
+    std::cerr << "sampled_reuse_distance_test()\n";
+    constexpr uint32_t LINE_SIZE = 64;
+    constexpr int NUM_LINES = 20000;
+    constexpr int NUM_REFS = 400000;
+    constexpr unsigned int MAX_LINES = 500;
+
+    reuse_distance_knobs_t knobs;
+    knobs.line_size = LINE_SIZE;
+    knobs.use_fenwick_tree = true;
+    reuse_distance_test_t exact_reuse(knobs);
+    knobs.sample_rate = 0.25;
+    reuse_distance_test_t sampled_reuse(knobs);
+    knobs.sample_rate = 1.0;
+    knobs.sample_max_lines = MAX_LINES;
+    reuse_distance_test_t bounded_reuse(knobs);
+
+    uint32_t seed = 42;
+    for (int i = 0; i < NUM_REFS; ++i) {
+        seed = seed * 1103515245 + 12345;
+        int line = (seed >> 8) % ((seed & 1) != 0 ? 1000 : NUM_LINES);
+        memref_t memref = generate_memref(line * LINE_SIZE, TRACE_TYPE_READ);
+        bool success = exact_reuse.process_memref(memref);
+        assert(success);
+        success = sampled_reuse.process_memref(memref);
+        assert(success);
+        success = bounded_reuse.process_memref(memref);
+        assert(success);
+    }
+
+    auto mean_and_count = [](const reuse_distance_t::distance_histogram_t &hist,
+                             double *mean) {
+        double sum = 0.;
+        int_least64_t count = 0;
+        for (const auto &entry : hist) {
+            sum += static_cast<double>(entry.first) * entry.second;
+            count += entry.second;
+        }
+        *mean = sum / count;
+        return count;
+    };
+    auto *exact_shard = exact_reuse.get_aggregated_results();
+    double exact_mean;
+    int_least64_t exact_count = mean_and_count(exact_shard->dist_map, &exact_mean);
+    // The sampled estimates should be close to the exact figures.
+    for (auto *shard : { sampled_reuse.get_aggregated_results(),
+                         bounded_reuse.get_aggregated_results() }) {
+        assert(shard->total_refs == NUM_REFS);
+        assert(shard->sample_shift > 0);
+        assert(shard->sampled_reuses < static_cast<uint_least64_t>(exact_count));
+        double mean;
+        int_least64_t count = mean_and_count(shard->dist_map, &mean);
+        assert(std::abs(count - exact_count) < exact_count * 0.15);
+        assert(std::abs(mean - exact_mean) < exact_mean * 0.15);
+    }
+    assert(sampled_reuse.get_aggregated_results()->sample_shift == 2);
+    // The line budget must be respected.
+    assert(bounded_reuse.get_aggregated_results()->cache_map.size() <= MAX_LINES);
+}
+
 } // namespace
 
 int
@@ -512,4 +628,6 @@ main(int argc, const char *argv[])
     simple_reuse_distance_test();
     reuse_distance_limit_test();
     data_histogram_test();
+    fenwick_tree_test();
+    sampled_reuse_distance_test();
 }
@@ -823,10 +823,11 @@ test_synthetic()
         std::cerr << "cpu #" << i << " schedule: " << sched_as_string[i] << "\n";
     }
     // Hardcoding here for the 2 outputs and 7 inputs.
-    // We expect 3 letter sequences (our quantum) alternating every-other as each
-    // core alternates; with an odd number the 2nd core finishes early.
-    assert(sched_as_string[0] == "AAACCCEEEGGGBBBDDDFFFAAACCCEEEGGG");
-    assert(sched_as_string[1] == "BBBDDDFFFAAACCCEEEGGGBBBDDDFFF");
+    // We expect 3 letter sequences (our quantum) with the waiting inputs dealt out
+    // every-other to each core's queue, where they stay.  The 2nd core has fewer
+    // inputs and so runs out first and steals the final quantum of E.
+    assert(sched_as_string[0] == "AAACCCEEEGGGAAACCCEEEGGGAAACCCGGG");
+    assert(sched_as_string[1] == "BBBDDDFFFBBBDDDFFFBBBDDDFFFEEE");
 }
 
 static void
@@ -1207,10 +1208,10 @@ test_replay()
     static constexpr int NUM_INSTRS = 9;
     static constexpr int QUANTUM_INSTRS = 3;
     // For our 2 outputs and 7 inputs:
-    // We expect 3 letter sequences (our quantum) alternating every-other as each
-    // core alternates; with an odd number the 2nd core finishes early.
-    static const char *const CORE0_SCHED_STRING = "AAACCCEEEGGGBBBDDDFFFAAACCCEEEGGG";
-    static const char *const CORE1_SCHED_STRING = "BBBDDDFFFAAACCCEEEGGGBBBDDDFFF";
+    // We expect 3 letter sequences (our quantum) with each core cycling through its
+    // own inputs until the 2nd core runs out and steals the final quantum of E.
+    static const char *const CORE0_SCHED_STRING = "AAACCCEEEGGGAAACCCEEEGGGAAACCCGGG";
+    static const char *const CORE1_SCHED_STRING = "BBBDDDFFFBBBDDDFFFBBBDDDFFFEEE";
 
     static constexpr memref_tid_t TID_BASE = 100;
     std::vector<trace_entry_t> inputs[NUM_INPUTS];
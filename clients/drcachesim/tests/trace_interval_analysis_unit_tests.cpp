@@ -30,7 +30,9 @@
  * DAMAGE.
  */
 
-/* Unit tests for the trace interval analysis APIs in analysis_tool_t. */
+/* Unit tests for the trace interval analysis and batched delivery APIs in
+ * analysis_tool_t.
+ */
 
 #include "analyzer.h"
 #include "memref_gen.h"
@@ -38,6 +40,7 @@
 #include <algorithm>
 #include <inttypes.h>
 #include <iostream>
+#include <map>
 #include <vector>
 
 #define FATAL_ERROR(msg, ...)                               \
@@ -158,13 +161,15 @@ private:
 class test_analyzer_t : public analyzer_t {
 public:
     test_analyzer_t(const std::vector<memref_t> &refs, analysis_tool_t **tools,
-                    int num_tools, bool parallel, uint64_t interval_microseconds)
+                    int num_tools, bool parallel, uint64_t interval_microseconds,
+                    size_t batch_size = 0)
         : analyzer_t()
     {
         num_tools_ = num_tools;
         tools_ = tools;
         parallel_ = parallel;
         interval_microseconds_ = interval_microseconds;
+        batch_size_ = batch_size;
         verbosity_ = 1;
         worker_count_ = 1;
         test_stream_ =
@@ -646,11 +651,153 @@ test_non_zero_interval(bool parallel, bool combine_only_active_shards = true)
     return true;
 }
 
+// Counts the records of each shard, optionally accepting them in batches.
+class counting_tool_t : public analysis_tool_t {
+public:
+    struct counts_t {
+        uint64_t instrs = 0;
+        uint64_t data = 0;
+        uint64_t markers = 0;
+        uint64_t other = 0;
+        bool
+        operator==(const counts_t &rhs) const
+        {
+            return instrs == rhs.instrs && data == rhs.data && markers == rhs.markers &&
+                other == rhs.other;
+        }
+    };
+    explicit counting_tool_t(bool batch)
+        : batch_(batch)
+    {
+    }
+    bool
+    process_memref(const memref_t &memref) override
+    {
+        return true;
+    }
+    bool
+    print_results() override
+    {
+        return true;
+    }
+    bool
+    parallel_shard_supported() override
+    {
+        return true;
+    }
+    bool
+    parallel_shard_batch_supported() override
+    {
+        return batch_;
+    }
+    void *
+    parallel_shard_init(int shard_index, void *worker_data) override
+    {
+        return &counts_[shard_index];
+    }
+    bool
+    parallel_shard_exit(void *shard_data) override
+    {
+        return true;
+    }
+    bool
+    parallel_shard_memref(void *shard_data, const memref_t &memref) override
+    {
+        counts_t *counts = reinterpret_cast<counts_t *>(shard_data);
+        if (type_is_instr(memref.instr.type))
+            ++counts->instrs;
+        else if (memref.data.type == TRACE_TYPE_READ ||
+                 memref.data.type == TRACE_TYPE_WRITE)
+            ++counts->data;
+        else if (memref.marker.type == TRACE_TYPE_MARKER)
+            ++counts->markers;
+        else
+            ++counts->other;
+        return true;
+    }
+    bool
+    parallel_shard_memref_batch(void *shard_data, const memref_t *memrefs,
+                                size_t count) override
+    {
+        batch_sizes_.push_back(count);
+        return analysis_tool_t::parallel_shard_memref_batch(shard_data, memrefs, count);
+    }
+    const std::map<int, counts_t> &
+    get_counts() const
+    {
+        return counts_;
+    }
+    const std::vector<size_t> &
+    get_batch_sizes() const
+    {
+        return batch_sizes_;
+    }
+
+private:
+    bool batch_;
+    // Keyed by shard index.  We have a single worker so no lock is needed.
+    std::map<int, counts_t> counts_;
+    std::vector<size_t> batch_sizes_;
+};
+
+static bool
+test_batched_delivery()
+{
+    constexpr size_t kBatchSize = 16;
+    // Two interleaved threads.  The first ends with an exit record part way into
+    // a batch.  The second has no exit record, leaving a partial batch to be
+    // delivered once the stream ends.
+    std::vector<memref_t> refs;
+    refs.push_back(gen_marker(51, TRACE_MARKER_TYPE_TIMESTAMP, 10));
+    refs.push_back(gen_marker(52, TRACE_MARKER_TYPE_TIMESTAMP, 20));
+    for (int i = 0; i < 50; ++i) {
+        refs.push_back(gen_instr(51, 1000 + i));
+        refs.push_back(gen_data(51, i % 2 == 0, 0x10000 + i * 8, 8));
+        if (i % 7 == 0) {
+            refs.push_back(gen_instr(52, 2000 + i));
+            refs.push_back(gen_data(52, true, 0x20000 + i * 8, 8));
+        }
+    }
+    refs.push_back(gen_exit(51));
+    for (int i = 0; i < 21; ++i)
+        refs.push_back(gen_instr(52, 3000 + i));
+
+    counting_tool_t batch_tool(/*batch=*/true);
+    counting_tool_t record_tool(/*batch=*/false);
+    analysis_tool_t *batch_tools[] = { &batch_tool };
+    analysis_tool_t *record_tools[] = { &record_tool };
+    test_analyzer_t batch_analyzer(refs, batch_tools, 1, /*parallel=*/true, 0,
+                                   kBatchSize);
+    test_analyzer_t record_analyzer(refs, record_tools, 1, /*parallel=*/true, 0);
+    CHECK(batch_analyzer.run(), batch_analyzer.get_error_string().c_str());
+    CHECK(record_analyzer.run(), record_analyzer.get_error_string().c_str());
+
+    CHECK(batch_tool.get_counts().size() == 2, "expected two shards");
+    CHECK(batch_tool.get_counts() == record_tool.get_counts(),
+          "batched counts differ from per-record counts");
+    uint64_t total = 0;
+    for (const auto &keyval : batch_tool.get_counts()) {
+        const counting_tool_t::counts_t &counts = keyval.second;
+        total += counts.instrs + counts.data + counts.markers + counts.other;
+    }
+    CHECK(total == refs.size(), "records were dropped");
+    CHECK(record_tool.get_batch_sizes().empty(), "per-record tool received a batch");
+    const std::vector<size_t> &sizes = batch_tool.get_batch_sizes();
+    CHECK(!sizes.empty(), "batch tool received no batches");
+    CHECK(std::all_of(sizes.begin(), sizes.end(),
+                      [](size_t size) { return size > 0 && size <= kBatchSize; }),
+          "batch size out of range");
+    // The trailing records of the second thread form the final partial batch.
+    CHECK(sizes.back() < kBatchSize, "final batch is not partial");
+    fprintf(stderr, "test_batched_delivery done\n");
+    return true;
+}
+
 int
 main(int argc, const char *argv[])
 {
     if (!test_non_zero_interval(false) || !test_non_zero_interval(true, true) ||
-        !test_non_zero_interval(true, false))
+        !test_non_zero_interval(true, false) || !test_batched_delivery())
         return 1;
     fprintf(stderr, "All done!\n");
     return 0;
@@ -0,0 +1,306 @@
+/* **********************************************************
+ * Copyright (c) 2023 Google, Inc.  All rights reserved.
+ * **********************************************************/
+
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of Google, Inc. nor the names of its contributors may be
+ *   used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL VMWARE, INC. OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+
+/* Unit tests for writing and reading seekable zstd trace files. */
+
+#include "droption.h"
+#include "zstd_ostream.h"
+#include "zstd_file_reader.h"
+
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#define CHECK(cond, msg, ...)             \
+    do {                                  \
+        if (!(cond)) {                    \
+            fprintf(stderr, "%s\n", msg); \
+            return false;                 \
+        }                                 \
+    } while (0)
+
+static droption_t<std::string>
+    op_tmp_output_dir(DROPTION_SCOPE_FRONTEND, "tmp_output_dir", "",
+                      "[Required] Output directory for the test files",
+                      "Specifies the directory where the test trace files are written.");
+
+namespace {
+
+constexpr memref_tid_t TID = 42;
+constexpr memref_pid_t PID = 7;
+constexpr int NUM_CHUNKS = 7;
+constexpr int CHUNK_INSTRS = 5;
+constexpr addr_t BASE_PC = 0x1000;
+constexpr uint64_t BASE_TIMESTAMP = 1000;
+
+trace_entry_t
+make_entry(unsigned short type, unsigned short size, addr_t addr)
+{
+    trace_entry_t entry;
+    entry.type = type;
+    entry.size = size;
+    entry.addr = addr;
+    return entry;
+}
+
+trace_entry_t
+make_marker(trace_marker_type_t type, uintptr_t value)
+{
+    return make_entry(TRACE_TYPE_MARKER, static_cast<unsigned short>(type), value);
+}
+
+// Returns a single-thread trace laid out in chunks the way raw2trace writes them,
+// with a chunk footer ending each chunk but the last, and a record ordinal and
+// duplicates of the last timestamp and cpu starting each chunk but the first.
+// Each instruction has a unique pc and is followed by a load, and each chunk has
+// a new timestamp and cpu partway through.
+std::vector<trace_entry_t>
+make_trace()
+{
+    std::vector<trace_entry_t> trace;
+    trace.push_back(make_entry(TRACE_TYPE_HEADER, 0, TRACE_ENTRY_VERSION));
+    trace.push_back(make_entry(TRACE_TYPE_THREAD, sizeof(int), TID));
+    trace.push_back(make_entry(TRACE_TYPE_PID, sizeof(int), PID));
+    trace.push_back(make_marker(TRACE_MARKER_TYPE_VERSION, TRACE_ENTRY_VERSION));
+    trace.push_back(make_marker(TRACE_MARKER_TYPE_FILETYPE, OFFLINE_FILE_TYPE_DEFAULT));
+    trace.push_back(make_marker(TRACE_MARKER_TYPE_CACHE_LINE_SIZE, 64));
+    trace.push_back(make_marker(TRACE_MARKER_TYPE_CHUNK_INSTR_COUNT, CHUNK_INSTRS));
+    trace.push_back(make_marker(TRACE_MARKER_TYPE_PAGE_SIZE, 4096));
+    trace.push_back(make_marker(TRACE_MARKER_TYPE_TIMESTAMP, BASE_TIMESTAMP));
+    trace.push_back(make_marker(TRACE_MARKER_TYPE_CPU_ID, 0));
+    // The record ordinal marker holds the count of visible records before it,
+    // which excludes the duplicated timestamps and cpus.
+    uint64_t refs = 7;
+    uint64_t timestamp = BASE_TIMESTAMP;
+    uintptr_t cpu = 0;
+    for (int chunk = 0; chunk < NUM_CHUNKS; ++chunk) {
+        if (chunk > 0) {
+            trace.push_back(make_marker(TRACE_MARKER_TYPE_CHUNK_FOOTER, chunk - 1));
+            ++refs;
+            trace.push_back(make_marker(TRACE_MARKER_TYPE_RECORD_ORDINAL, refs));
+            trace.push_back(make_marker(TRACE_MARKER_TYPE_TIMESTAMP, timestamp));
+            trace.push_back(make_marker(TRACE_MARKER_TYPE_CPU_ID, cpu));
+        }
+        for (int i = 0; i < CHUNK_INSTRS; ++i) {
+            if (i == CHUNK_INSTRS / 2) {
+                timestamp += 10;
+                cpu = 1 - cpu;
+                trace.push_back(make_marker(TRACE_MARKER_TYPE_TIMESTAMP, timestamp));
+                trace.push_back(make_marker(TRACE_MARKER_TYPE_CPU_ID, cpu));
+                refs += 2;
+            }
+            int instr = chunk * CHUNK_INSTRS + i;
+            trace.push_back(make_entry(TRACE_TYPE_INSTR, 1, BASE_PC + instr));
+            trace.push_back(make_entry(TRACE_TYPE_READ, 4, 0x10000 + instr * 8));
+            refs += 2;
+        }
+    }
+    trace.push_back(make_entry(TRACE_TYPE_THREAD_EXIT, sizeof(int), TID));
+    trace.push_back(make_entry(TRACE_TYPE_FOOTER, 0, 0));
+    return trace;
+}
+
+bool
+write_trace(const std::string &path, const std::vector<trace_entry_t> &trace,
+            bool use_components)
+{
+    zstd_ostream_t out(path);
+    CHECK(!!out, "failed to open zstd output file");
+    for (const trace_entry_t &entry : trace) {
+        // Mimic raw2trace, which starts a new component right after each footer.
+        // Without that the writer splits frames at the footers on its own.
+        if (use_components && entry.type == TRACE_TYPE_MARKER &&
+            entry.size == TRACE_MARKER_TYPE_RECORD_ORDINAL) {
+            std::string error = out.open_new_component("chunk");
+            CHECK(error.empty(), error.c_str());
+        }
+        out.write(reinterpret_cast<const char *>(&entry), sizeof(entry));
+        CHECK(!!out, "failed to write to zstd output file");
+    }
+    return true;
+}
+
+// The index is a skippable frame, so a generic zstd decoder must reproduce the
+// records exactly.
+bool
+test_plain_decompression(const std::string &path, const std::vector<trace_entry_t> &trace)
+{
+    std::ifstream file(path, std::ifstream::binary);
+    std::vector<char> input((std::istreambuf_iterator<char>(file)),
+                            std::istreambuf_iterator<char>());
+    std::vector<char> output(trace.size() * sizeof(trace_entry_t) + 1);
+    ZSTD_DCtx *dctx = ZSTD_createDCtx();
+    ZSTD_inBuffer in = { input.data(), input.size(), 0 };
+    ZSTD_outBuffer out = { output.data(), output.size(), 0 };
+    size_t res = 0;
+    while (in.pos < in.size && !ZSTD_isError(res))
+        res = ZSTD_decompressStream(dctx, &out, &in);
+    ZSTD_freeDCtx(dctx);
+    CHECK(!ZSTD_isError(res) && res == 0, "failed to decompress as plain zstd");
+    CHECK(out.pos == trace.size() * sizeof(trace_entry_t), "wrong decompressed size");
+    CHECK(memcmp(output.data(), trace.data(), out.pos) == 0, "wrong decompressed data");
+    return true;
+}
+
+bool
+test_sequential(const std::string &path)
+{
+    zstd_file_reader_t reader(path);
+    zstd_file_reader_t reader_end;
+    CHECK(reader.init(), "failed to initialize reader");
+    int instrs = 0;
+    int loads = 0;
+    for (; reader != reader_end; ++reader) {
+        const memref_t &memref = *reader;
+        if (type_is_instr(memref.instr.type)) {
+            CHECK(memref.instr.addr == BASE_PC + instrs, "wrong instruction pc");
+            ++instrs;
+        } else if (memref.data.type == TRACE_TYPE_READ)
+            ++loads;
+    }
+    CHECK(instrs == NUM_CHUNKS * CHUNK_INSTRS, "wrong instruction count");
+    CHECK(loads == instrs, "wrong load count");
+    return true;
+}
+
+// Skipping must land on the same record with the same state as a linear walk,
+// whether it jumps to a new frame or stays within the current one.
+bool
+test_skip(const std::string &path)
+{
+    // First record the state at each instruction from a linear walk.
+    std::vector<uint64_t> record_ordinals;
+    std::vector<uint64_t> timestamps;
+    {
+        zstd_file_reader_t reader(path);
+        zstd_file_reader_t reader_end;
+        CHECK(reader.init(), "failed to initialize reader");
+        for (; reader != reader_end; ++reader) {
+            if (type_is_instr((*reader).instr.type)) {
+                record_ordinals.push_back(reader.get_record_ordinal());
+                timestamps.push_back(reader.get_last_timestamp());
+            }
+        }
+    }
+    const int num_instrs = NUM_CHUNKS * CHUNK_INSTRS;
+    CHECK(record_ordinals.size() == static_cast<size_t>(num_instrs),
+          "wrong instruction count");
+    // We skip both from the start and from a prior skip target.
+    for (int start = 0; start < CHUNK_INSTRS + 2; start += CHUNK_INSTRS + 1) {
+        for (int skip = 1; skip < num_instrs - start; ++skip) {
+            std::unique_ptr<reader_t> iter =
+                std::unique_ptr<reader_t>(new zstd_file_reader_t(path));
+            std::unique_ptr<reader_t> iter_end =
+                std::unique_ptr<reader_t>(new zstd_file_reader_t());
+            CHECK(iter->init(), "failed to initialize reader");
+            if (start > 0)
+                iter->skip_instructions(start);
+            iter->skip_instructions(skip);
+            // Any timestamp and cpu markers inserted by the skip come first.
+            while (*iter != *iter_end && !type_is_instr((**iter).instr.type)) {
+                CHECK((**iter).marker.type == TRACE_TYPE_MARKER, "expected a marker");
+                ++(*iter);
+            }
+            CHECK(*iter != *iter_end, "missing target instruction");
+            int target = start + skip;
+            CHECK((**iter).instr.addr == BASE_PC + target, "skipped to wrong pc");
+            CHECK(iter->get_instruction_ordinal() == static_cast<uint64_t>(target) + 1,
+                  "wrong instruction ordinal after skip");
+            CHECK(iter->get_record_ordinal() == record_ordinals[target],
+                  "wrong record ordinal after skip");
+            CHECK(iter->get_last_timestamp() == timestamps[target],
+                  "wrong timestamp after skip");
+        }
+    }
+    return true;
+}
+
+bool
+test_truncation(const std::string &path)
+{
+    // Drop the index and part of the final frame.
+    std::string truncated = path + ".truncated";
+    {
+        std::ifstream in(path, std::ifstream::binary);
+        std::vector<char> data((std::istreambuf_iterator<char>(in)),
+                               std::istreambuf_iterator<char>());
+        std::ofstream out(truncated, std::ofstream::binary);
+        out.write(data.data(), data.size() / 2);
+    }
+    zstd_file_reader_t reader(truncated);
+    zstd_file_reader_t reader_end;
+    CHECK(reader.init(), "failed to initialize reader");
+    bool saw_footer = false;
+    for (; reader != reader_end; ++reader) {
+        if ((*reader).exit.type == TRACE_TYPE_THREAD_EXIT)
+            saw_footer = true;
+    }
+    CHECK(!saw_footer, "read past truncation");
+    CHECK(reader.get_instruction_ordinal() <
+              static_cast<uint64_t>(NUM_CHUNKS * CHUNK_INSTRS),
+          "read too many instructions from a truncated file");
+    return true;
+}
+
+bool
+run_tests(const std::string &dir, bool use_components)
+{
+    std::string path = dir + DIRSEP + "drmemtrace.zstd_io_test." +
+        (use_components ? "components" : "auto") + ".trace.zst";
+    std::vector<trace_entry_t> trace = make_trace();
+    return write_trace(path, trace, use_components) &&
+        test_plain_decompression(path, trace) && test_sequential(path) &&
+        test_skip(path) && test_truncation(path);
+}
+
+} // namespace
+
+int
+main(int argc, const char *argv[])
+{
+    std::string parse_err;
+    if (!droption_parser_t::parse_argv(DROPTION_SCOPE_FRONTEND, argc, (const char **)argv,
+                                       &parse_err, NULL) ||
+        op_tmp_output_dir.get_value().empty()) {
+        std::cerr << "Usage error: " << parse_err << "\nUsage:\n"
+                  << droption_parser_t::usage_short(DROPTION_SCOPE_ALL);
+        return 1;
+    }
+    if (!run_tests(op_tmp_output_dir.get_value(), /*use_components=*/true) ||
+        !run_tests(op_tmp_output_dir.get_value(), /*use_components=*/false))
+        return 1;
+    std::cerr << "all done\n";
+    return 0;
+}
@@ -50,6 +50,8 @@ public:
     generate_interval_snapshot(uint64_t interval_id) override;
     bool
     print_results() override;
+    std::string
+    initialize_shard_type(shard_type_t shard_type) override;
     bool
     parallel_shard_supported() override;
     void *
@@ -57,7 +59,14 @@ public:
     bool
     parallel_shard_exit(void *shard_data) override;
     bool
+    parallel_shard_warmup_end(void *shard_data) override;
+    bool
     parallel_shard_memref(void *shard_data, const memref_t &memref) override;
+    bool
+    parallel_shard_batch_supported() override;
+    bool
+    parallel_shard_memref_batch(void *shard_data, const memref_t *memrefs,
+                                size_t count) override;
     std::string
     parallel_shard_error(void *shard_data) override;
     interval_state_snapshot_t *
@@ -212,6 +221,7 @@ protected:
     // This mutex is only needed in parallel_shard_init.  In all other accesses to
     // shard_map (process_memref, print_results) we are single-threaded.
     std::mutex shard_map_mutex_;
+    shard_type_t shard_type_ = SHARD_BY_THREAD;
     unsigned int knob_verbose_;
     static const std::string TOOL_NAME;
 };
@@ -0,0 +1,213 @@
+/* **********************************************************
+ * Copyright (c) 2023 Google, Inc.  All rights reserved.
+ * **********************************************************/
+
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of Google, Inc. nor the names of its contributors may be
+ *   used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL VMWARE, INC. OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+
+/* decode_cache: a decoded-instruction cache shared by the analysis tools.
+ */
+
+#ifndef _DECODE_CACHE_H_
+#define _DECODE_CACHE_H_ 1
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <mutex>
+#include <unordered_map>
+
+#include "dr_api.h"
+#include "trace_entry.h"
+
+// The kind of control transfer performed by a decoded instruction.
+enum decode_branch_type_t {
+    DECODE_BRANCH_NONE,
+    DECODE_BRANCH_DIRECT_JUMP,
+    DECODE_BRANCH_CONDITIONAL,
+    DECODE_BRANCH_INDIRECT_JUMP,
+    DECODE_BRANCH_DIRECT_CALL,
+    DECODE_BRANCH_INDIRECT_CALL,
+    DECODE_BRANCH_RETURN,
+};
+
+// The properties of a decoded instruction that the tools ask about, kept in place
+// of a full instr_t.
+struct decode_info_t {
+    // False if the encoding failed to decode, in which case the other fields are
+    // not meaningful.
+    bool valid = false;
+    int opcode = 0;
+    // The decoded length, which may differ from the trace's size for a bad trace.
+    int length = 0;
+    int num_srcs = 0;
+    int num_dsts = 0;
+    decode_branch_type_t branch_type = DECODE_BRANCH_NONE;
+    // The target of a direct branch or call; else nullptr.
+    app_pc branch_target = nullptr;
+    bool reads_memory = false;
+    bool writes_memory = false;
+    bool is_syscall = false;
+};
+
+// A thread-safe cache of decode_info_t keyed by an instruction's encoding bytes, its
+// pc, as the pc determines relative branch targets, and the ISA mode it was decoded
+// in.  Entries are never removed,
+// so a returned pointer remains valid for the lifetime of the cache; changed code
+// simply produces a new key.  The table is split into independently locked stripes
+// so that parallel shards rarely contend.  Callers on hot paths are expected to
+// keep their own unsynchronized pc-to-entry map in front of this one, invalidated
+// when the trace marks an encoding as new.
+//
+// Entries are decoded in the current ISA mode of the dcontext passed to lookup(),
+// as set by dr_set_isa_mode(), and that mode is part of the key.  Thus traces or
+// shards in different modes (e.g., ARM and Thumb, or IA-32 and AMD64) can share one
+// cache without seeing each other's decodings of the same bytes.
+class decode_cache_t {
+public:
+    // Returns the instance shared by all tools in the process, so that an
+    // instruction is decoded once per run rather than once per tool and shard.
+    static decode_cache_t &
+    shared()
+    {
+        static decode_cache_t cache;
+        return cache;
+    }
+
+    // Returns the decoded properties of the "length" encoding bytes at "encoding",
+    // which were executed at "trace_pc".  Never returns nullptr.
+    const decode_info_t *
+    lookup(void *dcontext, app_pc trace_pc, const unsigned char *encoding,
+           size_t length)
+    {
+        key_t key;
+        key.pc = trace_pc;
+        key.mode = dr_get_isa_mode(dcontext);
+        // No instruction is longer than this; a longer size can only come from a
+        // bad trace and the decoder does not look past the real length anyway.
+        key.length = length < MAX_ENCODING_LENGTH ? length : MAX_ENCODING_LENGTH;
+        memset(key.bytes, 0, sizeof(key.bytes));
+        memcpy(key.bytes, encoding, key.length);
+        size_t hash = key_hash_t()(key);
+        stripe_t &stripe = stripes_[(hash >> 8) % NUM_STRIPES];
+        {
+            std::lock_guard<std::mutex> guard(stripe.lock);
+            auto it = stripe.table.find(key);
+            if (it != stripe.table.end())
+                return &it->second;
+        }
+        // Decode without holding the lock.  If another thread adds the same key
+        // first, emplace keeps its entry and ours is discarded.
+        decode_info_t info;
+        decode(dcontext, trace_pc, encoding, &info);
+        std::lock_guard<std::mutex> guard(stripe.lock);
+        return &stripe.table.emplace(key, info).first->second;
+    }
+
+private:
+    struct key_t {
+        app_pc pc;
+        dr_isa_mode_t mode;
+        size_t length;
+        unsigned char bytes[MAX_ENCODING_LENGTH];
+        bool
+        operator==(const key_t &rhs) const
+        {
+            return pc == rhs.pc && mode == rhs.mode && length == rhs.length &&
+                memcmp(bytes, rhs.bytes, length) == 0;
+        }
+    };
+
+    struct key_hash_t {
+        size_t
+        operator()(const key_t &key) const
+        {
+            // FNV-1a over the pc, the mode, and the encoding.
+            uint64_t hash = 0xcbf29ce484222325ULL;
+            hash = (hash ^ static_cast<uint64_t>(key.mode)) * 0x100000001b3ULL;
+            uint64_t pc = static_cast<uint64_t>(reinterpret_cast<uintptr_t>(key.pc));
+            for (int i = 0; i < 8; ++i) {
+                hash = (hash ^ ((pc >> (i * 8)) & 0xff)) * 0x100000001b3ULL;
+            }
+            for (size_t i = 0; i < key.length; ++i) {
+                hash = (hash ^ key.bytes[i]) * 0x100000001b3ULL;
+            }
+            return static_cast<size_t>(hash);
+        }
+    };
+
+    struct stripe_t {
+        std::mutex lock;
+        std::unordered_map<key_t, decode_info_t, key_hash_t> table;
+    };
+
+    static void
+    decode(void *dcontext, app_pc trace_pc, const unsigned char *encoding,
+           decode_info_t *info)
+    {
+        instr_t instr;
+        instr_init(dcontext, &instr);
+        app_pc next_pc = decode_from_copy(dcontext, const_cast<app_pc>(encoding),
+                                          trace_pc, &instr);
+        if (next_pc != nullptr && instr_valid(&instr)) {
+            info->valid = true;
+            info->opcode = instr_get_opcode(&instr);
+            info->length = static_cast<int>(next_pc - encoding);
+            info->num_srcs = instr_num_srcs(&instr);
+            info->num_dsts = instr_num_dsts(&instr);
+            if (instr_is_call_direct(&instr))
+                info->branch_type = DECODE_BRANCH_DIRECT_CALL;
+            else if (instr_is_call_indirect(&instr))
+                info->branch_type = DECODE_BRANCH_INDIRECT_CALL;
+            else if (instr_is_return(&instr))
+                info->branch_type = DECODE_BRANCH_RETURN;
+            else if (instr_is_cbr(&instr))
+                info->branch_type = DECODE_BRANCH_CONDITIONAL;
+            else if (instr_is_ubr(&instr))
+                info->branch_type = DECODE_BRANCH_DIRECT_JUMP;
+            else if (instr_is_mbr(&instr))
+                info->branch_type = DECODE_BRANCH_INDIRECT_JUMP;
+            if ((info->branch_type == DECODE_BRANCH_DIRECT_CALL ||
+                 info->branch_type == DECODE_BRANCH_CONDITIONAL ||
+                 info->branch_type == DECODE_BRANCH_DIRECT_JUMP) &&
+                opnd_is_pc(instr_get_target(&instr)))
+                info->branch_target = opnd_get_pc(instr_get_target(&instr));
+            info->reads_memory = instr_reads_memory(&instr);
+            info->writes_memory = instr_writes_memory(&instr);
+            info->is_syscall = instr_is_syscall(&instr);
+        }
+        instr_free(dcontext, &instr);
+    }
+
+    static constexpr size_t NUM_STRIPES = 64;
+    stripe_t stripes_[NUM_STRIPES];
+};
+
+#endif /* _DECODE_CACHE_H_ */
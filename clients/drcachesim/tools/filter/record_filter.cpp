@@ -38,6 +38,9 @@
 #ifdef HAS_ZLIB
 #    include "common/gzip_ostream.h"
 #endif
+#ifdef HAS_ZSTD
+#    include "common/zstd_ostream.h"
+#endif
 #include "record_filter.h"
 
 #ifdef DEBUG
@@ -71,11 +74,12 @@ is_any_instr_type(trace_type_t type)
 record_filter_t::record_filter_t(
     const std::string &output_dir,
     std::vector<std::unique_ptr<record_filter_func_t>> filters, uint64_t stop_timestamp,
-    unsigned int verbose)
+    unsigned int verbose, const std::string &output_compress)
     : output_dir_(output_dir)
     , filters_(std::move(filters))
     , stop_timestamp_(stop_timestamp)
     , verbosity_(verbose)
+    , output_compress_(output_compress)
 {
     UNUSED(verbosity_);
     UNUSED(output_prefix_);
@@ -98,6 +102,18 @@ std::unique_ptr<std::ostream>
 record_filter_t::get_writer(per_shard_t *per_shard, memtrace_stream_t *shard_stream)
 {
     per_shard->output_path = output_dir_ + DIRSEP + shard_stream->get_stream_name();
+    if (output_compress_ == "zstd") {
+#ifdef HAS_ZSTD
+        if (ends_with(per_shard->output_path, ".gz"))
+            per_shard->output_path.erase(per_shard->output_path.size() - 3);
+        per_shard->output_path += ".zst";
+        VPRINT(this, 3, "Using the zstd writer for %s\n", per_shard->output_path.c_str());
+        return std::unique_ptr<std::ostream>(new zstd_ostream_t(per_shard->output_path));
+#else
+        return nullptr;
+#endif
+    } else if (!output_compress_.empty())
+        return nullptr;
 #ifdef HAS_ZLIB
     if (ends_with(per_shard->output_path, ".gz")) {
         VPRINT(this, 3, "Using the gzip writer for %s\n", per_shard->output_path.c_str());
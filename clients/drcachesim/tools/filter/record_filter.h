@@ -106,9 +106,13 @@ public:
         std::string error_string_;
     };
 
+    // If output_compress is "zstd", each output file is written as a seekable zstd
+    // file whose name has any ".gz" suffix replaced with ".zst".  Otherwise, the
+    // output is compressed with gzip if and only if the input file name ends in ".gz".
     record_filter_t(const std::string &output_dir,
                     std::vector<std::unique_ptr<record_filter_func_t>> filters,
-                    uint64_t stop_timestamp, unsigned int verbose);
+                    uint64_t stop_timestamp, unsigned int verbose,
+                    const std::string &output_compress = "");
     ~record_filter_t() override;
     bool
     process_memref(const trace_entry_t &entry) override;
@@ -160,6 +164,7 @@ private:
     std::vector<std::unique_ptr<record_filter_func_t>> filters_;
     uint64_t stop_timestamp_;
     unsigned int verbosity_;
+    std::string output_compress_;
     const char *output_prefix_ = "[record_filter]";
 };
 
@@ -105,7 +105,7 @@ bool
 histogram_t::parallel_shard_memref(void *shard_data, const memref_t &memref)
 {
     shard_data_t *shard = reinterpret_cast<shard_data_t *>(shard_data);
-    std::unordered_map<addr_t, uint64_t> *cache_map = nullptr;
+    flat_hash_map_t<addr_t, uint64_t> *cache_map = nullptr;
     addr_t start_addr;
     size_t size;
     if (type_is_instr(memref.instr.type) ||
@@ -131,6 +131,23 @@ histogram_t::parallel_shard_memref(void *shard_data, const memref_t &memref)
     return true;
 }
 
+bool
+histogram_t::parallel_shard_batch_supported()
+{
+    return true;
+}
+
+bool
+histogram_t::parallel_shard_memref_batch(void *shard_data, const memref_t *memrefs,
+                                         size_t count)
+{
+    for (size_t i = 0; i < count; ++i) {
+        if (!histogram_t::parallel_shard_memref(shard_data, memrefs[i]))
+            return false;
+    }
+    return true;
+}
+
 std::string
 histogram_t::parallel_shard_error(void *shard_data)
 {
@@ -161,12 +178,8 @@ histogram_t::reduce_results(uint64_t *unique_icache_lines, uint64_t *unique_dcac
         reduced_ = serial_shard_;
     } else {
         for (const auto &shard : shard_map_) {
-            for (const auto &keyvals : shard.second->icache_map) {
-                reduced_.icache_map[keyvals.first] += keyvals.second;
-            }
-            for (const auto &keyvals : shard.second->dcache_map) {
-                reduced_.dcache_map[keyvals.first] += keyvals.second;
-            }
+            reduced_.icache_map.merge_add(shard.second->icache_map);
+            reduced_.dcache_map.merge_add(shard.second->dcache_map);
         }
     }
     if (unique_icache_lines != nullptr)
@@ -41,6 +41,7 @@
 #include <unordered_map>
 
 #include "analysis_tool.h"
+#include "flat_hash_map.h"
 #include "memref.h"
 
 class histogram_t : public analysis_tool_t {
@@ -63,6 +64,11 @@ public:
     parallel_shard_exit(void *shard_data) override;
     bool
     parallel_shard_memref(void *shard_data, const memref_t &memref) override;
+    bool
+    parallel_shard_batch_supported() override;
+    bool
+    parallel_shard_memref_batch(void *shard_data, const memref_t *memrefs,
+                                size_t count) override;
     std::string
     parallel_shard_error(void *shard_data) override;
 
@@ -73,8 +79,9 @@ public:
 
 protected:
     struct shard_data_t {
-        std::unordered_map<addr_t, uint64_t> icache_map;
-        std::unordered_map<addr_t, uint64_t> dcache_map;
+        // Access counts keyed by cache line tag.
+        flat_hash_map_t<addr_t, uint64_t> icache_map;
+        flat_hash_map_t<addr_t, uint64_t> dcache_map;
         std::string error;
     };
 
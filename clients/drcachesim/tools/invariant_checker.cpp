@@ -379,15 +379,21 @@ invariant_checker_t::parallel_shard_memref(void *shard_data, const memref_t &mem
         memref.instr.type == TRACE_TYPE_PREFETCH_INSTR ||
         memref.instr.type == TRACE_TYPE_INSTR_NO_FETCH) {
         bool expect_encoding = TESTANY(OFFLINE_FILE_TYPE_ENCODINGS, shard->file_type_);
-        std::unique_ptr<instr_autoclean_t> cur_instr_decoded = nullptr;
+        const decode_info_t *cur_instr_decoded = nullptr;
         if (expect_encoding) {
-            cur_instr_decoded.reset(new instr_autoclean_t(GLOBAL_DCONTEXT));
-            app_pc next_pc = decode_from_copy(
-                GLOBAL_DCONTEXT, const_cast<app_pc>(memref.instr.encoding),
-                reinterpret_cast<app_pc>(memref.instr.addr), cur_instr_decoded->data);
-            if (next_pc == nullptr) {
-                cur_instr_decoded.reset(nullptr);
+            if (memref.instr.encoding_is_new)
+                shard->decode_cache.erase(memref.instr.addr);
+            auto cached = shard->decode_cache.find(memref.instr.addr);
+            if (cached != shard->decode_cache.end()) {
+                cur_instr_decoded = cached->second;
+            } else {
+                cur_instr_decoded = decode_cache_t::shared().lookup(
+                    GLOBAL_DCONTEXT, reinterpret_cast<app_pc>(memref.instr.addr),
+                    memref.instr.encoding, memref.instr.size);
+                shard->decode_cache[memref.instr.addr] = cur_instr_decoded;
             }
+            if (!cur_instr_decoded->valid)
+                cur_instr_decoded = nullptr;
         }
         if (knob_verbose_ >= 3) {
             std::cerr << "::" << memref.data.pid << ":" << memref.data.tid << ":: "
@@ -498,7 +504,7 @@ invariant_checker_t::parallel_shard_memref(void *shard_data, const memref_t &mem
         shard->last_instr_in_cur_context_ = memref;
 #endif
         shard->prev_instr_ = memref;
-        shard->prev_instr_decoded_ = std::move(cur_instr_decoded);
+        shard->prev_instr_decoded_ = cur_instr_decoded;
         // Clear prev_xfer_marker_ on an instr (not a memref which could come between an
         // instr and a kernel-mediated far-away instr) to ensure it's *immediately*
         // prior (i#3937).
@@ -725,8 +731,7 @@ invariant_checker_t::print_results()
 std::string
 invariant_checker_t::check_for_pc_discontinuity(
     per_shard_t *shard, const memref_t &memref,
-    const std::unique_ptr<instr_autoclean_t> &cur_instr_decoded,
-    const bool expect_encoding)
+    const decode_info_t *cur_instr_decoded, const bool expect_encoding)
 {
     std::string error_msg = "";
     bool have_cond_branch_target = false;
@@ -735,25 +740,16 @@ invariant_checker_t::check_for_pc_discontinuity(
     if (prev_instr_trace_pc != 0 /*first*/ &&
         // We do not bother to support legacy traces without encodings.
         expect_encoding && type_is_instr_direct_branch(shard->prev_instr_.instr.type)) {
-        if (shard->prev_instr_.instr.encoding_is_new)
-            shard->branch_target_cache.erase(prev_instr_trace_pc);
-        auto cached = shard->branch_target_cache.find(prev_instr_trace_pc);
-        if (cached != shard->branch_target_cache.end()) {
-            have_cond_branch_target = true;
-            cond_branch_target = cached->second;
+        if (shard->prev_instr_decoded_ == nullptr ||
+            shard->prev_instr_decoded_->branch_target == nullptr) {
+            // Neither condition should happen but they could on an invalid
+            // encoding from raw2trace or the reader so we report an
+            // invariant rather than asserting.
+            report_if_false(shard, false, "Branch target is not decodeable");
         } else {
-            if (shard->prev_instr_decoded_ == nullptr ||
-                !opnd_is_pc(instr_get_target(shard->prev_instr_decoded_->data))) {
-                // Neither condition should happen but they could on an invalid
-                // encoding from raw2trace or the reader so we report an
-                // invariant rather than asserting.
-                report_if_false(shard, false, "Branch target is not decodeable");
-            } else {
-                have_cond_branch_target = true;
-                cond_branch_target = reinterpret_cast<addr_t>(
-                    opnd_get_pc(instr_get_target(shard->prev_instr_decoded_->data)));
-                shard->branch_target_cache[prev_instr_trace_pc] = cond_branch_target;
-            }
+            have_cond_branch_target = true;
+            cond_branch_target =
+                reinterpret_cast<addr_t>(shard->prev_instr_decoded_->branch_target);
         }
     }
     if (prev_instr_trace_pc != 0 /*first*/) {
@@ -801,12 +797,12 @@ invariant_checker_t::check_for_pc_discontinuity(
                 }
             } else if (cur_instr_decoded != nullptr &&
                        shard->prev_instr_decoded_ != nullptr &&
-                       instr_is_syscall(cur_instr_decoded->data) &&
+                       cur_instr_decoded->is_syscall &&
                        memref.instr.addr == prev_instr_trace_pc &&
-                       instr_is_syscall(shard->prev_instr_decoded_->data)) {
+                       shard->prev_instr_decoded_->is_syscall) {
                 error_msg = "Duplicate syscall instrs with the same PC";
             } else if (shard->prev_instr_decoded_ != nullptr &&
-                       instr_writes_memory(shard->prev_instr_decoded_->data) &&
+                       shard->prev_instr_decoded_->writes_memory &&
                        type_is_instr_conditional_branch(shard->last_branch_.instr.type)) {
                 // This sequence happens when an rseq side exit occurs which
                 // results in missing instruction in the basic block.
@@ -37,6 +37,7 @@
 #define _INVARIANT_CHECKER_H_ 1
 
 #include "analysis_tool.h"
+#include "decode_cache.h"
 #include "dr_api.h"
 #include <iostream>
 #include "memref.h"
@@ -46,31 +47,6 @@
 #include <unordered_map>
 #include <vector>
 
-/* The auto cleanup wrapper of instr_t.
- * This can ensure the instance of instr_t is cleaned up when it is out of scope.
- */
-struct instr_autoclean_t {
-public:
-    instr_autoclean_t(void *drcontext)
-        : drcontext(drcontext)
-    {
-        if (drcontext == nullptr) {
-            std::cerr << "instr_autoclean_t: invalid drcontext" << std::endl;
-            exit(1);
-        }
-        data = instr_create(drcontext);
-    }
-    ~instr_autoclean_t()
-    {
-        if (data != nullptr) {
-            instr_destroy(drcontext, data);
-            data = nullptr;
-        }
-    }
-    void *drcontext = nullptr;
-    instr_t *data = nullptr;
-};
-
 class invariant_checker_t : public analysis_tool_t {
 public:
     invariant_checker_t(bool offline = true, unsigned int verbose = 0,
@@ -113,7 +89,8 @@ protected:
         memtrace_stream_t *stream = nullptr;
         memref_t prev_entry_ = {};
         memref_t prev_instr_ = {};
-        std::unique_ptr<instr_autoclean_t> prev_instr_decoded_ = nullptr;
+        // From decode_cache_t; nullptr without encodings.
+        const decode_info_t *prev_instr_decoded_ = nullptr;
         memref_t prev_xfer_marker_ = {}; // Cleared on seeing an instr.
         memref_t last_xfer_marker_ = {}; // Not cleared: just the prior xfer marker.
         addr_t last_retaddr_ = 0;
@@ -168,9 +145,10 @@ protected:
         std::vector<schedule_entry_t> sched_;
         std::unordered_map<uint64_t, std::vector<schedule_entry_t>> cpu2sched_;
         bool skipped_instrs_ = false;
+        // An unsynchronized front end to decode_cache_t::shared().
         // We could move this to per-worker data and still not need a lock
         // (we don't currently have per-worker data though so leaving it as per-shard).
-        std::unordered_map<addr_t, addr_t> branch_target_cache;
+        std::unordered_map<addr_t, const decode_info_t *> decode_cache;
         // Rseq region state.
         bool in_rseq_region_ = false;
         addr_t rseq_start_pc_ = 0;
@@ -190,8 +168,7 @@ protected:
     std::string
     check_for_pc_discontinuity(
         per_shard_t *shard, const memref_t &memref,
-        const std::unique_ptr<instr_autoclean_t> &cur_instr_decoded,
-        const bool expect_encoding);
+        const decode_info_t *cur_instr_decoded, const bool expect_encoding);
 
     // The keys here are int for parallel, tid for serial.
     std::unordered_map<memref_tid_t, std::unique_ptr<per_shard_t>> shard_map_;
@@ -38,6 +38,7 @@
 
 #include "dr_api.h"
 #include "opcode_mix.h"
+#include "decode_cache.h"
 #include <algorithm>
 #include <iomanip>
 #include <iostream>
@@ -92,6 +93,16 @@ opcode_mix_t::~opcode_mix_t()
     }
 }
 
+std::string
+opcode_mix_t::initialize_shard_type(shard_type_t shard_type)
+{
+    // Time slices need only parallel_shard_warmup_end().  Per-core shards have
+    // not been checked.
+    if (shard_type != SHARD_BY_THREAD && shard_type != SHARD_BY_TIME_SLICE)
+        return "Only thread and time-slice sharding are supported";
+    return "";
+}
+
 bool
 opcode_mix_t::parallel_shard_supported()
 {
@@ -123,6 +134,18 @@ opcode_mix_t::parallel_shard_init(int shard_index, void *worker_data)
     return reinterpret_cast<void *>(shard);
 }
 
+void *
+opcode_mix_t::parallel_shard_init_stream(int shard_index, void *worker_data,
+                                         memtrace_stream_t *shard_stream)
+{
+    shard_data_t *shard =
+        reinterpret_cast<shard_data_t *>(parallel_shard_init(shard_index, worker_data));
+    // If the shard starts after a skip (such as a time slice) we never see the
+    // file type marker, but the stream has already recorded it.
+    shard->filetype = static_cast<offline_file_type_t>(shard_stream->get_filetype());
+    return reinterpret_cast<void *>(shard);
+}
+
 bool
 opcode_mix_t::parallel_shard_exit(void *shard_data)
 {
@@ -130,6 +153,16 @@ opcode_mix_t::parallel_shard_exit(void *shard_data)
     return true;
 }
 
+bool
+opcode_mix_t::parallel_shard_warmup_end(void *shard_data)
+{
+    shard_data_t *shard = reinterpret_cast<shard_data_t *>(shard_data);
+    // The worker's opcode cache stays warm.
+    shard->instr_count = 0;
+    shard->opcode_counts.clear();
+    return true;
+}
+
 bool
 opcode_mix_t::parallel_shard_memref(void *shard_data, const memref_t &memref)
 {
@@ -195,24 +228,40 @@ opcode_mix_t::parallel_shard_memref(void *shard_data, const memref_t &memref)
     if (cached_opcode != shard->worker->opcode_cache.end()) {
         opcode = cached_opcode->second;
     } else {
-        instr_t instr;
-        instr_init(dcontext_.dcontext, &instr);
-        app_pc next_pc =
-            decode_from_copy(dcontext_.dcontext, decode_pc, trace_pc, &instr);
-        if (next_pc == NULL || !instr_valid(&instr)) {
-            instr_free(dcontext_.dcontext, &instr);
+        // Other workers, and other tools in this process, may already have decoded
+        // this instruction.
+        const decode_info_t *info = decode_cache_t::shared().lookup(
+            dcontext_.dcontext, trace_pc, decode_pc, memref.instr.size);
+        if (!info->valid) {
             shard->error =
                 "Failed to decode instruction " + to_hex_string(memref.instr.addr);
             return false;
         }
-        opcode = instr_get_opcode(&instr);
+        opcode = info->opcode;
         shard->worker->opcode_cache[trace_pc] = opcode;
-        instr_free(dcontext_.dcontext, &instr);
     }
     ++shard->opcode_counts[opcode];
     return true;
 }
 
+bool
+opcode_mix_t::parallel_shard_batch_supported()
+{
+    return true;
+}
+
+bool
+opcode_mix_t::parallel_shard_memref_batch(void *shard_data, const memref_t *memrefs,
+                                          size_t count)
+{
+    // A qualified call lets the per-record work be inlined into this loop.
+    for (size_t i = 0; i < count; ++i) {
+        if (!opcode_mix_t::parallel_shard_memref(shard_data, memrefs[i]))
+            return false;
+    }
+    return true;
+}
+
 std::string
 opcode_mix_t::parallel_shard_error(void *shard_data)
 {
@@ -233,7 +282,10 @@ opcode_mix_t::process_memref(const memref_t &memref)
 static bool
 cmp_val(const std::pair<int, int_least64_t> &l, const std::pair<int, int_least64_t> &r)
 {
-    return (l.second > r.second);
+    // Break ties by opcode so the order does not depend on the hash table layout.
+    if (l.second != r.second)
+        return l.second > r.second;
+    return l.first < r.first;
 }
 
 bool
@@ -245,9 +297,7 @@ opcode_mix_t::print_results()
     } else {
         for (const auto &shard : shard_map_) {
             total.instr_count += shard.second->instr_count;
-            for (const auto &keyvals : shard.second->opcode_counts) {
-                total.opcode_counts[keyvals.first] += keyvals.second;
-            }
+            total.opcode_counts.merge_add(shard.second->opcode_counts);
         }
     }
     std::cerr << TOOL_NAME << " results:\n";
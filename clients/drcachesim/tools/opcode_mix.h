@@ -38,6 +38,7 @@
 #include <unordered_map>
 
 #include "analysis_tool.h"
+#include "flat_hash_map.h"
 #include "raw2trace.h"
 #include "raw2trace_directory.h"
 
@@ -56,6 +57,8 @@ public:
     process_memref(const memref_t &memref) override;
     bool
     print_results() override;
+    std::string
+    initialize_shard_type(shard_type_t shard_type) override;
     bool
     parallel_shard_supported() override;
     void *
@@ -64,16 +67,27 @@ public:
     parallel_worker_exit(void *worker_data) override;
     void *
     parallel_shard_init(int shard_index, void *worker_data) override;
+    void *
+    parallel_shard_init_stream(int shard_index, void *worker_data,
+                               memtrace_stream_t *shard_stream) override;
     bool
     parallel_shard_exit(void *shard_data) override;
     bool
+    parallel_shard_warmup_end(void *shard_data) override;
+    bool
     parallel_shard_memref(void *shard_data, const memref_t &memref) override;
+    bool
+    parallel_shard_batch_supported() override;
+    bool
+    parallel_shard_memref_batch(void *shard_data, const memref_t *memrefs,
+                                size_t count) override;
     std::string
     parallel_shard_error(void *shard_data) override;
 
 protected:
     struct worker_data_t {
-        std::unordered_map<app_pc, int> opcode_cache;
+        // An unsynchronized front end to decode_cache_t::shared().
+        flat_hash_map_t<app_pc, int> opcode_cache;
     };
 
     struct shard_data_t {
@@ -92,7 +106,7 @@ protected:
         }
         worker_data_t *worker;
         int_least64_t instr_count;
-        std::unordered_map<int, int_least64_t> opcode_counts;
+        flat_hash_map_t<int, int_least64_t> opcode_counts;
         std::string error;
         app_pc last_trace_module_start;
         size_t last_trace_module_size;
@@ -59,6 +59,14 @@ static droption_t<std::string>
                   "[Required] Output directory for the filtered trace",
                   "Specifies the directory where the filtered trace will be written.");
 
+static droption_t<std::string> op_output_compress(
+    DROPTION_SCOPE_FRONTEND, "output_compress", "", "Output compression type",
+    "Specifies the format of the output files.  By default each output file is "
+    "compressed with gzip if and only if its input file was.  \"zstd\" writes seekable "
+    "zstd files instead, with one compressed frame per trace chunk and an index of "
+    "the frames at the end of the file for fast seeking.  The zstd option is only "
+    "available when this tool was built with zstd support.");
+
 static droption_t<unsigned int> op_verbose(DROPTION_SCOPE_ALL, "verbose", 0, 0, 64,
                                            "Verbosity level",
                                            "Verbosity level for notifications.");
@@ -120,6 +128,13 @@ _tmain(int argc, const TCHAR *targv[])
         FATAL_ERROR("Usage error: %s\nUsage:\n%s", parse_err.c_str(),
                     droption_parser_t::usage_short(DROPTION_SCOPE_ALL).c_str());
     }
+    const std::string &compress = op_output_compress.get_value();
+    if (!compress.empty() && compress != "zstd")
+        FATAL_ERROR("Unknown output compression type %s", compress.c_str());
+#ifndef HAS_ZSTD
+    if (compress == "zstd")
+        FATAL_ERROR("zstd output compression is not supported by this build");
+#endif
 
     std::vector<
         std::unique_ptr<dynamorio::drmemtrace::record_filter_t::record_filter_func_t>>
@@ -149,7 +164,8 @@ _tmain(int argc, const TCHAR *targv[])
     auto record_filter = std::unique_ptr<record_analysis_tool_t>(
         new dynamorio::drmemtrace::record_filter_t(
             op_output_dir.get_value(), std::move(filter_funcs),
-            op_stop_timestamp.get_value(), op_verbose.get_value()));
+            op_stop_timestamp.get_value(), op_verbose.get_value(),
+            op_output_compress.get_value()));
     std::vector<record_analysis_tool_t *> tools;
     tools.push_back(record_filter.get());
 
@@ -48,15 +48,35 @@ reuse_distance_tool_create(const reuse_distance_knobs_t &knobs)
     return new reuse_distance_t(knobs);
 }
 
+// The lowest sampling rate we will go to is 1/2^MAX_SAMPLE_SHIFT.
+static const unsigned int MAX_SAMPLE_SHIFT = 32;
+
+static unsigned int
+sample_rate_to_shift(double rate)
+{
+    if (rate >= 1.0)
+        return 0;
+    // We only support power-of-two rates so that scaled counts stay integral.
+    double shift = std::round(-std::log2(rate));
+    if (shift > MAX_SAMPLE_SHIFT)
+        return MAX_SAMPLE_SHIFT;
+    return static_cast<unsigned int>(shift);
+}
+
 reuse_distance_t::reuse_distance_t(const reuse_distance_knobs_t &knobs)
     : knobs_(knobs)
     , line_size_bits_(compute_log2((int)knobs_.line_size))
+    , sampling_(knobs_.sample_rate < 1.0 || knobs_.sample_max_lines > 0)
+    , initial_sample_shift_(sample_rate_to_shift(knobs_.sample_rate))
 {
     reuse_distance_t::knob_verbose = knobs.verbose;
     IF_DEBUG_VERBOSE(2,
                      std::cerr << "cache line size " << knobs_.line_size << ", "
                                << "reuse distance threshold " << knobs_.distance_threshold
-                               << ", distance limit " << knobs_.distance_limit << "\n");
+                               << ", distance limit " << knobs_.distance_limit
+                               << ", sample shift " << initial_sample_shift_
+                               << ", sample max lines " << knobs_.sample_max_lines
+                               << "\n");
 }
 
 reuse_distance_t::~reuse_distance_t()
@@ -67,11 +87,62 @@ reuse_distance_t::~reuse_distance_t()
 }
 
 reuse_distance_t::shard_data_t::shard_data_t(uint64_t reuse_threshold, uint64_t skip_dist,
-                                             uint32_t distance_limit, bool verify)
+                                             uint32_t distance_limit, bool verify,
+                                             bool use_tree, unsigned int sample_shift)
     : distance_limit(distance_limit)
+    , sample_shift(sample_shift)
 {
-    ref_list = std::unique_ptr<line_ref_list_t>(
-        new line_ref_list_t(reuse_threshold, skip_dist, verify));
+    // Sampled distances are scaled up, so the raw threshold is scaled down.
+    reuse_threshold >>= sample_shift;
+    if (use_tree) {
+        ref_list = std::unique_ptr<line_ref_history_t>(
+            new line_ref_tree_t(reuse_threshold, verify));
+    } else {
+        ref_list = std::unique_ptr<line_ref_history_t>(
+            new line_ref_list_t(reuse_threshold, skip_dist, verify));
+    }
+}
+
+bool
+reuse_distance_t::line_is_sampled(addr_t tag, unsigned int sample_shift)
+{
+    if (sample_shift == 0)
+        return true;
+    // Hash the tag (with the splitmix64 finalizer) so that strided or clustered
+    // addresses are sampled uniformly.
+    uint64_t hash = static_cast<uint64_t>(tag);
+    hash = (hash ^ (hash >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    hash = (hash ^ (hash >> 27)) * 0x94d049bb133111ebULL;
+    hash = hash ^ (hash >> 31);
+    return (hash >> (64 - sample_shift)) == 0;
+}
+
+void
+reuse_distance_t::lower_sample_rate(shard_data_t *shard)
+{
+    ++shard->sample_shift;
+    shard->ref_list->threshold_ = knobs_.distance_threshold >> shard->sample_shift;
+    IF_DEBUG_VERBOSE(1,
+                     std::cerr << "Lowering sample shift to " << shard->sample_shift
+                               << " with " << shard->cache_map.size() << " lines\n");
+    // Sampling always uses the tree engine, which can remove arbitrary lines.
+    line_ref_tree_t *tree = static_cast<line_ref_tree_t *>(shard->ref_list.get());
+    for (auto it = shard->cache_map.begin(); it != shard->cache_map.end();) {
+        if (line_is_sampled(it->first, shard->sample_shift)) {
+            ++it;
+            continue;
+        }
+        tree->remove(it->second);
+        delete it->second;
+        it = shard->cache_map.erase(it);
+    }
+    for (auto it = shard->pruned_addresses.begin();
+         it != shard->pruned_addresses.end();) {
+        if (line_is_sampled(*it, shard->sample_shift))
+            ++it;
+        else
+            it = shard->pruned_addresses.erase(it);
+    }
 }
 
 bool
@@ -84,7 +155,9 @@ void *
 reuse_distance_t::parallel_shard_init(int shard_index, void *worker_data)
 {
     auto shard = new shard_data_t(knobs_.distance_threshold, knobs_.skip_list_distance,
-                                  knobs_.distance_limit, knobs_.verify_skip);
+                                  knobs_.distance_limit, knobs_.verify_skip,
+                                  knobs_.use_fenwick_tree || sampling_,
+                                  initial_sample_shift_);
     std::lock_guard<std::mutex> guard(shard_map_mutex_);
     shard_map_[shard_index] = shard;
     return reinterpret_cast<void *>(shard);
@@ -134,6 +207,8 @@ reuse_distance_t::parallel_shard_memref(void *shard_data, const memref_t &memref
             ++shard->data_refs;
         }
         addr_t tag = memref.data.addr >> line_size_bits_;
+        if (!line_is_sampled(tag, shard->sample_shift))
+            return true;
         std::unordered_map<addr_t, line_ref_t *>::iterator it =
             shard->cache_map.find(tag);
         if (it == shard->cache_map.end()) {
@@ -150,7 +225,7 @@ reuse_distance_t::parallel_shard_memref(void *shard_data, const memref_t &memref
             if (shard->distance_limit > 0 &&
                 shard->distance_limit < shard->cache_map.size()) {
                 // Distance list is too long, so prune most-distant entry.
-                ref = shard->ref_list->tail_; // Get a pointer to the line.
+                ref = shard->ref_list->get_tail(); // Get a pointer to the line.
                 assert(ref != NULL);
                 addr_t tag_to_remove = ref->tag;
                 // Move this line from the cache_map to the pruned set.
@@ -162,14 +237,24 @@ reuse_distance_t::parallel_shard_memref(void *shard_data, const memref_t &memref
                 // Delete the no-longer-needed line object
                 delete ref;
             }
+            while (knobs_.sample_max_lines > 0 &&
+                   shard->cache_map.size() > knobs_.sample_max_lines &&
+                   shard->sample_shift < MAX_SAMPLE_SHIFT) {
+                lower_sample_rate(shard);
+            }
         } else {
             int_least64_t dist = shard->ref_list->move_to_front(it->second);
+            // Each sampled reuse stands for 2^sample_shift reuses, with distances
+            // among the sampled lines similarly scaled.
+            dist <<= shard->sample_shift;
+            int_least64_t weight = static_cast<int_least64_t>(1) << shard->sample_shift;
+            ++shard->sampled_reuses;
             auto &dist_map = is_instr_type ? shard->dist_map : shard->dist_map_data;
             distance_histogram_t::iterator dist_it = dist_map.find(dist);
             if (dist_it == dist_map.end())
-                dist_map.insert(distance_map_pair_t(dist, 1));
+                dist_map.insert(distance_map_pair_t(dist, weight));
             else
-                ++dist_it->second;
+                dist_it->second += weight;
             IF_DEBUG_VERBOSE(3, std::cerr << "Distance is " << std::dec << dist << "\n");
         }
     }
@@ -184,7 +269,9 @@ reuse_distance_t::process_memref(const memref_t &memref)
     const auto &lookup = shard_map_.find(memref.data.tid);
     if (lookup == shard_map_.end()) {
         shard = new shard_data_t(knobs_.distance_threshold, knobs_.skip_list_distance,
-                                 knobs_.distance_limit, knobs_.verify_skip);
+                                 knobs_.distance_limit, knobs_.verify_skip,
+                                 knobs_.use_fenwick_tree || sampling_,
+                                 initial_sample_shift_);
         shard_map_[memref.data.tid] = shard;
     } else
         shard = lookup->second;
@@ -248,6 +335,26 @@ reuse_distance_t::print_shard_results(const shard_data_t *shard)
     std::cerr << "Distance limit: " << shard->distance_limit << "\n";
     std::cerr << "Pruned addresses: " << shard->pruned_address_count << "\n";
     std::cerr << "Pruned address hits: " << shard->pruned_address_hits << "\n";
+    if (sampling_) {
+        // Only sampled lines are counted in the unique figures above.
+        uint64_t sampled_lines = shard->cache_map.size() + shard->pruned_addresses.size();
+        std::cerr << "Sampling rate: 1/"
+                  << (static_cast<uint64_t>(1) << shard->sample_shift) << "\n";
+        std::cerr << "Sampled reuses: " << shard->sampled_reuses << "\n";
+        std::cerr << "Estimated unique cache lines: "
+                  << (sampled_lines << shard->sample_shift) << "\n";
+        if (sampled_lines > 0) {
+            // A conservative 95% confidence bound on each cumulative histogram
+            // fraction, treating each sampled line as a single independent sample.
+            std::ios_base::fmtflags saved_flags(std::cerr.flags());
+            std::cerr.precision(2);
+            std::cerr.setf(std::ios::fixed);
+            std::cerr << "Cumulative percentage error bound (95% confidence): +/-"
+                      << 1.96 * 0.5 / std::sqrt(static_cast<double>(sampled_lines)) * 100.
+                      << "%\n";
+            std::cerr.flags(saved_flags);
+        }
+    }
     std::cerr << "\n";
 
     std::cerr.precision(2);
@@ -419,12 +526,17 @@ reuse_distance_t::get_aggregated_results()
     // Otherwise, aggregate the per-shard data to get whole-trace data.
     aggregated_results_ = std::unique_ptr<shard_data_t>(
         new shard_data_t(knobs_.distance_threshold, knobs_.skip_list_distance,
-                         knobs_.distance_limit, knobs_.verify_skip));
+                         knobs_.distance_limit, knobs_.verify_skip,
+                         knobs_.use_fenwick_tree || sampling_, 0));
     for (auto &shard : shard_map_) {
         aggregated_results_->total_refs += shard.second->total_refs;
         aggregated_results_->data_refs += shard.second->data_refs;
         aggregated_results_->pruned_address_hits += shard.second->pruned_address_hits;
         aggregated_results_->pruned_address_count += shard.second->pruned_address_count;
+        aggregated_results_->sampled_reuses += shard.second->sampled_reuses;
+        // Report the lowest rate of any shard.
+        aggregated_results_->sample_shift =
+            std::max(aggregated_results_->sample_shift, shard.second->sample_shift);
         // We simply sum the unique accesses.
         // If the user wants the unique accesses over the merged trace they
         // can create a single shard and invoke the parallel operations.
@@ -473,7 +585,8 @@ reuse_distance_t::print_results()
     std::cerr << TOOL_NAME << " aggregated results:\n";
     print_shard_results(get_aggregated_results());
 
-    // For regular shards the line_ref_t's are deleted in ~line_ref_list_t.
+    // For regular shards the line_ref_t's are deleted by ~line_ref_list_t or
+    // ~line_ref_tree_t.
     for (auto &iter : get_aggregated_results()->cache_map) {
         delete iter.second;
     }
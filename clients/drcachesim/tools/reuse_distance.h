@@ -64,7 +64,7 @@
 #endif
 
 struct line_ref_t;
-struct line_ref_list_t;
+struct line_ref_history_t;
 
 class reuse_distance_t : public analysis_tool_t {
 public:
@@ -101,7 +101,8 @@ protected:
     // for computing over different units if for some reason that was desired.
     struct shard_data_t {
         shard_data_t(uint64_t reuse_threshold, uint64_t skip_dist,
-                     unsigned int distance_limit, bool verify);
+                     unsigned int distance_limit, bool verify, bool use_tree,
+                     unsigned int sample_shift);
         std::unordered_map<addr_t, line_ref_t *> cache_map;
         std::unordered_set<addr_t> pruned_addresses;
         // These are our reuse distance histograms: one for all accesses and one
@@ -117,7 +118,8 @@ protected:
         distance_histogram_t dist_map;
         distance_histogram_t dist_map_data;
         bool dist_map_is_instr_only = true;
-        std::unique_ptr<line_ref_list_t> ref_list;
+        // Either a line_ref_list_t or a line_ref_tree_t.
+        std::unique_ptr<line_ref_history_t> ref_list;
         int_least64_t total_refs = 0;
         int_least64_t data_refs = 0; // Non-instruction reference count.
         // Ideally the shard index would be the tid when shard==thread but that's
@@ -130,8 +132,22 @@ protected:
         // (pruned_address_hits) from the pruned_addresses set.
         uint_least64_t pruned_address_count = 0;
         uint_least64_t pruned_address_hits = 0;
+        // When sampling, only lines whose hash has its top sample_shift bits clear
+        // are tracked, for a sampling rate of 1/2^sample_shift.  Distances and
+        // histogram counts are scaled up by 2^sample_shift as they are recorded.
+        unsigned int sample_shift = 0;
+        // The number of reuses recorded, before scaling.
+        uint_least64_t sampled_reuses = 0;
     };
 
+    // Returns whether the line with this tag is tracked at the given sampling shift.
+    static bool
+    line_is_sampled(addr_t tag, unsigned int sample_shift);
+
+    // Halves the sampling rate of the shard, dropping the lines no longer sampled.
+    void
+    lower_sample_rate(shard_data_t *shard);
+
     void
     print_histogram(std::ostream &out, int_least64_t total_count,
                     const std::vector<distance_map_pair_t> &sorted,
@@ -147,6 +163,10 @@ protected:
 
     const reuse_distance_knobs_t knobs_;
     const size_t line_size_bits_;
+    // Whether sampling is enabled, and the initial shift derived from the
+    // requested rate.
+    const bool sampling_;
+    const unsigned int initial_sample_shift_;
     static const std::string TOOL_NAME;
     // In parallel operation the keys are "shard indices": just ints.
     std::unordered_map<memref_tid_t, shard_data_t *> shard_map_;
@@ -163,6 +183,7 @@ struct line_ref_t {
     uint64_t total_refs;     // the total number of references on this line
     uint64_t distant_refs;   // the total number of distant references on this line
     addr_t tag;
+    // line_ref_tree_t stores the line's slot in time_stamp instead.
 
     // We have a one-layer skip list for more efficient depth computation.
     // We inline the fields in every node for simplicity and to reduce allocs.
@@ -183,6 +204,42 @@ struct line_ref_t {
     }
 };
 
+// The interface shared by our engines for tracking the order in which cache lines
+// were last accessed and computing the reuse distance of each reference.
+struct line_ref_history_t {
+    line_ref_history_t(uint64_t reuse_threshold, bool verify)
+        : cur_time_(0)
+        , threshold_(reuse_threshold)
+        , verify_(verify)
+    {
+    }
+
+    virtual ~line_ref_history_t()
+    {
+    }
+
+    // Adds a newly seen cache line as the most recently accessed one.
+    virtual void
+    add_to_front(line_ref_t *ref) = 0;
+
+    // Makes a previously seen cache line the most recently accessed one.
+    // Returns the reuse distance of ref.
+    virtual int_least64_t
+    move_to_front(line_ref_t *ref) = 0;
+
+    // Returns the least recently accessed cache line.
+    virtual line_ref_t *
+    get_tail() = 0;
+
+    // Removes the least recently accessed cache line, without freeing it.
+    virtual void
+    prune_tail() = 0;
+
+    uint64_t cur_time_;  // current time stamp
+    uint64_t threshold_; // the reuse distance threshold
+    bool verify_;        // check results using brute-force walks
+};
+
 // We use a doubly linked list to keep track of the cache line reuse distance.
 // The head of the list is the most recently accessed cache line.
 // The earlier a cache line was accessed last time, the deeper that cache line
@@ -198,29 +255,24 @@ struct line_ref_t {
 // We have a second doubly-linked list, a one-layer skip list, for
 // more efficient computation of the depth.  Each node in the skip
 // list stores its depth from the front.
-struct line_ref_list_t {
+struct line_ref_list_t : public line_ref_history_t {
     line_ref_t *head_;       // the most recently accessed cache line
     line_ref_t *gate_;       // the earliest cache line refs within the threshold
     line_ref_t *tail_;       // the least recently accessed cache line
-    uint64_t cur_time_;      // current time stamp
     uint64_t unique_lines_;  // the total number of unique cache lines accessed
-    uint64_t threshold_;     // the reuse distance threshold
     uint64_t skip_distance_; // distance between skip list nodes
-    bool verify_skip_;       // check results using brute-force walks
 
     line_ref_list_t(uint64_t reuse_threshold_, uint64_t skip_dist, bool verify)
-        : head_(NULL)
+        : line_ref_history_t(reuse_threshold_, verify)
+        , head_(NULL)
         , gate_(NULL)
         , tail_(NULL)
-        , cur_time_(0)
         , unique_lines_(0)
-        , threshold_(reuse_threshold_)
         , skip_distance_(skip_dist)
-        , verify_skip_(verify)
     {
     }
 
-    virtual ~line_ref_list_t()
+    ~line_ref_list_t() override
     {
         line_ref_t *ref;
         line_ref_t *next;
@@ -278,7 +330,7 @@ struct line_ref_list_t {
     // than the threshold so that the gate points to the earliest
     // referenced cache line within the threshold.
     void
-    add_to_front(line_ref_t *ref)
+    add_to_front(line_ref_t *ref) override
     {
         IF_DEBUG_VERBOSE(3, std::cerr << "Add tag 0x" << std::hex << ref->tag << "\n");
         // update head_
@@ -324,9 +376,15 @@ struct line_ref_list_t {
         IF_DEBUG_VERBOSE(3, print_list());
     }
 
+    line_ref_t *
+    get_tail() override
+    {
+        return tail_;
+    }
+
     // Remove the last entry from the distance list.
     void
-    prune_tail()
+    prune_tail() override
     {
         // Make sure the tail pointers are legal.
         assert(tail_ != NULL);
@@ -359,7 +417,7 @@ struct line_ref_list_t {
     // line is the gate_ cache line or any cache line after.
     // Returns the reuse distance of ref.
     int_least64_t
-    move_to_front(line_ref_t *ref)
+    move_to_front(line_ref_t *ref) override
     {
         IF_DEBUG_VERBOSE(
             3, std::cerr << "Move tag 0x" << std::hex << ref->tag << " to front\n");
@@ -391,7 +449,7 @@ struct line_ref_list_t {
             --dist; // Don't count self.
 
         IF_DEBUG_VERBOSE(
-            0, if (verify_skip_) {
+            0, if (verify_) {
                 // Compute reuse distance with a full list walk as a sanity check.
                 // This is a debug-only option, so we guard with IF_DEBUG_VERBOSE(0).
                 // Yes, the option check branch shows noticeable overhead without it.
@@ -438,4 +496,176 @@ struct line_ref_list_t {
     }
 };
 
+// An alternative to line_ref_list_t whose cost per reference is O(log n) in the
+// number of lines regardless of the distance, for exact results on large
+// footprints where walks to the nearest skip node dominate.  Each line's most
+// recent access claims the next in a sequence of slots, and a Fenwick (binary
+// indexed) tree counts the live slots: a line's reuse distance is the number of
+// live slots after its own.  When the slots run out we renumber the live ones
+// from 0, doubling the slot count if more than half are live, so the renumbering
+// cost is amortized over at least as many references as there are live lines.
+struct line_ref_tree_t : public line_ref_history_t {
+    line_ref_tree_t(uint64_t reuse_threshold, bool verify)
+        : line_ref_history_t(reuse_threshold, verify)
+        , next_slot_(0)
+        , tail_slot_(0)
+        , live_lines_(0)
+    {
+    }
+
+    ~line_ref_tree_t() override
+    {
+        for (line_ref_t *ref : slots_)
+            delete ref;
+    }
+
+    // Stops tracking ref, wherever it is, without freeing it.
+    void
+    remove(line_ref_t *ref)
+    {
+        IF_DEBUG_VERBOSE(3, std::cerr << "Remove tag 0x" << std::hex << ref->tag << "\n");
+        release_slot(ref->time_stamp);
+    }
+
+    void
+    add_to_front(line_ref_t *ref) override
+    {
+        IF_DEBUG_VERBOSE(3, std::cerr << "Add tag 0x" << std::hex << ref->tag << "\n");
+        claim_slot(ref);
+    }
+
+    int_least64_t
+    move_to_front(line_ref_t *ref) override
+    {
+        IF_DEBUG_VERBOSE(
+            3, std::cerr << "Move tag 0x" << std::hex << ref->tag << " to front\n");
+        ref->total_refs++;
+        uint64_t slot = ref->time_stamp;
+        // The newest slot is always live, so this is the most recent line.
+        if (slot + 1 == next_slot_)
+            return 0;
+        int_least64_t dist = live_lines_ - count_through(slot);
+
+        IF_DEBUG_VERBOSE(
+            0, if (verify_) {
+                // Count the later live slots one by one as a sanity check.
+                int_least64_t brute_dist = 0;
+                for (uint64_t i = slot + 1; i < next_slot_; ++i) {
+                    if (slots_[i] != nullptr)
+                        ++brute_dist;
+                }
+                if (brute_dist != dist) {
+                    std::cerr << "Mismatch!  Brute=" << std::dec << brute_dist
+                              << " vs tree=" << dist << "\n";
+                    assert(false);
+                }
+            });
+
+        if (static_cast<uint64_t>(dist) > threshold_)
+            ref->distant_refs++;
+        release_slot(slot);
+        claim_slot(ref);
+        return dist;
+    }
+
+    line_ref_t *
+    get_tail() override
+    {
+        assert(live_lines_ > 0);
+        // Slots are claimed in increasing order, so the oldest live slot only
+        // moves forward until the next renumbering.
+        while (slots_[tail_slot_] == nullptr)
+            ++tail_slot_;
+        return slots_[tail_slot_];
+    }
+
+    void
+    prune_tail() override
+    {
+        line_ref_t *tail = get_tail();
+        IF_DEBUG_VERBOSE(3, std::cerr << "Prune tag 0x" << std::hex << tail->tag << "\n");
+        release_slot(tail->time_stamp);
+    }
+
+private:
+    // The initial number of slots.
+    static constexpr size_t MIN_SLOTS = 1024;
+
+    void
+    claim_slot(line_ref_t *ref)
+    {
+        if (next_slot_ == slots_.size())
+            renumber_slots();
+        uint64_t slot = next_slot_++;
+        slots_[slot] = ref;
+        ref->time_stamp = slot;
+        add_to_count(slot, 1);
+        ++live_lines_;
+        ++cur_time_;
+    }
+
+    void
+    release_slot(uint64_t slot)
+    {
+        slots_[slot] = nullptr;
+        add_to_count(slot, -1);
+        --live_lines_;
+    }
+
+    // Fenwick tree indices are 1-based: tree_[0] is unused.
+    void
+    add_to_count(uint64_t slot, int_least64_t delta)
+    {
+        for (uint64_t i = slot + 1; i < tree_.size(); i += i & (~i + 1))
+            tree_[i] += delta;
+    }
+
+    // Returns the number of live slots in [0, slot].
+    int_least64_t
+    count_through(uint64_t slot)
+    {
+        int_least64_t count = 0;
+        for (uint64_t i = slot + 1; i > 0; i -= i & (~i + 1))
+            count += tree_[i];
+        return count;
+    }
+
+    void
+    renumber_slots()
+    {
+        size_t capacity = slots_.size();
+        if (capacity < MIN_SLOTS)
+            capacity = MIN_SLOTS;
+        else if (live_lines_ * 2 > capacity)
+            capacity *= 2;
+        std::vector<line_ref_t *> new_slots(capacity, nullptr);
+        uint64_t live = 0;
+        for (uint64_t i = 0; i < next_slot_; ++i) {
+            if (slots_[i] != nullptr) {
+                slots_[i]->time_stamp = live;
+                new_slots[live++] = slots_[i];
+            }
+        }
+        assert(live == live_lines_);
+        slots_.swap(new_slots);
+        next_slot_ = live;
+        tail_slot_ = 0;
+        // Build the tree in linear time by pushing each node's count to its parent.
+        tree_.assign(capacity + 1, 0);
+        for (uint64_t i = 1; i <= live; ++i)
+            tree_[i] = 1;
+        for (uint64_t i = 1; i <= capacity; ++i) {
+            uint64_t parent = i + (i & (~i + 1));
+            if (parent <= capacity)
+                tree_[parent] += tree_[i];
+        }
+    }
+
+    std::vector<line_ref_t *> slots_;  // the line whose latest access is each slot
+    std::vector<int_least64_t> tree_; // Fenwick tree of live slot counts
+    uint64_t next_slot_;              // the slot for the next access
+    uint64_t tail_slot_;              // no live slot precedes this one
+    uint64_t live_lines_;             // the number of lines being tracked
+};
+
 #endif /* _REUSE_DISTANCE_H_ */
@@ -56,6 +56,9 @@ struct reuse_distance_knobs_t {
         , skip_list_distance(500)
         , distance_limit(0)
         , verify_skip(false)
+        , use_fenwick_tree(false)
+        , sample_rate(1.0)
+        , sample_max_lines(0)
         , verbose(0)
         , histogram_bin_multiplier(1.00)
     {
@@ -67,6 +70,9 @@ struct reuse_distance_knobs_t {
     unsigned int skip_list_distance;
     unsigned int distance_limit;
     bool verify_skip;
+    bool use_fenwick_tree;
+    double sample_rate;
+    unsigned int sample_max_lines;
     unsigned int verbose;
     double histogram_bin_multiplier;
 };
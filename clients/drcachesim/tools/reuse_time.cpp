@@ -132,14 +132,16 @@ reuse_time_t::parallel_shard_memref(void *shard_data, const memref_t &memref)
 
     shard->time_stamp++;
     addr_t line = memref.data.addr >> line_size_bits_;
-    if (shard->time_map.count(line) > 0) {
-        int_least64_t reuse_time = shard->time_stamp - shard->time_map[line];
+    // A single lookup: time stamps start at 1, so a new entry reads as 0.
+    int_least64_t &last_time = shard->time_map[line];
+    if (last_time > 0) {
+        int_least64_t reuse_time = shard->time_stamp - last_time;
         if (DEBUG_VERBOSE(3)) {
             std::cerr << "Reuse " << reuse_time << std::endl;
         }
         shard->reuse_time_histogram[reuse_time]++;
     }
-    shard->time_map[line] = shard->time_stamp;
+    last_time = shard->time_stamp;
     return true;
 }
 
@@ -214,9 +216,7 @@ reuse_time_t::print_results()
         // We simply sum the accesses.
         aggregate->time_stamp += shard.second->time_stamp;
         // Merge the histograms.
-        for (const auto &entry : shard.second->reuse_time_histogram) {
-            aggregate->reuse_time_histogram[entry.first] += entry.second;
-        }
+        aggregate->reuse_time_histogram.merge_add(shard.second->reuse_time_histogram);
     }
 
     std::cerr << TOOL_NAME << " aggregated results:\n";
@@ -38,6 +38,7 @@
 #include <string>
 
 #include "analysis_tool.h"
+#include "flat_hash_map.h"
 
 class reuse_time_t : public analysis_tool_t {
 public:
@@ -62,10 +63,11 @@ protected:
     // Just like for reuse_distance_t, we assume that the shard unit is the unit over
     // which we should measure time.  By default this is a traced thread.
     struct shard_data_t {
-        std::unordered_map<addr_t, int_least64_t> time_map;
+        // The time_stamp of the last access to each cache line tag.
+        flat_hash_map_t<addr_t, int_least64_t> time_map;
         int_least64_t time_stamp = 0;
         int_least64_t total_instructions = 0;
-        std::unordered_map<int_least64_t, int_least64_t> reuse_time_histogram;
+        flat_hash_map_t<int_least64_t, int_least64_t> reuse_time_histogram;
         memref_tid_t tid;
         std::string error;
     };
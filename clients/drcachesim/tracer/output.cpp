@@ -36,6 +36,7 @@
  */
 
 #include <limits.h>
+#include <algorithm>
 #include <atomic>
 #include "dr_api.h"
 #include "drmgr.h"
@@ -278,10 +279,15 @@ open_new_window_dir(ptr_int_t window_num)
     NOTIFY(2, "Created new window dir %s\n", windir);
 }
 
+static void
+async_drain(per_thread_t *data, thread_id_t tid);
+
 static void
 close_thread_file(void *drcontext)
 {
     per_thread_t *data = (per_thread_t *)drmgr_get_tls_field(drcontext, tls_idx);
+    // The compression state and file must not be in use by a writer.
+    async_drain(data, dr_get_thread_id(drcontext));
 #ifdef HAS_SNAPPY
     if (op_offline.get_value() && snappy_enabled()) {
         data->snappy_writer->~snappy_file_writer_t();
@@ -477,78 +483,521 @@ atomic_pipe_write(void *drcontext, byte *pipe_start, byte *pipe_end, ptr_int_t w
     return pipe_start;
 }
 
-static inline byte *
-write_trace_data(void *drcontext, byte *towrite_start, byte *towrite_end,
-                 ptr_int_t window)
+static void
+shm_wait(int *tries)
+{
+    if (++*tries < 128)
+        dr_thread_yield();
+    else
+        dr_sleep(1);
+}
+
+// Writes [towrite_start, towrite_end) to this thread's -ipc_shm ring in one piece,
+// waiting for the analyzer while no ring is free or the ring is full.
+static void
+shm_write(void *drcontext, byte *towrite_start, byte *towrite_end)
+{
+    per_thread_t *data = (per_thread_t *)drmgr_get_tls_field(drcontext, tls_idx);
+    int tries = 0;
+    while (data->shm_ring < 0) {
+        data->shm_ring = ipc_shm.claim_ring();
+        if (data->shm_ring < 0)
+            shm_wait(&tries);
+    }
+    tries = 0;
+    while (!ipc_shm.try_write(data->shm_ring, towrite_start, towrite_end - towrite_start))
+        shm_wait(&tries);
+}
+
+// Compresses if requested and writes to data->file.  Returns how many of the
+// size bytes at start were consumed.
+static ssize_t
+write_offline_file(per_thread_t *data, byte *start, ssize_t size)
 {
-    if (op_offline.get_value()) {
-        per_thread_t *data = (per_thread_t *)drmgr_get_tls_field(drcontext, tls_idx);
-        ssize_t size = towrite_end - towrite_start;
-        DR_ASSERT(data->file != INVALID_FILE);
-        if (file_ops_func.handoff_buf != NULL) {
-            if (!file_ops_func.handoff_buf(data->file, towrite_start, size,
-                                           max_buf_size)) {
-                FATAL("Fatal error: failed to hand off trace\n");
-            }
-        } else {
-            ssize_t wrote;
 #ifdef HAS_SNAPPY
-            if (op_offline.get_value() && snappy_enabled())
-                wrote = data->snappy_writer->compress_and_write(towrite_start, size);
-            else
+    if (snappy_enabled())
+        return data->snappy_writer->compress_and_write(start, size);
 #endif
 #ifdef HAS_ZLIB
-                if (op_offline.get_value() &&
-                    (op_raw_compress.get_value() == "zlib" ||
-                     op_raw_compress.get_value() == "gzip")) {
-                data->zstream.next_in = (Bytef *)towrite_start;
-                data->zstream.avail_in = static_cast<uInt>(size);
-                int res;
-                do {
-                    data->zstream.next_out = (Bytef *)data->buf_compressed;
-                    data->zstream.avail_out = static_cast<uInt>(max_buf_size);
-                    res = deflate(&data->zstream, Z_NO_FLUSH);
-                    NOTIFY(3, "deflate => %d in=%d out=%d => in=%d, out=%d, write=%d\n",
-                           res, size, size, data->zstream.avail_in,
-                           data->zstream.avail_out,
-                           max_buf_size - data->zstream.avail_out);
-                    DR_ASSERT(res != Z_STREAM_ERROR);
-                    wrote =
-                        file_ops_func.write_file(data->file, data->buf_compressed,
-                                                 max_buf_size - data->zstream.avail_out);
-                } while (data->zstream.avail_out == 0);
-                DR_ASSERT(data->zstream.avail_in == 0);
-                wrote = size;
-            } else
+    if (op_raw_compress.get_value() == "zlib" || op_raw_compress.get_value() == "gzip") {
+        data->zstream.next_in = (Bytef *)start;
+        data->zstream.avail_in = static_cast<uInt>(size);
+        int res;
+        do {
+            data->zstream.next_out = (Bytef *)data->buf_compressed;
+            data->zstream.avail_out = static_cast<uInt>(max_buf_size);
+            res = deflate(&data->zstream, Z_NO_FLUSH);
+            NOTIFY(3, "deflate => %d in=%d out=%d => in=%d, out=%d, write=%d\n", res,
+                   size, size, data->zstream.avail_in, data->zstream.avail_out,
+                   max_buf_size - data->zstream.avail_out);
+            DR_ASSERT(res != Z_STREAM_ERROR);
+            file_ops_func.write_file(data->file, data->buf_compressed,
+                                     max_buf_size - data->zstream.avail_out);
+        } while (data->zstream.avail_out == 0);
+        DR_ASSERT(data->zstream.avail_in == 0);
+        return size;
+    }
 #endif
 #ifdef HAS_LZ4
-                if (op_offline.get_value() && op_raw_compress.get_value() == "lz4") {
-                size_t res =
-                    LZ4F_compressUpdate(data->lzcxt, data->buf_lz4, data->buf_lz4_size,
-                                        towrite_start, size, nullptr);
-                DR_ASSERT(!LZ4F_isError(res));
-                wrote = file_ops_func.write_file(data->file, data->buf_lz4, res);
-                DR_ASSERT(static_cast<size_t>(wrote) == res);
-                wrote = size;
-            } else
+    if (op_raw_compress.get_value() == "lz4") {
+        size_t res = LZ4F_compressUpdate(data->lzcxt, data->buf_lz4, data->buf_lz4_size,
+                                         start, size, nullptr);
+        DR_ASSERT(!LZ4F_isError(res));
+        ssize_t wrote = file_ops_func.write_file(data->file, data->buf_lz4, res);
+        DR_ASSERT(static_cast<size_t>(wrote) == res);
+        return size;
+    }
 #endif
-                wrote = file_ops_func.write_file(data->file, towrite_start, size);
-            if (wrote < size) {
-                FATAL("Fatal error: failed to write trace for T%d window %zd: wrote %zd "
-                      "of %zd\n",
-                      dr_get_thread_id(drcontext), get_local_window(data), wrote, size);
-            }
+    return file_ops_func.write_file(data->file, start, size);
+}
+
+// Writes out [towrite_start, towrite_end) to the offline file for data.  This is
+// called on a writer thread for -async_writers, so it must not use the app
+// thread's drcontext or TLS.
+static void
+write_offline_data(per_thread_t *data, thread_id_t tid, ptr_int_t window,
+                   byte *towrite_start, byte *towrite_end)
+{
+    ssize_t size = towrite_end - towrite_start;
+    DR_ASSERT(data->file != INVALID_FILE);
+    if (file_ops_func.handoff_buf != NULL) {
+        if (!file_ops_func.handoff_buf(data->file, towrite_start, size, max_buf_size)) {
+            FATAL("Fatal error: failed to hand off trace\n");
         }
+        return;
+    }
+    ssize_t wrote = write_offline_file(data, towrite_start, size);
+    if (wrote < size) {
+        FATAL("Fatal error: failed to write trace for T%d window %zd: wrote %zd "
+              "of %zd\n",
+              tid, window, wrote, size);
+    }
+}
+
+static inline byte *
+write_trace_data(void *drcontext, byte *towrite_start, byte *towrite_end,
+                 ptr_int_t window)
+{
+    if (op_offline.get_value()) {
+        per_thread_t *data = (per_thread_t *)drmgr_get_tls_field(drcontext, tls_idx);
+        write_offline_data(data, dr_get_thread_id(drcontext), window, towrite_start,
+                           towrite_end);
         return towrite_start;
     } else {
 #ifdef HAS_SNAPPY
         // XXX i#5427: Use snappy compression for pipe data as well.  We need to
         // create a reader on the other end first.
 #endif
+        if (op_ipc_shm.get_value()) {
+            shm_write(drcontext, towrite_start, towrite_end);
+            return towrite_start;
+        }
         return atomic_pipe_write(drcontext, towrite_start, towrite_end, window);
     }
 }
 
+/***************************************************************************
+ * Asynchronous offline output for -async_writers.
+ *
+ * A full buffer is queued for a writer thread which compresses and writes it
+ * while the app thread continues tracing into a buffer from a recycled pool.
+ * Each app thread maps to a single writer which processes its queue in order,
+ * keeping each file's compression stream sequential.  A writer's current request
+ * is published as in_flight and written in slices, each under busy_lock, with
+ * buf_cur recording how far it got.  DR does not suspend a client thread holding
+ * a lock, so a writer is only ever stopped between slices, and whoever next holds
+ * busy_lock (async_drain() on the owning app thread, or async_exit()) can finish
+ * the in-flight request from buf_cur without losing or reordering output.
+ *
+ * DR only synchronizes with client threads after our exit event (i#297), so the
+ * writers are still running during the thread exit events at process exit and
+ * in async_exit().  async_exit() parks them before touching their queues; after
+ * that, async_drain() no longer waits on busy_lock.
+ */
+
+struct async_request_t {
+    per_thread_t *data;
+    thread_id_t tid;
+    ptr_int_t window;
+    byte *buf_base;
+    byte *buf_cur;
+    byte *buf_end;
+    async_request_t *next;
+};
+
+struct async_writer_t {
+    void *queue_lock;
+    void *busy_lock;
+    void *work_ready;
+    async_request_t *head;
+    async_request_t *tail;
+    // Dequeued and possibly partially written.  Only accessed while holding
+    // busy_lock or once the writers are parked.
+    async_request_t *in_flight;
+    // Set by the writer once it has seen async_writers_parking and will no longer
+    // touch any shared state.
+    volatile int parked;
+};
+
+// Bounds the memory held in buffers in flight.
+static constexpr int ASYNC_MAX_PENDING_PER_THREAD = 4;
+static constexpr uint ASYNC_MAX_POOLED_BUFFERS = 64;
+// Bounds how long a writer holds busy_lock, which delays suspension by DR.
+static constexpr size_t ASYNC_SLICE_SIZE = 64 * 1024;
+
+static async_writer_t *async_writers;
+static uint num_async_writers;
+static std::atomic<bool> async_writers_started;
+// Set by async_exit() to stop the writers.
+static std::atomic<bool> async_writers_parking;
+// Set once every started writer has parked.
+static std::atomic<bool> async_writers_parked;
+static void *async_pool_lock;
+// Free buffers, linked through their first pointer-sized slot.
+static byte *async_pool;
+static uint async_pool_count;
+
+static inline bool
+async_output_enabled()
+{
+    return num_async_writers > 0 && file_ops_func.handoff_buf == NULL;
+}
+
+static inline async_writer_t *
+async_writer_for(thread_id_t tid)
+{
+    return &async_writers[static_cast<uint>(tid) % num_async_writers];
+}
+
+static byte *
+async_take_buffer()
+{
+    byte *buf = nullptr;
+    dr_mutex_lock(async_pool_lock);
+    if (async_pool != nullptr) {
+        buf = async_pool;
+        async_pool = *reinterpret_cast<byte **>(buf);
+        --async_pool_count;
+    }
+    dr_mutex_unlock(async_pool_lock);
+    if (buf != nullptr) {
+        // Restore the zero overwritten by the pool link.
+        *reinterpret_cast<byte **>(buf) = nullptr;
+        return buf;
+    }
+    buf =
+        (byte *)dr_raw_mem_alloc(max_buf_size, DR_MEMPROT_READ | DR_MEMPROT_WRITE, NULL);
+    if (buf == NULL)
+        FATAL("Fatal error: out of memory for -async_writers buffers.\n");
+    /* dr_raw_mem_alloc guarantees to give us zeroed memory: just set the redzone. */
+    memset(buf + trace_buf_size, -1, redzone_size);
+    return buf;
+}
+
+static void
+async_recycle_buffer(byte *buf)
+{
+    // Our instrumentation expects zero in the trace buffer and non-zero in the
+    // redzone.  Doing this here takes it off the app thread as well.
+    memset(buf, 0, trace_buf_size);
+    memset(buf + trace_buf_size, -1, redzone_size);
+    dr_mutex_lock(async_pool_lock);
+    if (async_pool_count < ASYNC_MAX_POOLED_BUFFERS) {
+        *reinterpret_cast<byte **>(buf) = async_pool;
+        async_pool = buf;
+        ++async_pool_count;
+        buf = nullptr;
+    }
+    dr_mutex_unlock(async_pool_lock);
+    if (buf != nullptr)
+        dr_raw_mem_free(buf, max_buf_size);
+}
+
+// Writes out the next slice of req.  Returns true if req is now complete, in
+// which case it has been freed.
+static bool
+async_process_slice(async_request_t *req)
+{
+    byte *slice_end = req->buf_cur +
+        std::min(ASYNC_SLICE_SIZE, static_cast<size_t>(req->buf_end - req->buf_cur));
+    write_offline_data(req->data, req->tid, req->window, req->buf_cur, slice_end);
+    req->buf_cur = slice_end;
+    if (slice_end < req->buf_end)
+        return false;
+    async_recycle_buffer(req->buf_base);
+    dr_atomic_add32_return_sum(&req->data->num_async_pending, -1);
+    dr_global_free(req, sizeof(*req));
+    return true;
+}
+
+static void
+async_process_request(async_request_t *req)
+{
+    while (!async_process_slice(req)) {
+        /* Keep going. */
+    }
+}
+
+// Finishes writer's in-flight request if it belongs to data, or any owner if data
+// is nullptr.  The caller must hold busy_lock or have parked the writers.
+static void
+async_finish_in_flight(async_writer_t *writer, per_thread_t *data)
+{
+    async_request_t *req = writer->in_flight;
+    if (req == nullptr || (data != nullptr && req->data != data))
+        return;
+    writer->in_flight = nullptr;
+    async_process_request(req);
+}
+
+static void
+async_writer_thread(void *arg)
+{
+    async_writer_t *writer = reinterpret_cast<async_writer_t *>(arg);
+    while (!async_writers_parking.load(std::memory_order_acquire)) {
+        dr_mutex_lock(writer->busy_lock);
+        if (writer->in_flight == nullptr) {
+            dr_mutex_lock(writer->queue_lock);
+            async_request_t *req = writer->head;
+            if (req != nullptr) {
+                writer->head = req->next;
+                if (writer->head == nullptr)
+                    writer->tail = nullptr;
+            }
+            dr_mutex_unlock(writer->queue_lock);
+            writer->in_flight = req;
+        }
+        if (writer->in_flight == nullptr) {
+            dr_mutex_unlock(writer->busy_lock);
+            // The event auto-resets, and a signal with no waiter is not lost.
+            dr_event_wait(writer->work_ready);
+            continue;
+        }
+        // Releasing busy_lock between slices lets an app thread waiting in
+        // async_drain() take over the rest of its own request.
+        if (async_process_slice(writer->in_flight))
+            writer->in_flight = nullptr;
+        dr_mutex_unlock(writer->busy_lock);
+    }
+    dr_atomic_store32(&writer->parked, 1);
+    // DR terminates us after the exit event.  dr_sleep() marks us as safe for
+    // that and touches none of our state, which async_exit() is about to free.
+    while (true)
+        dr_sleep(1000);
+}
+
+// Writes out all of data's queued buffers before returning.  Rather than waiting
+// for the writer to reach them, we process our own requests.
+static void
+async_drain(per_thread_t *data, thread_id_t tid)
+{
+    if (num_async_writers == 0 || dr_atomic_load32(&data->num_async_pending) == 0)
+        return;
+    async_writer_t *writer = async_writer_for(tid);
+    // Once parked the writers never again touch the queues or take the locks.
+    bool parked = async_writers_parked.load(std::memory_order_acquire);
+    // Holding busy_lock ensures the writer is between slices, so we can finish
+    // our in-flight request ourselves before the rest of our queue.
+    if (!parked)
+        dr_mutex_lock(writer->busy_lock);
+    async_finish_in_flight(writer, data);
+    if (!parked)
+        dr_mutex_lock(writer->queue_lock);
+    async_request_t *mine = nullptr, **mine_next = &mine;
+    async_request_t **link = &writer->head;
+    writer->tail = nullptr;
+    while (*link != nullptr) {
+        async_request_t *req = *link;
+        if (req->data == data) {
+            *link = req->next;
+            req->next = nullptr;
+            *mine_next = req;
+            mine_next = &req->next;
+        } else {
+            writer->tail = req;
+            link = &req->next;
+        }
+    }
+    if (!parked)
+        dr_mutex_unlock(writer->queue_lock);
+    while (mine != nullptr) {
+        async_request_t *next = mine->next;
+        async_process_request(mine);
+        mine = next;
+    }
+    DR_ASSERT(dr_atomic_load32(&data->num_async_pending) == 0);
+    if (!parked)
+        dr_mutex_unlock(writer->busy_lock);
+}
+
+static void
+async_init()
+{
+    num_async_writers = op_async_writers.get_value();
+    async_writers = reinterpret_cast<async_writer_t *>(
+        dr_global_alloc(num_async_writers * sizeof(*async_writers)));
+    async_pool_lock = dr_mutex_create();
+    async_pool = nullptr;
+    async_pool_count = 0;
+    for (uint i = 0; i < num_async_writers; ++i) {
+        async_writer_t *writer = &async_writers[i];
+        writer->queue_lock = dr_mutex_create();
+        writer->busy_lock = dr_mutex_create();
+        writer->work_ready = dr_event_create();
+        writer->head = nullptr;
+        writer->tail = nullptr;
+        writer->in_flight = nullptr;
+        writer->parked = 0;
+    }
+    async_writers_started.store(false, std::memory_order_release);
+    async_writers_parking.store(false, std::memory_order_release);
+    async_writers_parked.store(false, std::memory_order_release);
+}
+
+// We create the writer threads on first use rather than in init_io(): that
+// avoids idle threads in processes which never write a buffer, and client threads
+// created during drmemtrace_client_main() before all of our DR extensions are
+// initialized crash at startup.
+static void
+async_start_writers()
+{
+    dr_mutex_lock(mutex);
+    if (!async_writers_started.load(std::memory_order_acquire)) {
+        for (uint i = 0; i < num_async_writers; ++i) {
+            if (!dr_create_client_thread(async_writer_thread, &async_writers[i]))
+                FATAL("Fatal error: failed to create -async_writers thread.\n");
+        }
+        async_writers_started.store(true, std::memory_order_release);
+    }
+    dr_mutex_unlock(mutex);
+}
+
+// Queues data's buffer ending at buf_end for its writer and replaces
+// data->buf_base with a fresh buffer.
+static void
+async_output_buffer(void *drcontext, per_thread_t *data, byte *buf_end,
+                    ptr_int_t window)
+{
+    thread_id_t tid = dr_get_thread_id(drcontext);
+    if (!async_writers_started.load(std::memory_order_acquire))
+        async_start_writers();
+    // If our writer has fallen behind, write out our backlog ourselves.
+    if (dr_atomic_load32(&data->num_async_pending) >= ASYNC_MAX_PENDING_PER_THREAD)
+        async_drain(data, tid);
+    async_request_t *req =
+        reinterpret_cast<async_request_t *>(dr_global_alloc(sizeof(*req)));
+    req->data = data;
+    req->tid = tid;
+    req->window = window;
+    req->buf_base = data->buf_base;
+    req->buf_cur = data->buf_base;
+    req->buf_end = buf_end;
+    req->next = nullptr;
+    dr_atomic_add32_return_sum(&data->num_async_pending, 1);
+    async_writer_t *writer = async_writer_for(tid);
+    dr_mutex_lock(writer->queue_lock);
+    if (writer->tail == nullptr)
+        writer->head = req;
+    else
+        writer->tail->next = req;
+    writer->tail = req;
+    dr_mutex_unlock(writer->queue_lock);
+    dr_event_signal(writer->work_ready);
+    data->buf_base = async_take_buffer();
+}
+
+static void
+async_exit()
+{
+    // DR has not yet suspended the writers (it only synchronizes with client
+    // threads after the exit event), so we stop them ourselves.  A writer may
+    // be mid-request: it stops after its current slice, leaving the rest to us.
+    if (async_writers_started.load(std::memory_order_acquire)) {
+        async_writers_parking.store(true, std::memory_order_release);
+        for (uint i = 0; i < num_async_writers; ++i) {
+            async_writer_t *writer = &async_writers[i];
+            while (dr_atomic_load32(&writer->parked) == 0) {
+                dr_event_signal(writer->work_ready);
+                dr_thread_yield();
+            }
+        }
+    }
+    async_writers_parked.store(true, std::memory_order_release);
+    // Each traced thread drained its queue at thread exit, but if thread exit
+    // events were skipped we write out what remains, in-flight requests first.
+    for (uint i = 0; i < num_async_writers; ++i) {
+        async_writer_t *writer = &async_writers[i];
+        async_finish_in_flight(writer, nullptr);
+        while (writer->head != nullptr) {
+            async_request_t *req = writer->head;
+            writer->head = req->next;
+            async_process_request(req);
+        }
+        dr_mutex_destroy(writer->queue_lock);
+        dr_mutex_destroy(writer->busy_lock);
+        dr_event_destroy(writer->work_ready);
+    }
+    dr_global_free(async_writers, num_async_writers * sizeof(*async_writers));
+    async_writers = nullptr;
+    num_async_writers = 0;
+    while (async_pool != nullptr) {
+        byte *next = *reinterpret_cast<byte **>(async_pool);
+        dr_raw_mem_free(async_pool, max_buf_size);
+        async_pool = next;
+    }
+    async_pool_count = 0;
+    dr_mutex_destroy(async_pool_lock);
+}
+
+// Destroys a lock inherited across a fork.  A thread that did not survive the fork
+// may have held it, in which case what it guards may be mid-update and the caller
+// must leave that alone: we return false and leak the lock.
+static bool
+async_fork_destroy_lock(void *lock)
+{
+    if (!dr_mutex_trylock(lock))
+        return false;
+    dr_mutex_unlock(lock);
+    dr_mutex_destroy(lock);
+    return true;
+}
+
+static void
+async_fork_free_request(async_request_t *req)
+{
+    dr_raw_mem_free(req->buf_base, max_buf_size);
+    dr_global_free(req, sizeof(*req));
+}
+
+// Frees the writers, queued requests, and pooled buffers inherited from the
+// parent, in a child where no writer threads exist.
+static void
+async_fork_discard()
+{
+    for (uint i = 0; i < num_async_writers; ++i) {
+        async_writer_t *writer = &async_writers[i];
+        if (async_fork_destroy_lock(writer->busy_lock) && writer->in_flight != nullptr)
+            async_fork_free_request(writer->in_flight);
+        if (async_fork_destroy_lock(writer->queue_lock)) {
+            while (writer->head != nullptr) {
+                async_request_t *req = writer->head;
+                writer->head = req->next;
+                async_fork_free_request(req);
+            }
+        }
+        dr_event_destroy(writer->work_ready);
+    }
+    dr_global_free(async_writers, num_async_writers * sizeof(*async_writers));
+    async_writers = nullptr;
+    if (async_fork_destroy_lock(async_pool_lock)) {
+        while (async_pool != nullptr) {
+            byte *next = *reinterpret_cast<byte **>(async_pool);
+            dr_raw_mem_free(async_pool, max_buf_size);
+            async_pool = next;
+        }
+    }
+}
+
 // Should only be called when the trace buffer is empty.
 // For a new window, appends the thread headers, but not the unit headers;
 // returns true if that happens else returns false.
@@ -688,7 +1137,11 @@ output_buffer(void *drcontext, per_thread_t *data, byte *buf_base, byte *buf_ptr
 {
     byte *pipe_start = buf_base;
     byte *pipe_end = pipe_start;
-    if (!op_offline.get_value()) {
+    if (!op_offline.get_value() && op_ipc_shm.get_value()) {
+        // A ring has no atomic write size, so the whole buffer goes at once.
+        if ((buf_ptr - pipe_start) > (ssize_t)buf_hdr_slots_size)
+            shm_write(drcontext, pipe_start, buf_ptr);
+    } else if (!op_offline.get_value()) {
         for (byte *mem_ref = buf_base + header_size; mem_ref < buf_ptr;
              mem_ref += instru->sizeof_entry()) {
             // Split up the buffer into multiple writes to ensure atomic pipe writes.
@@ -728,6 +1181,8 @@ output_buffer(void *drcontext, per_thread_t *data, byte *buf_base, byte *buf_ptr
                 is_ok_to_split_before(instru->get_entry_type(pipe_start + header_size)));
             atomic_pipe_write(drcontext, pipe_start, buf_ptr, get_local_window(data));
         }
+    } else if (async_output_enabled() && buf_base == data->buf_base) {
+        async_output_buffer(drcontext, data, buf_ptr, get_local_window(data));
     } else {
         write_trace_data(drcontext, pipe_start, buf_ptr, get_local_window(data));
     }
@@ -903,6 +1358,7 @@ process_and_output_buffer(void *drcontext, bool skip_size_cap)
     per_thread_t *data = (per_thread_t *)drmgr_get_tls_field(drcontext, tls_idx);
     byte *mem_ref, *buf_ptr;
     byte *redzone;
+    byte *orig_buf_base = data->buf_base;
     bool do_write = true;
     uint current_num_refs = 0;
 
@@ -1039,7 +1495,8 @@ process_and_output_buffer(void *drcontext, bool skip_size_cap)
             output_buffer(drcontext, data, data->buf_base + skip, buf_ptr, header_size);
     }
 
-    if (file_ops_func.handoff_buf == NULL) {
+    // A buffer swapped out for -async_writers is reset by its writer.
+    if (file_ops_func.handoff_buf == NULL && data->buf_base == orig_buf_base) {
         // Our instrumentation reads from buffer and skips the clean call if the
         // content is 0, so we need set zero in the trace buffer and set non-zero
         // in redzone.
@@ -1133,6 +1590,7 @@ init_thread_io(void *drcontext)
             append_unit_header(drcontext, BUF_PTR(data->seg_base),
                                dr_get_thread_id(drcontext), get_local_window(data));
     } else {
+        data->shm_ring = -1;
         /* pass pid and tid to the simulator to register current thread */
         char buf[MAXIMUM_PATH];
         proc_info = (byte *)buf;
@@ -1197,6 +1655,11 @@ exit_thread_io(void *drcontext)
 
     if (op_offline.get_value() && data->file != INVALID_FILE)
         close_thread_file(drcontext);
+    if (!op_offline.get_value() && op_ipc_shm.get_value() && data->shm_ring >= 0) {
+        // Let the analyzer reuse the ring once it has read the rest.
+        ipc_shm.release_ring(data->shm_ring);
+        data->shm_ring = -1;
+    }
 
 #ifdef HAS_ZLIB
     if (op_offline.get_value() &&
@@ -1256,13 +1719,38 @@ init_io()
     }
 #endif
 
+    // We may be called more than once.
+    if (op_offline.get_value() && op_async_writers.get_value() > 0 &&
+        async_writers == nullptr) {
+        if (op_use_physical.get_value()) {
+            NOTIFY(0, "-async_writers is not supported with -use_physical: ignoring.\n");
+            op_async_writers.set_value(0);
+        } else
+            async_init();
+    }
+
     DR_ASSERT(cur_window_instr_count.is_lock_free());
 }
 
+void
+fork_init_io(void *drcontext)
+{
+    if (async_writers == nullptr)
+        return;
+    // Only this thread survives the fork, and the parent writes out the queued
+    // buffers, so we discard our copies and start over with new writers.
+    per_thread_t *data = (per_thread_t *)drmgr_get_tls_field(drcontext, tls_idx);
+    data->num_async_pending = 0;
+    async_fork_discard();
+    async_init();
+}
+
 void
 exit_io()
 {
     notify_beyond_global_max_once = 0;
+    if (async_writers != nullptr)
+        async_exit();
 }
 
 } // namespace drmemtrace
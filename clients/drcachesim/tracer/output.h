@@ -60,6 +60,9 @@ init_buffers(per_thread_t *data);
 void
 init_io();
 
+void
+fork_init_io(void *drcontext);
+
 void
 exit_io();
 
@@ -908,14 +908,17 @@ raw2trace_t::check_thread_file(std::istream *f)
 }
 
 void
-raw2trace_t::process_tasks(std::vector<raw2trace_thread_data_t *> *tasks)
+raw2trace_t::process_tasks(int worker)
 {
-    if (tasks->empty()) {
-        VPRINT(1, "Worker has no tasks\n");
-        return;
-    }
-    VPRINT(1, "Worker %d assigned %zd task(s)\n", (*tasks)[0]->worker, tasks->size());
-    for (raw2trace_thread_data_t *tdata : *tasks) {
+    int count = 0;
+    while (true) {
+        size_t index = next_task_index_.fetch_add(1, std::memory_order_acq_rel);
+        if (index >= thread_data_.size())
+            break;
+        raw2trace_thread_data_t *tdata = thread_data_[index].get();
+        // The worker owns the tdata from here on, and its decode cache is used.
+        tdata->worker = worker;
+        ++count;
         VPRINT(1, "Worker %d starting on trace thread %d\n", tdata->worker, tdata->index);
         std::string error = process_thread_file(tdata);
         if (!error.empty()) {
@@ -925,6 +928,7 @@ raw2trace_t::process_tasks(std::vector<raw2trace_thread_data_t *> *tasks)
         }
         VPRINT(1, "Worker %d finished trace thread %d\n", tdata->worker, tdata->index);
     }
+    VPRINT(1, "Worker %d processed %d task(s)\n", worker, count);
 }
 
 std::string
@@ -947,14 +951,16 @@ raw2trace_t::do_conversion()
             count_rseq_side_exit_ += thread_data_[i]->count_rseq_side_exit;
         }
     } else {
-        // The files can be converted concurrently.
+        // The files can be converted concurrently.  Each worker claims the next
+        // unclaimed file when it finishes its current one, so a few large threads
+        // do not leave other workers idle with statically assigned files queued
+        // behind them.
         std::vector<std::thread> threads;
         VPRINT(1, "Creating %d worker threads\n", worker_count_);
         threads.reserve(worker_count_);
-        for (int i = 0; i < worker_count_; ++i) {
-            threads.push_back(
-                std::thread(&raw2trace_t::process_tasks, this, &worker_tasks_[i]));
-        }
+        next_task_index_.store(0, std::memory_order_release);
+        for (int i = 0; i < worker_count_; ++i)
+            threads.push_back(std::thread(&raw2trace_t::process_tasks, this, i));
         for (std::thread &thread : threads)
             thread.join();
         for (auto &tdata : thread_data_) {
@@ -2718,6 +2724,7 @@ raw2trace_t::raw2trace_t(const char *module_map,
     : dcontext_(dcontext == nullptr ? dr_standalone_init() : dcontext)
     , passed_dcontext_(dcontext != nullptr)
     , worker_count_(worker_count)
+    , next_task_index_(0)
     , user_process_(nullptr)
     , user_process_data_(nullptr)
     , modmap_bytes_(module_map)
@@ -2758,25 +2765,19 @@ raw2trace_t::raw2trace_t(const char *module_map,
             thread_data_[i]->out_file = out_files[i];
         }
     }
-    // Since we know the traced-thread count up front, we use a simple round-robin
-    // static work assigment.  This won't be as load balanced as a dynamic work
-    // queue but it is much simpler.
+    // Work is handed out dynamically in thread_data_ order by process_tasks(), so
+    // callers should list the largest thread files first for the best load balance
+    // (raw2trace_directory_t does so).
     if (worker_count_ < 0) {
         worker_count_ = std::thread::hardware_concurrency();
         if (worker_count_ > kDefaultJobMax)
             worker_count_ = kDefaultJobMax;
     }
+    // We never need more workers than thread files.
+    if (worker_count_ > static_cast<int>(thread_data_.size()))
+        worker_count_ = static_cast<int>(thread_data_.size());
     int cache_count = worker_count_;
-    if (worker_count_ > 0) {
-        worker_tasks_.resize(worker_count_);
-        int worker = 0;
-        for (size_t i = 0; i < thread_data_.size(); ++i) {
-            VPRINT(2, "Worker %d assigned trace thread %zd\n", worker, i);
-            worker_tasks_[worker].push_back(thread_data_[i].get());
-            thread_data_[i]->worker = worker;
-            worker = (worker + 1) % worker_count_;
-        }
-    } else
+    if (worker_count_ == 0)
         cache_count = 1;
     decode_cache_.reserve(cache_count);
     for (int i = 0; i < cache_count; ++i)
@@ -94,6 +94,9 @@
 #else
 #    define TRACE_SUFFIX "trace"
 #endif
+// The suffix of seekable zstd output (see zstd_ostream_t), which is only produced on
+// request.
+#define TRACE_SUFFIX_ZSTD "trace.zst"
 #define TRACE_CHUNK_PREFIX "chunk."
 
 typedef enum {
@@ -1253,8 +1256,9 @@ private:
     std::string
     process_thread_file(raw2trace_thread_data_t *tdata);
 
+    // Claims and converts thread files from thread_data_ until none remain.
     void
-    process_tasks(std::vector<raw2trace_thread_data_t *> *tasks);
+    process_tasks(int worker);
 
     std::string
     emit_new_chunk_header(raw2trace_thread_data_t *tdata);
@@ -1299,7 +1303,8 @@ private:
                   OUT bool *reached_end_of_memrefs);
 
     int worker_count_;
-    std::vector<std::vector<raw2trace_thread_data_t *>> worker_tasks_;
+    // The index into thread_data_ of the next thread file for a worker to claim.
+    std::atomic<size_t> next_task_index_;
 
     class block_hashtable_t {
         // We use a hashtable to cache decodings.  We compared the performance of
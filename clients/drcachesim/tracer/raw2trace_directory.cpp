@@ -69,6 +69,9 @@
 #ifdef HAS_LZ4
 #    include "common/lz4_istream.h"
 #endif
+#ifdef HAS_ZSTD
+#    include "common/zstd_ostream.h"
+#endif
 
 #define FATAL_ERROR(msg, ...)                               \
     do {                                                    \
@@ -106,6 +109,31 @@ raw2trace_directory_t::open_thread_files()
         if (!error.empty())
             return error;
     }
+    // raw2trace_t hands out files to its workers in order, so we put the largest
+    // first to avoid a big thread being started last and running alone at the end.
+    // The on-disk size of a compressed file is a reasonable proxy for its work.
+    std::vector<size_t> order(in_files_.size());
+    for (size_t i = 0; i < order.size(); ++i)
+        order[i] = i;
+    std::stable_sort(order.begin(), order.end(), [this](size_t l, size_t r) {
+        return in_file_sizes_[l] > in_file_sizes_[r];
+    });
+    std::vector<std::istream *> sorted_in;
+    std::vector<std::ostream *> sorted_out;
+    std::vector<archive_ostream_t *> sorted_archives;
+    std::vector<uint64> sorted_sizes;
+    for (size_t i : order) {
+        sorted_in.push_back(in_files_[i]);
+        sorted_sizes.push_back(in_file_sizes_[i]);
+        if (!out_files_.empty())
+            sorted_out.push_back(out_files_[i]);
+        if (!out_archives_.empty())
+            sorted_archives.push_back(out_archives_[i]);
+    }
+    in_files_ = std::move(sorted_in);
+    in_file_sizes_ = std::move(sorted_sizes);
+    out_files_ = std::move(sorted_out);
+    out_archives_ = std::move(sorted_archives);
     return "";
 }
 
@@ -191,6 +219,14 @@ raw2trace_directory_t::open_thread_log_file(const char *basename)
 #endif
     if (ifile == nullptr)
         ifile = new std::ifstream(path, std::ifstream::binary);
+    uint64 file_size = 0;
+    file_t size_file = dr_open_file(path, DR_FILE_READ);
+    if (size_file != INVALID_FILE) {
+        if (!dr_file_size(size_file, &file_size))
+            file_size = 0;
+        dr_close_file(size_file);
+    }
+    in_file_sizes_.push_back(file_size);
     in_files_.push_back(ifile);
     if (!(*in_files_.back()))
         return "Failed to open thread log file " + std::string(path);
@@ -207,10 +243,21 @@ raw2trace_directory_t::open_thread_log_file(const char *basename)
                     basename_pre_suffix - 1 - basename, basename) <= 0) {
         return "Failed to compute output name for file " + std::string(basename);
     }
+    const char *suffix = compress_type_ == "zstd" ? TRACE_SUFFIX_ZSTD : TRACE_SUFFIX;
     if (dr_snprintf(path, BUFFER_SIZE_ELEMENTS(path), "%s%s%s.%s", outdir_.c_str(),
-                    DIRSEP, outname, TRACE_SUFFIX) <= 0) {
+                    DIRSEP, outname, suffix) <= 0) {
         return "Failed to compute full path of output file for " + std::string(basename);
     }
+#ifdef HAS_ZSTD
+    if (compress_type_ == "zstd") {
+        archive_ostream_t *ofile = new zstd_ostream_t(path);
+        out_archives_.push_back(ofile);
+        if (!(*out_archives_.back()))
+            return "Failed to open output file " + std::string(path);
+        VPRINT(1, "Opened output file %s\n", path);
+        return "";
+    }
+#endif
 #ifdef HAS_ZIP
     archive_ostream_t *ofile = new zipfile_ostream_t(path);
     out_archives_.push_back(ofile);
@@ -351,10 +398,18 @@ raw2trace_directory_t::tracedir_from_rawdir(const std::string &rawdir_in)
 }
 
 std::string
-raw2trace_directory_t::initialize(const std::string &indir, const std::string &outdir)
+raw2trace_directory_t::initialize(const std::string &indir, const std::string &outdir,
+                                  const std::string &compress_type)
 {
     indir_ = indir;
     outdir_ = outdir;
+    compress_type_ = compress_type;
+    if (!compress_type_.empty() && compress_type_ != "zstd")
+        return "Unknown trace compression type " + compress_type_;
+#ifndef HAS_ZSTD
+    if (compress_type_ == "zstd")
+        return "zstd trace compression is not supported by this build";
+#endif
 #ifdef WINDOWS
     // Canonicalize.
     std::replace(indir_.begin(), indir_.end(), ALT_DIRSEP[0], DIRSEP[0]);
@@ -56,9 +56,12 @@ public:
     ~raw2trace_directory_t();
 
     // If outdir.empty() then a peer of indir's OUTFILE_SUBDIR named TRACE_SUBDIR
-    // is used by default.  Returns "" on success or an error message on failure.
+    // is used by default.  If compress_type is "zstd" the per-thread trace files are
+    // written as seekable zstd files; if it is empty the default format for the
+    // build is used.  Returns "" on success or an error message on failure.
     std::string
-    initialize(const std::string &indir, const std::string &outdir);
+    initialize(const std::string &indir, const std::string &outdir,
+               const std::string &compress_type = "");
     // Use this instead of initialize() to only fill in modfile_bytes, for
     // constructing a module_mapper_t.  Returns "" on success or an error message on
     // failure.
@@ -100,8 +103,11 @@ private:
     std::string
     open_cpu_schedule_file();
     file_t modfile_;
+    // Parallel to in_files_.
+    std::vector<uint64> in_file_sizes_;
     std::string indir_;
     std::string outdir_;
+    std::string compress_type_;
     unsigned int verbosity_;
 };
 
@@ -69,6 +69,15 @@ static droption_t<bytesize_t> op_chunk_instr_count(
     "is split inside a zipfile.  This is the granularity of a fast seek. "
     "For 32-bit this cannot exceed 4G.");
 
+static droption_t<std::string> op_trace_compress(
+    DROPTION_SCOPE_FRONTEND, "trace_compress", "", "Trace output compression type",
+    "Specifies the format of the per-thread output files.  The default (empty) uses "
+    "the format chosen when this tool was built: a zipfile, gzip, or uncompressed.  "
+    "\"zstd\" writes seekable zstd files with one compressed frame per chunk (see "
+    "-chunk_instr_count) and an index of the frames at the end of the file, which "
+    "supports fast seeking like a zipfile.  The zstd option is only available when "
+    "this tool was built with zstd support.");
+
 static droption_t<unsigned int> op_verbose(DROPTION_SCOPE_FRONTEND, "verbose", 0,
                                            "Verbosity level for diagnostic output",
                                            "Verbosity level for diagnostic output.");
@@ -105,7 +114,8 @@ _tmain(int argc, const TCHAR *targv[])
     }
 
     raw2trace_directory_t dir(op_verbose.get_value());
-    std::string dir_err = dir.initialize(op_indir.get_value(), op_outdir.get_value());
+    std::string dir_err = dir.initialize(op_indir.get_value(), op_outdir.get_value(),
+                                         op_trace_compress.get_value());
     if (!dir_err.empty())
         FATAL_ERROR("Directory parsing failed: %s", dir_err.c_str());
     raw2trace_t raw2trace(
@@ -59,6 +59,7 @@
 #include "func_trace.h"
 #include "../common/trace_entry.h"
 #include "../common/named_pipe.h"
+#include "../common/shm_ring.h"
 #include "../common/options.h"
 #include "../common/utils.h"
 
@@ -134,6 +135,10 @@ typedef struct {
 
 /* For online simulation, we write to a single global pipe */
 named_pipe_t ipc_pipe;
+/* ...or, for -ipc_shm, to per-thread rings in this shared region. */
+shm_rings_t ipc_shm;
+static void *ipc_shm_base;
+static size_t ipc_shm_size;
 
 #define MAX_INSTRU_SIZE 256 /* The max instance size of instru_t or its children. */
 instru_t *instru;
@@ -1656,6 +1661,9 @@ event_exit(void)
             file_ops_func.close_file(funclist_file);
         if (encoding_file != INVALID_FILE)
             file_ops_func.close_file(encoding_file);
+    } else if (op_ipc_shm.get_value()) {
+        ipc_shm.detach();
+        dr_unmap_file(static_cast<byte *>(ipc_shm_base), ipc_shm_size);
     } else
         ipc_pipe.close();
 
@@ -1702,6 +1710,39 @@ event_exit(void)
     droption_parser_t::clear_values();
 }
 
+/* Maps the -ipc_shm region created by the analyzer and registers this process
+ * as a writer.
+ */
+static bool
+init_ipc_shm()
+{
+#ifdef UNIX
+    std::string path = shm_rings_t::get_path(op_ipc_name.get_value());
+    /* dr_open_file() would create a missing file: the analyzer must do that. */
+    if (!dr_file_exists(path.c_str()))
+        return false;
+    /* We want an isolated fd, though only until the region is mapped. */
+    file_t fd = dr_open_file(path.c_str(), DR_FILE_READ | DR_FILE_WRITE_APPEND);
+    if (fd == INVALID_FILE)
+        return false;
+    uint64 file_size;
+    if (!dr_file_size(fd, &file_size)) {
+        dr_close_file(fd);
+        return false;
+    }
+    size_t map_size = static_cast<size_t>(file_size);
+    ipc_shm_base =
+        dr_map_file(fd, &map_size, 0, NULL, DR_MEMPROT_READ | DR_MEMPROT_WRITE, 0);
+    dr_close_file(fd);
+    if (ipc_shm_base == NULL || map_size < file_size)
+        return false;
+    ipc_shm_size = map_size;
+    return ipc_shm.attach(ipc_shm_base, ipc_shm_size);
+#else
+    return false;
+#endif
+}
+
 static bool
 init_offline_dir(void)
 {
@@ -1801,8 +1842,16 @@ fork_init(void *drcontext)
      * initial header in process_and_output_buffer() for offline).
      */
     data->num_refs = 0;
+    if (!op_offline.get_value() && op_ipc_shm.get_value()) {
+        /* The child is a new writer.  Its threads claim their own rings in
+         * init_thread_io().
+         */
+        if (!ipc_shm.attach(ipc_shm_base, ipc_shm_size))
+            FATAL("Fatal error: failed to attach to the -ipc_shm region.\n");
+    }
     if (op_offline.get_value()) {
         data->file = INVALID_FILE;
+        fork_init_io(drcontext);
         if (!init_offline_dir()) {
             FATAL("Failed to create a subdir in %s\n", op_outdir.get_value().c_str());
         }
@@ -2030,26 +2079,33 @@ drmemtrace_client_main(client_id_t id, int argc, const char *argv[])
                             op_L0I_filter.get_value(), &scratch_reserve_vec);
         if (!ipc_pipe.set_name(op_ipc_name.get_value().c_str()))
             DR_ASSERT(false);
+        if (op_ipc_shm.get_value()) {
+            if (!init_ipc_shm()) {
+                FATAL("Fatal error: failed to attach to the -ipc_shm region for %s.\n",
+                      op_ipc_name.get_value().c_str());
+            }
+        } else {
 #ifdef UNIX
-        /* we want an isolated fd so we don't use ipc_pipe.open_for_write() */
-        int fd = dr_open_file(ipc_pipe.get_pipe_path().c_str(), DR_FILE_WRITE_ONLY);
-        DR_ASSERT(fd != INVALID_FILE);
-        if (!ipc_pipe.set_fd(fd))
-            DR_ASSERT(false);
+            /* we want an isolated fd so we don't use ipc_pipe.open_for_write() */
+            int fd = dr_open_file(ipc_pipe.get_pipe_path().c_str(), DR_FILE_WRITE_ONLY);
+            DR_ASSERT(fd != INVALID_FILE);
+            if (!ipc_pipe.set_fd(fd))
+                DR_ASSERT(false);
 #else
-        if (!ipc_pipe.open_for_write()) {
-            if (GetLastError() == ERROR_PIPE_BUSY) {
-                // FIXME i#1727: add multi-process support to Windows named_pipe_t.
-                FATAL("Fatal error: multi-process applications not yet supported "
-                      "for drcachesim on Windows\n");
-            } else {
-                FATAL("Fatal error: Failed to open pipe %s.\n",
-                      op_ipc_name.get_value().c_str());
+            if (!ipc_pipe.open_for_write()) {
+                if (GetLastError() == ERROR_PIPE_BUSY) {
+                    // FIXME i#1727: add multi-process support to Windows named_pipe_t.
+                    FATAL("Fatal error: multi-process applications not yet supported "
+                          "for drcachesim on Windows\n");
+                } else {
+                    FATAL("Fatal error: Failed to open pipe %s.\n",
+                          op_ipc_name.get_value().c_str());
+                }
             }
-        }
 #endif
-        if (!ipc_pipe.maximize_buffer())
-            NOTIFY(1, "Failed to maximize pipe buffer: performance may suffer.\n");
+            if (!ipc_pipe.maximize_buffer())
+                NOTIFY(1, "Failed to maximize pipe buffer: performance may suffer.\n");
+        }
     }
 
     if (op_offline.get_value() &&
@@ -2115,6 +2171,11 @@ drmemtrace_client_main(client_id_t id, int argc, const char *argv[])
     max_buf_size = ALIGN_FORWARD(trace_buf_size + redzone_size, dr_page_size());
     /* Mark any padding as redzone as well */
     redzone_size = max_buf_size - trace_buf_size;
+    if (!op_offline.get_value() && op_ipc_shm.get_value() &&
+        ipc_shm.get_ring_size() < max_buf_size) {
+        FATAL("Fatal error: -ipc_shm_ring_size must be at least %zu bytes.\n",
+              max_buf_size);
+    }
     /* Append a throwaway header to get its size. */
     buf_hdr_slots_size = append_unit_header(
         NULL /*no TLS yet*/, buf, 0 /*doesn't matter*/, has_tracing_windows() ? 0 : -1);
@@ -40,6 +40,7 @@
 #include "instru.h"
 #include "../common/options.h"
 #include "../common/named_pipe.h"
+#include "../common/shm_ring.h"
 #ifdef HAS_SNAPPY
 #    include <snappy.h>
 #    include "snappy_file_writer.h"
@@ -58,13 +59,17 @@ namespace dynamorio {
 namespace drmemtrace {
 
 extern named_pipe_t ipc_pipe;
+extern shm_rings_t ipc_shm;
 // A clean exit via dr_exit_process() is not supported from init code, but
-// we do want to at least close the pipe file.
+// we do want to at least close the pipe file or let the reader of the
+// -ipc_shm region know we are gone.
 #define FATAL(...)                       \
     do {                                 \
         dr_fprintf(STDERR, __VA_ARGS__); \
-        if (!op_offline.get_value())     \
+        if (!op_offline.get_value()) {   \
             ipc_pipe.close();            \
+            ipc_shm.detach();            \
+        }                                \
         dr_abort();                      \
     } while (0)
 
@@ -76,9 +81,13 @@ typedef struct {
     uint64 num_writeouts; /* Buffer writeout instances. */
     uint64 bytes_written;
     uint64 cur_window_instr_count;
+    /* For -ipc_shm: this thread's ring, or -1 before it first writes. */
+    int shm_ring;
     /* For offline traces */
     file_t file;
     size_t init_header_size;
+    /* For -async_writers: buffers queued for a writer but not yet written. */
+    volatile int num_async_pending;
     /* For file_ops_func.handoff_buf */
     uint num_buffers;
     byte *reserve_buf;
@@ -46,6 +46,8 @@
  *                    Uses nudge to notify a child process being terminated
  *                    by its parent, so that the exit event will be called.
  * -logdir <dir>      Sets log directory, which by default is ".".
+ * -hit_counts        Counts executions of each basic block.
+ * -snapshot_ms <ms>  Writes a coverage snapshot every <ms> milliseconds.
  */
 
 #include "dr_api.h"
@@ -150,6 +152,15 @@ options_init(client_id_t id, int argc, const char *argv[], drcovlib_options_t *o
                 ops->native_until_thread = 0;
                 USAGE_CHECK(false, "invalid -native_until_thread number");
             }
+        } else if (strcmp(token, "-hit_counts") == 0)
+            ops->flags |= DRCOVLIB_HIT_COUNTS;
+        else if (strcmp(token, "-snapshot_ms") == 0) {
+            USAGE_CHECK((i + 1) < argc, "missing -snapshot_ms number");
+            token = argv[++i];
+            if (dr_sscanf(token, "%u", &ops->snapshot_interval_ms) != 1) {
+                ops->snapshot_interval_ms = 0;
+                USAGE_CHECK(false, "invalid -snapshot_ms number");
+            }
         } else if (strcmp(token, "-verbose") == 0) {
             /* XXX: should drcovlib expose its internal verbose param? */
             USAGE_CHECK((i + 1) < argc, "missing -verbose number");
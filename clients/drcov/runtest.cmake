@@ -36,6 +36,10 @@
 #     should have intra-arg space=@@ and inter-arg space=@ and ;=!
 # * cmp = file containing output to compare app output to, to ensure app ran correctly
 # * postcmd = post processing command to run
+#
+# If cmd passes -hit_counts, the log must also hold a hit count for each block,
+# some of them large.  If it passes -snapshot_ms, at least one snapshot must be
+# written and must be readable by postcmd.
 
 # Intra-arg space=@@ and inter-arg space=@.
 # XXX i#1327: now that we have -c and other option passing improvements we
@@ -63,8 +67,70 @@ string(REGEX REPLACE "\\.[^.]+$" "" test_name ${test_name})
 string(REGEX REPLACE "^.+\\.([^.]+)$" "\\1" test_name ${test_name})
 
 FILE(GLOB drcov_logs "drcov.*${test_name}*.log")
+FILE(GLOB drcov_snaps "drcov.*${test_name}*.snap")
 set(cov_file "coverage.${test_name}")
 
+if ("${cmd}" MATCHES "-hit_counts")
+  foreach(logfile ${drcov_logs})
+    file(STRINGS ${logfile} headers REGEX "^BB (Table|Hit Counts): [0-9]+ bbs$")
+    if (NOT "${headers}" MATCHES "^BB Table: ([0-9]+) bbs;BB Hit Counts: ([0-9]+) bbs$"
+        OR NOT "${CMAKE_MATCH_1}" STREQUAL "${CMAKE_MATCH_2}")
+      message(FATAL_ERROR "${logfile} has no hit count per block: ${headers}")
+    endif ()
+    set(num_bbs ${CMAKE_MATCH_1})
+    # The counts follow the "BB Hit Counts: <n> bbs\n" line as 64-bit
+    # little-endian values.  A loop in the app must have run some block at least
+    # 256 times, i.e., with a non-zero byte above the lowest one.
+    file(READ ${logfile} log_hex HEX)
+    string(REGEX MATCH "42422048697420436f756e74733a20(3[0-9])+206262730a"
+      count_header "${log_hex}")
+    string(FIND "${log_hex}" "${count_header}" count_start)
+    string(LENGTH "${count_header}" count_header_len)
+    math(EXPR count_start "${count_start} + ${count_header_len}")
+    set(found_hot OFF)
+    set(idx 0)
+    while (idx LESS num_bbs AND NOT found_hot)
+      math(EXPR offs "${count_start} + ${idx} * 16 + 2")
+      string(SUBSTRING "${log_hex}" ${offs} 14 high_bytes)
+      if (NOT "${high_bytes}" STREQUAL "00000000000000")
+        set(found_hot ON)
+      endif ()
+      math(EXPR idx "${idx} + 1")
+    endwhile ()
+    if (NOT found_hot)
+      message(FATAL_ERROR "${logfile} has no block hit count of 256 or more")
+    endif ()
+  endforeach(logfile)
+endif ()
+
+if ("${cmd}" MATCHES "-snapshot_ms")
+  # Each snapshot replaces the previous one: there is one file per log file.
+  list(LENGTH drcov_snaps num_snaps)
+  list(LENGTH drcov_logs num_logs)
+  if (NOT num_snaps EQUAL num_logs)
+    message(FATAL_ERROR "expected one snapshot per log, found: ${drcov_snaps}")
+  endif ()
+  FILE(GLOB drcov_snap_tmps "drcov.*${test_name}*.snap.tmp")
+  if (drcov_snap_tmps)
+    message(FATAL_ERROR "temporary snapshot left behind: ${drcov_snap_tmps}")
+  endif ()
+  # The snapshot must convert like the log.
+  list(GET drcov_snaps -1 last_snap)
+  execute_process(COMMAND ${postcmd}
+    -input      ${last_snap}
+    -mod_filter ${test_name}
+    -src_filter ${test_name}
+    -output     ${cov_file}
+    RESULT_VARIABLE cmd_result
+    ERROR_VARIABLE cmd_err
+    OUTPUT_VARIABLE cmd_out)
+  if (cmd_result)
+    message(FATAL_ERROR "*** ${postcmd} failed on ${last_snap} (${cmd_result}): "
+      "${cmd_err} ${cmd_out}***\n")
+  endif (cmd_result)
+  file(REMOVE ${cov_file})
+endif ()
+
 file(READ ${cmp} expect)
 if (WIN32)
   # our test prep turned \n into \r?\n so revert
@@ -86,7 +152,7 @@ endif (cmd_result)
 file(READ ${cov_file} cov_out)
 
 # cleanup
-foreach(logfile ${drcov_logs})
+foreach(logfile ${drcov_logs} ${drcov_snaps})
   file(REMOVE ${logfile})
 endforeach(logfile)
 file(REMOVE ${cov_file})
@@ -206,6 +206,8 @@ dump_emitted_routines(dcontext_t *dcontext, file_t file, const char *code_descri
                 print_file(file, "fcache_return_coarse:\n");
             else if (last_pc == code->trace_head_return_coarse)
                 print_file(file, "trace_head_return_coarse:\n");
+            else if (last_pc == code->trace_head_gate_return)
+                print_file(file, "trace_head_gate_return:\n");
             else if (last_pc == code->special_ibl_xfer[CLIENT_IBL_IDX])
                 print_file(file, "client_ibl_xfer:\n");
 #    ifdef UNIX
@@ -340,6 +342,11 @@ shared_gencode_emit(generated_code_t *gencode _IF_X86_64(bool x86_mode))
         gencode->trace_head_return_coarse = pc;
         pc = emit_trace_head_return_coarse(GLOBAL_DCONTEXT, gencode, pc);
     }
+    if (DYNAMO_OPTION(inline_trace_head_counters) IF_X86_64(&&!x86_mode)) {
+        pc = check_size_and_cache_line(isa_mode, gencode, pc);
+        gencode->trace_head_gate_return = pc;
+        pc = emit_trace_head_gate_return(GLOBAL_DCONTEXT, gencode, pc);
+    }
 #ifdef WINDOWS_PC_SAMPLE
     gencode->fcache_enter_return_end = pc;
 #endif
@@ -2004,6 +2011,17 @@ cache_pc trace_head_return_coarse_routine(IF_X86_64_ELSE(gencode_mode_t mode, vo
         return (cache_pc)code->trace_head_return_coarse;
 }
 
+cache_pc
+trace_head_gate_return_routine(void)
+{
+    generated_code_t *code = get_shared_gencode(GLOBAL_DCONTEXT _IF_X86_64(GENCODE_X64));
+    ASSERT(DYNAMO_OPTION(inline_trace_head_counters));
+    if (code == NULL)
+        return NULL;
+    else
+        return (cache_pc)code->trace_head_gate_return;
+}
+
 cache_pc
 get_clean_call_save(dcontext_t *dcontext _IF_X86_64(gencode_mode_t mode))
 {
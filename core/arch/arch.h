@@ -1009,6 +1009,10 @@ typedef struct _generated_code_t {
     byte *fcache_return_coarse;
     byte *fcache_return_coarse_end;
     byte *trace_head_return_coarse;
+    /* -inline_trace_head_counters: where a trace head gate goes once its head is
+     * hot, with the head's tag in DIRECT_STUB_SPILL_SLOT.
+     */
+    byte *trace_head_gate_return;
     /* special ibl xfer */
     byte *special_ibl_xfer[NUM_SPECIAL_IBL_XFERS];
     uint special_ibl_unlink_offs[NUM_SPECIAL_IBL_XFERS];
@@ -1062,6 +1066,12 @@ emit_trace_head_return_coarse(dcontext_t *dcontext, generated_code_t *code, byte
 cache_pc fcache_return_coarse_routine(IF_X86_64(gencode_mode_t mode));
 cache_pc trace_head_return_coarse_routine(IF_X86_64(gencode_mode_t mode));
 
+/* -inline_trace_head_counters generated code */
+byte *
+emit_trace_head_gate_return(dcontext_t *dcontext, generated_code_t *code, byte *pc);
+cache_pc
+trace_head_gate_return_routine(void);
+
 /* shared clean call context switch */
 bool
 client_clean_call_is_thread_private();
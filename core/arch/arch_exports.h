@@ -1168,6 +1168,11 @@ void
 link_indirect_exit(dcontext_t *dcontext, fragment_t *f, linkstub_t *l, bool hot_patch);
 void
 unlink_indirect_exit(dcontext_t *dcontext, fragment_t *f, linkstub_t *l);
+#if defined(X86) && defined(X64)
+byte *
+emit_trace_head_gate(dcontext_t *dcontext, byte *pc, uint *counter, uint reset_value,
+                     cache_pc target, app_pc tag);
+#endif
 void
 insert_fragment_prefix(dcontext_t *dcontext, fragment_t *f);
 int
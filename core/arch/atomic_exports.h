@@ -186,6 +186,7 @@
 #        define ATOMIC_COMPARE_EXCHANGE_PTR ATOMIC_COMPARE_EXCHANGE_int
 #    endif
 #    define MEMORY_STORE_BARRIER()       /* not needed on x86 */
+#    define MEMORY_LOAD_BARRIER()        /* not needed on x86 */
 #    define SPINLOCK_PAUSE() _mm_pause() /* PAUSE = 0xf3 0x90 = repz nop */
 #    define SERIALIZE_INSTRUCTIONS()     \
         do {                             \
@@ -378,6 +379,7 @@ atomic_add_exchange_int64(volatile int64 *var, int64 value)
                              : "0"(newval), "m"(var))
 
 #        define MEMORY_STORE_BARRIER() /* not needed on x86 */
+#        define MEMORY_LOAD_BARRIER()  /* not needed on x86 */
 #        define SPINLOCK_PAUSE() __asm__ __volatile__("pause")
 #        define SERIALIZE_INSTRUCTIONS()                   \
             __asm__ __volatile__("xor %%eax, %%eax; cpuid" \
@@ -552,7 +554,8 @@ DEF_ATOMIC_incdec(ATOMIC_INC_int, int, "w", "add") DEF_ATOMIC_incdec(ATOMIC_INC_
     return ret;
 }
 
-#        define MEMORY_STORE_BARRIER() __asm__ __volatile__("dmb st")
+#        define MEMORY_STORE_BARRIER() __asm__ __volatile__("dmb st" ::: "memory")
+#        define MEMORY_LOAD_BARRIER() __asm__ __volatile__("dmb ishld" ::: "memory")
 /* i#4719: QEMU crashes on "wfi" so we use the superset "wfe".
  * XXX: Consider issuing "sev" on lock release?
  */
@@ -712,7 +715,9 @@ atomic_dec_becomes_zero(volatile int *var)
                                  : "r"(newval)                  \
                                  : "cc", "memory", "r2", "r3");
 
-#        define MEMORY_STORE_BARRIER() __asm__ __volatile__("dmb st")
+#        define MEMORY_STORE_BARRIER() __asm__ __volatile__("dmb st" ::: "memory")
+/* ARMv7 has no load-only dmb. */
+#        define MEMORY_LOAD_BARRIER() __asm__ __volatile__("dmb ish" ::: "memory")
 /* QEMU crashes on "wfi" so we use the superset "wfe".
  * XXX: Consider issuing "sev" on lock release?
  */
@@ -993,7 +998,9 @@ atomic_exchange_int(volatile int *var, int newval)
 }
 
 /* Ensure no store reordering for normal memory writes. */
-#        define MEMORY_STORE_BARRIER() __asm__ __volatile__("fence w,w")
+#        define MEMORY_STORE_BARRIER() __asm__ __volatile__("fence w,w" ::: "memory")
+/* Ensure no load reordering for normal memory reads. */
+#        define MEMORY_LOAD_BARRIER() __asm__ __volatile__("fence r,r" ::: "memory")
 
 /* Insert pause hint directly to be compatible with old compilers. This
  * will work even on platforms without Zihintpause extension because this
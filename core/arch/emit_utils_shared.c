@@ -447,6 +447,18 @@ link_direct_exit(dcontext_t *dcontext, fragment_t *f, linkstub_t *l, fragment_t
     }
 #endif
 
+    /* -inline_trace_head_counters: go through the head's counting gate */
+    if (DYNAMO_OPTION(inline_trace_head_counters)) {
+        cache_pc gate = trace_head_gate_lookup_or_create(dcontext, f, l, targetf);
+        if (gate != NULL && exit_cti_reaches_target(dcontext, f, l, gate)) {
+            LOG(THREAD, LOG_LINKS, 4,
+                "\tlinking F%d." PFX " to gate " PFX " b/c F%d is trace head\n", f->id,
+                EXIT_CTI_PC(f, l), gate, targetf->id);
+            patch_branch(FRAG_ISA_MODE(f->flags), EXIT_CTI_PC(f, l), gate, hot_patch);
+            return true; /* do not need stub anymore */
+        }
+    }
+
     /* change jmp target to point to the passed-in target */
     if (exit_cti_reaches_target(dcontext, f, l, (cache_pc)FCACHE_ENTRY_PC(targetf))) {
         /* TODO i#1911: Patching the exit_cti to point to the linked fragment is
@@ -2730,6 +2742,29 @@ emit_trace_head_return_coarse(dcontext_t *dcontext, generated_code_t *code, byte
     return pc;
 }
 
+byte *
+emit_trace_head_gate_return(dcontext_t *dcontext, generated_code_t *code, byte *pc)
+{
+    /* Like trace_head_return_coarse, the app state is intact and the target tag
+     * is in DIRECT_STUB_SPILL_SLOT; only the linkstub differs.
+     */
+    bool instr_targets;
+    linkstub_t *linkstub = (linkstub_t *)get_trace_head_gate_exit_linkstub();
+    instrlist_t ilist;
+    instrlist_init(&ilist);
+    instr_targets = append_fcache_return_common(
+        dcontext, code, &ilist, false /*!ibl_end*/, false /*through xdi*/,
+        true /*shared*/, linkstub, false /*no coarse info*/);
+    /* now encode the instructions */
+    pc = instrlist_encode_to_copy(dcontext, &ilist, vmcode_get_writable_addr(pc), pc,
+                                  NULL, instr_targets);
+    ASSERT(pc != NULL);
+    pc = vmcode_get_executable_addr(pc);
+    /* free the instrlist_t elements */
+    instrlist_clear(dcontext, &ilist);
+    return pc;
+}
+
 /* Our coarse entrance stubs have several advantages, such as eliminating
  * future fragments, but their accompanying lazy linking does need source
  * information that is not available in each stub.  We instead have an
@@ -975,6 +975,70 @@ coarse_is_entrance_stub(cache_pc stub)
     return res;
 }
 
+/*******************************************************************************
+ * TRACE HEAD GATES
+ */
+
+#ifdef X64
+/* Emits the -inline_trace_head_counters gate for the trace head with the given
+ * tag and cache entry target.  Only xcx is used and the flags are untouched:
+ *
+ *     mov  %xcx, MANGLE_XCX_SPILL_SLOT
+ *     mov  counter(%rip), %ecx
+ *     jecxz hot
+ *     lea  -1(%rcx), %ecx
+ *     mov  %ecx, counter(%rip)
+ *     mov  MANGLE_XCX_SPILL_SLOT, %xcx
+ *     jmp  target
+ *   hot:
+ *     movl $reset_value, counter(%rip)
+ *     mov  $tag, %xcx
+ *     mov  %xcx, DIRECT_STUB_SPILL_SLOT
+ *     mov  MANGLE_XCX_SPILL_SLOT, %xcx
+ *     jmp  trace_head_gate_return
+ *
+ * The counter lives in reachable heap rather than next to the code.
+ */
+byte *
+emit_trace_head_gate(dcontext_t *dcontext, byte *pc, uint *counter, uint reset_value,
+                     cache_pc target, app_pc tag)
+{
+    instrlist_t ilist;
+    instr_t *hot = INSTR_CREATE_label(dcontext);
+    instrlist_init(&ilist);
+    APP(&ilist, SAVE_TO_TLS(dcontext, REG_XCX, MANGLE_XCX_SPILL_SLOT));
+    APP(&ilist,
+        XINST_CREATE_load(dcontext, opnd_create_reg(REG_ECX),
+                          opnd_create_rel_addr(counter, OPSZ_4)));
+    APP(&ilist, INSTR_CREATE_jecxz(dcontext, opnd_create_instr(hot)));
+    APP(&ilist,
+        INSTR_CREATE_lea(dcontext, opnd_create_reg(REG_ECX),
+                         opnd_create_base_disp(REG_XCX, REG_NULL, 0, -1, OPSZ_lea)));
+    APP(&ilist,
+        XINST_CREATE_store(dcontext, opnd_create_rel_addr(counter, OPSZ_4),
+                           opnd_create_reg(REG_ECX)));
+    APP(&ilist, RESTORE_FROM_TLS(dcontext, REG_XCX, MANGLE_XCX_SPILL_SLOT));
+    APP(&ilist, XINST_CREATE_jump(dcontext, opnd_create_pc(target)));
+    APP(&ilist, hot);
+    APP(&ilist,
+        XINST_CREATE_store(dcontext, opnd_create_rel_addr(counter, OPSZ_4),
+                           OPND_CREATE_INT32(reset_value)));
+    APP(&ilist,
+        XINST_CREATE_load_int(dcontext, opnd_create_reg(REG_XCX),
+                              OPND_CREATE_INTPTR((ptr_int_t)tag)));
+    APP(&ilist, SAVE_TO_TLS(dcontext, REG_XCX, DIRECT_STUB_SPILL_SLOT));
+    APP(&ilist, RESTORE_FROM_TLS(dcontext, REG_XCX, MANGLE_XCX_SPILL_SLOT));
+    APP(&ilist,
+        XINST_CREATE_jump(dcontext, opnd_create_pc(trace_head_gate_return_routine())));
+    pc = instrlist_encode_to_copy(dcontext, &ilist, vmcode_get_writable_addr(pc), pc,
+                                  NULL, true /*instr targets*/);
+    ASSERT(pc != NULL);
+    pc = vmcode_get_executable_addr(pc);
+    instrlist_clear(dcontext, &ilist);
+    return pc;
+}
+#endif /* X64 */
+
 /*###########################################################################
  *
  * fragment_t Prefixes
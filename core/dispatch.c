@@ -1503,6 +1503,10 @@ dispatch_exit_fcache_stats(dcontext_t *dcontext)
             "Exit from sourceless coarse-grain fragment targeting trace head");
         /* FIXME: this stat is not mutually exclusive of reason-for-exit stats */
         STATS_INC(num_exits_coarse_trace_head);
+    } else if (dcontext->last_exit == get_trace_head_gate_exit_linkstub()) {
+        LOG(THREAD, LOG_DISPATCH, 2, "Exit from trace head gate");
+        /* FIXME: this stat is not mutually exclusive of reason-for-exit stats */
+        STATS_INC(num_exits_trace_head_gate);
     } else {
         LOG(THREAD, LOG_DISPATCH, 2, "Exit from F%d(" PFX ")." PFX, last_f->id,
             last_f->tag, EXIT_CTI_PC(dcontext->last_fragment, dcontext->last_exit));
@@ -1654,7 +1658,8 @@ dispatch_exit_fcache_stats(dcontext_t *dcontext)
 #    endif   /* RETURN_AFTER_CALL */
     } else { /* DIRECT LINK */
         ASSERT(LINKSTUB_DIRECT(dcontext->last_exit->flags) ||
-               IS_COARSE_LINKSTUB(dcontext->last_exit));
+               IS_COARSE_LINKSTUB(dcontext->last_exit) ||
+               dcontext->last_exit == get_trace_head_gate_exit_linkstub());
 
         if (exited_due_to_ni_syscall(dcontext)) {
             LOG(THREAD, LOG_DISPATCH, 2, " (block ends with syscall)");
@@ -1687,6 +1692,8 @@ dispatch_exit_fcache_stats(dcontext_t *dcontext)
 #    ifdef DEBUG
         else if (IS_COARSE_LINKSTUB(dcontext->last_exit)) {
             LOG(THREAD, LOG_DISPATCH, 2, " (not lazily linked yet)");
+        } else if (dcontext->last_exit == get_trace_head_gate_exit_linkstub()) {
+            LOG(THREAD, LOG_DISPATCH, 2, " (trace head F%d now hot)", next_f->id);
         } else if (!is_linkable(dcontext, dcontext->last_fragment, dcontext->last_exit,
                                 next_f, false /*don't own link lock*/,
                                 false /*do not change trace head state*/)) {
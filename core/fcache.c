@@ -522,6 +522,7 @@ typedef struct _fcache {
     uint free_stats_coalesced[FREE_LIST_SIZES_NUM]; /* occurrences */
     uint free_stats_split[FREE_LIST_SIZES_NUM];     /* entry split, occurrences */
     uint free_stats_charge[FREE_LIST_SIZES_NUM];    /* bytes on free list */
+    uint free_stats_largest;                        /* largest entry, bytes */
     /* sizes of real requests and frees */
     uint request_size_histogram[HISTOGRAM_MAX_SIZE / HISTOGRAM_GRANULARITY];
     uint free_size_histogram[HISTOGRAM_MAX_SIZE / HISTOGRAM_GRANULARITY];
@@ -662,6 +663,26 @@ DECLARE_FREQPROT_VAR(uint reset_every_nth_unit[CACHE_NUM_TYPES],
             STATS_MAX(fcache_bb_##stat1, fcache_bb_##stat2);                         \
     })
 
+/* Only for stats that are updated while holding the cache lock. */
+#define STATS_FCACHE_SET(cache, stat, val)                  \
+    DOSTATS({                                               \
+        if (cache->is_shared) {                             \
+            if (cache->is_trace) {                          \
+                STATS_RESET(fcache_shared_trace_##stat);    \
+                STATS_ADD(fcache_shared_trace_##stat, val); \
+            } else {                                        \
+                STATS_RESET(fcache_shared_bb_##stat);       \
+                STATS_ADD(fcache_shared_bb_##stat, val);    \
+            }                                               \
+        } else if (cache->is_trace) {                       \
+            STATS_RESET(fcache_trace_##stat);               \
+            STATS_ADD(fcache_trace_##stat, val);            \
+        } else {                                            \
+            STATS_RESET(fcache_bb_##stat);                  \
+            STATS_ADD(fcache_bb_##stat, val);               \
+        }                                                   \
+    })
+
 #ifdef DEBUG
 /* forward decl */
 #    ifdef INTERNAL
@@ -1615,6 +1636,7 @@ fcache_cache_init(dcontext_t *dcontext, uint flags, bool initial_unit)
             memset(cache->free_stats_coalesced, 0, sizeof(cache->free_stats_coalesced));
             memset(cache->free_stats_charge, 0, sizeof(cache->free_stats_charge));
             memset(cache->free_stats_split, 0, sizeof(cache->free_stats_split));
+            cache->free_stats_largest = 0;
             memset(cache->request_size_histogram, 0,
                    sizeof(cache->request_size_histogram));
             memset(cache->free_size_histogram, 0, sizeof(cache->free_size_histogram));
@@ -1662,6 +1684,21 @@ fcache_cache_free(dcontext_t *dcontext, fcache_t *cache, bool free_units)
     /* we must use pre-cached cache_size since fcache_free_unit decrements it */
     ASSERT(size_check == cache_size);
     ASSERT(cache->size == 0);
+    DOSTATS({
+        if (USE_FREE_LIST_FOR_CACHE(cache)) {
+            /* any free list entries went away with the units */
+            int bucket;
+            for (bucket = 0; bucket < FREE_LIST_SIZES_NUM; bucket++) {
+                STATS_FCACHE_SUB(cache, free_entries,
+                                 cache->free_stats_freed[bucket] -
+                                     (cache->free_stats_reused[bucket] +
+                                      cache->free_stats_coalesced[bucket]));
+                STATS_FCACHE_SUB(cache, free_bytes, cache->free_stats_charge[bucket]);
+            }
+            STATS_FCACHE_SET(cache, free_largest, 0);
+            STATS_FCACHE_SET(cache, free_fragmented, 0);
+        }
+    });
 
     if (cache->is_shared)
         DELETE_LOCK(cache->lock);
@@ -1690,9 +1727,8 @@ fcache_free_list_consistency(dcontext_t *dcontext, fcache_t *cache, int bucket)
         ASSERT(size >= FREE_LIST_SIZES[bucket] && size <= MAX_FREE_ENTRY_SIZE &&
                (bucket == FREE_LIST_SIZES_NUM - 1 || size < FREE_LIST_SIZES[bucket + 1]));
 
-        /* FIXME: should ASSERT entries in a bucket are all sorted
-         * properly, when we start keeping them in order */
-        ASSERT(prev_size < size || true /* not sorted yet */);
+        /* entries in a bucket are kept sorted by size (case 7318) */
+        ASSERT(prev_size <= size);
         prev_size = size;
         ASSERT(header->next == NULL || header->next->prev == header);
         ASSERT(header->prev == NULL || header->prev->next == header);
@@ -1791,6 +1827,27 @@ fcache_cache_stats(dcontext_t *dcontext, fcache_t *cache)
             }
         });
 
+        DOLOG(1, LOG_CACHE, {
+            /* the same figures are kept live in the fcache_*_free_* stats */
+            uint entries = 0;
+            size_t free_bytes = 0;
+            for (bucket = 0; bucket < FREE_LIST_SIZES_NUM; bucket++) {
+                entries += cache->free_stats_freed[bucket] -
+                    (cache->free_stats_reused[bucket] +
+                     cache->free_stats_coalesced[bucket]);
+                free_bytes += cache->free_stats_charge[bucket];
+            }
+            LOG(GLOBAL, LOG_CACHE, 1,
+                "fcache %s free space: %d entries, " SZFMT " bytes (%d%% of used), "
+                "largest %d bytes, %d%% fragmented\n",
+                cache->name, entries, free_bytes,
+                used == 0 ? 0 : (int)(free_bytes * 100 / used),
+                cache->free_stats_largest,
+                free_bytes == 0
+                    ? 0
+                    : (int)(100 - (cache->free_stats_largest * 100 / free_bytes)));
+        });
+
         LOG(GLOBAL, LOG_ALL, 1, "fcache %s requests and frees histogram:\n", cache->name);
         for (bucket = 0; bucket < sizeof(cache->request_size_histogram) /
                  sizeof(cache->request_size_histogram[0]);
@@ -2956,6 +3013,48 @@ free_list_header_from_footer(free_list_footer_t *h)
     return (free_list_header_t *)(((cache_pc)h) + sizeof(free_list_footer_t) - h->size);
 }
 
+#ifdef DEBUG
+/* Keeps the free space stats current after an entry of size bytes has been added
+ * to or removed from cache's free lists.  Fragmentation is the share of free space
+ * that a request the size of the largest entry could not use.
+ */
+static void
+free_list_update_stats(fcache_t *cache, uint size, bool added)
+{
+    size_t free_bytes = 0;
+    int bucket;
+    if (added) {
+        STATS_FCACHE_ADD(cache, free_entries, 1);
+        STATS_FCACHE_ADD(cache, free_bytes, size);
+        STATS_FCACHE_MAX(cache, free_bytes_peak, free_bytes);
+        if (size > cache->free_stats_largest)
+            cache->free_stats_largest = size;
+    } else {
+        STATS_FCACHE_SUB(cache, free_entries, 1);
+        STATS_FCACHE_SUB(cache, free_bytes, size);
+        if (size == cache->free_stats_largest) {
+            /* Buckets are sorted, so the largest entry is the last one in the
+             * highest non-empty bucket.
+             */
+            free_list_header_t *header = NULL;
+            for (bucket = FREE_LIST_SIZES_NUM - 1; bucket >= 0 && header == NULL;
+                 bucket--)
+                header = cache->free_list[bucket];
+            cache->free_stats_largest = 0;
+            for (; header != NULL; header = header->next)
+                cache->free_stats_largest = header->size;
+        }
+    }
+    for (bucket = 0; bucket < FREE_LIST_SIZES_NUM; bucket++)
+        free_bytes += cache->free_stats_charge[bucket];
+    STATS_FCACHE_SET(cache, free_largest, cache->free_stats_largest);
+    STATS_FCACHE_SET(cache, free_fragmented,
+                     free_bytes == 0
+                         ? 0
+                         : 100 - (cache->free_stats_largest * 100 / free_bytes));
+}
+#endif
+
 static inline void
 remove_from_free_list(fcache_t *cache, uint bucket,
                       free_list_header_t *header _IF_DEBUG(bool coalesce))
@@ -2985,6 +3084,7 @@ remove_from_free_list(fcache_t *cache, uint bucket,
         else
             cache->free_stats_reused[bucket]++;
         cache->free_stats_charge[bucket] -= header->size;
+        free_list_update_stats(cache, header->size, false /*removed*/);
     });
 }
 
@@ -3122,28 +3222,41 @@ add_to_free_list(dcontext_t *dcontext, fcache_t *cache, fcache_unit_t *unit,
 
     bucket = find_free_list_bucket(size);
 
+    /* Case 7318: keep each bucket sorted by size, so the first large enough
+     * entry find_free_list_slot() comes across is also the best fit.
+     */
+    free_list_header_t *prev = NULL, *next = cache->free_list[bucket];
+    while (next != NULL && next->size < size) {
+        prev = next;
+        next = next->next;
+    }
     free_list_header_t *header_writable =
         (free_list_header_t *)vmcode_get_writable_addr((byte *)header);
-    header_writable->next = cache->free_list[bucket];
-    header_writable->prev = NULL;
+    header_writable->next = next;
+    header_writable->prev = prev;
     header_writable->size = size;
     header_writable->flags = FRAG_FAKE | FRAG_FCACHE_FREE_LIST;
     free_list_footer_t *footer_writable = free_list_footer_from_header(header_writable);
     footer_writable->size = size;
-    if (cache->free_list[bucket] != NULL) {
-        ASSERT(cache->free_list[bucket]->prev == NULL);
-        free_list_header_t *list_writable =
-            (free_list_header_t *)vmcode_get_writable_addr(
-                (byte *)cache->free_list[bucket]);
-        list_writable->prev = header;
+    if (next != NULL) {
+        free_list_header_t *next_writable =
+            (free_list_header_t *)vmcode_get_writable_addr((byte *)next);
+        next_writable->prev = header;
+    }
+    if (prev != NULL) {
+        free_list_header_t *prev_writable =
+            (free_list_header_t *)vmcode_get_writable_addr((byte *)prev);
+        prev_writable->next = header;
+    } else {
+        ASSERT(next == NULL || next == cache->free_list[bucket]);
+        cache->free_list[bucket] = header;
     }
-    cache->free_list[bucket] = header;
-    /* FIXME: case 7318 we should keep sorted */
 
     DOSTATS({
         /* FIXME: we could split freed into pure-freed, split-freed, and coalesce-freed */
         cache->free_stats_freed[bucket]++;
         cache->free_stats_charge[bucket] += size;
+        free_list_update_stats(cache, size, true /*added*/);
         LOG(GLOBAL, LOG_CACHE, 4, "add_to_free_list: %s bucket[%d] %d bytes @" PFX "\n",
             cache->name, bucket, size, start_pc);
         /* assumption: caller has already adjusted cache's empty space stats */
@@ -3189,9 +3302,8 @@ find_free_list_slot(dcontext_t *dcontext, fcache_t *cache, fragment_t *f, uint s
          * finish immediately */
         header = cache->free_list[bucket];
 
+        /* buckets are sorted, so the first large enough entry is the best fit */
         while (header != NULL && header->size < size) {
-            /* FIXME: if we keep the list sorted, we'd not waste too
-             * much space by picking the first large enough slot */
             /* FIXME: if we want to coalesce here we can act on any
              * fragment while walking list and make sure that it is
              * coalesced */
@@ -3694,6 +3806,39 @@ fcache_add_fragment(dcontext_t *dcontext, fragment_t *f)
     PROTECT_CACHE(cache, unlock);
 }
 
+/* Releases unit, via the dead unit list, if it is a full unit other than the
+ * current one and a single free list entry now spans all of it.  Otherwise a
+ * shared cache whose fragments are deleted can only recycle its slots and
+ * never shrinks.
+ */
+static void
+free_list_release_empty_unit(dcontext_t *dcontext, fcache_t *cache,
+                             fcache_unit_t *unit)
+{
+    free_list_header_t *header = (free_list_header_t *)unit->start_pc;
+    fcache_unit_t *u, *prev = NULL;
+    ASSERT(CACHE_PROTECTED(cache));
+    ASSERT(USE_FREE_LIST_FOR_CACHE(cache));
+    if (!DYNAMO_OPTION(cache_shared_free_empty_units) || dynamo_resetting ||
+        dynamo_exited || unit == cache->units || !unit->full ||
+        !FRAG_IS_FREE_LIST(*(fragment_t **)unit->start_pc) ||
+        header->size != (uint)(unit->cur_pc - unit->start_pc))
+        return;
+    /* A unit marked for flushing is off the list but may still be walked. */
+    for (u = cache->units; u != NULL && u != unit; prev = u, u = u->next_local)
+        ; /* nothing */
+    if (u == NULL)
+        return;
+    ASSERT(prev != NULL);
+    LOG(THREAD, LOG_CACHE, 2, "releasing empty %s unit " PFX "-" PFX "\n", cache->name,
+        unit->start_pc, unit->end_pc);
+    remove_from_free_list(cache, find_free_list_bucket(header->size),
+                          header _IF_DEBUG(false /*!coalesce*/));
+    prev->next_local = unit->next_local;
+    STATS_FCACHE_ADD(cache, free_unit_released, 1);
+    fcache_free_unit(dcontext, unit, true /*dealloc or reuse*/);
+}
+
 void
 fcache_remove_fragment(dcontext_t *dcontext, fragment_t *f)
 {
@@ -3731,7 +3876,9 @@ fcache_remove_fragment(dcontext_t *dcontext, fragment_t *f)
         if (USE_FIFO(f)) {
             fifo_remove(dcontext, cache, f);
             DOLOG(3, LOG_CACHE, { verify_fifo(dcontext, cache); });
-        }
+        } else if (DYNAMO_OPTION(cache_shared_free_list) &&
+                   USE_FREE_LIST_FOR_CACHE(cache))
+            free_list_release_empty_unit(dcontext, cache, unit);
     }
     PROTECT_CACHE(cache, unlock);
 }
@@ -4683,3 +4830,154 @@ fcache_coarse_set_info(dcontext_t *dcontext, coarse_info_t *info)
     cache = (fcache_t *)info->cache;
     cache->coarse_info = info;
 }
+
+#ifdef STANDALONE_UNIT_TEST
+/* A shared bb with a single exit whose stub is kept elsewhere, so removing it
+ * needs nothing beyond the fragment_t.
+ */
+typedef struct _test_fragment_t {
+    fragment_t f;
+    linkstub_t l;
+} test_fragment_t;
+
+#    define TEST_SEP_SLOT 48
+#    define TEST_FILL_SLOT 1024
+#    define TEST_NUM_FRAGS 128
+
+static test_fragment_t test_frags[TEST_NUM_FRAGS];
+
+static void
+test_add_fragment(fcache_t *cache, test_fragment_t *tf, uint slot_size)
+{
+    memset(tf, 0, sizeof(*tf));
+    tf->f.flags = FRAG_SHARED;
+    tf->f.size = (ushort)(slot_size - HEADER_SIZE(&tf->f));
+    tf->f.fcache_extra = (byte)HEADER_SIZE(&tf->f);
+    /* as in fcache_add_fragment, for FRAG_START_PADDING */
+    tf->f.start_pc = (cache_pc)(ptr_uint_t)START_PC_ALIGNMENT;
+    tf->l.flags = LINK_DIRECT | LINK_SEPARATE_STUB | LINK_END_OF_LIST;
+    ASSERT(ALIGNED(slot_size, SLOT_ALIGNMENT(cache)));
+    PROTECT_CACHE(cache, lock);
+    add_fragment_common(GLOBAL_DCONTEXT, cache, &tf->f, slot_size);
+    PROTECT_CACHE(cache, unlock);
+}
+
+static void
+test_remove_fragment(test_fragment_t *tf)
+{
+    /* as for any shared fragment deleted by another thread */
+    tf->f.flags |= FRAG_WAS_DELETED;
+    fcache_remove_fragment(GLOBAL_DCONTEXT, &tf->f);
+    tf->f.start_pc = NULL;
+}
+
+static bool
+test_cache_has_unit(fcache_t *cache, fcache_unit_t *unit)
+{
+    fcache_unit_t *u;
+    for (u = cache->units; u != NULL; u = u->next_local) {
+        if (u == unit)
+            return true;
+    }
+    return false;
+}
+
+/* Case 7318: each free list bucket is sorted so the first fit is the best fit,
+ * and a unit that a single free entry spans is released.
+ */
+static void
+test_free_list_best_fit(void)
+{
+    bool shared_bbs = DYNAMO_OPTION(shared_bbs);
+    bool shared_traces = DYNAMO_OPTION(shared_traces);
+    fcache_t *cache;
+    fcache_unit_t *unit;
+    free_list_header_t *header;
+    cache_pc best_pc;
+    uint bucket = find_free_list_bucket(160);
+    int i, num_frags;
+    print_file(STDERR, "fcache free list best fit test\n");
+    /* The test makes its own shared cache. */
+    dynamo_options.shared_bbs = false;
+    dynamo_options.shared_traces = false;
+    fcache_init();
+    cache = fcache_cache_init(GLOBAL_DCONTEXT, FRAG_SHARED, true /*initial unit*/);
+    /* Grow by adding units, with no working set flushes. */
+    cache->finite_cache = false;
+    cache->max_unit_size = cache->init_unit_size;
+    unit = cache->units;
+
+    /* Three free entries in one bucket, kept apart by live fragments so they
+     * do not coalesce.  They are freed in an order where the old unsorted
+     * lists would have put the largest one first.
+     */
+    test_add_fragment(cache, &test_frags[0], 160);
+    test_add_fragment(cache, &test_frags[1], TEST_SEP_SLOT);
+    test_add_fragment(cache, &test_frags[2], 128);
+    test_add_fragment(cache, &test_frags[3], TEST_SEP_SLOT);
+    test_add_fragment(cache, &test_frags[4], 144);
+    test_add_fragment(cache, &test_frags[5], TEST_SEP_SLOT);
+    EXPECT(find_free_list_bucket(128), bucket);
+    EXPECT(find_free_list_bucket(144), bucket);
+    best_pc = FRAG_HDR_START(&test_frags[4].f);
+    test_remove_fragment(&test_frags[4]);
+    test_remove_fragment(&test_frags[2]);
+    test_remove_fragment(&test_frags[0]);
+    header = cache->free_list[bucket];
+    EXPECT(header->size, 128);
+    EXPECT(header->next->size, 144);
+    EXPECT(header->next->next->size, 160);
+    EXPECT(header->next->next->next == NULL, true);
+    DOSTATS({
+        EXPECT(GLOBAL_STAT(fcache_shared_bb_free_entries), 3);
+        EXPECT(GLOBAL_STAT(fcache_shared_bb_free_bytes), 432);
+        EXPECT(GLOBAL_STAT(fcache_shared_bb_free_largest), 160);
+        EXPECT(GLOBAL_STAT(fcache_shared_bb_free_fragmented), 100 - 16000 / 432);
+    });
+
+    /* Only the 144 and 160 entries fit; the smaller of them is the best fit. */
+    test_add_fragment(cache, &test_frags[6], 136);
+    EXPECT(FRAG_HDR_START(&test_frags[6].f) == best_pc, true);
+    DOSTATS({
+        EXPECT(GLOBAL_STAT(fcache_shared_bb_free_entries), 2);
+        EXPECT(GLOBAL_STAT(fcache_shared_bb_free_bytes), 288);
+        EXPECT(GLOBAL_STAT(fcache_shared_bb_free_largest), 160);
+        EXPECT(GLOBAL_STAT(fcache_shared_bb_free_fragmented), 100 - 16000 / 288);
+    });
+
+    /* Fill the unit until a new one is started, then empty the old one. */
+    for (num_frags = 7; cache->units == unit; num_frags++) {
+        ASSERT(num_frags < TEST_NUM_FRAGS);
+        test_add_fragment(cache, &test_frags[num_frags], TEST_FILL_SLOT);
+    }
+    EXPECT(unit->full, true);
+    for (i = 0; i < num_frags; i++) {
+        if (test_frags[i].f.start_pc != NULL && FIFO_UNIT(&test_frags[i].f) == unit)
+            test_remove_fragment(&test_frags[i]);
+    }
+    EXPECT(test_cache_has_unit(cache, unit), false);
+    DOSTATS({
+        EXPECT(GLOBAL_STAT(fcache_shared_bb_free_unit_released), 1);
+        EXPECT(GLOBAL_STAT(fcache_shared_bb_free_entries), 0);
+        EXPECT(GLOBAL_STAT(fcache_shared_bb_free_bytes), 0);
+        EXPECT(GLOBAL_STAT(fcache_shared_bb_free_largest), 0);
+    });
+
+    for (i = 0; i < num_frags; i++) {
+        if (test_frags[i].f.start_pc != NULL)
+            test_remove_fragment(&test_frags[i]);
+    }
+    /* The lock is not held, as when fcache_exit() frees the shared caches. */
+    DODEBUG({ cache->is_local = true; });
+    fcache_cache_free(GLOBAL_DCONTEXT, cache, true);
+    fcache_exit();
+    dynamo_options.shared_bbs = shared_bbs;
+    dynamo_options.shared_traces = shared_traces;
+}
+
+void
+unit_test_fcache(void)
+{
+    test_free_list_best_fit();
+}
+#endif /* STANDALONE_UNIT_TEST */
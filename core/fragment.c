@@ -2553,6 +2553,14 @@ fragment_free(dcontext_t *dcontext, fragment_t *f)
 
     linkstub_free_exitstubs(dcontext, f);
 
+    /* FRAG_IS_TRACE_HEAD may have been cleared since the gate was created, so we
+     * check the flag set at creation, which also keeps fragments without a gate
+     * off the global gate table lock.
+     */
+    if (DYNAMO_OPTION(inline_trace_head_counters) &&
+        TEST(FRAG_HAS_TRACE_HEAD_GATE, f->flags))
+        trace_head_gate_free(dcontext, f);
+
     if ((f->flags & FRAG_IS_TRACE) != 0) {
         trace_only_t *t = TRACE_FIELDS(f);
         if (t->bbs != NULL) {
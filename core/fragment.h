@@ -144,6 +144,12 @@
 #ifdef LINUX
 #    define FRAG_STARTS_RSEQ_REGION 0x4000000
 #endif
+/* -inline_trace_head_counters: this block may have a trace head gate to free.  Set
+ * on built blocks only (trace heads are never traces), so it does not conflict with
+ * FRAG_TRACE_OUTPUT.  A block that kept FRAG_STARTS_RSEQ_REGION (it is not cleared
+ * when there is no client) just costs a gate table lookup when freed.
+ */
+#define FRAG_HAS_TRACE_HEAD_GATE 0x4000000
 
 #define FRAG_CBR_FALLTHROUGH_SHORT 0x8000000
 
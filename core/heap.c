@@ -264,6 +264,27 @@ typedef struct _thread_heap_t {
      */
     thread_units_t *nonpersistent_heap;
     thread_units_t *reachable_heap; /* Only used if !REACHABLE_HEAP() */
+    /* Each thread keeps a small magazine of free global heap blocks per fixed-size
+     * bucket, refilled from and drained to the global heap in batches under
+     * global_alloc_lock, so most global allocs and frees (including frees of
+     * blocks allocated by other threads) never take the lock.  Blocks are linked
+     * as on a free list.
+     */
+    heap_pc magazine[BLOCK_TYPES - 1];
+    uint magazine_count[BLOCK_TYPES - 1];
+    bool use_magazines;
+    /* Set while this thread is in the middle of a magazine operation, so that a
+     * re-entrant global alloc or free (from our signal handler, or from unit
+     * creation during a refill) takes the locked path instead.
+     */
+    volatile bool magazine_busy;
+#ifdef HEAP_ACCOUNTING
+    /* Charges moved by magazine hits: blocks in a magazine are charged to
+     * ACCT_MEM_MGT.  Per-type values can wrap below zero when another thread frees
+     * what this one allocated.  Added to the global units at thread exit.
+     */
+    heap_acct_t acct;
+#endif
 #ifdef UNIX
     /* Used for -satisfy_w_xor_x. */
     heap_pc fork_copy_start;
@@ -399,7 +420,8 @@ DECLARE_NEVERPROT_VAR(static thread_units_t global_racy_units, { 0 });
             (tu)->acct.type[which] += alloc_sz;                            \
             (tu)->acct.num_alloc[which]++;                                 \
             (tu)->acct.cur_usage[which] += alloc_sz;                       \
-            if ((tu)->acct.cur_usage[which] > (tu)->acct.max_usage[which]) \
+            if ((ptr_int_t)(tu)->acct.cur_usage[which] >                   \
+                (ptr_int_t)(tu)->acct.max_usage[which])                    \
                 (tu)->acct.max_usage[which] = (tu)->acct.cur_usage[which]; \
             if (ask_sz > (tu)->acct.max_single[which])                     \
                 (tu)->acct.max_single[which] = ask_sz;                     \
@@ -780,6 +802,26 @@ report_w_xor_x_fatal_error_and_exit(void)
     ASSERT_NOT_REACHED();
 }
 
+#ifdef LINUX
+/* Asks for huge page backing of the huge-page-aligned part of vmh's reservation. */
+static void
+vmm_heap_advise_huge_pages(vm_heap_t *vmh)
+{
+    heap_pc start = (heap_pc)ALIGN_FORWARD(vmh->start_addr, VMM_HUGE_PAGE_SIZE);
+    heap_pc end = (heap_pc)ALIGN_BACKWARD(vmh->end_addr, VMM_HUGE_PAGE_SIZE);
+    if (start >= end)
+        return;
+    if (os_heap_advise_huge_pages(start, end - start)) {
+        RSTATS_ADD(vmm_huge_page_vsize, end - start);
+        LOG(GLOBAL, LOG_HEAP, 1,
+            "vmm_heap_unit_init %s: huge pages requested for [" PFX "," PFX ")\n",
+            vmh->name, start, end);
+    } else {
+        SYSLOG_INTERNAL_WARNING_ONCE("Transparent huge pages are unavailable");
+    }
+}
+#endif
+
 static void
 vmm_place_vmcode(vm_heap_t *vmh, size_t size, heap_error_code_t *error_code)
 {
@@ -849,6 +891,10 @@ vmm_place_vmcode(vm_heap_t *vmh, size_t size, heap_error_code_t *error_code)
                                        DYNAMO_OPTION(vmm_block_size)) *
                          DYNAMO_OPTION(vmm_block_size));
         preferred = ALIGN_FORWARD(preferred, OS_ALLOC_GRANULARITY);
+#ifdef LINUX
+        if (DYNAMO_OPTION(vmm_huge_pages))
+            preferred = ALIGN_FORWARD(preferred, VMM_HUGE_PAGE_SIZE);
+#endif
         /* overflow check: w/ vm_base shouldn't happen so debug-only check */
         ASSERT(!POINTER_OVERFLOW_ON_ADD(preferred, size));
         /* let's assume a single chunk is sufficient to reserve */
@@ -999,11 +1045,15 @@ vmm_heap_unit_init(vm_heap_t *vmh, size_t size, bool is_vmcode, const char *name
         /* These days every OS provides ASLR, so we do not bother to do our own
          * for this second reservation and rely on the OS.
          */
-        vmh->alloc_size = size + DYNAMO_OPTION(vmm_block_size);
-        vmh->alloc_start = (heap_pc)os_heap_reserve(
-            NULL, size + DYNAMO_OPTION(vmm_block_size), &error_code, false /*-x*/);
-        vmh->start_addr =
-            (heap_pc)ALIGN_FORWARD(vmh->alloc_start, DYNAMO_OPTION(vmm_block_size));
+        size_t align = DYNAMO_OPTION(vmm_block_size);
+#ifdef LINUX
+        if (DYNAMO_OPTION(vmm_huge_pages))
+            align = MAX(align, VMM_HUGE_PAGE_SIZE);
+#endif
+        vmh->alloc_size = size + align;
+        vmh->alloc_start =
+            (heap_pc)os_heap_reserve(NULL, size + align, &error_code, false /*-x*/);
+        vmh->start_addr = (heap_pc)ALIGN_FORWARD(vmh->alloc_start, align);
     }
 
     if (vmh->start_addr == 0) {
@@ -1011,6 +1061,10 @@ vmm_heap_unit_init(vm_heap_t *vmh, size_t size, bool is_vmcode, const char *name
         ASSERT_NOT_REACHED();
     }
     vmh->end_addr = vmh->start_addr + size;
+#ifdef LINUX
+    if (DYNAMO_OPTION(vmm_huge_pages))
+        vmm_heap_advise_huge_pages(vmh);
+#endif
     ASSERT_TRUNCATE(vmh->num_blocks, uint, size / DYNAMO_OPTION(vmm_block_size));
     vmh->num_blocks = (uint)(size / DYNAMO_OPTION(vmm_block_size));
     size_t blocks_sz_bytes = BITMAP_INDEX(vmh->num_blocks) * sizeof(bitmap_element_t);
@@ -3542,11 +3596,238 @@ common_global_heap_free(thread_units_t *tu, void *p,
     ASSERT(ok);
 }
 
+/* Returns the current thread's heap if its global heap magazines are usable. */
+static inline thread_heap_t *
+magazine_thread_heap(void)
+{
+    dcontext_t *dcontext;
+    thread_heap_t *th;
+    if (DYNAMO_OPTION(global_heap_magazine_size) == 0)
+        return NULL;
+#ifdef STATIC_LIBRARY
+    /* Standalone allocations go to malloc: see common_global_heap_alloc(). */
+    if (standalone_library)
+        return NULL;
+#endif
+    dcontext = get_thread_private_dcontext();
+    if (dcontext == NULL || dcontext == GLOBAL_DCONTEXT)
+        return NULL;
+    th = (thread_heap_t *)dcontext->heap_field;
+    if (th == NULL || !th->use_magazines)
+        return NULL;
+    return th;
+}
+
+static inline uint
+magazine_bucket(size_t size)
+{
+    size_t aligned_size = ALIGN_FORWARD(size, HEAP_ALIGNMENT);
+    uint bucket = 0;
+    while (aligned_size > BLOCK_SIZES[bucket])
+        bucket++;
+    return bucket;
+}
+
+/* Claims th's magazines for the current operation.  Returns false if they are
+ * already in use further up this thread's stack, in which case the caller must
+ * take the locked path.  A signal arriving between the check and the set runs to
+ * completion before we resume, so no atomic operation is needed.
+ */
+static inline bool
+magazine_enter(thread_heap_t *th)
+{
+    if (th->magazine_busy)
+        return false;
+    th->magazine_busy = true;
+    /* Keep the compiler from moving magazine updates above the flag write. */
+#ifdef WINDOWS
+    MemoryBarrier();
+#else
+    __asm__ __volatile__("" : : : "memory");
+#endif
+    return true;
+}
+
+static inline void
+magazine_exit(thread_heap_t *th)
+{
+#ifdef WINDOWS
+    MemoryBarrier();
+#else
+    __asm__ __volatile__("" : : : "memory");
+#endif
+    th->magazine_busy = false;
+}
+
+/* Moves a batch of blocks from the global heap into th's magazine for bucket.
+ * While we hold global_alloc_lock without dynamo_vm_areas_lock,
+ * common_heap_alloc() returns NULL rather than extend or create a unit (see
+ * safe_to_allocate_or_free_heap_units()), so a refill only takes blocks from the
+ * free list and the room left in the current unit.  Returns false if that
+ * yielded nothing, in which case the caller takes the regular path, which
+ * retries with dynamo_vm_areas_lock and so adds the unit a later refill uses.
+ */
+static bool
+magazine_refill(thread_heap_t *th, uint bucket)
+{
+    uint i, batch = MAX(DYNAMO_OPTION(global_heap_magazine_size) / 2, 1);
+    acquire_recursive_lock(&global_alloc_lock);
+    for (i = 0; i < batch; i++) {
+        heap_pc p = (heap_pc)common_heap_alloc(
+            &heapmgt->global_units, BLOCK_SIZES[bucket] HEAPACCT(ACCT_MEM_MGT));
+        if (p == NULL)
+            break;
+#ifdef DEBUG_MEMORY
+        /* Blocks wait in the magazine marked as unallocated, as on a free list. */
+        DOCHECK(CHKLVL_MEMFILL, memset(p, HEAP_UNALLOCATED_BYTE, BLOCK_SIZES[bucket]););
+#endif
+        *((heap_pc *)p) = th->magazine[bucket];
+        th->magazine[bucket] = p;
+        th->magazine_count[bucket]++;
+    }
+    release_recursive_lock(&global_alloc_lock);
+    return th->magazine_count[bucket] > 0;
+}
+
+/* Returns blocks from th's magazine for bucket to the global heap until at
+ * most keep remain.  common_heap_free() only needs dynamo_vm_areas_lock to
+ * release the special unit of an oversized allocation; a fixed-size block just
+ * goes back on the free list, so it cannot fail here.
+ */
+static void
+magazine_drain(thread_heap_t *th, uint bucket, uint keep)
+{
+    acquire_recursive_lock(&global_alloc_lock);
+    while (th->magazine_count[bucket] > keep) {
+        heap_pc p = th->magazine[bucket];
+        DEBUG_DECLARE(bool ok;)
+        th->magazine[bucket] = *((heap_pc *)p);
+        th->magazine_count[bucket]--;
+#ifdef DEBUG_MEMORY
+        /* Avoid common_heap_free()'s double free check. */
+        DOCHECK(CHKLVL_MEMFILL, memset(p, HEAP_ALLOCATED_BYTE, BLOCK_SIZES[bucket]););
+#endif
+        DEBUG_DECLARE(ok =)
+        common_heap_free(&heapmgt->global_units, p,
+                         BLOCK_SIZES[bucket] HEAPACCT(ACCT_MEM_MGT));
+        ASSERT(ok);
+    }
+    release_recursive_lock(&global_alloc_lock);
+}
+
+/* Returns a block of size bytes from th's magazine for bucket, or NULL if the
+ * caller should take the regular path.
+ */
+static void *
+magazine_alloc(thread_heap_t *th, uint bucket, size_t size HEAPACCT(which_heap_t which))
+{
+    heap_pc p = NULL;
+#if defined(DEBUG_MEMORY) && defined(DEBUG)
+    uint chklvl = CHKLVL_MEMFILL + (IF_HEAPACCT_ELSE(which == ACCT_LIBDUP ? 1 : 0, 0));
+#endif
+    if (!magazine_enter(th))
+        return NULL;
+    if (th->magazine_count[bucket] > 0 || magazine_refill(th, bucket)) {
+        p = th->magazine[bucket];
+        th->magazine[bucket] = *((heap_pc *)p);
+        th->magazine_count[bucket]--;
+        /* The block was charged to ACCT_MEM_MGT while in the magazine. */
+        ACCOUNT_FOR_FREE(th, ACCT_MEM_MGT, BLOCK_SIZES[bucket]);
+        ACCOUNT_FOR_ALLOC(alloc_reuse, th, which, BLOCK_SIZES[bucket],
+                          ALIGN_FORWARD(size, HEAP_ALIGNMENT));
+#ifdef DEBUG_MEMORY
+        /* Same checks and fill as common_heap_alloc(). */
+        DOCHECK(chklvl, {
+            CLIENT_ASSERT(
+            is_region_memset_to_char(p + sizeof(heap_pc *),
+                                     BLOCK_SIZES[bucket] - sizeof(heap_pc *),
+                                     HEAP_UNALLOCATED_BYTE),
+            "memory corruption detected");
+        });
+        DOCHECK(chklvl, memset(p + size, HEAP_PAD_BYTE, BLOCK_SIZES[bucket] - size););
+        DOCHECK(chklvl, memset(p, HEAP_ALLOCATED_BYTE, size););
+#endif
+    }
+    magazine_exit(th);
+    return p;
+}
+
+/* Puts p in th's magazine for bucket.  Returns false if the caller should take
+ * the regular path.
+ */
+static bool
+magazine_free(thread_heap_t *th, uint bucket, void *p_void,
+              size_t size HEAPACCT(which_heap_t which))
+{
+    heap_pc p = (heap_pc)p_void;
+#if defined(DEBUG_MEMORY) && defined(DEBUG)
+    uint chklvl = CHKLVL_MEMFILL + (IF_HEAPACCT_ELSE(which == ACCT_LIBDUP ? 1 : 0, 0));
+#endif
+    if (!magazine_enter(th))
+        return false;
+#ifdef DEBUG_MEMORY
+    /* Same checks and fill as common_heap_free(): see the comments there. */
+    DOCHECK(chklvl, {
+        ASSERT_CURIOSITY(
+            (*(uint *)p != HEAP_UNALLOCATED_UINT ||
+             (size >= 2 * sizeof(uint) && *(((uint *)p) + 1) != HEAP_UNALLOCATED_UINT)) &&
+            *(uint *)(p + size - sizeof(int)) != HEAP_UNALLOCATED_UINT &&
+            "attempting to free memory containing HEAP_UNALLOCATED pattern, "
+            "possible double free!");
+    });
+    ASSERT_MESSAGE(
+        chklvl, "heap overflow",
+        is_region_memset_to_char(p + size, BLOCK_SIZES[bucket] - size, HEAP_PAD_BYTE));
+    DOCHECK(CHKLVL_MEMFILL, memset(p, HEAP_UNALLOCATED_BYTE, BLOCK_SIZES[bucket]););
+#endif
+    ACCOUNT_FOR_FREE(th, which, BLOCK_SIZES[bucket]);
+    /* The magazine holds the block as ACCT_MEM_MGT, as a refill does. */
+    ACCOUNT_FOR_ALLOC(alloc_reuse, th, ACCT_MEM_MGT, BLOCK_SIZES[bucket],
+                      BLOCK_SIZES[bucket]);
+    *((heap_pc *)p) = th->magazine[bucket];
+    th->magazine[bucket] = p;
+    th->magazine_count[bucket]++;
+    if (th->magazine_count[bucket] > DYNAMO_OPTION(global_heap_magazine_size))
+        magazine_drain(th, bucket, DYNAMO_OPTION(global_heap_magazine_size) / 2);
+    magazine_exit(th);
+    return true;
+}
+
+/* Called when the thread owning th exits, or for it once it is no longer running:
+ * returns everything in th's magazines to the global heap.
+ */
+static void
+magazine_thread_exit(thread_heap_t *th)
+{
+    uint i;
+    th->use_magazines = false;
+    for (i = 0; i < BLOCK_TYPES - 1; i++)
+        magazine_drain(th, i, 0);
+#ifdef HEAP_ACCOUNTING
+    /* As for thread-private heaps, the accurate global stats only get this
+     * thread's charges now.  The maxes are not simultaneous, as there.
+     */
+    acquire_recursive_lock(&global_alloc_lock);
+    for (i = 0; i < ACCT_LAST; i++) {
+        heap_acct_t *acct = &heapmgt->global_units.acct;
+        acct->alloc_reuse[i] += th->acct.alloc_reuse[i];
+        acct->num_alloc[i] += th->acct.num_alloc[i];
+        acct->cur_usage[i] += th->acct.cur_usage[i];
+        if ((ptr_int_t)acct->cur_usage[i] > (ptr_int_t)acct->max_usage[i])
+            acct->max_usage[i] = acct->cur_usage[i];
+        if (th->acct.max_single[i] > acct->max_single[i])
+            acct->max_single[i] = th->acct.max_single[i];
+    }
+    release_recursive_lock(&global_alloc_lock);
+#endif
+}
+
 /* these functions use the global heap instead of a thread's heap: */
 void *
 global_heap_alloc(size_t size HEAPACCT(which_heap_t which))
 {
     void *p;
+    thread_heap_t *th;
     /* We pay the cost of this branch to support using DR's decode routines from the
      * regular DR library and not just drdecode, to support libraries that would use
      * drdecode but that also have to work with full DR (i#2499).
@@ -3559,6 +3840,15 @@ global_heap_alloc(size_t size HEAPACCT(which_heap_t which))
          */
         standalone_init();
     }
+    th = magazine_thread_heap();
+    if (th != NULL) {
+        uint bucket = magazine_bucket(size);
+        if (bucket < BLOCK_TYPES - 1) {
+            p = magazine_alloc(th, bucket, size HEAPACCT(which));
+            if (p != NULL)
+                return p;
+        }
+    }
     p = common_global_heap_alloc(&heapmgt->global_units, size HEAPACCT(which));
     ASSERT(p != NULL);
     LOG(GLOBAL, LOG_HEAP, 6, "\nglobal alloc: " PFX " (%d bytes)\n", p, size);
@@ -3568,6 +3858,13 @@ global_heap_alloc(size_t size HEAPACCT(which_heap_t which))
 void
 global_heap_free(void *p, size_t size HEAPACCT(which_heap_t which))
 {
+    thread_heap_t *th = magazine_thread_heap();
+    if (th != NULL && p != NULL) {
+        uint bucket = magazine_bucket(size);
+        if (bucket < BLOCK_TYPES - 1 &&
+            magazine_free(th, bucket, p, size HEAPACCT(which)))
+            return;
+    }
     common_global_heap_free(&heapmgt->global_units, p, size HEAPACCT(which));
     LOG(GLOBAL, LOG_HEAP, 6, "\nglobal free: " PFX " (%d bytes)\n", p, size);
 }
@@ -4036,6 +4333,13 @@ heap_thread_init(dcontext_t *dcontext)
 {
     thread_heap_t *th =
         (thread_heap_t *)global_heap_alloc(sizeof(thread_heap_t) HEAPACCT(ACCT_MEM_MGT));
+    memset(th->magazine, 0, sizeof(th->magazine));
+    memset(th->magazine_count, 0, sizeof(th->magazine_count));
+    th->magazine_busy = false;
+#ifdef HEAP_ACCOUNTING
+    memset(&th->acct, 0, sizeof(th->acct));
+#endif
+    th->use_magazines = true;
     dcontext->heap_field = (void *)th;
     th->local_heap = (thread_units_t *)global_heap_alloc(sizeof(thread_units_t)
                                                              HEAPACCT(ACCT_MEM_MGT));
@@ -4072,6 +4376,10 @@ void
 heap_thread_exit(dcontext_t *dcontext)
 {
     thread_heap_t *th = (thread_heap_t *)dcontext->heap_field;
+    /* We may be called for another thread: its magazines are only touched by
+     * their owner, which is no longer running.
+     */
+    magazine_thread_exit(th);
     threadunits_exit(th->local_heap, dcontext);
     heap_thread_reset_free(dcontext);
     global_heap_free(th->local_heap, sizeof(thread_units_t) HEAPACCT(ACCT_MEM_MGT));
@@ -4085,6 +4393,8 @@ heap_thread_exit(dcontext_t *dcontext)
                          sizeof(thread_units_t) HEAPACCT(ACCT_MEM_MGT));
     }
     global_heap_free(th, sizeof(thread_heap_t) HEAPACCT(ACCT_MEM_MGT));
+    /* Later global frees by this thread must not find the freed magazines. */
+    dcontext->heap_field = NULL;
 }
 
 #if defined(DEBUG_MEMORY) && defined(DEBUG)
@@ -5998,3 +6308,115 @@ release_landing_pad_mem(void)
 }
 #endif /* WINDOWS */
 /*----------------------------------------------------------------------------*/
+
+#ifdef STANDALONE_UNIT_TEST
+/* Several times the default -global_heap_magazine_size. */
+#    define TEST_MAGAZINE_BLOCKS 200
+/* Not a bucket size, to check the padding too. */
+#    define TEST_MAGAZINE_SIZE 20
+
+static uint
+test_global_free_list_length(uint bucket)
+{
+    uint len = 0;
+    heap_pc p;
+    acquire_recursive_lock(&global_alloc_lock);
+    for (p = heapmgt->global_units.free_list[bucket]; p != NULL; p = *((heap_pc *)p))
+        len++;
+    release_recursive_lock(&global_alloc_lock);
+    return len;
+}
+
+/* The unit test has a single DR thread, so other threads are simulated by
+ * switching its dcontext to one of these.
+ */
+static dcontext_t *
+test_thread_init(void)
+{
+    dcontext_t *dcontext =
+        (dcontext_t *)global_heap_alloc(sizeof(*dcontext) HEAPACCT(ACCT_OTHER));
+    memset(dcontext, 0, sizeof(*dcontext));
+    heap_thread_init(dcontext);
+    return dcontext;
+}
+
+/* Global blocks allocated by one thread and freed by another, and the magazines
+ * returned to the global heap at thread exit.
+ */
+static void
+test_magazines(void)
+{
+    dcontext_t *initial = get_thread_private_dcontext();
+    dcontext_t *dc_alloc, *dc_free;
+    thread_heap_t *th_alloc, *th_free;
+    static void *blocks[TEST_MAGAZINE_BLOCKS];
+    uint bucket = magazine_bucket(TEST_MAGAZINE_SIZE);
+    uint max = DYNAMO_OPTION(global_heap_magazine_size);
+    uint i, count, free_len;
+    void *p;
+#    ifdef HEAP_ACCOUNTING
+    size_t usage;
+#    endif
+    print_file(STDERR, "global heap magazine test\n");
+    ASSERT(max > 0 && bucket < BLOCK_TYPES - 1);
+    dc_alloc = test_thread_init();
+    dc_free = test_thread_init();
+    th_alloc = (thread_heap_t *)dc_alloc->heap_field;
+    th_free = (thread_heap_t *)dc_free->heap_field;
+#    ifdef HEAP_ACCOUNTING
+    usage = heapmgt->global_units.acct.cur_usage[ACCT_OTHER];
+#    endif
+
+    set_thread_private_dcontext(dc_alloc);
+    for (i = 0; i < TEST_MAGAZINE_BLOCKS; i++) {
+        blocks[i] = global_heap_alloc(TEST_MAGAZINE_SIZE HEAPACCT(ACCT_OTHER));
+        memset(blocks[i], i, TEST_MAGAZINE_SIZE);
+        EXPECT_RELATION(th_alloc->magazine_count[bucket], <=, max);
+    }
+    /* Freed by another thread: they go into its magazine, which drains to the
+     * global heap whenever it overflows.
+     */
+    set_thread_private_dcontext(dc_free);
+    for (i = 0; i < TEST_MAGAZINE_BLOCKS; i++) {
+        EXPECT(*(byte *)blocks[i], (byte)i);
+        global_heap_free(blocks[i], TEST_MAGAZINE_SIZE HEAPACCT(ACCT_OTHER));
+        EXPECT_RELATION(th_free->magazine_count[bucket], <=, max);
+    }
+    count = th_free->magazine_count[bucket];
+    EXPECT_RELATION(count, >, 0);
+
+    /* A re-entrant call, as from our signal handler in the middle of a magazine
+     * operation, must leave the magazine alone.
+     */
+    th_free->magazine_busy = true;
+    p = global_heap_alloc(TEST_MAGAZINE_SIZE HEAPACCT(ACCT_OTHER));
+    EXPECT(th_free->magazine_count[bucket], count);
+    global_heap_free(p, TEST_MAGAZINE_SIZE HEAPACCT(ACCT_OTHER));
+    EXPECT(th_free->magazine_count[bucket], count);
+    th_free->magazine_busy = false;
+
+    /* Thread exit, run by another thread as for a thread that was killed. */
+    set_thread_private_dcontext(initial);
+    free_len = test_global_free_list_length(bucket);
+    heap_thread_exit(dc_free);
+    EXPECT(test_global_free_list_length(bucket), free_len + count);
+    count = th_alloc->magazine_count[bucket];
+    free_len = test_global_free_list_length(bucket);
+    heap_thread_exit(dc_alloc);
+    EXPECT(test_global_free_list_length(bucket), free_len + count);
+#    ifdef HEAP_ACCOUNTING
+    /* Each block was charged to ACCT_OTHER by one thread and uncharged by the
+     * other.
+     */
+    EXPECT(heapmgt->global_units.acct.cur_usage[ACCT_OTHER], usage);
+#    endif
+    global_heap_free(dc_alloc, sizeof(*dc_alloc) HEAPACCT(ACCT_OTHER));
+    global_heap_free(dc_free, sizeof(*dc_free) HEAPACCT(ACCT_OTHER));
+}
+
+void
+unit_test_heap(void)
+{
+    test_magazines();
+}
+#endif /* STANDALONE_UNIT_TEST */
@@ -355,6 +355,8 @@ global_unprotected_heap_free(void *p, size_t size HEAPACCT(which_heap_t which));
     NONPERSISTENT_HEAP_ARRAY_FREE(dc, p, type, 1, which)
 
 #define MIN_VMM_BLOCK_SIZE (4U * 1024)
+/* The PMD-level transparent huge page size for 4K base pages. */
+#define VMM_HUGE_PAGE_SIZE (2U * 1024 * 1024)
 
 /* special heap of same-sized blocks that avoids global locks */
 void *
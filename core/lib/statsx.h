@@ -482,6 +482,7 @@ STATS_DEF("Fragments deleted due to capacity conflicts", num_fragments_replaced)
 STATS_DEF("Fragments deleted on thread/process death", num_fragments_deleted_exit)
 STATS_DEF("Fragments deleted on thread/process reset", num_fragments_deleted_reset)
 STATS_DEF("Trace heads marked", num_trace_heads_marked)
+STATS_DEF("Trace head gates created", num_trace_head_gates)
 STATS_DEF("Fragments deleted and replaced with traces", num_fragments_deleted_trace_heads)
 STATS_DEF("Fragments deleted after selfmod", num_fragments_deleted_selfmod)
 STATS_DEF("Fragments deleted for munmap or RO consistency",
@@ -681,6 +682,7 @@ STATS_DEF("Exit hooks from DR", num_exiting_DR)
 RSTATS_DEF("Fcache exits, total", num_exits)
 STATS_DEF("Fcache exits, coarse-grain fragments", num_exits_coarse)
 STATS_DEF("Fcache exits, coarse-grain targeting trace head", num_exits_coarse_trace_head)
+STATS_DEF("Fcache exits, trace head gate now hot", num_exits_trace_head_gate)
 STATS_DEF("Fcache exits, fine targeting th coarse", num_exits_fine2th_coarse)
 STATS_DEF("Fcache exits, fine targeting non-th coarse", num_exits_fine2non_th_coarse)
 STATS_DEF("Fcache exits, system call executions", num_exits_syscalls)
@@ -777,6 +779,12 @@ STATS_DEF("Fcache trace free coalesce too big", fcache_trace_free_coalesce_too_b
 STATS_DEF("Fcache trace return last", fcache_trace_return_last)
 STATS_DEF("Fcache trace free use larger bucket", fcache_trace_free_use_larger)
 STATS_DEF("Fcache trace free split", fcache_trace_free_split)
+STATS_DEF("Fcache trace empty units released", fcache_trace_free_unit_released)
+STATS_DEF("Fcache trace free list entries", fcache_trace_free_entries)
+STATS_DEF("Fcache trace free list space (bytes)", fcache_trace_free_bytes)
+STATS_DEF("Fcache trace peak free list space (bytes)", fcache_trace_free_bytes_peak)
+STATS_DEF("Fcache trace largest free entry (bytes)", fcache_trace_free_largest)
+STATS_DEF("Fcache trace free list fragmentation (%)", fcache_trace_free_fragmented)
 
 STATS_DEF("Fcache bb capacity (bytes)", fcache_bb_capacity)
 STATS_DEF("Fcache bb peak capacity (bytes)", fcache_bb_capacity_peak)
@@ -797,6 +805,12 @@ STATS_DEF("Fcache bb free coalesce too big", fcache_bb_free_coalesce_too_big)
 STATS_DEF("Fcache bb return last", fcache_bb_return_last)
 STATS_DEF("Fcache bb free use larger bucket", fcache_bb_free_use_larger)
 STATS_DEF("Fcache bb free split", fcache_bb_free_split)
+STATS_DEF("Fcache bb empty units released", fcache_bb_free_unit_released)
+STATS_DEF("Fcache bb free list entries", fcache_bb_free_entries)
+STATS_DEF("Fcache bb free list space (bytes)", fcache_bb_free_bytes)
+STATS_DEF("Fcache bb peak free list space (bytes)", fcache_bb_free_bytes_peak)
+STATS_DEF("Fcache bb largest free entry (bytes)", fcache_bb_free_largest)
+STATS_DEF("Fcache bb free list fragmentation (%)", fcache_bb_free_fragmented)
 
 STATS_DEF("Fcache shared bb capacity (bytes)", fcache_shared_bb_capacity)
 STATS_DEF("Fcache shared bb peak capacity (bytes)", fcache_shared_bb_capacity_peak)
@@ -818,6 +832,15 @@ STATS_DEF("Fcache shared bb free coalesce too big",
 STATS_DEF("Fcache shared bb return last", fcache_shared_bb_return_last)
 STATS_DEF("Fcache shared bb free use larger bucket", fcache_shared_bb_free_use_larger)
 STATS_DEF("Fcache shared bb free split", fcache_shared_bb_free_split)
+STATS_DEF("Fcache shared bb empty units released", fcache_shared_bb_free_unit_released)
+STATS_DEF("Fcache shared bb free list entries", fcache_shared_bb_free_entries)
+STATS_DEF("Fcache shared bb free list space (bytes)", fcache_shared_bb_free_bytes)
+STATS_DEF("Fcache shared bb peak free list space (bytes)",
+          fcache_shared_bb_free_bytes_peak)
+STATS_DEF("Fcache shared bb largest free entry (bytes)",
+          fcache_shared_bb_free_largest)
+STATS_DEF("Fcache shared bb free list fragmentation (%)",
+          fcache_shared_bb_free_fragmented)
 
 STATS_DEF("Fcache shared trace capacity (bytes)", fcache_shared_trace_capacity)
 STATS_DEF("Fcache shared trace peak capacity (bytes)", fcache_shared_trace_capacity_peak)
@@ -844,6 +867,16 @@ STATS_DEF("Fcache shared trace return last", fcache_shared_trace_return_last)
 STATS_DEF("Fcache shared trace free use larger bucket",
           fcache_shared_trace_free_use_larger)
 STATS_DEF("Fcache shared trace free split", fcache_shared_trace_free_split)
+STATS_DEF("Fcache shared trace empty units released",
+          fcache_shared_trace_free_unit_released)
+STATS_DEF("Fcache shared trace free list entries", fcache_shared_trace_free_entries)
+STATS_DEF("Fcache shared trace free list space (bytes)", fcache_shared_trace_free_bytes)
+STATS_DEF("Fcache shared trace peak free list space (bytes)",
+          fcache_shared_trace_free_bytes_peak)
+STATS_DEF("Fcache shared trace largest free entry (bytes)",
+          fcache_shared_trace_free_largest)
+STATS_DEF("Fcache shared trace free list fragmentation (%)",
+          fcache_shared_trace_free_fragmented)
 
 STATS_DEF("Fcache coarse bb capacity (bytes)", fcache_coarse_bb_capacity)
 STATS_DEF("Fcache coarse bb peak capacity (bytes)", fcache_coarse_bb_capacity_peak)
@@ -998,6 +1031,7 @@ STATS_DEF("Wasted vmm space due to alignment", vmm_vsize_wasted)
 STATS_DEF("Peak wasted vmm space due to alignment", peak_vmm_vsize_wasted)
 STATS_DEF("Allocations using multiple vmm blocks", vmm_multi_block_allocs)
 STATS_DEF("Blocks used for multi-block allocs", vmm_multi_blocks)
+RSTATS_DEF("Vmm reservation advised for huge pages (bytes)", vmm_huge_page_vsize)
 RSTATS_DEF("Current vmm virtual memory in use (bytes)", vmm_vsize_used)
 RSTATS_DEF("Peak vmm virtual memory in use (bytes)", peak_vmm_vsize_used)
 STATS_DEF("Number of landing pad areas allocated", num_landing_pad_areas)
@@ -1010,6 +1044,9 @@ STATS_DEF("Number of safe reads", num_safe_reads)
 STATS_DEF("Number of safe writes", num_safe_writes)
 STATS_DEF("Number of vmarea vector resize reallocations", num_vmareas_resized)
 STATS_DEF("Number of vmarea vector resize synch fixups", num_vmareas_resize_synch)
+STATS_DEF("Lockless vmarea vector lookups", num_vmareas_lockless_lookups)
+STATS_DEF("Lockless vmarea vector lookups retried under lock",
+          num_vmareas_lockless_retries)
 STATS_DEF("Peak vmarea vector length", max_vmareas_length)
 STATS_DEF("Peak dynamo areas vector length", max_DRareas_length)
 STATS_DEF("Peak executable areas vector length", max_execareas_length)
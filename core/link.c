@@ -63,6 +63,12 @@ coarse_stubs_init(void);
 static void
 coarse_stubs_free(void);
 
+static void
+trace_head_gates_init(void);
+
+static void
+trace_head_gates_free(void);
+
 static fragment_t *
 fragment_link_lookup_same_sharing(dcontext_t *dcontext, app_pc tag, linkstub_t *last_exit,
                                   uint flags);
@@ -113,6 +119,13 @@ void *stub_heap;
 void *stub32_heap;
 #endif
 
+/* -inline_trace_head_counters gates: see the TRACE HEAD GATES section below */
+static void *trace_head_gate_heap;
+static vm_area_vector_t *trace_head_gate_areas;
+static generic_table_t *trace_head_gate_table;
+
+#define INIT_TRACE_HEAD_GATE_TABLE_SIZE 10
+
 #if defined(X86) && defined(X64)
 #    define SEPARATE_STUB_HEAP(flags) (FRAG_IS_32(flags) ? stub32_heap : stub_heap)
 #else
@@ -198,6 +211,8 @@ static const fragment_t coarse_fragment = {
 /* We don't mark as direct since not everything checks for being fake */
 static const linkstub_t linkstub_coarse_exit = { LINK_FAKE, 0 };
 static const linkstub_t linkstub_coarse_trace_head_exit = { LINK_FAKE, 0 };
+/* -inline_trace_head_counters: exit from a trace head gate once the head is hot */
+static const linkstub_t linkstub_trace_head_gate_exit = { LINK_FAKE, 0 };
 
 #ifdef HOT_PATCHING_INTERFACE
 /* used to change control flow in a hot patch routine */
@@ -290,6 +305,8 @@ link_reset_init(void)
                                         false /* not persistent */);
 #endif
     }
+    if (DYNAMO_OPTION(inline_trace_head_counters))
+        trace_head_gates_init();
 }
 
 /* Free all thread-shared state not critical to forward progress;
@@ -304,11 +321,17 @@ link_reset_free(void)
         special_heap_exit(stub32_heap);
 #endif
     }
+    if (DYNAMO_OPTION(inline_trace_head_counters))
+        trace_head_gates_free();
 }
 
 void
 d_r_link_init()
 {
+    if (DYNAMO_OPTION(inline_trace_head_counters)) {
+        VMVECTOR_ALLOC_VECTOR(trace_head_gate_areas, GLOBAL_DCONTEXT,
+                              VECTOR_SHARED | VECTOR_NEVER_MERGE, trace_head_gate_areas);
+    }
     link_reset_init();
     coarse_stubs_init();
 }
@@ -318,6 +341,11 @@ d_r_link_exit()
 {
     coarse_stubs_free();
     link_reset_free();
+    if (DYNAMO_OPTION(inline_trace_head_counters)) {
+        /* should be empty from special_heap_exit() in trace_head_gates_free() */
+        ASSERT(vmvector_empty(trace_head_gate_areas));
+        vmvector_delete_vector(GLOBAL_DCONTEXT, trace_head_gate_areas);
+    }
     DELETE_RECURSIVE_LOCK(change_linking_lock);
 }
 
@@ -853,6 +881,13 @@ get_coarse_trace_head_exit_linkstub()
     return &linkstub_coarse_trace_head_exit;
 }
 
+/* Trace head gate exit once the head is hot */
+const linkstub_t *
+get_trace_head_gate_exit_linkstub()
+{
+    return &linkstub_trace_head_gate_exit;
+}
+
 bool
 should_separate_stub(dcontext_t *dcontext, app_pc target, uint fragment_flags)
 {
@@ -2317,6 +2352,166 @@ shift_links_to_new_fragment(dcontext_t *dcontext, fragment_t *old_f, fragment_t
     });
 }
 
+/***************************************************************************
+ * TRACE HEAD GATES
+ *
+ * With -inline_trace_head_counters, direct exits that target a trace head are
+ * linked to a small per-head gate rather than left unlinked.  The gate counts
+ * transfers to the head in the cache and only exits to d_r_dispatch, via
+ * trace_head_gate_return, once the head is hot.  The counter is shared by all
+ * sources and threads, so it only approximates the per-thread trace head
+ * counters kept by the monitor.
+ */
+
+/* Each gate is one aligned block holding a pointer to its trace_head_gate_t
+ * followed by the gate code.  The counter lives in the trace_head_gate_t so that
+ * its frequent updates do not land on a cache line holding code.
+ */
+#define TRACE_HEAD_GATE_ALLOC_SIZE 128
+#define TRACE_HEAD_GATE_CODE_OFFS 16
+
+typedef struct _trace_head_gate_t {
+    uint counter;  /* transfers left before the head is hot */
+    fragment_t *f; /* the trace head */
+    cache_pc pc;   /* the gate's block */
+} trace_head_gate_t;
+
+static void
+trace_head_gate_free_payload(dcontext_t *dcontext, void *payload)
+{
+    heap_reachable_free(GLOBAL_DCONTEXT, payload,
+                        sizeof(trace_head_gate_t) HEAPACCT(ACCT_OTHER));
+}
+
+static void
+trace_head_gates_init(void)
+{
+    ASSERT(trace_head_gate_areas != NULL);
+    /* The vector data only needs to be non-NULL for lookups to find a unit */
+    trace_head_gate_heap = special_heap_pclookup_init(
+        TRACE_HEAD_GATE_ALLOC_SIZE, true /* must synch */, true /* +x */,
+        false /* not persistent */, trace_head_gate_areas, &trace_head_gate_heap, NULL,
+        0, false);
+    trace_head_gate_table = generic_hash_create(
+        GLOBAL_DCONTEXT, INIT_TRACE_HEAD_GATE_TABLE_SIZE, 80,
+        HASHTABLE_SHARED | HASHTABLE_PERSISTENT,
+        trace_head_gate_free_payload _IF_DEBUG("trace head gate table"));
+}
+
+static void
+trace_head_gates_free(void)
+{
+    /* gates of heads that were never freed go away with the heap */
+    generic_hash_destroy(GLOBAL_DCONTEXT, trace_head_gate_table);
+    special_heap_exit(trace_head_gate_heap);
+}
+
+/* The counter value that makes a gate exit on the trace_threshold-th transfer */
+static inline uint
+trace_head_gate_reset_value(void)
+{
+    return INTERNAL_OPTION(trace_threshold) > 0 ? INTERNAL_OPTION(trace_threshold) - 1
+                                                : 0;
+}
+
+/* Returns whether the direct exit from_l of from_f can be linked through a gate
+ * to the trace head to_f.  Gates are 64-bit code owned by a fine-grained head,
+ * and coarse proxies are linked through entrance stubs instead.
+ */
+bool
+trace_head_gate_linkable(fragment_t *from_f, linkstub_t *from_l, fragment_t *to_f)
+{
+    return DYNAMO_OPTION(inline_trace_head_counters) &&
+        !TESTANY(FRAG_COARSE_GRAIN | FRAG_FAKE, from_f->flags | to_f->flags) &&
+        !FRAG_IS_32(from_f->flags) && !FRAG_IS_32(to_f->flags) &&
+        LINKSTUB_DIRECT(from_l->flags) && !LINKSTUB_COARSE_PROXY(from_l->flags);
+}
+
+/* Returns the gate that from_l of from_f should be linked to in place of the
+ * trace head targetf, creating it on first use, or NULL if from_l should be
+ * linked to targetf directly.
+ */
+cache_pc
+trace_head_gate_lookup_or_create(dcontext_t *dcontext, fragment_t *from_f,
+                                 linkstub_t *from_l, fragment_t *targetf)
+{
+    trace_head_gate_t *gate;
+    if (!TEST(FRAG_IS_TRACE_HEAD, targetf->flags) ||
+        !trace_head_gate_linkable(from_f, from_l, targetf))
+        return NULL;
+    ASSERT(!TEST(FRAG_IS_TRACE, targetf->flags));
+    /* Links to a shared head are made holding change_linking_lock and a private
+     * head is only linked by its owner, so there is no creation race.
+     */
+    ASSERT(!NEED_SHARED_LOCK(targetf->flags) ||
+           self_owns_recursive_lock(&change_linking_lock));
+    TABLE_RWLOCK(trace_head_gate_table, read, lock);
+    gate = generic_hash_lookup(GLOBAL_DCONTEXT, trace_head_gate_table,
+                               (ptr_uint_t)targetf);
+    TABLE_RWLOCK(trace_head_gate_table, read, unlock);
+    if (gate == NULL) {
+        gate = (trace_head_gate_t *)heap_reachable_alloc(
+            GLOBAL_DCONTEXT, sizeof(*gate) HEAPACCT(ACCT_OTHER));
+        gate->counter = trace_head_gate_reset_value();
+        gate->f = targetf;
+        gate->pc = special_heap_alloc(trace_head_gate_heap);
+        ASSERT(ALIGNED(gate->pc, TRACE_HEAD_GATE_ALLOC_SIZE));
+        *(trace_head_gate_t **)vmcode_get_writable_addr(gate->pc) = gate;
+#if defined(X86) && defined(X64)
+        DEBUG_DECLARE(byte *end_pc =)
+        emit_trace_head_gate(GLOBAL_DCONTEXT, gate->pc + TRACE_HEAD_GATE_CODE_OFFS,
+                             &gate->counter, trace_head_gate_reset_value(),
+                             FCACHE_ENTRY_PC(targetf), targetf->tag);
+        ASSERT(end_pc <= gate->pc + TRACE_HEAD_GATE_ALLOC_SIZE);
+#else
+        /* the option is rejected elsewhere */
+        ASSERT_NOT_REACHED();
+#endif
+        TABLE_RWLOCK(trace_head_gate_table, write, lock);
+        generic_hash_add(GLOBAL_DCONTEXT, trace_head_gate_table, (ptr_uint_t)targetf,
+                         gate);
+        TABLE_RWLOCK(trace_head_gate_table, write, unlock);
+        /* under the same synchronization as the creation race above */
+        targetf->flags |= FRAG_HAS_TRACE_HEAD_GATE;
+        STATS_INC(num_trace_head_gates);
+        LOG(THREAD, LOG_LINKS, 4, "    created trace head gate " PFX " for F%d\n",
+            gate->pc + TRACE_HEAD_GATE_CODE_OFFS, targetf->id);
+    }
+    return gate->pc + TRACE_HEAD_GATE_CODE_OFFS;
+}
+
+/* Frees f's gate, if it has one.  Called for fragments with
+ * FRAG_HAS_TRACE_HEAD_GATE set when f itself is freed, at which point nothing
+ * links to the gate and no thread can still be executing it.
+ */
+void
+trace_head_gate_free(dcontext_t *dcontext, fragment_t *f)
+{
+    trace_head_gate_t *gate;
+    cache_pc pc = NULL;
+    TABLE_RWLOCK(trace_head_gate_table, write, lock);
+    gate = generic_hash_lookup(GLOBAL_DCONTEXT, trace_head_gate_table, (ptr_uint_t)f);
+    if (gate != NULL) {
+        pc = gate->pc;
+        /* frees gate */
+        generic_hash_remove(GLOBAL_DCONTEXT, trace_head_gate_table, (ptr_uint_t)f);
+    }
+    TABLE_RWLOCK(trace_head_gate_table, write, unlock);
+    /* special_heap_lock ranks below table_rwlock */
+    if (pc != NULL)
+        special_heap_free(trace_head_gate_heap, pc);
+}
+
+/* Returns the trace head whose gate contains pc, or NULL if pc is not in a gate */
+fragment_t *
+trace_head_gate_fragment(cache_pc pc)
+{
+    if (!DYNAMO_OPTION(inline_trace_head_counters) ||
+        vmvector_lookup(trace_head_gate_areas, pc) == NULL)
+        return NULL;
+    return (*(trace_head_gate_t **)ALIGN_BACKWARD(pc, TRACE_HEAD_GATE_ALLOC_SIZE))->f;
+}
+
 /***************************************************************************
  * COARSE-GRAIN UNITS
  */
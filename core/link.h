@@ -423,6 +423,20 @@ cache_pc
 get_coarse_ibl_prefix(dcontext_t *dcontext, cache_pc stub_pc,
                       ibl_branch_type_t branch_type);
 
+/* -inline_trace_head_counters */
+bool
+trace_head_gate_linkable(fragment_t *from_f, linkstub_t *from_l, fragment_t *to_f);
+
+cache_pc
+trace_head_gate_lookup_or_create(dcontext_t *dcontext, fragment_t *from_f,
+                                 linkstub_t *from_l, fragment_t *targetf);
+
+void
+trace_head_gate_free(dcontext_t *dcontext, fragment_t *f);
+
+fragment_t *
+trace_head_gate_fragment(cache_pc pc);
+
 bool
 in_coarse_stubs(cache_pc pc);
 
@@ -520,6 +534,8 @@ const linkstub_t *
 get_coarse_exit_linkstub(void);
 const linkstub_t *
 get_coarse_trace_head_exit_linkstub(void);
+const linkstub_t *
+get_trace_head_gate_exit_linkstub(void);
 
 #define IS_COARSE_LINKSTUB(l) \
     ((l) == get_coarse_exit_linkstub() || (l) == get_coarse_trace_head_exit_linkstub())
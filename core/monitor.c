@@ -754,6 +754,11 @@ mark_trace_head(dcontext_t *dcontext_in, fragment_t *f, fragment_t *src_f,
      * When fix it, change link_branch to assert that !already linked
      */
     link_fragment_incoming(dcontext, f, false /*not new*/);
+#else
+    /* -inline_trace_head_counters: re-link incoming links to the head's gate */
+    if (DYNAMO_OPTION(inline_trace_head_counters) &&
+        !TEST(FRAG_COARSE_GRAIN, f->flags))
+        link_fragment_incoming(dcontext, f, false /*not new*/);
 #endif
     STATS_INC(num_trace_heads_marked);
     /* caller is either d_r_dispatch or inside emit_fragment, they take care of
@@ -918,9 +923,9 @@ monitor_is_linkable(dcontext_t *dcontext, fragment_t *from_f, linkstub_t *from_l
     if (DYNAMO_OPTION(disable_traces))
         return true;
 #ifndef TRACE_HEAD_CACHE_INCR
-    /* no link case -- block is a trace head */
+    /* no link case -- block is a trace head, unless we can count it in its gate */
     if (TEST(FRAG_IS_TRACE_HEAD, to_f->flags) && !DYNAMO_OPTION(disable_traces))
-        return false;
+        return trace_head_gate_linkable(from_f, from_l, to_f);
 #endif
     if (mark_new_trace_head) {
         uint th = should_be_trace_head(dcontext, from_f, from_l, to_f->tag, to_f->flags,
@@ -935,7 +940,8 @@ monitor_is_linkable(dcontext_t *dcontext, fragment_t *from_f, linkstub_t *from_l
              */
             return true;
 #else
-            return false;
+            /* the link will point at the head's gate */
+            return trace_head_gate_linkable(from_f, from_l, to_f);
 #endif
         }
     }
@@ -2121,6 +2127,11 @@ monitor_cache_enter(dcontext_t *dcontext, fragment_t *f)
         ctr->counter = INTERNAL_OPTION(trace_counter_on_delete);
         STATS_INC(th_counter_reset);
     }
+    if (dcontext->last_exit == get_trace_head_gate_exit_linkstub() &&
+        ctr->counter + 1 < INTERNAL_OPTION(trace_threshold)) {
+        /* The head's gate has already counted it up to the threshold */
+        ctr->counter = INTERNAL_OPTION(trace_threshold) - 1;
+    }
 
     ctr->counter++;
     /* Should never be > here (assert is down below) but we check just in case */
@@ -2241,6 +2252,14 @@ monitor_cache_enter(dcontext_t *dcontext, fragment_t *f)
                     : "trace body limit / trace cache size");
             /* turn back into a non-trace head */
             SHARED_FLAGS_RECURSIVE_LOCK(f->flags, acquire, change_linking_lock);
+            /* -inline_trace_head_counters linked the incoming links to the
+             * head's gate: unlink them while still a head so they are re-linked
+             * directly below rather than left counting in the gate.
+             */
+            if (DYNAMO_OPTION(inline_trace_head_counters) &&
+                !TEST(FRAG_COARSE_GRAIN, f->flags) &&
+                TEST(FRAG_LINKED_INCOMING, f->flags))
+                unlink_fragment_incoming(dcontext, f);
             f->flags &= ~FRAG_IS_TRACE_HEAD;
             /* make sure not marked as trace head again */
             f->flags |= FRAG_CANNOT_BE_TRACE;
@@ -1285,6 +1285,13 @@ check_option_compatibility_helper(int recurse_count)
         SET_DEFAULT_VALUE(trace_counter_on_delete);
         changed_options = true;
     }
+#    if !defined(X86) || !defined(X64)
+    if (DYNAMO_OPTION(inline_trace_head_counters)) {
+        USAGE_ERROR("-inline_trace_head_counters is only supported on x86-64");
+        dynamo_options.inline_trace_head_counters = false;
+        changed_options = true;
+    }
+#    endif
     if (INTERNAL_OPTION(alt_hash_func) >= HASH_FUNCTION_ENUM_MAX) {
         USAGE_ERROR("Invalid selection (%d) for shared cache hash func, must be < %d",
                     INTERNAL_OPTION(alt_hash_func), HASH_FUNCTION_ENUM_MAX);
@@ -1878,6 +1885,46 @@ check_option_compatibility_helper(int recurse_count)
         changed_options = true;
     }
 #    endif
+#    ifdef LINUX
+    if (DYNAMO_OPTION(vmm_huge_pages)) {
+        if (DYNAMO_OPTION(satisfy_w_xor_x) || PAGE_SIZE != 4096) {
+            /* The dual-mapped vmcode is file-backed, and other base page sizes
+             * have a different huge page size.
+             */
+            USAGE_ERROR("-vmm_huge_pages requires 4K pages and no -satisfy_w_xor_x");
+            dynamo_options.vmm_huge_pages = false;
+            changed_options = true;
+        } else {
+            /* Guard pages would split adjacent units into separate mappings, none
+             * of which could be huge-backed.
+             */
+            if (DYNAMO_OPTION(guard_pages)) {
+                SYSLOG_INTERNAL_WARNING("-vmm_huge_pages disables -guard_pages");
+                dynamo_options.guard_pages = false;
+                changed_options = true;
+            }
+            /* Commits are capped at the unit size, so this commits whole units
+             * up to a huge page at a time.
+             */
+            if (DYNAMO_OPTION(heap_commit_increment) < VMM_HUGE_PAGE_SIZE) {
+                SYSLOG_INTERNAL_WARNING("-vmm_huge_pages raises -heap_commit_increment "
+                                        "from " SZFMT " to " SZFMT,
+                                        DYNAMO_OPTION(heap_commit_increment),
+                                        (size_t)VMM_HUGE_PAGE_SIZE);
+                dynamo_options.heap_commit_increment = VMM_HUGE_PAGE_SIZE;
+                changed_options = true;
+            }
+            if (DYNAMO_OPTION(cache_commit_increment) < VMM_HUGE_PAGE_SIZE) {
+                SYSLOG_INTERNAL_WARNING("-vmm_huge_pages raises -cache_commit_increment "
+                                        "from " SZFMT " to " SZFMT,
+                                        DYNAMO_OPTION(cache_commit_increment),
+                                        (size_t)VMM_HUGE_PAGE_SIZE);
+                dynamo_options.cache_commit_increment = VMM_HUGE_PAGE_SIZE;
+                changed_options = true;
+            }
+        }
+    }
+#    endif
 #    ifdef WINDOWS
     /* In theory ignore syscalls should work for int system calls, and also for
      * sysenter system calls when Sygate SPA is not installed [though haven't
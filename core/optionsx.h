@@ -905,6 +905,13 @@ OPTION_COMMAND(
 OPTION_DEFAULT_INTERNAL(
     uint, trace_counter_on_delete, 0U,
     "trace head counter will be reset to this value upon trace deletion")
+/* Rather than keeping trace heads unlinked so that every direct transfer to one
+ * exits the cache to have its counter incremented, link such transfers to a
+ * small per-head gate that counts in the cache and only exits once the head is
+ * hot.  Currently only supported on x86-64.
+ */
+OPTION_DEFAULT(bool, inline_trace_head_counters, false,
+               "count direct transfers to trace heads in the code cache")
 
 OPTION_DEFAULT(uint, max_elide_jmp, 16, "maximum direct jumps to elide in a basic block")
 OPTION_DEFAULT(uint, max_elide_call, 16, "maximum direct calls to elide in a basic block")
@@ -1327,6 +1334,8 @@ OPTION_DEFAULT(uint_size, initial_heap_nonpers_size, IF_WINDOWS_ELSE(24, 12) * 1
 /* initial_global_heap_unit_size may be adjusted by adjust_defaults_for_page_size(). */
 OPTION_DEFAULT(uint_size, initial_global_heap_unit_size, 24 * 1024,
                "initial global heap unit size")
+OPTION_DEFAULT(uint, global_heap_magazine_size, 32,
+               "max free global heap blocks cached per thread per size class (0=off)")
 /* if this is too small then once past the vm reservation we have too many
  * DR areas and subsequent problems with DR areas and allmem synch (i#369)
  */
@@ -1336,6 +1345,18 @@ OPTION_DEFAULT_INTERNAL(uint_size, max_heap_unit_size, 256 * 1024,
 OPTION_DEFAULT(uint_size, heap_commit_increment, 4 * 1024, "heap commit increment")
 /* cache_commit_increment may be adjusted by adjust_defaults_for_page_size(). */
 OPTION_DEFAULT(uint_size, cache_commit_increment, 4 * 1024, "cache commit increment")
+#ifdef LINUX
+/* Aligns the vmm reservations to VMM_HUGE_PAGE_SIZE, asks the kernel to back them
+ * with transparent huge pages, and raises the heap and cache commit increments to
+ * VMM_HUGE_PAGE_SIZE so committed ranges can be huge-backed.  Also turns off
+ * -guard_pages, as guard pages keep adjacent units from sharing a huge page.
+ * Each override is reported with an internal warning.
+ */
+OPTION_DEFAULT(bool, vmm_huge_pages, false,
+               "back the code cache and heap reservations with transparent huge pages; "
+               "disables -guard_pages and raises -heap_commit_increment and "
+               "-cache_commit_increment to 2M")
+#endif
 
 /* cache capacity control
  * FIXME: these are external for now while we study the right way to
@@ -1522,6 +1543,8 @@ OPTION_COMMAND(
 /* FIXME: separate for bb and trace shared caches? */
 OPTION_DEFAULT(bool, cache_shared_free_list, true,
                "use size-separated free lists to manage empty shared cache slots")
+OPTION_DEFAULT(bool, cache_shared_free_empty_units, true,
+               "release a full, non-current shared cache unit once it is entirely free")
 
 /* FIXME i#1674: enable on ARM once bugs are fixed, along with all the
  * reset_* trigger options as well.
@@ -3192,9 +3215,9 @@ OPTION_DEFAULT_INTERNAL(
 
 /* for stress testing can use 1 */
 OPTION_DEFAULT_INTERNAL(uint, vmarea_initial_size, 100, "initial vmarea vector size")
-/* FIXME: case 4471 should start smaller and double instead */
+/* Vectors grow by the larger of this and their current length (case 4471). */
 OPTION_DEFAULT_INTERNAL(uint, vmarea_increment_size, 100,
-                        "incremental vmarea vector size")
+                        "minimum incremental vmarea vector size")
 OPTION_INTERNAL(uint_addr, stress_fake_userva,
                 "pretend system address space starts at this address (case 9022)")
 
@@ -49,8 +49,12 @@ unit_test_memquery(void);
 void
 unit_test_options(void);
 void
+unit_test_heap(void);
+void
 unit_test_vmareas(void);
 void
+unit_test_fcache(void);
+void
 unit_test_utils(void);
 #ifdef WINDOWS
 void
@@ -80,7 +84,9 @@ main(int argc, char **argv, char **envp)
 #endif
     unit_test_utils();
     unit_test_options();
+    unit_test_heap();
     unit_test_vmareas();
+    unit_test_fcache();
 #ifdef WINDOWS
     unit_test_drwinapi();
 #endif
@@ -3611,6 +3611,25 @@ os_heap_commit(void *p, size_t size, uint prot, heap_error_code_t *error_code)
     return true;
 }
 
+#ifdef LINUX
+bool
+os_heap_advise_huge_pages(void *p, size_t size)
+{
+    long res;
+    /* should only be used on aligned pieces */
+    ASSERT(size > 0 && ALIGNED(p, PAGE_SIZE) && ALIGNED(size, PAGE_SIZE));
+    /* The advice is kept by the mprotect calls that later commit the pages. */
+    res = dynamorio_syscall(SYS_madvise, 3, p, size, MADV_HUGEPAGE);
+    if (res != 0) {
+        LOG(GLOBAL, LOG_HEAP, 1, "os_heap_advise_huge_pages failed: %ld\n", res);
+        return false;
+    }
+    LOG(GLOBAL, LOG_HEAP, 2, "os_heap_advise_huge_pages: " SZFMT " bytes @ " PFX "\n",
+        size, p);
+    return true;
+}
+#endif
+
 /* caller is required to handle thread synchronization and to update dynamo vm areas */
 void
 os_heap_decommit(void *p, size_t size, heap_error_code_t *error_code)
@@ -2753,6 +2753,17 @@ safe_is_in_coarse_stubs(dcontext_t *dcontext, app_pc pc, app_pc xsp)
     return in_coarse_stubs(pc);
 }
 
+static bool
+safe_is_in_trace_head_gate(dcontext_t *dcontext, app_pc pc, app_pc xsp)
+{
+    if (!DYNAMO_OPTION(inline_trace_head_counters) ||
+        dcontext->whereami != DR_WHERE_FCACHE || is_in_client_lib(pc) ||
+        is_in_dynamo_dll(pc) || is_on_initstack(xsp))
+        return false;
+    /* Reasonably certain not in DR code, so no locks should be held */
+    return trace_head_gate_fragment(pc) != NULL;
+}
+
 static bool
 is_on_alt_stack(dcontext_t *dcontext, byte *sp)
 {
@@ -4654,6 +4665,9 @@ find_next_fragment_from_gencode(dcontext_t *dcontext, sigcontext_t *sc)
 #else
 #    error Unsupported arch.
 #endif
+    } else if (DYNAMO_OPTION(inline_trace_head_counters) &&
+               (f = trace_head_gate_fragment(pc)) != NULL) {
+        /* A trace head gate either enters its head or returns to d_r_dispatch */
     } else if (in_indirect_branch_lookup_code(dcontext, pc)) {
         /* Try to find the target if the signal arrived in the IBL.
          * We could try to be a lot more precise by hardcoding the IBL
@@ -4929,7 +4943,8 @@ record_pending_signal(dcontext_t *dcontext, int sig, kernel_ucontext_t *ucxt,
         }
     } else if (in_generated_routine(dcontext, pc) ||
                /* XXX: should also check fine stubs */
-               safe_is_in_coarse_stubs(dcontext, pc, xsp)) {
+               safe_is_in_coarse_stubs(dcontext, pc, xsp) ||
+               safe_is_in_trace_head_gate(dcontext, pc, xsp)) {
         /* Assumption: dynamo errors have been caught already inside
          * the main_signal_handler, thus any error in a generated routine
          * is an asynch signal that can be delayed
@@ -536,6 +536,7 @@ enum {
     LOCK_RANK(profile_callers_lock), /* < global_alloc_lock */
 #    endif
     LOCK_RANK(coarse_stub_areas), /* < global_alloc_lock */
+    LOCK_RANK(trace_head_gate_areas), /* > special_heap_lock, < global_alloc_lock */
     LOCK_RANK(moduledb_lock),     /* < global heap allocation */
     LOCK_RANK(pcache_dir_check_lock),
 #    ifdef UNIX
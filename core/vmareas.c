@@ -330,6 +330,15 @@ static app_pc tamper_resistant_region_start, tamper_resistant_region_end;
  */
 static thread_data_t *shared_data; /* set in vm_areas_reset_init() */
 
+/* A buffer replaced by a resize of a VECTOR_LOCKLESS_LOOKUP vector.  Lockless
+ * readers may still be walking it, so it is kept until the vector is reset.
+ */
+typedef struct _vmvector_retired_buf_t {
+    vm_area_t *buf;
+    int size; /* capacity */
+    struct _vmvector_retired_buf_t *next;
+} vmvector_retired_buf_t;
+
 typedef struct _pending_delete_t {
 #ifdef DEBUG
     /* record bounds of original deleted region, for debugging only */
@@ -842,6 +851,34 @@ writelock_if_not_already(vm_area_vector_t *v)
     return false;
 }
 
+/* For VECTOR_LOCKLESS_LOOKUP vectors: marks the start of a change to v's buf,
+ * length, or area bounds.  Returns whether this call started the change, to be
+ * passed to vmvector_mutate_end(); a nested call (add_vm_area() recurses) is a nop.
+ * Caller must hold v's write lock.
+ */
+static inline bool
+vmvector_mutate_begin(vm_area_vector_t *v)
+{
+    if (!TEST(VECTOR_LOCKLESS_LOOKUP, v->flags) || TEST(1, v->version))
+        return false;
+    ATOMIC_INC(int, v->version);
+    /* No buf or length store may become visible before the version turns odd.
+     * The atomic increment is not a full barrier on every architecture.
+     */
+    MEMORY_STORE_BARRIER();
+    return true;
+}
+
+static inline void
+vmvector_mutate_end(vm_area_vector_t *v, bool started)
+{
+    if (!started)
+        return;
+    ASSERT(TEST(1, v->version));
+    MEMORY_STORE_BARRIER();
+    ATOMIC_INC(int, v->version);
+}
+
 static void
 vm_area_vector_check_size(vm_area_vector_t *v)
 {
@@ -854,11 +891,39 @@ vm_area_vector_check_size(vm_area_vector_t *v)
             v->buf = (vm_area_t *)global_heap_alloc(
                 v->size * sizeof(struct vm_area_t) HEAPACCT(ACCT_VMAREAS));
         } else {
-            /* FIXME: case 4471 we should be doubling size here */
-            int new_size = (INTERNAL_OPTION(vmarea_increment_size) + v->length);
+            /* Case 4471: grow geometrically so a vector with many areas is not
+             * copied on every few additions.
+             */
+            int new_size =
+                v->length + MAX((int)INTERNAL_OPTION(vmarea_increment_size), v->length);
             STATS_INC(num_vmareas_resized);
-            v->buf = global_heap_realloc(v->buf, v->size, new_size,
-                                         sizeof(struct vm_area_t) HEAPACCT(ACCT_VMAREAS));
+            if (TEST(VECTOR_LOCKLESS_LOOKUP, v->flags)) {
+                /* Lockless readers may still be walking the old buffer, so we
+                 * retire it instead of freeing it.  With doubling the retired
+                 * buffers together are smaller than the live one.
+                 */
+                vmvector_retired_buf_t *retired =
+                    (vmvector_retired_buf_t *)global_heap_alloc(
+                        sizeof(*retired) HEAPACCT(ACCT_VMAREAS));
+                vm_area_t *new_buf = (vm_area_t *)global_heap_alloc(
+                    new_size * sizeof(struct vm_area_t) HEAPACCT(ACCT_VMAREAS));
+                ASSERT(TEST(1, v->version));
+                memcpy(new_buf, v->buf, v->length * sizeof(struct vm_area_t));
+                retired->buf = v->buf;
+                retired->size = v->size;
+                retired->next = v->retired;
+                v->retired = retired;
+                v->buf = new_buf;
+                /* A reader that read the version just before our mutation began
+                 * must not see the grown length with the old buf: the barrier
+                 * orders the buf store first.
+                 */
+                MEMORY_STORE_BARRIER();
+            } else {
+                v->buf = global_heap_realloc(
+                    v->buf, v->size, new_size,
+                    sizeof(struct vm_area_t) HEAPACCT(ACCT_VMAREAS));
+            }
             v->size = new_size;
         }
         ASSERT(v->buf != NULL);
@@ -919,6 +984,7 @@ add_vm_area(vm_area_vector_t *v, app_pc start, app_pc end, uint vm_flags, uint f
     int i, j, diff;
     /* if we have overlap, we extend an existing area -- else we add a new area */
     int overlap_start = -1, overlap_end = -1;
+    bool mutating;
     DEBUG_DECLARE(uint flagignore;)
     IF_UNIX(IF_DEBUG(IF_NO_MEMQUERY(extern vm_area_vector_t * all_memory_areas;)))
 
@@ -931,6 +997,7 @@ add_vm_area(vm_area_vector_t *v, app_pc start, app_pc end, uint vm_flags, uint f
                                       ? " all_memory_areas"
                                       : (v == dynamo_areas ? " dynamo_areas" : ""))),
         start, end, comment);
+    mutating = vmvector_mutate_begin(v);
     /* N.B.: new area could span multiple existing areas! */
     for (i = 0; i < v->length; i++) {
         /* look for overlap, or adjacency of same type (including all flags, and never
@@ -1269,6 +1336,7 @@ add_vm_area(vm_area_vector_t *v, app_pc start, app_pc end, uint vm_flags, uint f
             vm_area_clean_fraglist(dcontext, &v->buf[i]);
         }
     }
+    vmvector_mutate_end(v, mutating);
     DOLOG(5, LOG_VMAREAS, { print_vm_areas(v, GLOBAL); });
 }
 
@@ -1326,6 +1394,7 @@ remove_vm_area(vm_area_vector_t *v, app_pc start, app_pc end, bool restore_prot)
     int i, diff;
     int overlap_start = -1, overlap_end = -1;
     bool add_new_area = false;
+    bool mutating;
     vm_area_t new_area = { 0 }; /* used only when add_new_area, wimpy compiler */
     /* FIXME: cleaner test? shared_data copies flags, but uses
      * custom.frags and not custom.client
@@ -1350,6 +1419,7 @@ remove_vm_area(vm_area_vector_t *v, app_pc start, app_pc end, bool restore_prot)
         return false;
     if (overlap_end == -1)
         overlap_end = v->length;
+    mutating = vmvector_mutate_begin(v);
     /* since it's sorted and there are no overlaps, we do not have to re-sort.
      * we just delete entire intervals affected, and shorten non-entire
      */
@@ -1484,6 +1554,7 @@ remove_vm_area(vm_area_vector_t *v, app_pc start, app_pc end, bool restore_prot)
                     new_area.frag_flags,
                     new_area.custom.client _IF_DEBUG(new_area.comment));
     }
+    vmvector_mutate_end(v, mutating);
     DOLOG(5, LOG_VMAREAS, { print_vm_areas(v, GLOBAL); });
     return true;
 }
@@ -1582,6 +1653,66 @@ vm_area_overlap(vm_area_vector_t *v, app_pc start, app_pc end)
     return binary_search(v, start, end, NULL, NULL, false);
 }
 
+/* Lockless counterpart of binary_search() for VECTOR_LOCKLESS_LOOKUP vectors,
+ * for use without holding v->lock.  If [start,end) overlaps an area, sets *found
+ * and, if area is non-NULL, copies an overlapping area into *area.
+ * Returns false if a writer raced with the lookup, in which case the caller must
+ * redo it under the lock.
+ * Only single-word fields of the copy are coherent with respect to in-place
+ * updates made under the write lock without a vmvector_mutate_begin().
+ */
+static bool
+lockless_lookup(vm_area_vector_t *v, app_pc start, app_pc end, vm_area_t *area /*OUT*/,
+                bool *found /*OUT*/)
+{
+    /* This is a seqlock read: the load barriers pair with the store barriers in
+     * vmvector_mutate_{begin,end}() and vm_area_vector_check_size().  They are
+     * nops on x86, which does not reorder loads with other loads; volatile keeps
+     * the compiler from doing so.
+     */
+    volatile vm_area_vector_t *vv = v;
+    volatile vm_area_t *buf;
+    int version, min, max;
+    ASSERT(start != NULL || end != NULL);
+    ASSERT(start <= end || end == NULL /* wraparound */);
+    if (!TEST(VECTOR_LOCKLESS_LOOKUP, v->flags))
+        return false;
+    version = vv->version;
+    if (TEST(1, version)) {
+        STATS_INC(num_vmareas_lockless_retries);
+        return false;
+    }
+    MEMORY_LOAD_BARRIER();
+    /* Read length before buf: a resize publishes the new buf before length can
+     * grow past the old capacity, so buf[0..length) is always in bounds.
+     */
+    min = 0;
+    max = vv->length - 1;
+    MEMORY_LOAD_BARRIER();
+    buf = vv->buf;
+    *found = false;
+    while (max >= min) {
+        int i = (min + max) / 2;
+        if (end != NULL && end <= buf[i].start)
+            max = i - 1;
+        else if (start >= buf[i].end || start == end)
+            min = i + 1;
+        else {
+            if (area != NULL)
+                *area = buf[i];
+            *found = true;
+            break;
+        }
+    }
+    MEMORY_LOAD_BARRIER();
+    if (vv->version != version) {
+        STATS_INC(num_vmareas_lockless_retries);
+        return false;
+    }
+    STATS_INC(num_vmareas_lockless_lookups);
+    return true;
+}
+
 /*********************** EXPORTED ROUTINES **********************/
 
 /* thread-shared initialization that should be repeated after a reset */
@@ -1619,8 +1750,8 @@ vm_areas_init()
      * We're already paying the indirection cost by passing their addresses
      * to generic routines, after all.
      */
-    VMVECTOR_ALLOC_VECTOR(executable_areas, GLOBAL_DCONTEXT, VECTOR_SHARED,
-                          executable_areas);
+    VMVECTOR_ALLOC_VECTOR(executable_areas, GLOBAL_DCONTEXT,
+                          VECTOR_SHARED | VECTOR_LOCKLESS_LOOKUP, executable_areas);
     VMVECTOR_ALLOC_VECTOR(pretend_writable_areas, GLOBAL_DCONTEXT, VECTOR_SHARED,
                           pretend_writable_areas);
     VMVECTOR_ALLOC_VECTOR(patch_proof_areas, GLOBAL_DCONTEXT, VECTOR_SHARED,
@@ -1629,7 +1760,8 @@ vm_areas_init()
                           emulate_write_areas);
     VMVECTOR_ALLOC_VECTOR(IAT_areas, GLOBAL_DCONTEXT, VECTOR_SHARED, IAT_areas);
     VMVECTOR_ALLOC_VECTOR(written_areas, GLOBAL_DCONTEXT,
-                          VECTOR_SHARED | VECTOR_NEVER_MERGE, written_areas);
+                          VECTOR_SHARED | VECTOR_NEVER_MERGE | VECTOR_LOCKLESS_LOOKUP,
+                          written_areas);
     vmvector_set_callbacks(written_areas, free_written_area, NULL, NULL, NULL);
 #ifdef PROGRAM_SHEPHERDING
     VMVECTOR_ALLOC_VECTOR(futureexec_areas, GLOBAL_DCONTEXT, VECTOR_SHARED,
@@ -1995,6 +2127,8 @@ vmvector_overlap(vm_area_vector_t *v, app_pc start, app_pc end)
     bool release_lock; /* 'true' means this routine needs to unlock */
     if (vmvector_empty(v))
         return false;
+    if (lockless_lookup(v, start, end, NULL, &overlap))
+        return overlap;
     LOCK_VECTOR(v, release_lock, read);
     ASSERT_OWN_READWRITE_LOCK(SHOULD_LOCK_VECTOR(v), &v->lock);
     overlap = vm_area_overlap(v, start, end);
@@ -2024,8 +2158,20 @@ vmvector_lookup_data(vm_area_vector_t *v, app_pc pc, app_pc *start /* OUT */,
 {
     bool overlap;
     vm_area_t *area = NULL;
+    vm_area_t area_copy;
     bool release_lock; /* 'true' means this routine needs to unlock */
 
+    if (lockless_lookup(v, pc, pc + 1 /*open end*/, &area_copy, &overlap)) {
+        if (overlap) {
+            if (start != NULL)
+                *start = area_copy.start;
+            if (end != NULL)
+                *end = area_copy.end;
+            if (data != NULL)
+                *data = area_copy.custom.client;
+        }
+        return overlap;
+    }
     LOCK_VECTOR(v, release_lock, read);
     ASSERT_OWN_READWRITE_LOCK(SHOULD_LOCK_VECTOR(v), &v->lock);
     overlap = lookup_addr(v, pc, &area);
@@ -2172,6 +2318,15 @@ vmvector_reset_vector(dcontext_t *dcontext, vm_area_vector_t *v)
         v->buf = NULL;
     } else
         ASSERT(v->size == 0 && v->length == 0);
+    /* Resets happen with all threads synched, so no lockless reader remains. */
+    while (v->retired != NULL) {
+        vmvector_retired_buf_t *next = v->retired->next;
+        global_heap_free(v->retired->buf,
+                         v->retired->size *
+                             sizeof(struct vm_area_t) HEAPACCT(ACCT_VMAREAS));
+        global_heap_free(v->retired, sizeof(*v->retired) HEAPACCT(ACCT_VMAREAS));
+        v->retired = next;
+    }
 }
 
 static void
@@ -2493,7 +2648,11 @@ add_executable_vm_area_check_IAT(app_pc *start /*IN/OUT*/, app_pc *end /*IN/OUT*
                 ASSERT(IAT_end > orig_start && IAT_end < area->start);
                 ASSERT(*start == IAT_end); /* set up above */
                 *end = area->end;
-                area->start = *start;
+                {
+                    bool mutating = vmvector_mutate_begin(executable_areas);
+                    area->start = *start;
+                    vmvector_mutate_end(executable_areas, mutating);
+                }
                 *existing_area = area;
                 STATS_INC(coarse_merge_IAT);
                 /* If info was loaded prior to rebinding just use it.
@@ -2989,6 +3148,8 @@ bool
 is_executable_address(app_pc addr)
 {
     bool found;
+    if (lockless_lookup(executable_areas, addr, addr + 1 /*open end*/, NULL, &found))
+        return found;
     d_r_read_lock(&executable_areas->lock);
     found = lookup_addr(executable_areas, addr, NULL);
     d_r_read_unlock(&executable_areas->lock);
@@ -3003,7 +3164,13 @@ bool
 get_executable_area_vm_flags(app_pc addr, uint *vm_flags)
 {
     bool found = false;
-    vm_area_t *area;
+    vm_area_t *area, area_copy;
+    if (lockless_lookup(executable_areas, addr, addr + 1 /*open end*/, &area_copy,
+                        &found)) {
+        if (found)
+            *vm_flags = area_copy.vm_flags;
+        return found;
+    }
     d_r_read_lock(&executable_areas->lock);
     if (lookup_addr(executable_areas, addr, &area)) {
         *vm_flags = area->vm_flags;
@@ -3023,7 +3190,13 @@ bool
 get_executable_area_flags(app_pc addr, uint *frag_flags)
 {
     bool found = false;
-    vm_area_t *area;
+    vm_area_t *area, area_copy;
+    if (lockless_lookup(executable_areas, addr, addr + 1 /*open end*/, &area_copy,
+                        &found)) {
+        if (found)
+            *frag_flags = area_copy.frag_flags;
+        return found;
+    }
     d_r_read_lock(&executable_areas->lock);
     if (lookup_addr(executable_areas, addr, &area)) {
         *frag_flags = area->frag_flags;
@@ -3491,7 +3664,7 @@ was_executable_area_writable(app_pc addr)
 bool
 is_executable_area_selfmod(app_pc addr)
 {
-    uint flags;
+    uint flags = 0;
     if (get_executable_area_flags(addr, &flags))
         return TEST(FRAG_SELFMOD_SANDBOXED, flags);
     else
@@ -3834,6 +4007,8 @@ bool
 executable_vm_area_overlap(app_pc start, app_pc end, bool have_writelock)
 {
     bool overlap;
+    if (!have_writelock && lockless_lookup(executable_areas, start, end, NULL, &overlap))
+        return overlap;
     if (!have_writelock)
         d_r_read_lock(&executable_areas->lock);
     overlap = vm_area_overlap(executable_areas, start, end);
@@ -3934,7 +4109,7 @@ is_address_on_stack(dcontext_t *dcontext, app_pc address)
 bool
 is_driver_address(app_pc addr)
 {
-    uint vm_flags;
+    uint vm_flags = 0;
     if (get_executable_area_vm_flags(addr, &vm_flags)) {
         return TEST(VM_DRIVER_ADDRESS, vm_flags);
     }
@@ -6345,7 +6520,7 @@ tamper_resistant_region_overlap(app_pc start, app_pc end)
 bool
 is_jit_managed_area(app_pc addr)
 {
-    uint vm_flags;
+    uint vm_flags = 0;
     if (get_executable_area_vm_flags(addr, &vm_flags))
         return TEST(VM_JIT_MANAGED, vm_flags);
     else
@@ -10969,10 +11144,15 @@ handle_modified_code(dcontext_t *dcontext, cache_pc instr_cache_pc, app_pc instr
 uint *
 get_selfmod_exec_counter(app_pc tag)
 {
-    vm_area_t *area = NULL;
+    vm_area_t *area = NULL, area_copy;
     ro_vs_sandbox_data_t *ro2s;
     uint *counter;
     bool ok;
+    if (lockless_lookup(written_areas, tag, tag + 1 /*open end*/, &area_copy, &ok) &&
+        ok) {
+        ro2s = (ro_vs_sandbox_data_t *)area_copy.custom.client;
+        return &ro2s->selfmod_execs;
+    }
     d_r_read_lock(&written_areas->lock);
     ok = lookup_addr(written_areas, tag, &area);
     if (!ok) {
@@ -11712,6 +11892,119 @@ vmvector_tests()
         vmvector_remove(&v, INT_TO_PC(0x20), INT_TO_PC(0x210)); /* truncation allowed? */
     EXPECT(res, true);
     vmvector_print(&v, STDERR);
+    /* Take the stack lock off the global lock list before its frame goes away. */
+    DELETE_READWRITE_LOCK(v.lock);
+}
+
+#    ifdef UNIX
+#        include <pthread.h>
+#    endif
+
+#    define LOCKLESS_NUM_STABLE 8
+#    define LOCKLESS_NUM_CHURN 150
+#    define LOCKLESS_NUM_ROUNDS 200
+/* Stable areas sit at odd multiples of the stride, churn at even multiples. */
+#    define LOCKLESS_STRIDE 0x10000
+#    define LOCKLESS_STABLE_START(k) INT_TO_PC((2 * (k) + 1) * LOCKLESS_STRIDE)
+
+static volatile bool lockless_done;
+static volatile int lockless_hits;
+
+/* Looks up the stable areas, which the main thread never touches, while the main
+ * thread shifts and resizes the vector around them.  This thread is not set up
+ * for DR locks (it sees the main thread's TLS), so it only does the lockless
+ * lookups, skipping those that raced with a writer.
+ */
+static IF_UNIX_ELSE(void *, DWORD WINAPI) lockless_reader(void *arg)
+{
+    vm_area_vector_t *v = (vm_area_vector_t *)arg;
+    while (!lockless_done) {
+        int k;
+        for (k = 0; k < LOCKLESS_NUM_STABLE; k++) {
+            app_pc pc = LOCKLESS_STABLE_START(k) + 0x80;
+            vm_area_t area;
+            bool found;
+            if (lockless_lookup(v, pc, pc + 1, &area, &found)) {
+                EXPECT(found, true);
+                EXPECT(area.start, LOCKLESS_STABLE_START(k));
+                EXPECT(area.end, LOCKLESS_STABLE_START(k) + 0x100);
+                EXPECT(area.custom.client, k + 1);
+                lockless_hits++;
+            }
+        }
+    }
+    return 0;
+}
+
+static void
+vmvector_lockless_tests(void)
+{
+    vm_area_vector_t *v;
+    int i, j, hits_before;
+    bool mutating, found;
+    IF_UNIX_ELSE(pthread_t, HANDLE) reader;
+    print_file(STDERR, "\nvm_area_vector_t lockless lookup tests\n");
+    VMVECTOR_ALLOC_VECTOR(v, GLOBAL_DCONTEXT,
+                          VECTOR_SHARED | VECTOR_NEVER_MERGE | VECTOR_LOCKLESS_LOOKUP,
+                          thread_vm_areas);
+    for (i = 0; i < LOCKLESS_NUM_STABLE; i++) {
+        vmvector_add(v, LOCKLESS_STABLE_START(i), LOCKLESS_STABLE_START(i) + 0x100,
+                     (void *)(ptr_uint_t)(i + 1));
+    }
+    /* A lookup during a mutation must defer to the lock. */
+    mutating = vmvector_mutate_begin(v);
+    EXPECT(mutating, true);
+    EXPECT(vmvector_mutate_begin(v), false); /* nested */
+    EXPECT(lockless_lookup(v, LOCKLESS_STABLE_START(0), LOCKLESS_STABLE_START(0) + 1,
+                           NULL, &found),
+           false);
+    vmvector_mutate_end(v, mutating);
+    EXPECT(lockless_lookup(v, LOCKLESS_STABLE_START(0), LOCKLESS_STABLE_START(0) + 1,
+                           NULL, &found),
+           true);
+    EXPECT(found, true);
+
+    lockless_done = false;
+#    ifdef UNIX
+    pthread_create(&reader, NULL, lockless_reader, v);
+#    else
+    reader = CreateThread(NULL, 0, lockless_reader, v, 0, NULL);
+#    endif
+    while (lockless_hits == 0)
+        os_thread_yield();
+    hits_before = lockless_hits;
+    /* Each round inserts areas below and between the stable ones, shifting them
+     * within buf and, on the first round, growing buf past its initial size.
+     * We yield between rounds so the reader also runs on a single core.
+     */
+    for (i = 0; i < LOCKLESS_NUM_ROUNDS; i++) {
+        for (j = 0; j < LOCKLESS_NUM_CHURN; j++) {
+            app_pc start = INT_TO_PC((j % (LOCKLESS_NUM_STABLE + 1)) * 2 *
+                                         LOCKLESS_STRIDE +
+                                     (j / (LOCKLESS_NUM_STABLE + 1) + 1) * 0x100);
+            vmvector_add(v, start, start + 0x10, NULL);
+        }
+        EXPECT(v->length, LOCKLESS_NUM_STABLE + LOCKLESS_NUM_CHURN);
+        vmvector_remove(v, INT_TO_PC(0), LOCKLESS_STABLE_START(0));
+        for (j = 0; j < LOCKLESS_NUM_STABLE; j++) {
+            vmvector_remove(v, LOCKLESS_STABLE_START(j) + 0x100,
+                            LOCKLESS_STABLE_START(j + 1));
+        }
+        EXPECT(v->length, LOCKLESS_NUM_STABLE);
+        os_thread_yield();
+    }
+    lockless_done = true;
+#    ifdef UNIX
+    pthread_join(reader, NULL);
+#    else
+    WaitForSingleObject(reader, INFINITE);
+#    endif
+    EXPECT(TEST(1, v->version), false);
+    EXPECT_RELATION(lockless_hits, >, hits_before);
+    /* Frees the buffers retired by the resizes too. */
+    vmvector_reset_vector(GLOBAL_DCONTEXT, v);
+    EXPECT(v->retired, NULL);
+    vmvector_delete_vector(GLOBAL_DCONTEXT, v);
 }
 
 /* initial vector tests
@@ -11874,5 +12167,6 @@ unit_test_vmareas(void)
     EXPECT(index, 2);
 
     vmvector_tests();
+    vmvector_lockless_tests();
 }
 #endif /* STANDALONE_UNIT_TEST */
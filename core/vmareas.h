@@ -67,6 +67,11 @@ enum {
      * flag to avoid the redundant vector-level lock
      */
     VECTOR_NO_LOCK = 0x0010,
+    /* Readers of a few hot queries may skip the lock: writers bump the vector's
+     * version around each mutation and readers retry under the lock if it
+     * changed.  Requires VECTOR_SHARED and a lock.
+     */
+    VECTOR_LOCKLESS_LOOKUP = 0x0020,
 };
 
 #define VECTOR_NEVER_MERGE (VECTOR_NEVER_MERGE_ADJACENT | VECTOR_NEVER_OVERLAP)
@@ -89,6 +94,12 @@ struct vm_area_vector_t {
      * to perform a read (don't need full recursive lock)
      */
     read_write_lock_t lock;
+    /* For VECTOR_LOCKLESS_LOOKUP: odd while a writer is mutating buf or length. */
+    volatile int version;
+    /* For VECTOR_LOCKLESS_LOOKUP: buffers replaced on a resize, which lockless
+     * readers may still be walking.  Freed when the vector is reset.
+     */
+    struct _vmvector_retired_buf_t *retired;
 
     /* Callbacks to support payloads */
     /* Frees a payload */
@@ -35,7 +35,8 @@
  * Collects information about basic blocks that have been executed.
  * It simply stores the information of basic blocks seen in bb callback event
  * into a table without any instrumentation, and dumps the buffer into log files
- * on thread/process exit.
+ * on thread/process exit.  With DRCOVLIB_HIT_COUNTS it additionally inserts an
+ * inline counter increment into each block.
  *
  * There are pros and cons to creating this coverage library as opposed to other
  * tools using the drcov client straight-up as a 2nd client: DR has support for
@@ -52,6 +53,7 @@
 
 #include "dr_api.h"
 #include "drmgr.h"
+#include "drreg.h"
 #include "drx.h"
 #include "drcovlib.h"
 #include "hashtable.h"
@@ -59,6 +61,7 @@
 #include "modules.h"
 #include "drcovlib_private.h"
 #include <limits.h>
+#include <stddef.h>
 #include <string.h>
 
 #define UNKNOWN_MODULE_ID USHRT_MAX
@@ -73,12 +76,36 @@ static char logdir[MAXIMUM_PATH];
 
 typedef struct _per_thread_t {
     void *bb_table;
+    /* For DRCOVLIB_HIT_COUNTS, a uint64 counter per bb_table entry at the same index. */
+    void *count_table;
+    /* The counter of the block being built, from the analysis to the insertion phase.
+     * For !drcov_per_thread each thread has its own copy of this struct.
+     */
+    uint64 *bb_counter;
+    /* For DRCOVLIB_HIT_COUNTS, maps each tag to the counter of the block most
+     * recently built for it, indexed by for_trace, so translation re-creates the
+     * same code.  The counter address is materialized with a variable number of
+     * instructions on AArchXX, so any other counter could change the code size.
+     */
+    hashtable_t *counter_map[2];
     file_t log;
     char logname[MAXIMUM_PATH];
 } per_thread_t;
 
 static per_thread_t *global_data;
 static bool drcov_per_thread = false;
+/* For !drcov_per_thread with hit counts or snapshots: keeps the bb and count tables
+ * in step and the table size consistent with the entries dumped.
+ */
+static void *table_lock;
+static volatile bool snapshot_exiting;
+/* The snapshot thread has its own process id on Linux, so we record the app's. */
+static process_id_t snapshot_pid;
+/* Each snapshot is written to the temporary file and then renamed over the
+ * previous one, so there is a single snapshot file per process.
+ */
+static char snapshot_name[MAXIMUM_PATH];
+static char snapshot_tmp_name[MAXIMUM_PATH];
 #ifndef WINDOWS
 static int sysnum_execve = IF_X64_ELSE(59, 11);
 #endif
@@ -90,12 +117,11 @@ static int drcovlib_init_count;
  * Utility Functions
  */
 static file_t
-log_file_create_helper(void *drcontext, const char *suffix, char *buf, size_t buf_els)
+log_file_create_helper(void *drcontext, ptr_int_t id, const char *suffix, char *buf,
+                       size_t buf_els)
 {
     file_t log = drx_open_unique_appid_file(
-        options.logdir,
-        drcontext == NULL ? dr_get_process_id() : dr_get_thread_id(drcontext),
-        options.logprefix, suffix,
+        options.logdir, id, options.logprefix, suffix,
 #ifndef WINDOWS
         DR_FILE_CLOSE_ON_FORK |
 #endif
@@ -111,9 +137,10 @@ log_file_create_helper(void *drcontext, const char *suffix, char *buf, size_t bu
 static void
 log_file_create(void *drcontext, per_thread_t *data)
 {
-    data->log =
-        log_file_create_helper(drcontext, drcontext == NULL ? "proc.log" : "thd.log",
-                               data->logname, BUFFER_SIZE_ELEMENTS(data->logname));
+    data->log = log_file_create_helper(
+        drcontext, drcontext == NULL ? dr_get_process_id() : dr_get_thread_id(drcontext),
+        drcontext == NULL ? "proc.log" : "thd.log", data->logname,
+        BUFFER_SIZE_ELEMENTS(data->logname));
 }
 
 /****************************************************************************
@@ -131,6 +158,30 @@ bb_table_entry_print(ptr_uint_t idx, void *entry, void *iter_data)
     return true; /* continue iteration */
 }
 
+static bool
+count_table_entry_print(ptr_uint_t idx, void *entry, void *iter_data)
+{
+    per_thread_t *data = iter_data;
+    dr_fprintf(data->log, "bb[%5u]: " UINT64_FORMAT_STRING "\n", (uint)idx,
+               *(uint64 *)entry);
+    return true; /* continue iteration */
+}
+
+static void
+count_table_print(void *drcontext, per_thread_t *data)
+{
+    ASSERT(drtable_num_entries(data->count_table) ==
+               drtable_num_entries(data->bb_table),
+           "hit counts out of step with bb table");
+    dr_fprintf(data->log, "BB Hit Counts: %u bbs\n",
+               (uint)drtable_num_entries(data->count_table));
+    if (TEST(DRCOVLIB_DUMP_AS_TEXT, options.flags)) {
+        dr_fprintf(data->log, "bb index, hits:\n");
+        drtable_iterate(data->count_table, data, count_table_entry_print);
+    } else
+        drtable_dump_entries(data->count_table, data->log);
+}
+
 static void
 bb_table_print(void *drcontext, per_thread_t *data)
 {
@@ -139,6 +190,8 @@ bb_table_print(void *drcontext, per_thread_t *data)
         ASSERT(false, "invalid log file");
         return;
     }
+    if (table_lock != NULL)
+        dr_mutex_lock(table_lock);
     /* We do not support >32U-bit-max (~4 billion) blocks.
      * drcov2lcov would need a number of changes to support this.
      * We have a debug-build check here.
@@ -152,16 +205,32 @@ bb_table_print(void *drcontext, per_thread_t *data)
         drtable_iterate(data->bb_table, data, bb_table_entry_print);
     } else
         drtable_dump_entries(data->bb_table, data->log);
+    if (data->count_table != NULL)
+        count_table_print(drcontext, data);
+    if (table_lock != NULL)
+        dr_mutex_unlock(table_lock);
 }
 
-static void
+/* Returns the new entry's counter, or NULL without DRCOVLIB_HIT_COUNTS. */
+static uint64 *
 bb_table_entry_add(void *drcontext, per_thread_t *data, app_pc start, uint size)
 {
-    bb_entry_t *bb_entry = drtable_alloc(data->bb_table, 1, NULL);
+    bb_entry_t *bb_entry;
+    uint64 *counter = NULL;
     uint mod_id;
     app_pc mod_seg_start;
     drcovlib_status_t res =
         drmodtrack_lookup_segment(drcontext, start, &mod_id, &mod_seg_start);
+    /* A snapshot may dump the tables as soon as we unlock, so the new entries
+     * must be complete by then.
+     */
+    if (table_lock != NULL)
+        dr_mutex_lock(table_lock);
+    bb_entry = drtable_alloc(data->bb_table, 1, NULL);
+    if (data->count_table != NULL) {
+        counter = drtable_alloc(data->count_table, 1, NULL);
+        *counter = 0;
+    }
     /* we do not de-duplicate repeated bbs */
     ASSERT(size < USHRT_MAX, "size overflow");
     bb_entry->size = (ushort)size;
@@ -179,6 +248,9 @@ bb_table_entry_add(void *drcontext, per_thread_t *data, app_pc start, uint size)
         bb_entry->mod_id = UNKNOWN_MODULE_ID;
         bb_entry->start = (uint)(ptr_uint_t)start;
     }
+    if (table_lock != NULL)
+        dr_mutex_unlock(table_lock);
+    return counter;
 }
 
 #define INIT_BB_TABLE_ENTRIES 4096
@@ -195,6 +267,41 @@ bb_table_destroy(void *table, void *data)
     drtable_destroy(table, data);
 }
 
+static void *
+count_table_create(void)
+{
+    /* The counters are updated by code cache instructions that address them
+     * directly, so they must be reachable.
+     */
+    return drtable_create(INIT_BB_TABLE_ENTRIES, sizeof(uint64), DRTABLE_MEM_REACHABLE,
+                          false /*synch*/, NULL);
+}
+
+#define COUNTER_MAP_HASH_BITS 12
+static hashtable_t *
+counter_map_create(void *drcontext)
+{
+    hashtable_t *map;
+    if (drcontext == NULL)
+        map = dr_global_alloc(sizeof(*map));
+    else
+        map = dr_thread_alloc(drcontext, sizeof(*map));
+    /* The process-wide map is read by translation in any thread. */
+    hashtable_init_ex(map, COUNTER_MAP_HASH_BITS, HASH_INTPTR, false /*!strdup*/,
+                      drcontext == NULL /*synch*/, NULL, NULL, NULL);
+    return map;
+}
+
+static void
+counter_map_destroy(void *drcontext, hashtable_t *map)
+{
+    hashtable_delete(map);
+    if (drcontext == NULL)
+        dr_global_free(map, sizeof(*map));
+    else
+        dr_thread_free(drcontext, map, sizeof(*map));
+}
+
 static void
 version_print(file_t log)
 {
@@ -255,7 +362,17 @@ thread_data_create(void *drcontext)
     /* XXX: can we assume bb create event is serialized,
      * if so, no lock is required for bb_table operation.
      */
-    data->bb_table = bb_table_create(drcontext == NULL ? true : false);
+    data->bb_table = bb_table_create(drcontext == NULL && table_lock == NULL);
+    if (TEST(DRCOVLIB_HIT_COUNTS, options.flags)) {
+        data->count_table = count_table_create();
+        data->counter_map[0] = counter_map_create(drcontext);
+        data->counter_map[1] = counter_map_create(drcontext);
+    } else {
+        data->count_table = NULL;
+        data->counter_map[0] = NULL;
+        data->counter_map[1] = NULL;
+    }
+    data->bb_counter = NULL;
     log_file_create(drcontext, data);
     return data;
 }
@@ -265,6 +382,11 @@ thread_data_destroy(void *drcontext, per_thread_t *data)
 {
     /* destroy the bb table */
     bb_table_destroy(data->bb_table, data);
+    if (data->count_table != NULL) {
+        drtable_destroy(data->count_table, data);
+        counter_map_destroy(drcontext, data->counter_map[0]);
+        counter_map_destroy(drcontext, data->counter_map[1]);
+    }
     dr_close_file(data->log);
     /* free thread data */
     if (drcontext == NULL) {
@@ -288,6 +410,78 @@ global_data_destroy(per_thread_t *data)
     thread_data_destroy(NULL, data);
 }
 
+/****************************************************************************
+ * Periodic Snapshots
+ */
+
+static void
+snapshot_dump(void)
+{
+    /* A copy of the global data pointing at the temporary file, so the snapshot
+     * goes through the same dumping code as the final log file.  Renaming the
+     * finished file means a reader never sees a partial snapshot.
+     */
+    static bool reported_failure;
+    per_thread_t snap = *global_data;
+    snap.log = dr_open_file(snapshot_tmp_name,
+                            DR_FILE_WRITE_OVERWRITE |
+#ifndef WINDOWS
+                                DR_FILE_CLOSE_ON_FORK |
+#endif
+                                DR_FILE_ALLOW_LARGE);
+    if (snap.log != INVALID_FILE) {
+        dump_drcov_data(NULL, &snap);
+        dr_close_file(snap.log);
+        if (dr_rename_file(snapshot_tmp_name, snapshot_name, true /*replace*/))
+            return;
+        dr_delete_file(snapshot_tmp_name);
+    }
+    /* Only the first failure is reported, as later intervals likely fail alike. */
+    if (!reported_failure) {
+        reported_failure = true;
+        dr_log(NULL, DR_LOG_ALL, 1, "drcov: failed to write snapshot %s\n",
+               snapshot_name);
+        NOTIFY(0, "failed to write snapshot %s\n", snapshot_name);
+    }
+}
+
+static void
+snapshot_thread(void *arg)
+{
+    /* DR suspends us at process exit while we sleep or wait for table_lock, so
+     * drcovlib_exit() never frees the tables out from under a snapshot.
+     */
+    while (true) {
+        dr_sleep((int)options.snapshot_interval_ms);
+        if (snapshot_exiting)
+            break;
+        snapshot_dump();
+    }
+}
+
+static bool
+snapshot_thread_start(void)
+{
+    size_t len;
+    if (options.snapshot_interval_ms == 0)
+        return true;
+    snapshot_pid = dr_get_process_id();
+    /* The snapshot sits next to the log file, with "snap" in place of "log". */
+    len = strlen(global_data->logname);
+    if (global_data->log == INVALID_FILE || len < 3 ||
+        strcmp(global_data->logname + len - 3, "log") != 0 ||
+        dr_snprintf(snapshot_name, BUFFER_SIZE_ELEMENTS(snapshot_name), "%.*ssnap",
+                    (int)(len - 3), global_data->logname) < 0 ||
+        dr_snprintf(snapshot_tmp_name, BUFFER_SIZE_ELEMENTS(snapshot_tmp_name),
+                    "%s.tmp", snapshot_name) < 0) {
+        NOTIFY(0, "%s", "no log file to name snapshots after\n");
+        return false;
+    }
+    NULL_TERMINATE_BUFFER(snapshot_name);
+    NULL_TERMINATE_BUFFER(snapshot_tmp_name);
+    return dr_create_client_thread(snapshot_thread, NULL);
+}
+
 /****************************************************************************
  * Event Callbacks
  */
@@ -325,9 +519,30 @@ event_pre_syscall(void *drcontext, int sysnum)
     return true;
 }
 
+/* Returns where to insert a block's counter increment: before the first instruction
+ * that writes the arithmetic flags without reading them, so no flags spill is
+ * needed, or at the top of the block if a flags read or a branch comes first.
+ */
+static instr_t *
+counter_insert_point(instrlist_t *bb)
+{
+    instr_t *first = instrlist_first_app(bb);
+#ifdef X86
+    instr_t *instr;
+    for (instr = first; instr != NULL; instr = instr_get_next_app(instr)) {
+        uint eflags = instr_get_arith_flags(instr, DR_QUERY_DEFAULT);
+        if (TESTANY(EFLAGS_READ_ARITH, eflags) || instr_is_cti(instr))
+            break;
+        if (TESTALL(EFLAGS_WRITE_ARITH, eflags))
+            return instr;
+    }
+#endif
+    return first;
+}
+
 /* We collect the basic block information including offset from module base,
- * size, and num of instructions, and add it into a basic block table without
- * instrumentation.
+ * size, and num of instructions, and add it into a basic block table.  Unless
+ * DRCOVLIB_HIT_COUNTS is set, no instrumentation is added.
  */
 static dr_emit_flags_t
 event_basic_block_analysis(void *drcontext, void *tag, instrlist_t *bb, bool for_trace,
@@ -337,11 +552,20 @@ event_basic_block_analysis(void *drcontext, void *tag, instrlist_t *bb, bool for
     instr_t *instr;
     app_pc tag_pc, start_pc, end_pc;
 
-    /* do nothing for translation */
-    if (translating)
+    data = (per_thread_t *)drmgr_get_tls_field(drcontext, tls_idx);
+    *user_data = NULL;
+    /* For translation we only need to reproduce the same instrumentation. */
+    if (translating) {
+        if (data->count_table != NULL) {
+            data->bb_counter =
+                hashtable_lookup(data->counter_map[for_trace ? 1 : 0], tag);
+            ASSERT(data->bb_counter != NULL, "no counter for a translated block");
+            if (data->bb_counter != NULL)
+                *user_data = counter_insert_point(bb);
+        }
         return DR_EMIT_DEFAULT;
+    }
 
-    data = (per_thread_t *)drmgr_get_tls_field(drcontext, tls_idx);
     /* Collect the number of instructions and the basic block size,
      * assuming the basic block does not have any elision on control
      * transfer instructions, which is true for default options passed
@@ -373,7 +597,13 @@ event_basic_block_analysis(void *drcontext, void *tag, instrlist_t *bb, bool for
      * 4. The duplication can be easily handled in a post-processing step,
      *    which is required anyway.
      */
-    bb_table_entry_add(drcontext, data, tag_pc, (uint)(end_pc - start_pc));
+    data->bb_counter =
+        bb_table_entry_add(drcontext, data, tag_pc, (uint)(end_pc - start_pc));
+    if (data->bb_counter != NULL) {
+        hashtable_add_replace(data->counter_map[for_trace ? 1 : 0], tag,
+                              data->bb_counter);
+        *user_data = counter_insert_point(bb);
+    }
 
     if (go_native)
         return DR_EMIT_GO_NATIVE;
@@ -381,6 +611,22 @@ event_basic_block_analysis(void *drcontext, void *tag, instrlist_t *bb, bool for
         return DR_EMIT_DEFAULT;
 }
 
+static dr_emit_flags_t
+event_app_instruction(void *drcontext, void *tag, instrlist_t *bb, instr_t *instr,
+                      bool for_trace, bool translating, void *user_data)
+{
+    per_thread_t *data;
+    if (instr != (instr_t *)user_data)
+        return DR_EMIT_DEFAULT;
+    data = (per_thread_t *)drmgr_get_tls_field(drcontext, tls_idx);
+    ASSERT(data->bb_counter != NULL, "counter must be set by analysis");
+    if (!drx_insert_counter_update(drcontext, bb, instr, SPILL_SLOT_MAX + 1,
+                                   IF_AARCHXX_(SPILL_SLOT_MAX + 1) data->bb_counter, 1,
+                                   DRX_COUNTER_64BIT))
+        ASSERT(false, "failed to insert hit counter");
+    return DR_EMIT_DEFAULT;
+}
+
 static void
 event_thread_exit(void *drcontext)
 {
@@ -449,6 +695,9 @@ event_fork(void *drcontext)
 {
     if (!drcov_per_thread) {
         log_file_create(NULL, global_data);
+        /* The snapshot thread does not survive the fork. */
+        if (!snapshot_thread_start())
+            NOTIFY(0, "%s", "failed to create snapshot thread\n");
     } else {
         per_thread_t *data = drmgr_get_tls_field(drcontext, tls_idx);
         if (data != NULL) {
@@ -504,17 +753,27 @@ drcovlib_exit(void)
     if (count != 0)
         return DRCOVLIB_SUCCESS;
 
+    /* The snapshot thread, if any, was suspended by DR before we get here at process
+     * exit; the flag stops it for an earlier exit.
+     */
+    snapshot_exiting = true;
     if (!drcov_per_thread) {
         dump_drcov_data(NULL, global_data);
         global_data_destroy(global_data);
     }
     drcov_per_thread = false;
+    if (table_lock != NULL) {
+        dr_mutex_destroy(table_lock);
+        table_lock = NULL;
+    }
 
     /* destroy module table */
     drmodtrack_exit();
 
     drmgr_unregister_tls_field(tls_idx);
 
+    if (TEST(DRCOVLIB_HIT_COUNTS, options.flags))
+        drreg_exit();
     drx_exit();
     drmgr_exit();
 
@@ -539,8 +798,13 @@ event_init(void)
         return res;
 
     /* create process data if whole process bb coverage. */
-    if (!drcov_per_thread)
+    if (!drcov_per_thread) {
+        if (TEST(DRCOVLIB_HIT_COUNTS, options.flags) || options.snapshot_interval_ms > 0)
+            table_lock = dr_mutex_create();
         global_data = global_data_create();
+    }
+    if (!snapshot_thread_start())
+        return DRCOVLIB_ERROR;
     return DRCOVLIB_SUCCESS;
 }
 
@@ -551,16 +815,29 @@ drcovlib_init(drcovlib_options_t *ops)
     if (count > 1)
         return DRCOVLIB_SUCCESS;
 
-    if (ops->struct_size != sizeof(options))
+    /* Accept the size from before snapshot_interval_ms was added. */
+    if (ops->struct_size > sizeof(options) ||
+        ops->struct_size < offsetof(drcovlib_options_t, snapshot_interval_ms))
         return DRCOVLIB_ERROR_INVALID_PARAMETER;
-    if ((ops->flags & (~(DRCOVLIB_DUMP_AS_TEXT | DRCOVLIB_THREAD_PRIVATE))) != 0)
+    if ((ops->flags & ~(DRCOVLIB_DUMP_AS_TEXT | DRCOVLIB_THREAD_PRIVATE |
+                        DRCOVLIB_HIT_COUNTS)) != 0)
+        return DRCOVLIB_ERROR_INVALID_PARAMETER;
+#if defined(ARM) || defined(RISCV64)
+    /* drx_insert_counter_update() has no 64-bit counters here. */
+    if (TEST(DRCOVLIB_HIT_COUNTS, ops->flags))
+        return DRCOVLIB_ERROR_FEATURE_NOT_AVAILABLE;
+#endif
+    memset(&options, 0, sizeof(options));
+    memcpy(&options, ops, ops->struct_size);
+    options.struct_size = sizeof(options);
+    /* Snapshots only cover the process-wide table. */
+    if (TEST(DRCOVLIB_THREAD_PRIVATE, options.flags) && options.snapshot_interval_ms > 0)
         return DRCOVLIB_ERROR_INVALID_PARAMETER;
     if (TEST(DRCOVLIB_THREAD_PRIVATE, ops->flags)) {
         if (!dr_using_all_private_caches())
             return DRCOVLIB_ERROR_INVALID_SETUP;
         drcov_per_thread = true;
     }
-    options = *ops;
     if (options.logdir != NULL)
         dr_snprintf(logdir, BUFFER_SIZE_ELEMENTS(logdir), "%s", ops->logdir);
     else /* default */
@@ -574,6 +851,13 @@ drcovlib_init(drcovlib_options_t *ops)
 
     drmgr_init();
     drx_init();
+    if (TEST(DRCOVLIB_HIT_COUNTS, options.flags)) {
+        /* Two scratch registers on AArch64; only the flags on x86. */
+        drreg_options_t drreg_ops = { sizeof(drreg_ops), 2 /*max slots needed*/,
+                                      false };
+        if (drreg_init(&drreg_ops) != DRREG_SUCCESS)
+            return DRCOVLIB_ERROR;
+    }
 
     /* We follow a simple model of the caller requesting the coverage dump,
      * either via calling the exit routine, using its own soft_kills nudge, or
@@ -585,7 +869,9 @@ drcovlib_init(drcovlib_options_t *ops)
 
     drmgr_register_thread_init_event(event_thread_init);
     drmgr_register_thread_exit_event(event_thread_exit);
-    drmgr_register_bb_instrumentation_event(event_basic_block_analysis, NULL, NULL);
+    drmgr_register_bb_instrumentation_event(
+        event_basic_block_analysis,
+        TEST(DRCOVLIB_HIT_COUNTS, options.flags) ? event_app_instruction : NULL, NULL);
     dr_register_filter_syscall_event(event_filter_syscall);
     drmgr_register_pre_syscall_event(event_pre_syscall);
 #ifdef UNIX
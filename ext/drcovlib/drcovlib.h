@@ -78,6 +78,17 @@ typedef enum {
      * drcovlib's own thread exit events rather than in drcovlib_exit().
      */
     DRCOVLIB_THREAD_PRIVATE = 0x0002,
+    /**
+     * Requests that each basic block be instrumented with an inline increment of
+     * its own execution counter.  The counters are written to the log file after
+     * the basic block table, in a "BB Hit Counts" section holding one 64-bit count
+     * per table entry in table order.  The increment is placed where the
+     * arithmetic flags are dead when the block allows it, so that no flags spill
+     * is needed.  Without #DRCOVLIB_THREAD_PRIVATE the counters are shared among
+     * threads and are not updated atomically, so they may under-count blocks that
+     * are executed concurrently.  Not supported on 32-bit ARM or RISC-V.
+     */
+    DRCOVLIB_HIT_COUNTS = 0x0004,
 } drcovlib_flags_t;
 
 /** Specifies the options when initializing drcovlib. */
@@ -102,6 +113,16 @@ typedef struct _drcovlib_options_t {
      * option, is created.  This option only works under Windows.
      */
     int native_until_thread;
+    /**
+     * If non-zero, a snapshot of the coverage information collected so far is
+     * written every this many milliseconds to a file next to the log file, with
+     * the suffix "snap" in place of "log".  Each snapshot is a complete log file in
+     * the same format, and replaces the previous snapshot once it is complete.  The
+     * snapshots are written by a separate client thread and do not stop the
+     * application, though blocks being built wait for a snapshot in progress.  Not
+     * supported with #DRCOVLIB_THREAD_PRIVATE.
+     */
+    uint snapshot_interval_ms;
 } drcovlib_options_t;
 
 /***************************************************************************
@@ -150,6 +171,11 @@ typedef struct _bb_entry_t {
     ushort mod_id;
 } bb_entry_t;
 
+/* With DRCOVLIB_HIT_COUNTS, the bb table is followed by a "BB Hit Counts: %u bbs"
+ * line and then one 64-bit execution count per bb, in bb table order.  Older
+ * readers stop at the end of the bb table and ignore the counts.
+ */
+
 /***************************************************************************
  * Coverage interface
  */
@@ -239,6 +239,32 @@ drsym_error_t
 drsym_lookup_address(const char *modpath, size_t modoffs, drsym_info_t *info /*INOUT*/,
                      uint flags);
 
+DR_EXPORT
+/**
+ * Speeds up repeated drsym_lookup_address() queries on ELF modules.  After
+ * this call, the first address query in each module builds a sorted index of
+ * its symbol ranges, demangled names, and line table ranges, and that and
+ * later queries binary search the index instead of walking the symbol table
+ * and the DWARF information.  Building the index costs more than a single
+ * query, so this is only worthwhile for clients that symbolize many
+ * addresses.
+ *
+ * If \p cache_dir is not NULL, each index is also saved in that directory in
+ * a file named for the module's build id, and later processes map that file
+ * rather than building the index again.  Modules without a build id are
+ * indexed in memory only.
+ *
+ * Results match those without the index, except that an address outside of
+ * every line table sequence reports DRSYM_ERROR_LINE_NOT_AVAILABLE rather
+ * than the nearest preceding line.
+ *
+ * @param[in] cache_dir  An existing directory for index files, or NULL.
+ *
+ * \note Not supported on Windows or Mac.
+ */
+drsym_error_t
+drsym_enable_address_index(const char *cache_dir);
+
 enum {
     DRSYM_TYPE_OTHER,    /**< Unknown type, cannot downcast. */
     DRSYM_TYPE_INT,      /**< Integer, cast to drsym_int_type_t. */
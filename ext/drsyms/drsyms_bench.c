@@ -32,8 +32,9 @@
 
 /* DRSyms benchmarking standalone app. */
 
-/* This is a standalone app for benchmarking drsyms.  Currently we just time
- * symbol enumeration of an arbitrary object file.
+/* This is a standalone app for benchmarking drsyms.  We time symbol
+ * enumeration of an arbitrary object file and then address lookups inside each
+ * of its symbols, without and then with drsym_enable_address_index().
  */
 
 #include <stdio.h>
@@ -58,7 +59,7 @@ usage(const char *msg)
     if (msg != NULL && msg[0] != '\0') {
         dr_fprintf(STDERR, "%s\n", msg);
     }
-    dr_fprintf(STDERR, "usage: bench <modpath>\n");
+    dr_fprintf(STDERR, "usage: bench <modpath> [<index_cache_dir>]\n");
     return 1;
 }
 
@@ -103,10 +104,74 @@ enumerate_with_flags(const char *modpath, drsym_flags_t flags)
     dr_printf("Took %d.%03d seconds.\n", (int)(time / 1000), (int)(time % 1000));
 }
 
+#define MAX_LOOKUPS 100000
+
+typedef struct _lookups_t {
+    size_t offs[MAX_LOOKUPS];
+    uint count;
+} lookups_t;
+
+static lookups_t lookups;
+
+static bool
+offs_callback(const char *name, size_t modoffs, void *data)
+{
+    lookups_t *list = (lookups_t *)data;
+    if (list->count >= MAX_LOOKUPS)
+        return false;
+    /* Query a little way into each symbol so we also exercise line ranges. */
+    list->offs[list->count++] = modoffs + 4;
+    return true;
+}
+
+/* Returns a checksum of the results so runs can be compared. */
+static uint64
+lookup_all(const char *modpath, const char *label)
+{
+    uint64 start, end, time;
+    uint64 checksum = 0;
+    uint i, found = 0, with_lines = 0;
+    static char file_buf[MAXIMUM_PATH];
+    drsym_info_t info;
+
+    info.struct_size = sizeof(info);
+    info.name = sym_buf;
+    info.name_size = sizeof(sym_buf);
+    info.file = file_buf;
+    info.file_size = sizeof(file_buf);
+    start = dr_get_milliseconds();
+    for (i = 0; i < lookups.count; i++) {
+        const char *s;
+        drsym_error_t res =
+            drsym_lookup_address(modpath, lookups.offs[i], &info, DRSYM_DEMANGLE);
+        checksum = checksum * 31 + res;
+        if (res != DRSYM_SUCCESS && res != DRSYM_ERROR_LINE_NOT_AVAILABLE)
+            continue;
+        found++;
+        checksum = checksum * 31 + info.start_offs;
+        for (s = sym_buf; *s != '\0'; s++)
+            checksum = checksum * 31 + *s;
+        if (res != DRSYM_SUCCESS)
+            continue;
+        with_lines++;
+        checksum = checksum * 31 + info.line + info.line_offs;
+        for (s = file_buf; *s != '\0'; s++)
+            checksum = checksum * 31 + *s;
+    }
+    end = dr_get_milliseconds();
+    time = end - start;
+    dr_printf("%s: %u lookups, %u found, %u with lines, took %d.%03d seconds, "
+              "checksum " HEX64_FORMAT_STRING "\n",
+              label, lookups.count, found, with_lines, (int)(time / 1000),
+              (int)(time % 1000), checksum);
+    return checksum;
+}
+
 int
 main(int argc, char **argv)
 {
     const char *modpath;
+    uint64 direct, indexed;
 #ifdef WINDOWS
     char full_path[2048];
 #endif
@@ -114,7 +179,7 @@ main(int argc, char **argv)
     dr_standalone_init();
     drsym_init(0);
 
-    if (argc != 2) {
+    if (argc != 2 && argc != 3) {
         return usage(NULL);
     }
     modpath = argv[1];
@@ -135,6 +200,16 @@ main(int argc, char **argv)
     enumerate_with_flags(modpath, DRSYM_DEFAULT_FLAGS);
     enumerate_with_flags(modpath, DRSYM_DEFAULT_FLAGS);
 
+    drsym_enumerate_symbols(modpath, offs_callback, &lookups, DRSYM_DEFAULT_FLAGS);
+    direct = lookup_all(modpath, "Direct lookups");
+    if (drsym_enable_address_index(argc == 3 ? argv[2] : NULL) == DRSYM_SUCCESS) {
+        /* Start over so the first lookup builds or maps the index. */
+        drsym_free_resources(modpath);
+        indexed = lookup_all(modpath, "Indexed lookups");
+        if (indexed != direct)
+            dr_printf("Indexed lookups differ from direct lookups.\n");
+    }
+
     drsym_exit();
     dr_standalone_exit();
 }
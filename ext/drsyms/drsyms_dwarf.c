@@ -37,6 +37,7 @@
 #include "dr_api.h"
 #include "drsyms.h"
 #include "drsyms_private.h"
+#include "drsyms_obj.h"
 
 #include "dwarf.h"
 #include "libdwarf.h"
@@ -440,6 +441,117 @@ drsym_dwarf_enumerate_lines(void *mod_in, drsym_enumerate_lines_cb callback, voi
     return success;
 }
 
+static bool
+enumerate_rows_in_cu(dwarf_module_t *mod, Dwarf_Die cu_die, drsym_dwarf_row_cb callback,
+                     void *data)
+{
+    Dwarf_Line *lines;
+    Dwarf_Signed num_lines;
+    int i;
+    Dwarf_Error de; /* expensive to init (DrM#1770) */
+
+    /* We use the same sorted table that search_addr2line_in_cu() searches, so that
+     * rows sharing an address are seen in the same order.
+     */
+    num_lines = get_lines_from_cu(mod, cu_die, &lines);
+    for (i = 0; i < num_lines; i++) {
+        char *file;
+        Dwarf_Unsigned lineno;
+        Dwarf_Addr lineaddr;
+        Dwarf_Bool end_sequence;
+        if (dwarf_lineaddr(lines[i], &lineaddr, &de) != DW_DLV_OK) {
+            NOTIFY_DWARF(de);
+            continue;
+        }
+        if (dwarf_lineendsequence(lines[i], &end_sequence, &de) != DW_DLV_OK) {
+            NOTIFY_DWARF(de);
+            end_sequence = false;
+        }
+        if (dwarf_linesrc(lines[i], &file, &de) != DW_DLV_OK ||
+            dwarf_lineno(lines[i], &lineno, &de) != DW_DLV_OK) {
+            NOTIFY_DWARF(de);
+            file = NULL;
+            lineno = 0;
+        }
+        if (!(*callback)(file, lineno,
+                         (size_t)(lineaddr - (Dwarf_Addr)(ptr_uint_t)mod->load_base -
+                                  mod->offs_adjust),
+                         end_sequence != 0, data))
+            return false;
+    }
+    return true;
+}
+
+static int
+compare_offs(const void *a_in, const void *b_in)
+{
+    Dwarf_Off a = *(const Dwarf_Off *)a_in;
+    Dwarf_Off b = *(const Dwarf_Off *)b_in;
+    if (a > b)
+        return 1;
+    if (a < b)
+        return -1;
+    return 0;
+}
+
+drsym_error_t
+drsym_dwarf_enumerate_rows(void *mod_in, drsym_dwarf_row_cb callback, void *data)
+{
+    dwarf_module_t *mod = (dwarf_module_t *)mod_in;
+    Dwarf_Error de; /* expensive to init (DrM#1770) */
+    Dwarf_Die cu_die;
+    Dwarf_Unsigned cu_offset = 0;
+    Dwarf_Arange *arlist;
+    Dwarf_Signed arcnt = 0, i;
+    Dwarf_Off *cu_offs = NULL, die_offs;
+    size_t num_cus = 0;
+    bool keep_going = true;
+
+    /* We first visit the CUs named by .debug_aranges, as that is how find_cu_die()
+     * locates them, and the CU walk below stops early at a CU that libdwarf cannot
+     * parse (such as DWARFv5).
+     */
+    if (dwarf_get_aranges(mod->dbg, &arlist, &arcnt, &de) != DW_DLV_OK)
+        arcnt = 0;
+    if (arcnt > 0)
+        cu_offs = (Dwarf_Off *)dr_global_alloc((size_t)arcnt * sizeof(*cu_offs));
+    for (i = 0; i < arcnt; i++) {
+        if (dwarf_get_cu_die_offset(arlist[i], &die_offs, &de) == DW_DLV_OK)
+            cu_offs[num_cus++] = die_offs;
+    }
+    if (num_cus > 0)
+        qsort(cu_offs, num_cus, sizeof(*cu_offs), compare_offs);
+    for (i = 0; keep_going && i < (Dwarf_Signed)num_cus; i++) {
+        if (i > 0 && cu_offs[i] == cu_offs[i - 1])
+            continue;
+        if (dwarf_offdie(mod->dbg, cu_offs[i], &cu_die, &de) == DW_DLV_OK)
+            keep_going = enumerate_rows_in_cu(mod, cu_die, callback, data);
+    }
+
+    /* Then any CUs without aranges. */
+    while (keep_going &&
+           dwarf_next_cu_header(mod->dbg, NULL, NULL, NULL, NULL, &cu_offset, &de) ==
+               DW_DLV_OK) {
+        /* Scan forward in the tag soup for a CU DIE. */
+        cu_die = next_die_matching_tag(mod->dbg, DW_TAG_compile_unit);
+        if (cu_die == NULL)
+            continue;
+        if (num_cus > 0 && dwarf_dieoffset(cu_die, &die_offs, &de) == DW_DLV_OK &&
+            bsearch(&die_offs, cu_offs, num_cus, sizeof(*cu_offs), compare_offs) != NULL)
+            continue;
+        keep_going = enumerate_rows_in_cu(mod, cu_die, callback, data);
+    }
+
+    while (dwarf_next_cu_header(mod->dbg, NULL, NULL, NULL, NULL, &cu_offset, &de) ==
+           DW_DLV_OK) {
+        /* Reset the internal CU header state. */
+    }
+
+    if (cu_offs != NULL)
+        dr_global_free(cu_offs, (size_t)arcnt * sizeof(*cu_offs));
+    return DRSYM_SUCCESS;
+}
+
 void *
 drsym_dwarf_init(Dwarf_Debug dbg)
 {
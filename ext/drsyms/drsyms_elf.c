@@ -43,6 +43,7 @@
 #include "dwarf.h"
 #include "libdwarf.h"
 
+#include <stdlib.h> /* qsort */
 #include <string.h>
 #include <sys/stat.h>
 #include <unistd.h>
@@ -481,6 +482,139 @@ drsym_obj_addrsearch_symtab(void *mod_in, size_t modoffs, uint *idx OUT)
     return DRSYM_ERROR_SYMBOL_NOT_FOUND;
 }
 
+static int
+compare_offs(const void *a_in, const void *b_in)
+{
+    size_t a = *(const size_t *)a_in;
+    size_t b = *(const size_t *)b_in;
+    if (a > b)
+        return 1;
+    if (a < b)
+        return -1;
+    return 0;
+}
+
+/* Returns the index of the first entry in the sorted pts[] that is >= offs. */
+static uint
+find_point(const size_t *pts, uint num_pts, size_t offs)
+{
+    uint lo = 0, hi = num_pts;
+    while (lo < hi) {
+        uint mid = lo + (hi - lo) / 2;
+        if (pts[mid] < offs)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+/* Returns the first segment at or after seg that has no symbol yet, shortening
+ * the chain through next[] as it goes.
+ */
+static uint
+next_unassigned(uint *next, uint seg)
+{
+    uint root = seg;
+    while (next[root] != root)
+        root = next[root];
+    while (next[seg] != root) {
+        uint up = next[seg];
+        next[seg] = root;
+        seg = up;
+    }
+    return root;
+}
+
+/* Produces the same answers as drsym_obj_addrsearch_symtab() for every offset
+ * without its linear walk: the symbol starts and ends split the address space
+ * into segments over which the answer cannot change.  Each sized symbol, in
+ * table order, claims the segments it covers that no earlier symbol claimed.
+ * Unclaimed segments get the closest preceding symbol if it is an unsized
+ * one with a name (i#1337).
+ */
+drsym_error_t
+drsym_obj_addrsearch_ranges(void *mod_in, drsym_obj_range_cb callback, void *data)
+{
+    elf_info_t *mod = (elf_info_t *)mod_in;
+    size_t *pts;
+    int *seg_idx, *start_idx;
+    uint *next;
+    uint num_pts = 0, max_pts, seg, i;
+    int cur_start = -1, prev_idx = -2;
+
+    if (mod == NULL || mod->syms == NULL || callback == NULL)
+        return DRSYM_ERROR;
+
+    max_pts = 2 * mod->num_syms + 1;
+    pts = (size_t *)dr_global_alloc(max_pts * sizeof(*pts));
+    pts[num_pts++] = 0;
+    for (i = 0; i < (uint)mod->num_syms; i++) {
+        size_t lo_offs = mod->syms[i].st_value - mod->load_base;
+        size_t hi_offs = lo_offs + mod->syms[i].st_size;
+        pts[num_pts++] = lo_offs;
+        if (hi_offs > lo_offs)
+            pts[num_pts++] = hi_offs;
+    }
+    qsort(pts, num_pts, sizeof(*pts), compare_offs);
+    for (i = 1, seg = 1; i < num_pts; i++) {
+        if (pts[i] != pts[seg - 1])
+            pts[seg++] = pts[i];
+    }
+    num_pts = seg;
+
+    /* Segment k runs from pts[k] up to pts[k + 1], or to the end of the address
+     * space for the last one.
+     */
+    seg_idx = (int *)dr_global_alloc(num_pts * sizeof(*seg_idx));
+    start_idx = (int *)dr_global_alloc(num_pts * sizeof(*start_idx));
+    next = (uint *)dr_global_alloc((num_pts + 1) * sizeof(*next));
+    for (seg = 0; seg < num_pts; seg++) {
+        seg_idx[seg] = -1;
+        start_idx[seg] = -1;
+        next[seg] = seg;
+    }
+    next[num_pts] = num_pts;
+    for (i = 0; i < (uint)mod->num_syms; i++) {
+        size_t lo_offs = mod->syms[i].st_value - mod->load_base;
+        size_t hi_offs = lo_offs + mod->syms[i].st_size;
+        uint lo_seg = find_point(pts, num_pts, lo_offs);
+        uint hi_seg;
+        if (start_idx[lo_seg] == -1)
+            start_idx[lo_seg] = i;
+        if (hi_offs <= lo_offs)
+            continue;
+        hi_seg = find_point(pts, num_pts, hi_offs);
+        for (seg = next_unassigned(next, lo_seg); seg < hi_seg;
+             seg = next_unassigned(next, seg)) {
+            seg_idx[seg] = i;
+            next[seg] = seg + 1;
+        }
+    }
+
+    for (seg = 0; seg < num_pts; seg++) {
+        int idx = seg_idx[seg];
+        if (start_idx[seg] != -1)
+            cur_start = start_idx[seg];
+        if (idx == -1 && cur_start >= 0 && mod->syms[cur_start].st_size == 0) {
+            const char *name = drsym_obj_symbol_name(mod_in, cur_start);
+            if (name != NULL && name[0] != '\0')
+                idx = cur_start;
+        }
+        if (idx != prev_idx) {
+            if (!callback(pts[seg], idx, data))
+                break;
+            prev_idx = idx;
+        }
+    }
+
+    dr_global_free(next, (num_pts + 1) * sizeof(*next));
+    dr_global_free(start_idx, num_pts * sizeof(*start_idx));
+    dr_global_free(seg_idx, num_pts * sizeof(*seg_idx));
+    dr_global_free(pts, max_pts * sizeof(*pts));
+    return DRSYM_SUCCESS;
+}
+
 const char *
 drsym_obj_build_id(void *mod_in)
 {
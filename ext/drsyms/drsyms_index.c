@@ -0,0 +1,631 @@
+/* **********************************************************
+ * Copyright (c) 2023 Google, Inc.  All rights reserved.
+ * **********************************************************/
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of Google, Inc. nor the names of its contributors may be
+ *   used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL VMWARE, INC. OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+
+/* DRSyms DynamoRIO Extension */
+
+/* Address index for ELF modules.
+ *
+ * drsym_obj_addrsearch_symtab() walks the whole symbol table, and
+ * drsym_dwarf_search_addr2line() looks up a CU and sorts its line table, on
+ * every query.  For tools that symbolize many addresses we flatten both into
+ * sorted range tables that are binary searched.  The tables use offsets rather
+ * than pointers so they can be saved to a file named for the module's build id
+ * and mapped by later processes instead of being rebuilt.
+ */
+
+#include "dr_api.h"
+#include "drsyms.h"
+#include "drsyms_private.h"
+#include "drsyms_obj.h"
+#include "hashtable.h"
+
+#include <stdlib.h> /* qsort */
+#include <string.h>
+
+/* For debugging */
+static bool verbose = false;
+
+#define INDEX_MAGIC 0x5844494d59535244ULL /* "DRSYMIDX" */
+#define INDEX_VERSION 1
+#define INDEX_FILE_SUFFIX ".drsymidx"
+
+/* Marks a range with no symbol, a symbol name that could not be read or has no
+ * demangled form, or a line row without line information.
+ */
+#define INDEX_NONE 0xffffffff
+
+/* The layout of an index, in memory and on disk: this header followed by the
+ * symbol, range, and line arrays and then the string pool.  Offsets are from the
+ * start of the header.
+ */
+typedef struct _index_header_t {
+    uint64 magic;
+    uint version;
+    uint debug_kind; /* Of the module the index was built from. */
+    uint has_lines;
+    uint num_syms;
+    uint num_ranges;
+    uint num_lines;
+    uint64 syms_offs;
+    uint64 ranges_offs;
+    uint64 lines_offs;
+    uint64 strings_offs;
+    uint64 strings_size;
+    uint64 total_size;
+} index_header_t;
+
+typedef struct _index_sym_t {
+    uint64 start_offs;
+    uint64 end_offs;
+    uint64 demangled_len; /* What drsym_demangle_symbol() returned for demangled. */
+    uint name;            /* The mangled name. */
+    uint demangled;       /* The DRSYM_DEMANGLE name. */
+    int offs_res;         /* What drsym_obj_symbol_offs() returned. */
+    uint padding;
+} index_sym_t;
+
+typedef struct _index_range_t {
+    uint64 start; /* The range ends where the next one starts. */
+    uint sym;     /* Index into the symbol array. */
+    uint padding;
+} index_range_t;
+
+typedef struct _index_line_t {
+    uint64 addr; /* The row ends where the next one starts. */
+    uint64 line;
+    uint file;
+    uint padding;
+} index_line_t;
+
+typedef struct _addr_index_t {
+    byte *base;
+    size_t size;
+    /* If non-zero, base is a file mapping of this size; else it is heap. */
+    size_t map_size;
+    const index_header_t *header;
+    const index_sym_t *syms;
+    const index_range_t *ranges;
+    const index_line_t *lines;
+    const char *strings;
+} addr_index_t;
+
+/******************************************************************************
+ * Building.
+ */
+
+/* A growable array. */
+typedef struct _buf_t {
+    byte *data;
+    size_t size;
+    size_t capacity;
+} buf_t;
+
+typedef struct _build_row_t {
+    index_line_t line;
+    uint seq; /* Enumeration order, to break ties between rows at one address. */
+    bool end_sequence;
+} build_row_t;
+
+typedef struct _index_builder_t {
+    void *obj_info;
+    buf_t syms;
+    buf_t ranges;
+    buf_t rows;
+    buf_t strings;
+    /* Maps a string to its offset in the pool plus one. */
+    hashtable_t string_table;
+    /* Maps a symbol table index to its entry in syms, or INDEX_NONE. */
+    uint *sym_entry;
+    uint num_obj_syms;
+    uint num_rows;
+    char *demangle_buf;
+    size_t demangle_buf_size;
+} index_builder_t;
+
+static void *
+buf_append(buf_t *buf, size_t sz)
+{
+    void *res;
+    if (buf->size + sz > buf->capacity) {
+        size_t capacity = (buf->capacity == 0) ? 4096 : buf->capacity;
+        byte *data;
+        while (capacity < buf->size + sz)
+            capacity *= 2;
+        data = (byte *)dr_global_alloc(capacity);
+        if (buf->data != NULL) {
+            memcpy(data, buf->data, buf->size);
+            dr_global_free(buf->data, buf->capacity);
+        }
+        buf->data = data;
+        buf->capacity = capacity;
+    }
+    res = buf->data + buf->size;
+    buf->size += sz;
+    return res;
+}
+
+static void
+buf_free(buf_t *buf)
+{
+    if (buf->data != NULL)
+        dr_global_free(buf->data, buf->capacity);
+}
+
+static uint
+add_string(index_builder_t *builder, const char *str)
+{
+    uint offs = (uint)(ptr_uint_t)hashtable_lookup(&builder->string_table, (void *)str);
+    size_t len;
+    if (offs != 0)
+        return offs - 1;
+    len = strlen(str) + 1;
+    offs = (uint)builder->strings.size;
+    memcpy(buf_append(&builder->strings, len), str, len);
+    hashtable_add(&builder->string_table, (void *)str, (void *)(ptr_uint_t)(offs + 1));
+    return offs;
+}
+
+static uint
+add_symbol(index_builder_t *builder, uint idx)
+{
+    index_sym_t *sym;
+    const char *name;
+    size_t start_offs, end_offs, len;
+
+    if (builder->sym_entry[idx] != INDEX_NONE)
+        return builder->sym_entry[idx];
+    builder->sym_entry[idx] = (uint)(builder->syms.size / sizeof(*sym));
+    sym = (index_sym_t *)buf_append(&builder->syms, sizeof(*sym));
+    memset(sym, 0, sizeof(*sym));
+    sym->offs_res = drsym_obj_symbol_offs(builder->obj_info, idx, &start_offs, &end_offs);
+    sym->start_offs = start_offs;
+    sym->end_offs = end_offs;
+    sym->name = INDEX_NONE;
+    sym->demangled = INDEX_NONE;
+    name = drsym_obj_symbol_name(builder->obj_info, idx);
+    if (name == NULL)
+        return builder->sym_entry[idx];
+    sym->name = add_string(builder, name);
+    /* Resize until it's big enough. */
+    while ((len = drsym_demangle_symbol(builder->demangle_buf,
+                                        builder->demangle_buf_size, name,
+                                        DRSYM_DEMANGLE)) > builder->demangle_buf_size) {
+        dr_global_free(builder->demangle_buf, builder->demangle_buf_size);
+        builder->demangle_buf_size = len;
+        builder->demangle_buf = (char *)dr_global_alloc(builder->demangle_buf_size);
+    }
+    if (len != 0) {
+        sym->demangled = add_string(builder, builder->demangle_buf);
+        sym->demangled_len = len;
+    }
+    return builder->sym_entry[idx];
+}
+
+static bool
+add_range(size_t start, int idx, void *data)
+{
+    index_builder_t *builder = (index_builder_t *)data;
+    index_range_t *range;
+    uint sym = (idx < 0) ? INDEX_NONE : add_symbol(builder, (uint)idx);
+    range = (index_range_t *)buf_append(&builder->ranges, sizeof(*range));
+    range->start = start;
+    range->sym = sym;
+    range->padding = 0;
+    return true;
+}
+
+static bool
+add_row(const char *file, uint64 line, size_t modoffs, bool end_sequence, void *data)
+{
+    index_builder_t *builder = (index_builder_t *)data;
+    build_row_t *row = (build_row_t *)buf_append(&builder->rows, sizeof(*row));
+    row->line.addr = modoffs;
+    row->line.line = line;
+    if (file == NULL || end_sequence)
+        row->line.file = INDEX_NONE;
+    else
+        row->line.file = add_string(builder, file);
+    row->line.padding = 0;
+    row->seq = builder->num_rows++;
+    row->end_sequence = end_sequence;
+    return true;
+}
+
+/* Orders by address, with a row that ends a sequence ahead of one that starts the
+ * next sequence at the same address, and otherwise in enumeration order.
+ */
+static int
+compare_rows(const void *a_in, const void *b_in)
+{
+    const build_row_t *a = (const build_row_t *)a_in;
+    const build_row_t *b = (const build_row_t *)b_in;
+    if (a->line.addr != b->line.addr)
+        return (a->line.addr > b->line.addr) ? 1 : -1;
+    if (a->end_sequence != b->end_sequence)
+        return a->end_sequence ? -1 : 1;
+    if (a->seq != b->seq)
+        return (a->seq > b->seq) ? 1 : -1;
+    return 0;
+}
+
+/* Sorts the rows into non-overlapping line ranges.  Among rows at one address
+ * the DWARF search reports the last, so we keep only that one.
+ */
+static void
+finish_lines(index_builder_t *builder, buf_t *lines OUT)
+{
+    build_row_t *rows = (build_row_t *)builder->rows.data;
+    uint i;
+    const index_line_t *last = NULL;
+    if (builder->num_rows == 0)
+        return;
+    qsort(rows, builder->num_rows, sizeof(*rows), compare_rows);
+    for (i = 0; i < builder->num_rows; i++) {
+        index_line_t *line;
+        if (i + 1 < builder->num_rows && rows[i + 1].line.addr == rows[i].line.addr)
+            continue;
+        /* A run of rows without line information is one range. */
+        if (rows[i].line.file == INDEX_NONE && (last == NULL || last->file == INDEX_NONE))
+            continue;
+        line = (index_line_t *)buf_append(lines, sizeof(*line));
+        *line = rows[i].line;
+        last = line;
+    }
+}
+
+static bool
+index_init(addr_index_t *index, drsym_debug_kind_t debug_kind);
+
+static addr_index_t *
+index_build(void *obj_info, void *dwarf_info, drsym_debug_kind_t debug_kind)
+{
+    index_builder_t builder;
+    buf_t lines;
+    index_header_t header;
+    addr_index_t *index = NULL;
+    uint i;
+
+    memset(&builder, 0, sizeof(builder));
+    memset(&lines, 0, sizeof(lines));
+    builder.obj_info = obj_info;
+    builder.num_obj_syms = drsym_obj_num_symbols(obj_info);
+    if (builder.num_obj_syms == 0)
+        return NULL;
+    builder.sym_entry =
+        (uint *)dr_global_alloc(builder.num_obj_syms * sizeof(*builder.sym_entry));
+    for (i = 0; i < builder.num_obj_syms; i++)
+        builder.sym_entry[i] = INDEX_NONE;
+    builder.demangle_buf_size = 1024; /* C++ symbols can be quite long. */
+    builder.demangle_buf = (char *)dr_global_alloc(builder.demangle_buf_size);
+    hashtable_init_ex(&builder.string_table, 16, HASH_STRING, true /*strdup*/,
+                      false /*!synch*/, NULL, NULL, NULL);
+    /* Offset 0 is the empty string, which also guarantees a non-empty pool. */
+    add_string(&builder, "");
+
+    if (drsym_obj_addrsearch_ranges(obj_info, add_range, &builder) != DRSYM_SUCCESS ||
+        builder.ranges.size == 0) {
+        NOTIFY("%s: failed to enumerate symbol ranges\n", __FUNCTION__);
+        goto done;
+    }
+    if (dwarf_info != NULL) {
+        drsym_dwarf_enumerate_rows(dwarf_info, add_row, &builder);
+        finish_lines(&builder, &lines);
+    }
+
+    memset(&header, 0, sizeof(header));
+    header.magic = INDEX_MAGIC;
+    header.version = INDEX_VERSION;
+    header.debug_kind = debug_kind;
+    header.has_lines = (dwarf_info != NULL);
+    header.num_syms = (uint)(builder.syms.size / sizeof(index_sym_t));
+    header.num_ranges = (uint)(builder.ranges.size / sizeof(index_range_t));
+    header.num_lines = (uint)(lines.size / sizeof(index_line_t));
+    header.syms_offs = sizeof(header);
+    header.ranges_offs = header.syms_offs + builder.syms.size;
+    header.lines_offs = header.ranges_offs + builder.ranges.size;
+    header.strings_offs = header.lines_offs + lines.size;
+    header.strings_size = builder.strings.size;
+    header.total_size = header.strings_offs + builder.strings.size;
+
+    index = (addr_index_t *)dr_global_alloc(sizeof(*index));
+    memset(index, 0, sizeof(*index));
+    index->size = (size_t)header.total_size;
+    index->base = (byte *)dr_global_alloc(index->size);
+    memcpy(index->base, &header, sizeof(header));
+    if (builder.syms.size > 0)
+        memcpy(index->base + header.syms_offs, builder.syms.data, builder.syms.size);
+    memcpy(index->base + header.ranges_offs, builder.ranges.data, builder.ranges.size);
+    if (lines.size > 0)
+        memcpy(index->base + header.lines_offs, lines.data, lines.size);
+    memcpy(index->base + header.strings_offs, builder.strings.data,
+           builder.strings.size);
+    NOTIFY("%s: %u symbols, %u ranges, %u lines, " SZFMT " bytes\n", __FUNCTION__,
+           header.num_syms, header.num_ranges, header.num_lines, index->size);
+    if (!index_init(index, debug_kind)) {
+        NOTIFY("%s: built an invalid index\n", __FUNCTION__);
+        drsym_index_free(index);
+        index = NULL;
+    }
+
+done:
+    buf_free(&lines);
+    buf_free(&builder.syms);
+    buf_free(&builder.ranges);
+    buf_free(&builder.rows);
+    buf_free(&builder.strings);
+    hashtable_delete(&builder.string_table);
+    dr_global_free(builder.demangle_buf, builder.demangle_buf_size);
+    dr_global_free(builder.sym_entry, builder.num_obj_syms * sizeof(*builder.sym_entry));
+    return index;
+}
+
+/******************************************************************************
+ * Validation and the cache file.
+ */
+
+static bool
+array_in_bounds(const index_header_t *header, uint64 offs, uint num, size_t entry_size)
+{
+    return offs >= sizeof(*header) && offs % sizeof(uint64) == 0 &&
+        offs <= header->total_size &&
+        (uint64)num * entry_size <= header->total_size - offs;
+}
+
+/* Points the index at its arrays, after checking that a possibly corrupt cache
+ * file cannot send any lookup out of bounds.
+ */
+static bool
+index_init(addr_index_t *index, drsym_debug_kind_t debug_kind)
+{
+    const index_header_t *header = (const index_header_t *)index->base;
+    uint i;
+    if (index->size < sizeof(*header) || header->magic != INDEX_MAGIC ||
+        header->version != INDEX_VERSION || header->debug_kind != (uint)debug_kind ||
+        header->total_size > index->size || header->num_ranges == 0 ||
+        !array_in_bounds(header, header->syms_offs, header->num_syms,
+                         sizeof(index_sym_t)) ||
+        !array_in_bounds(header, header->ranges_offs, header->num_ranges,
+                         sizeof(index_range_t)) ||
+        !array_in_bounds(header, header->lines_offs, header->num_lines,
+                         sizeof(index_line_t)) ||
+        header->strings_size == 0 ||
+        !array_in_bounds(header, header->strings_offs, (uint)header->strings_size, 1) ||
+        header->strings_size != (uint)header->strings_size)
+        return false;
+    index->header = header;
+    index->syms = (const index_sym_t *)(index->base + header->syms_offs);
+    index->ranges = (const index_range_t *)(index->base + header->ranges_offs);
+    index->lines = (const index_line_t *)(index->base + header->lines_offs);
+    index->strings = (const char *)(index->base + header->strings_offs);
+    if (index->strings[header->strings_size - 1] != '\0')
+        return false;
+    for (i = 0; i < header->num_syms; i++) {
+        if ((index->syms[i].name != INDEX_NONE &&
+             index->syms[i].name >= header->strings_size) ||
+            (index->syms[i].demangled != INDEX_NONE &&
+             index->syms[i].demangled >= header->strings_size))
+            return false;
+    }
+    for (i = 0; i < header->num_ranges; i++) {
+        if (index->ranges[i].sym != INDEX_NONE &&
+            index->ranges[i].sym >= header->num_syms)
+            return false;
+    }
+    for (i = 0; i < header->num_lines; i++) {
+        if (index->lines[i].file != INDEX_NONE &&
+            index->lines[i].file >= header->strings_size)
+            return false;
+    }
+    return true;
+}
+
+static addr_index_t *
+index_map_file(const char *path, drsym_debug_kind_t debug_kind)
+{
+    addr_index_t *index;
+    uint64 file_size;
+    file_t fd = dr_open_file(path, DR_FILE_READ);
+    if (fd == INVALID_FILE)
+        return NULL;
+    if (!dr_file_size(fd, &file_size) || file_size < sizeof(index_header_t)) {
+        dr_close_file(fd);
+        return NULL;
+    }
+    index = (addr_index_t *)dr_global_alloc(sizeof(*index));
+    memset(index, 0, sizeof(*index));
+    index->size = (size_t)file_size;
+    index->map_size = index->size;
+    index->base = (byte *)dr_map_file(fd, &index->map_size, 0, NULL, DR_MEMPROT_READ,
+                                      DR_MAP_PRIVATE);
+    /* The mapping stays valid after the file is closed. */
+    dr_close_file(fd);
+    if (index->base == NULL || index->map_size < index->size ||
+        !index_init(index, debug_kind)) {
+        NOTIFY("%s: ignoring invalid index %s\n", __FUNCTION__, path);
+        drsym_index_free(index);
+        return NULL;
+    }
+    NOTIFY("%s: mapped %s\n", __FUNCTION__, path);
+    return index;
+}
+
+static void
+index_save(addr_index_t *index, const char *path)
+{
+    char tmp_path[MAXIMUM_PATH];
+    file_t fd;
+    bool ok;
+    /* We write under a name private to this process and then rename, so that a
+     * concurrent process never maps a partially written file.
+     */
+    dr_snprintf(tmp_path, BUFFER_SIZE_ELEMENTS(tmp_path), "%s.%d", path,
+                (int)dr_get_process_id());
+    NULL_TERMINATE_BUFFER(tmp_path);
+    fd = dr_open_file(tmp_path, DR_FILE_WRITE_OVERWRITE);
+    if (fd == INVALID_FILE) {
+        NOTIFY("%s: unable to create %s\n", __FUNCTION__, tmp_path);
+        return;
+    }
+    ok = (dr_write_file(fd, index->base, index->size) == (ssize_t)index->size);
+    dr_close_file(fd);
+    if (!ok || !dr_rename_file(tmp_path, path, true /*replace*/)) {
+        NOTIFY("%s: unable to write %s\n", __FUNCTION__, path);
+        dr_delete_file(tmp_path);
+    }
+}
+
+/******************************************************************************
+ * Exports.
+ */
+
+void *
+drsym_index_create(void *obj_info, void *dwarf_info, drsym_debug_kind_t debug_kind,
+                   const char *cache_dir)
+{
+    const char *build_id = drsym_obj_build_id(obj_info);
+    char path[MAXIMUM_PATH];
+    addr_index_t *index;
+    bool use_cache = (cache_dir != NULL && build_id != NULL && build_id[0] != '\0');
+
+    if (use_cache) {
+        dr_snprintf(path, BUFFER_SIZE_ELEMENTS(path), "%s/%s" INDEX_FILE_SUFFIX,
+                    cache_dir, build_id);
+        NULL_TERMINATE_BUFFER(path);
+        index = index_map_file(path, debug_kind);
+        if (index != NULL)
+            return index;
+    }
+    index = index_build(obj_info, dwarf_info, debug_kind);
+    if (index != NULL && use_cache)
+        index_save(index, path);
+    return index;
+}
+
+void
+drsym_index_free(void *index_in)
+{
+    addr_index_t *index = (addr_index_t *)index_in;
+    if (index->base != NULL) {
+        if (index->map_size != 0)
+            dr_unmap_file(index->base, index->map_size);
+        else
+            dr_global_free(index->base, index->size);
+    }
+    dr_global_free(index, sizeof(*index));
+}
+
+/* Returns the last of the num entries, each entry_size bytes and starting with a
+ * uint64 address, whose address is <= offs, or NULL if there is none.
+ */
+static const void *
+find_entry(const void *array, uint num, size_t entry_size, size_t offs)
+{
+    uint lo = 0, hi = num;
+    while (lo < hi) {
+        uint mid = lo + (hi - lo) / 2;
+        if (*(const uint64 *)((const byte *)array + mid * entry_size) <= offs)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    if (lo == 0)
+        return NULL;
+    return (const byte *)array + (lo - 1) * entry_size;
+}
+
+drsym_error_t
+drsym_index_lookup_address(void *index_in, size_t modoffs, drsym_info_t *info INOUT,
+                           uint flags)
+{
+    addr_index_t *index = (addr_index_t *)index_in;
+    const index_range_t *range;
+    const index_sym_t *sym;
+    const index_line_t *line;
+    const char *name, *file;
+    size_t name_len = 0;
+
+    range = (const index_range_t *)find_entry(index->ranges, index->header->num_ranges,
+                                              sizeof(*range), modoffs);
+    if (range == NULL || range->sym == INDEX_NONE)
+        return DRSYM_ERROR_SYMBOL_NOT_FOUND;
+    sym = &index->syms[range->sym];
+    if (sym->name == INDEX_NONE)
+        return DRSYM_ERROR;
+    name = index->strings + sym->name;
+
+    if (TEST(DRSYM_DEMANGLE, flags) && info->name != NULL) {
+        if (TEST(DRSYM_DEMANGLE_FULL, flags) ||
+            (sym->demangled != INDEX_NONE && sym->demangled_len > info->name_size)) {
+            name_len = drsym_demangle_symbol(info->name, info->name_size, name, flags);
+        } else if (sym->demangled != INDEX_NONE) {
+            strncpy(info->name, index->strings + sym->demangled, info->name_size);
+            info->name[info->name_size - 1] = '\0';
+            name_len = (size_t)sym->demangled_len;
+        }
+    }
+    if (name_len == 0) {
+        /* Demangling either failed or was not requested. */
+        name_len = strlen(name) + 1;
+        if (info->name != NULL) {
+            strncpy(info->name, name, info->name_size);
+            info->name[info->name_size - 1] = '\0';
+        }
+    }
+    info->name_available_size = name_len;
+    info->start_offs = (size_t)sym->start_offs;
+    info->end_offs = (size_t)sym->end_offs;
+    if (sym->offs_res != DRSYM_SUCCESS)
+        return (drsym_error_t)sym->offs_res;
+
+    if (!index->header->has_lines)
+        return DRSYM_ERROR_LINE_NOT_AVAILABLE;
+    /* On failure, these should be zeroed. */
+    info->file_available_size = 0;
+    if (info->file != NULL)
+        info->file[0] = '\0';
+    info->line = 0;
+    info->line_offs = 0;
+    line = (const index_line_t *)find_entry(index->lines, index->header->num_lines,
+                                            sizeof(*line), modoffs);
+    if (line == NULL || line->file == INDEX_NONE)
+        return DRSYM_ERROR_LINE_NOT_AVAILABLE;
+    file = index->strings + line->file;
+    info->file_available_size = strlen(file);
+    if (info->file != NULL) {
+        strncpy(info->file, file, info->file_size);
+        info->file[info->file_size - 1] = '\0';
+    }
+    info->line = line->line;
+    info->line_offs = (size_t)(modoffs - line->addr);
+    return DRSYM_SUCCESS;
+}
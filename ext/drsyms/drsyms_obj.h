@@ -95,6 +95,17 @@ drsym_obj_symbol_offs(void *mod_in, uint idx, size_t *offs_start OUT,
 drsym_error_t
 drsym_obj_addrsearch_symtab(void *mod_in, size_t modoffs, uint *idx OUT);
 
+/* Called in increasing address order with the start of each range of module
+ * offsets over which drsym_obj_addrsearch_symtab() finds the same symbol index,
+ * or -1 where it finds none.  Each range ends where the next one starts.
+ * Returns whether to continue.
+ */
+typedef bool (*drsym_obj_range_cb)(size_t start, int idx, void *data);
+
+/* Only implemented for ELF, for use by the address index. */
+drsym_error_t
+drsym_obj_addrsearch_ranges(void *mod_in, drsym_obj_range_cb callback, void *data);
+
 bool
 drsym_obj_same_file(const char *path1, const char *path2);
 
@@ -126,4 +137,36 @@ drsym_dwarf_search_addr2line(void *mod_in, Dwarf_Addr pc, drsym_info_t *sym_info
 drsym_error_t
 drsym_dwarf_enumerate_lines(void *mod_in, drsym_enumerate_lines_cb callback, void *data);
 
+/* Called for every row of every line table, with the row's offset from the module
+ * base.  file is NULL if the row's file or line could not be read.  Returns
+ * whether to continue.
+ */
+typedef bool (*drsym_dwarf_row_cb)(const char *file, uint64 line, size_t modoffs,
+                                   bool end_sequence, void *data);
+
+drsym_error_t
+drsym_dwarf_enumerate_rows(void *mod_in, drsym_dwarf_row_cb callback, void *data);
+
+/***************************************************************************
+ * Address index (ELF only)
+ */
+
+/* Builds an address index from obj_info and, if non-NULL, dwarf_info.  If
+ * cache_dir is non-NULL and the module has a build id, first tries to map a
+ * saved index from cache_dir and otherwise saves the new one there.
+ */
+void *
+drsym_index_create(void *obj_info, void *dwarf_info, drsym_debug_kind_t debug_kind,
+                   const char *cache_dir);
+
+void
+drsym_index_free(void *index);
+
+/* Matches drsym_obj_addrsearch_symtab() followed by drsym_dwarf_search_addr2line(),
+ * except that offsets outside of any line table sequence have no line.
+ */
+drsym_error_t
+drsym_index_lookup_address(void *index, size_t modoffs, drsym_info_t *info INOUT,
+                           uint flags);
+
 #endif /* DRSYMS_ARCH_H */
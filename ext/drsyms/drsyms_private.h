@@ -101,6 +101,9 @@ drsym_error_t
 drsym_unix_lookup_address(void *moddata, size_t modoffs, drsym_info_t *out INOUT,
                           uint flags);
 
+drsym_error_t
+drsym_unix_enable_address_index(const char *cache_dir);
+
 drsym_error_t
 drsym_unix_lookup_symbol(void *moddata, const char *symbol, size_t *modoffs OUT,
                          uint flags);
@@ -61,6 +61,12 @@
 /* For debugging */
 static bool verbose = false;
 
+#ifdef LINUX
+/* Set by drsym_enable_address_index(). */
+static bool use_addr_index;
+static char addr_index_dir[MAXIMUM_PATH];
+#endif
+
 typedef struct _dbg_module_t {
     file_t fd;
     size_t file_size;
@@ -76,6 +82,9 @@ typedef struct _dbg_module_t {
     struct _dbg_module_t *mod_with_dwarf;
 #define SYMTABLE_HASH_BITS 12
     hashtable_t symtable;
+    /* Created by the first address lookup when use_addr_index is set. */
+    void *addr_index;
+    bool addr_index_failed;
 } dbg_module_t;
 
 /******************************************************************************
@@ -326,6 +335,10 @@ unload_module(dbg_module_t *mod)
         drsym_obj_mod_exit(mod->obj_info);
     if (mod->symtable.table != NULL)
         hashtable_delete(&mod->symtable);
+#ifdef LINUX
+    if (mod->addr_index != NULL)
+        drsym_index_free(mod->addr_index);
+#endif
     if (mod->map_base != NULL)
         dr_unmap_file(mod->map_base, mod->map_size);
     if (mod->fd != INVALID_FILE)
@@ -663,11 +676,10 @@ drsym_unix_lookup_symbol(void *mod_in, const char *symbol, size_t *modoffs OUT,
     return DRSYM_SUCCESS;
 }
 
-drsym_error_t
-drsym_unix_lookup_address(void *mod_in, size_t modoffs, drsym_info_t *out INOUT,
-                          uint flags)
+static drsym_error_t
+lookup_address_in_module(dbg_module_t *mod, size_t modoffs, drsym_info_t *out INOUT,
+                         uint flags)
 {
-    dbg_module_t *mod = (dbg_module_t *)mod_in;
     drsym_error_t r = addrsearch_symtab(mod, modoffs, out, flags);
 
     /* If we did find an address for the symbol, go look for its line number
@@ -689,6 +701,39 @@ drsym_unix_lookup_address(void *mod_in, size_t modoffs, drsym_info_t *out INOUT,
             r = DRSYM_ERROR_LINE_NOT_AVAILABLE;
         }
     }
+    return r;
+}
+
+#ifdef LINUX
+static void
+create_addr_index(dbg_module_t *mod)
+{
+    dbg_module_t *mod4line = mod;
+    if (mod->mod_with_dwarf != NULL)
+        mod4line = mod->mod_with_dwarf;
+    mod->addr_index =
+        drsym_index_create(mod->obj_info, mod4line->dwarf_info, mod->debug_kind,
+                           addr_index_dir[0] == '\0' ? NULL : addr_index_dir);
+    /* Don't keep retrying: we fall back to the direct search. */
+    mod->addr_index_failed = (mod->addr_index == NULL);
+}
+#endif
+
+drsym_error_t
+drsym_unix_lookup_address(void *mod_in, size_t modoffs, drsym_info_t *out INOUT,
+                          uint flags)
+{
+    dbg_module_t *mod = (dbg_module_t *)mod_in;
+    drsym_error_t r;
+
+#ifdef LINUX
+    if (use_addr_index && mod->addr_index == NULL && !mod->addr_index_failed)
+        create_addr_index(mod);
+    if (mod->addr_index != NULL)
+        r = drsym_index_lookup_address(mod->addr_index, modoffs, out, flags);
+    else
+#endif
+        r = lookup_address_in_module(mod, modoffs, out, flags);
 
     out->debug_kind = mod->debug_kind;
     /* Fields beyond name require compatibility checks */
@@ -699,6 +744,27 @@ drsym_unix_lookup_address(void *mod_in, size_t modoffs, drsym_info_t *out INOUT,
     return r;
 }
 
+drsym_error_t
+drsym_unix_enable_address_index(const char *cache_dir)
+{
+#ifdef LINUX
+    if (cache_dir != NULL && !dr_directory_exists(cache_dir))
+        return DRSYM_ERROR_INVALID_PARAMETER;
+    use_addr_index = true;
+    if (cache_dir == NULL)
+        addr_index_dir[0] = '\0';
+    else {
+        dr_snprintf(addr_index_dir, BUFFER_SIZE_ELEMENTS(addr_index_dir), "%s",
+                    cache_dir);
+        NULL_TERMINATE_BUFFER(addr_index_dir);
+    }
+    return DRSYM_SUCCESS;
+#else
+    /* The index relies on ELF symbol table semantics. */
+    return DRSYM_ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
 drsym_error_t
 drsym_unix_enumerate_lines(void *mod_in, drsym_enumerate_lines_cb callback, void *data)
 {
@@ -245,6 +245,19 @@ drsym_lookup_address(const char *modpath, size_t modoffs, drsym_info_t *out INOU
     }
 }
 
+DR_EXPORT
+drsym_error_t
+drsym_enable_address_index(const char *cache_dir)
+{
+    drsym_error_t r;
+    if (IS_SIDELINE)
+        return DRSYM_ERROR_NOT_IMPLEMENTED;
+    dr_recurlock_lock(symbol_lock);
+    r = drsym_unix_enable_address_index(cache_dir);
+    dr_recurlock_unlock(symbol_lock);
+    return r;
+}
+
 DR_EXPORT
 drsym_error_t
 drsym_lookup_symbol(const char *modpath, const char *symbol, size_t *modoffs OUT,
@@ -1819,6 +1819,14 @@ drsym_module_has_symbols(const char *modpath)
     }
 }
 
+DR_EXPORT
+drsym_error_t
+drsym_enable_address_index(const char *cache_dir)
+{
+    /* The index relies on ELF symbol table semantics. */
+    return DRSYM_ERROR_NOT_IMPLEMENTED;
+}
+
 /* We do not want to take unlimited resources when a client queries a whole
  * bunch of libraries.  Usually the client will query at module load and
  * then not again, unless in a callstack later.  So we can save a lot of memory
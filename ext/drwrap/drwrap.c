@@ -102,6 +102,15 @@ static uint verbose = 0;
 #    define dr_atomic_add_stat_return_sum dr_atomic_add32_return_sum
 #    define dr_atomic_load_stat dr_atomic_load32
 #endif
+#ifdef X64
+#    define dr_atomic_load_ptr(src) ((void *)dr_atomic_load64((volatile int64 *)(src)))
+#    define dr_atomic_store_ptr(dest, val) \
+        dr_atomic_store64((volatile int64 *)(dest), (int64)(val))
+#else
+#    define dr_atomic_load_ptr(src) ((void *)dr_atomic_load32((volatile int *)(src)))
+#    define dr_atomic_store_ptr(dest, val) \
+        dr_atomic_store32((volatile int *)(dest), (int)(val))
+#endif
 
 /* protected by wrap_lock */
 static drwrap_global_flags_t global_flags;
@@ -272,6 +281,178 @@ fast_safe_read(void *base, size_t size, void *out_buf)
 #endif
 }
 
+/***************************************************************************
+ * LOCK-FREE PC INDEX
+ */
+
+/* Our hashtables may only be read under their locks, yet the bb event probes
+ * them for every instruction and nearly every probe misses, so shared locks
+ * bounce between cores.  Beside each such table we keep a pc_index_t holding just
+ * its keys, which can be probed with no lock: an open-addressed array whose
+ * pointer-sized slots are each read and written atomically.  Writers are
+ * serialized by the table's own lock.  A removed key leaves a tombstone so probes
+ * continue past it.  Growing publishes a new array, but a reader may still be
+ * probing the old one, so retired arrays are only freed at exit; their combined
+ * size is less than that of the live array.
+ */
+#define PC_INDEX_TOMBSTONE ((app_pc)1)
+
+typedef struct _pc_index_array_t {
+    uint capacity; /* A power of 2. */
+    struct _pc_index_array_t *retired;
+    app_pc slots[1]; /* Really "capacity" entries. */
+} pc_index_array_t;
+
+typedef struct _pc_index_t {
+    pc_index_array_t *array; /* Published with dr_atomic_store_ptr(). */
+    uint used;               /* Keys plus tombstones. */
+} pc_index_t;
+
+static pc_index_array_t *
+pc_index_array_create(uint capacity)
+{
+    size_t size = offsetof(pc_index_array_t, slots) + capacity * sizeof(app_pc);
+    pc_index_array_t *array = (pc_index_array_t *)dr_global_alloc(size);
+    memset(array, 0, size);
+    array->capacity = capacity;
+    return array;
+}
+
+static inline uint
+pc_index_hash(app_pc pc, uint capacity)
+{
+    ptr_uint_t val = (ptr_uint_t)pc;
+    return (uint)((val ^ (val >> 16)) * 2654435761U) & (capacity - 1);
+}
+
+static void
+pc_index_init(pc_index_t *index, uint capacity_bits)
+{
+    index->array = pc_index_array_create(1U << capacity_bits);
+    index->used = 0;
+}
+
+static void
+pc_index_delete(pc_index_t *index)
+{
+    pc_index_array_t *array = index->array, *next;
+    for (; array != NULL; array = next) {
+        next = array->retired;
+        dr_global_free(array,
+                       offsetof(pc_index_array_t, slots) +
+                           array->capacity * sizeof(app_pc));
+    }
+    index->array = NULL;
+}
+
+/* Needs no lock.  A key added or removed concurrently may or may not be seen. */
+static bool
+pc_index_lookup(pc_index_t *index, app_pc pc)
+{
+    pc_index_array_t *array = (pc_index_array_t *)dr_atomic_load_ptr(&index->array);
+    uint i = pc_index_hash(pc, array->capacity), probes;
+    for (probes = 0; probes < array->capacity; probes++) {
+        app_pc cur = (app_pc)dr_atomic_load_ptr(&array->slots[i]);
+        if (cur == pc)
+            return true;
+        if (cur == NULL)
+            return false;
+        i = (i + 1) & (array->capacity - 1);
+    }
+    return false;
+}
+
+/* The caller must hold the lock of the table this indexes. */
+static void
+pc_index_grow(pc_index_t *index)
+{
+    pc_index_array_t *old = index->array, *array;
+    uint capacity = old->capacity, live = 0, i;
+    for (i = 0; i < old->capacity; i++) {
+        if (old->slots[i] != NULL && old->slots[i] != PC_INDEX_TOMBSTONE)
+            live++;
+    }
+    /* Rehashing at the same size just clears out the tombstones. */
+    while ((live + 1) * 2 > capacity)
+        capacity *= 2;
+    array = pc_index_array_create(capacity);
+    for (i = 0; i < old->capacity; i++) {
+        app_pc pc = old->slots[i];
+        if (pc != NULL && pc != PC_INDEX_TOMBSTONE) {
+            uint j = pc_index_hash(pc, capacity);
+            while (array->slots[j] != NULL)
+                j = (j + 1) & (capacity - 1);
+            array->slots[j] = pc;
+        }
+    }
+    array->retired = old;
+    index->used = live;
+    dr_atomic_store_ptr(&index->array, array);
+}
+
+/* The caller must hold the lock of the table this indexes. */
+static void
+pc_index_add(pc_index_t *index, app_pc pc)
+{
+    pc_index_array_t *array;
+    uint i, probes, reuse = UINT_MAX;
+    ASSERT(pc != NULL && pc != PC_INDEX_TOMBSTONE, "invalid index key");
+    if ((index->used + 1) * 4 > index->array->capacity * 3)
+        pc_index_grow(index);
+    array = index->array;
+    i = pc_index_hash(pc, array->capacity);
+    for (probes = 0; probes < array->capacity; probes++) {
+        app_pc cur = array->slots[i];
+        if (cur == pc)
+            return;
+        if (cur == PC_INDEX_TOMBSTONE && reuse == UINT_MAX)
+            reuse = i;
+        if (cur == NULL)
+            break;
+        i = (i + 1) & (array->capacity - 1);
+    }
+    if (reuse == UINT_MAX) {
+        ASSERT(probes < array->capacity, "index should never be full");
+        reuse = i;
+        index->used++;
+    }
+    dr_atomic_store_ptr(&array->slots[reuse], pc);
+}
+
+/* The caller must hold the lock of the table this indexes. */
+static void
+pc_index_remove_range(pc_index_t *index, app_pc start, app_pc end)
+{
+    pc_index_array_t *array = index->array;
+    uint i;
+    for (i = 0; i < array->capacity; i++) {
+        app_pc cur = array->slots[i];
+        if (cur != NULL && cur != PC_INDEX_TOMBSTONE && cur >= start && cur < end)
+            dr_atomic_store_ptr(&array->slots[i], PC_INDEX_TOMBSTONE);
+    }
+}
+
+/* The caller must hold the lock of the table this indexes. */
+static void
+pc_index_remove(pc_index_t *index, app_pc pc)
+{
+    pc_index_array_t *array = index->array;
+    uint i = pc_index_hash(pc, array->capacity), probes;
+    for (probes = 0; probes < array->capacity; probes++) {
+        app_pc cur = array->slots[i];
+        if (cur == pc) {
+            dr_atomic_store_ptr(&array->slots[i], PC_INDEX_TOMBSTONE);
+            return;
+        }
+        if (cur == NULL)
+            return;
+        i = (i + 1) & (array->capacity - 1);
+    }
+}
+
+/* The keys of wrap_table, protected by wrap_lock. */
+static pc_index_t wrap_index;
+
 /***************************************************************************
  * WRAPPING INSTRUMENTATION TRACKING
  */
@@ -285,6 +466,8 @@ fast_safe_read(void *base, size_t size, void *out_buf)
 /* i#1689: we store the aligned (LSB=0) pc here */
 static hashtable_t post_call_table;
 static void *post_call_rwlock;
+/* The keys of post_call_table, protected by post_call_rwlock. */
+static pc_index_t post_call_index;
 
 typedef struct _post_call_entry_t {
     /* PR 454616: we need two flags in the post_call_table: one that
@@ -346,6 +529,7 @@ post_call_entry_add(app_pc postcall, bool external)
         post_call_entry_free(e);
         return NULL;
     }
+    pc_index_add(&post_call_index, postcall);
     if (!external && post_call_notify_list != NULL) {
         post_call_notify_t *cb = post_call_notify_list;
         while (cb != NULL) {
@@ -381,11 +565,7 @@ post_call_consistent(app_pc postcall, post_call_entry_t *e)
 static bool
 post_call_lookup(app_pc pc)
 {
-    bool res = false;
-    dr_rwlock_read_lock(post_call_rwlock);
-    res = (hashtable_lookup(&post_call_table, (void *)pc) != NULL);
-    dr_rwlock_read_unlock(post_call_rwlock);
-    return res;
+    return pc_index_lookup(&post_call_index, pc);
 }
 #endif
 
@@ -395,6 +575,11 @@ post_call_lookup_for_instru(app_pc pc)
 {
     bool res = false;
     post_call_entry_t *e;
+    /* This is called for every instruction, so we avoid the lock for the common
+     * case of a pc that is not a post-call site.
+     */
+    if (!pc_index_lookup(&post_call_index, pc))
+        return false;
     dr_rwlock_read_lock(post_call_rwlock);
     e = (post_call_entry_t *)hashtable_lookup(&post_call_table, (void *)pc);
     if (e != NULL) {
@@ -408,6 +593,7 @@ post_call_lookup_for_instru(app_pc pc)
             /* might not be found now if racily removed: but that's fine */
             NOTIFY(2, "%s: removing %p\n", __FUNCTION__, pc);
             hashtable_remove(&post_call_table, (void *)pc);
+            pc_index_remove(&post_call_index, pc);
             /* invalidate cache */
             for (i = 0; i < POSTCALL_CACHE_SIZE; i++) {
                 if (pc == postcall_cache[i])
@@ -988,6 +1174,8 @@ drwrap_init(void)
     hashtable_init_ex(&post_call_table, POST_CALL_TABLE_HASH_BITS, HASH_INTPTR,
                       false /*!str_dup*/, false /*!synch*/, post_call_entry_free, NULL,
                       NULL);
+    pc_index_init(&wrap_index, WRAP_TABLE_HASH_BITS + 1);
+    pc_index_init(&post_call_index, POST_CALL_TABLE_HASH_BITS + 1);
     post_call_rwlock = dr_rwlock_create();
     /* This lock may have been set up by drwrap_set_global_flags() (in this thread). */
     if (wrap_lock == NULL)
@@ -1071,6 +1259,8 @@ drwrap_exit(void)
     hashtable_delete(&replace_native_table);
     hashtable_delete(&wrap_table);
     hashtable_delete(&post_call_table);
+    pc_index_delete(&wrap_index);
+    pc_index_delete(&post_call_index);
     dr_rwlock_destroy(post_call_rwlock);
     dr_recurlock_destroy(wrap_lock);
     wrap_lock = NULL; /* For early drwrap_set_global_flags() after re-attach. */
@@ -1956,6 +2146,9 @@ drwrap_ensure_postcall(void *drcontext, per_thread_t *pt, wrap_entry_t *wrap,
         if (retaddr == postcall_cache[i])
             return;
     }
+    /* For more call sites than the cache holds, the index still avoids the lock. */
+    if (pc_index_lookup(&post_call_index, retaddr))
+        return;
 
     /* to write to the cache we need a write lock */
     dr_rwlock_write_lock(post_call_rwlock);
@@ -2270,6 +2463,7 @@ drwrap_after_callee_func(void *drcontext, per_thread_t *pt, dr_mcontext_t *mc, i
                                  */
                                 drvector_append(&toflush, (void *)wrap->func);
                                 hashtable_remove(&wrap_table, (void *)wrap->func);
+                                pc_index_remove(&wrap_index, wrap->func);
                                 wrap = NULL; /* don't double-free */
                             } else {
                                 hashtable_add_replace(&wrap_table, (void *)wrap->func,
@@ -2433,7 +2627,8 @@ drwrap_event_bb_insert_where(void *drcontext, void *tag, instrlist_t *bb, instr_
     app_pc pc =
         dr_app_pc_as_jump_target(instr_get_isa_mode(inst), instr_get_app_pc(inst));
 
-    if (!cleanup_only) {
+    /* The index lets us skip wrap_lock for the vast majority of instructions. */
+    if (!cleanup_only && pc_index_lookup(&wrap_index, pc)) {
         /* Strategy: for the pre-hook, do not insert at the call site but rather wait for
          * the callee.  For the post-hook, record the post-call site when we see the
          * call instruction, and additionally record the actual retaddr when in the
@@ -2489,11 +2684,14 @@ drwrap_event_bb_insert_where(void *drcontext, void *tag, instrlist_t *bb, instr_
     if (instr_is_call(inst) && instr_is_app(inst) && opnd_is_pc(instr_get_target(inst))) {
         app_pc target = dr_app_pc_as_jump_target(instr_get_isa_mode(inst),
                                                  opnd_get_pc(instr_get_target(inst)));
-        dr_recurlock_lock(wrap_lock);
-        wrap = hashtable_lookup(&wrap_table, (void *)target);
-        bool add_post = wrap != NULL && wrap->post_cb != NULL &&
-            !TEST(DRWRAP_REPLACE_RETADDR, wrap->flags);
-        dr_recurlock_unlock(wrap_lock);
+        bool add_post = false;
+        if (pc_index_lookup(&wrap_index, target)) {
+            dr_recurlock_lock(wrap_lock);
+            wrap = hashtable_lookup(&wrap_table, (void *)target);
+            add_post = wrap != NULL && wrap->post_cb != NULL &&
+                !TEST(DRWRAP_REPLACE_RETADDR, wrap->flags);
+            dr_recurlock_unlock(wrap_lock);
+        }
         if (add_post) {
             /* Add the pc-as-load-target (so *not* "pc"). */
             dr_rwlock_write_lock(post_call_rwlock);
@@ -2525,6 +2723,7 @@ drwrap_event_module_unload(void *drcontext, const module_data_t *info)
     NOTIFY(2, "%s: removing %p..%p\n", __FUNCTION__, info->start, info->end);
     dr_rwlock_write_lock(post_call_rwlock);
     hashtable_remove_range(&post_call_table, (void *)info->start, (void *)info->end);
+    pc_index_remove_range(&post_call_index, info->start, info->end);
     /* Invalidate cache. */
     for (int i = 0; i < POSTCALL_CACHE_SIZE; i++) {
         if (postcall_cache[i] >= info->start && postcall_cache[i] < info->end)
@@ -2676,6 +2875,7 @@ drwrap_wrap_ex(app_pc func, void (*pre_func_cb)(void *wrapcxt, INOUT void **user
     } else {
         wrap_new->next = NULL;
         hashtable_add(&wrap_table, (void *)func, (void *)wrap_new);
+        pc_index_add(&wrap_index, func);
         /* XXX: we're assuming void* tag == pc */
         if (dr_fragment_exists_at(dr_get_current_drcontext(), func)) {
             dr_atomic_add_stat_return_sum(&drwrap_stats.flush_count, 1);
@@ -2752,13 +2952,9 @@ DR_EXPORT
 bool
 drwrap_is_post_wrap(app_pc pc)
 {
-    bool res = false;
     if (pc == NULL)
         return false;
-    dr_rwlock_read_lock(post_call_rwlock);
-    res = (hashtable_lookup(&post_call_table, (void *)pc) != NULL);
-    dr_rwlock_read_unlock(post_call_rwlock);
-    return res;
+    return pc_index_lookup(&post_call_index, pc);
 }
 
 DR_EXPORT
@@ -39,6 +39,10 @@
 
 #include <limits.h>
 #include <string.h>
+#ifdef LINUX
+#    include <dirent.h>
+#    include <sys/stat.h>
+#endif
 
 /* DR's build system usually disables warnings we're not interested in, but the
  * flags don't seem to make it to the compiler for this file, maybe because
@@ -560,6 +564,178 @@ test_line_iteration(const module_data_t *dll_data)
         dr_fprintf(STDERR, "found tools.h\n");
 }
 
+#ifdef LINUX
+typedef struct _addr_result_t {
+    drsym_error_t res;
+    char name[MAX_FUNC_LEN];
+    char file[MAXIMUM_PATH];
+    uint64 line;
+    size_t start_offs;
+} addr_result_t;
+
+static void
+lookup_addr_result(const char *dll_path, size_t modoffs, addr_result_t *result OUT)
+{
+    drsym_info_t sym_info;
+    sym_info.struct_size = sizeof(sym_info);
+    sym_info.name = result->name;
+    sym_info.name_size = BUFFER_SIZE_ELEMENTS(result->name);
+    sym_info.file = result->file;
+    sym_info.file_size = BUFFER_SIZE_ELEMENTS(result->file);
+    result->res = drsym_lookup_address(dll_path, modoffs, &sym_info, DRSYM_DEMANGLE);
+    result->line = sym_info.line;
+    result->start_offs = sym_info.start_offs;
+}
+
+static const char *const index_syms[] = { "dll_export", "dll_public", "stack_trace" };
+
+/* Drops the module's index and checks that looking up each of the num offsets
+ * through a fresh index finds what the direct search found.
+ */
+static void
+check_index_lookups(const char *dll_path, const size_t *offs,
+                    const addr_result_t *direct, uint num)
+{
+    static addr_result_t indexed;
+    uint i;
+    drsym_free_resources(dll_path);
+    for (i = 0; i < num; i++) {
+        lookup_addr_result(dll_path, offs[i], &indexed);
+        ASSERT(indexed.res == direct[i].res);
+        ASSERT(strcmp(indexed.name, direct[i].name) == 0);
+        ASSERT(strcmp(indexed.file, direct[i].file) == 0);
+        ASSERT(indexed.line == direct[i].line);
+        ASSERT(indexed.start_offs == direct[i].start_offs);
+    }
+}
+
+/* Returns the inode of the only file in dir, which must be an index file, and
+ * writes its path to path.
+ */
+static ino_t
+find_index_file(const char *dir, char *path, size_t path_len)
+{
+    static const char suffix[] = ".drsymidx";
+    DIR *dirp = opendir(dir);
+    struct dirent *ent;
+    struct stat st;
+    uint count = 0;
+    ASSERT(dirp != NULL);
+    while ((ent = readdir(dirp)) != NULL) {
+        size_t len = strlen(ent->d_name);
+        if (strcmp(ent->d_name, ".") == 0 || strcmp(ent->d_name, "..") == 0)
+            continue;
+        /* A leftover temporary file would show up here too. */
+        ASSERT(len > strlen(suffix) &&
+               strcmp(ent->d_name + len - strlen(suffix), suffix) == 0);
+        dr_snprintf(path, path_len, "%s/%s", dir, ent->d_name);
+        path[path_len - 1] = '\0';
+        count++;
+    }
+    closedir(dirp);
+    ASSERT(count == 1);
+    ASSERT(stat(path, &st) == 0);
+    return st.st_ino;
+}
+
+/* Overwrites the index file at path with its first size bytes, with the 32-bit
+ * field at version_offs incremented if version_offs is not -1.
+ */
+static void
+damage_index_file(const char *path, size_t size, int version_offs)
+{
+    static char buf[4096];
+    file_t f = dr_open_file(path, DR_FILE_READ);
+    ASSERT(f != INVALID_FILE);
+    ASSERT(size <= sizeof(buf) && dr_read_file(f, buf, size) == (ssize_t)size);
+    dr_close_file(f);
+    if (version_offs != -1)
+        (*(uint *)(buf + version_offs))++;
+    f = dr_open_file(path, DR_FILE_WRITE_OVERWRITE);
+    ASSERT(f != INVALID_FILE);
+    ASSERT(dr_write_file(f, buf, size) == (ssize_t)size);
+    dr_close_file(f);
+}
+
+/* Checks the on-disk cache: the first index is saved under the build id, the
+ * next process (simulated by dropping the module) maps that file rather than
+ * rebuilding it, and a stale or truncated file is rejected and replaced.
+ */
+static void
+test_address_index_cache(const char *dll_path, const size_t *offs,
+                         const addr_result_t *direct, uint num)
+{
+    /* The index header starts with a 64-bit magic followed by the version. */
+    const int version_offs = 8;
+    char dir[MAXIMUM_PATH];
+    char path[MAXIMUM_PATH];
+    ino_t ino, new_ino;
+    dr_snprintf(dir, BUFFER_SIZE_ELEMENTS(dir), "drsyms-test.%d.idx",
+                (int)dr_get_process_id());
+    NULL_TERMINATE_BUFFER(dir);
+    ASSERT(dr_create_dir(dir));
+    ASSERT(drsym_enable_address_index(dir) == DRSYM_SUCCESS);
+
+    check_index_lookups(dll_path, offs, direct, num);
+    ino = find_index_file(dir, path, BUFFER_SIZE_ELEMENTS(path));
+
+    /* The file is mapped, not rebuilt: rebuilding renames a new file over it. */
+    check_index_lookups(dll_path, offs, direct, num);
+    new_ino = find_index_file(dir, path, BUFFER_SIZE_ELEMENTS(path));
+    ASSERT(new_ino == ino);
+
+    /* A file from another format version is rebuilt. */
+    damage_index_file(path, 64, version_offs);
+    check_index_lookups(dll_path, offs, direct, num);
+    new_ino = find_index_file(dir, path, BUFFER_SIZE_ELEMENTS(path));
+    ASSERT(new_ino != ino);
+    ino = new_ino;
+
+    /* So is a truncated file, whose header is intact. */
+    damage_index_file(path, 128, -1);
+    check_index_lookups(dll_path, offs, direct, num);
+    new_ino = find_index_file(dir, path, BUFFER_SIZE_ELEMENTS(path));
+    ASSERT(new_ino != ino);
+
+    /* The rebuilt file is good again. */
+    ino = new_ino;
+    check_index_lookups(dll_path, offs, direct, num);
+    ASSERT(find_index_file(dir, path, BUFFER_SIZE_ELEMENTS(path)) == ino);
+
+    ASSERT(dr_delete_file(path));
+    ASSERT(dr_delete_dir(dir));
+}
+
+/* Checks that drsym_enable_address_index() finds what the direct search does,
+ * both in memory and through the cache directory.  The index stays enabled, so
+ * the later stack traces also go through it.
+ */
+static void
+test_address_index(const char *dll_path)
+{
+    static addr_result_t direct[BUFFER_SIZE_ELEMENTS(index_syms)];
+    size_t offs[BUFFER_SIZE_ELEMENTS(index_syms)];
+    drsym_error_t r;
+    uint i;
+
+    for (i = 0; i < BUFFER_SIZE_ELEMENTS(index_syms); i++) {
+        r = drsym_lookup_symbol(dll_path, index_syms[i], &offs[i], DRSYM_DEFAULT_FLAGS);
+        ASSERT(r == DRSYM_SUCCESS);
+        /* Query inside the function, past its first line. */
+        offs[i] += 4;
+        lookup_addr_result(dll_path, offs[i], &direct[i]);
+        ASSERT(direct[i].res == DRSYM_SUCCESS);
+    }
+    r = drsym_enable_address_index(NULL);
+    ASSERT(r == DRSYM_SUCCESS);
+    check_index_lookups(dll_path, offs, direct, BUFFER_SIZE_ELEMENTS(index_syms));
+    test_address_index_cache(dll_path, offs, direct, BUFFER_SIZE_ELEMENTS(index_syms));
+    /* The cache directory is gone. */
+    r = drsym_enable_address_index(NULL);
+    ASSERT(r == DRSYM_SUCCESS);
+}
+#endif
+
 /* Lookup symbols in the appdll and wrap them. */
 static void
 lookup_dll_syms(void *dc, const module_data_t *dll_data, bool loaded)
@@ -632,6 +808,10 @@ lookup_dll_syms(void *dc, const module_data_t *dll_data, bool loaded)
 
     test_line_iteration(dll_data);
 
+#ifdef LINUX
+    test_address_index(dll_path);
+#endif
+
     drsym_free_resources(dll_path);
 }
 
@@ -0,0 +1,179 @@
+/* **********************************************************
+ * Copyright (c) 2023 Google, Inc.  All rights reserved.
+ * **********************************************************/
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of VMware, Inc. nor the names of its contributors may be
+ *   used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL VMWARE, INC. OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+/* Tests wrapping and unwrapping a function from one thread while another thread
+ * is calling it, racing the table updates against the lock-free lookups.
+ */
+
+/* XXX: We undef this b/c it's easier than getting rid of from CMake with the
+ * global cflags config where all the other tests want this set.
+ */
+#undef DR_REG_ENUM_COMPATIBILITY
+
+#include <assert.h>
+#include <atomic>
+#include <iostream>
+#include "configure.h"
+#include "dr_api.h"
+#include "drwrap.h"
+#include "tools.h"
+#include "thread.h"
+
+#define NUM_TOGGLES 400
+
+static std::atomic<bool> sideline_running;
+static std::atomic<bool> sideline_exit;
+static std::atomic<int> pre_count;
+static std::atomic<int> post_count;
+static std::atomic<int> wrap_count;
+static app_pc racy_pc;
+/* Side effects to keep the compiler from dropping or merging calls. */
+static volatile int racy_calls;
+static volatile int toggle_calls;
+
+extern "C" { /* Make it easy to get the name across platforms. */
+EXPORT NOINLINE int
+racy_func(int x)
+{
+    racy_calls = racy_calls + 1;
+    return x * 2 + 1;
+}
+/* The client wraps or unwraps racy_func each time this is called. */
+EXPORT NOINLINE void
+toggle_wrap(void)
+{
+    toggle_calls = toggle_calls + 1;
+}
+}
+
+THREAD_FUNC_RETURN_TYPE
+sideline_func(void *arg)
+{
+    int calls = 0;
+    while (!sideline_exit.load(std::memory_order_acquire)) {
+        for (int i = 0; i < 100; ++i) {
+            if (racy_func(i) != i * 2 + 1) {
+                print("wrong return value\n");
+                exit(1);
+            }
+        }
+        if (++calls == 10)
+            sideline_running.store(true, std::memory_order_release);
+    }
+    return THREAD_FUNC_RETURN_ZERO;
+}
+
+static void
+racy_pre(void *wrapcxt, OUT void **user_data)
+{
+    *user_data = drwrap_get_arg(wrapcxt, 0);
+    pre_count.fetch_add(1, std::memory_order_relaxed);
+}
+
+static void
+racy_post(void *wrapcxt, void *user_data)
+{
+    /* The post-callback may be skipped for a call in flight across an unwrap, but
+     * when it is called it must see the pre-callback's state for the same call.
+     */
+    int x = (int)(ptr_int_t)user_data;
+    assert((int)(ptr_int_t)drwrap_get_retval(wrapcxt) == x * 2 + 1);
+    post_count.fetch_add(1, std::memory_order_relaxed);
+}
+
+static void
+toggle_pre(void *wrapcxt, OUT void **user_data)
+{
+    if (drwrap_is_wrapped(racy_pc, racy_pre, racy_post)) {
+        bool ok = drwrap_unwrap(racy_pc, racy_pre, racy_post);
+        assert(ok);
+        assert(!drwrap_is_wrapped(racy_pc, racy_pre, racy_post));
+    } else {
+        bool ok = drwrap_wrap(racy_pc, racy_pre, racy_post);
+        assert(ok);
+        assert(drwrap_is_wrapped(racy_pc, racy_pre, racy_post));
+        wrap_count.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+static void
+event_exit(void)
+{
+    assert(wrap_count.load() == NUM_TOGGLES / 2);
+    /* Some calls ran wrapped and some unwrapped. */
+    assert(pre_count.load() > 0 && pre_count.load() < racy_calls);
+    assert(post_count.load() <= pre_count.load());
+    drwrap_exit();
+    dr_fprintf(STDERR, "client done\n");
+}
+
+DR_EXPORT void
+dr_client_main(client_id_t id, int argc, const char *argv[])
+{
+    std::cerr << "in dr_client_main\n";
+    dr_register_exit_event(event_exit);
+    drwrap_init();
+
+    module_data_t *module = dr_get_main_module();
+    racy_pc = (app_pc)dr_get_proc_address(module->handle, "racy_func");
+    assert(racy_pc != nullptr);
+    app_pc pc = (app_pc)dr_get_proc_address(module->handle, "toggle_wrap");
+    bool ok = drwrap_wrap(pc, toggle_pre, nullptr);
+    assert(ok);
+    dr_free_module_data(module);
+}
+
+int
+main(void)
+{
+    if (!my_setenv("DYNAMORIO_OPTIONS",
+                   "-stderr_mask 0xc"
+                   " -client_lib ';;'"))
+        std::cerr << "failed to set env var!\n";
+
+    dr_app_setup_and_start();
+    thread_t thread = create_thread(sideline_func, nullptr);
+    while (!sideline_running.load(std::memory_order_acquire))
+        thread_yield();
+    for (int i = 0; i < NUM_TOGGLES; ++i) {
+        toggle_wrap();
+        /* Give the sideline thread time to call through the new state. */
+        for (int j = 0; j < 10; ++j)
+            thread_yield();
+    }
+    sideline_exit.store(true, std::memory_order_release);
+    join_thread(thread);
+    dr_app_stop_and_cleanup();
+
+    print("app done\n");
+    return 0;
+}
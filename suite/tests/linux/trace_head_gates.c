@@ -0,0 +1,98 @@
+/* **********************************************************
+ * Copyright (c) 2023 Google, Inc.  All rights reserved.
+ * **********************************************************/
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of Google, Inc. nor the names of its contributors may be
+ *   used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL GOOGLE, INC. OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+/* Tests that with -inline_trace_head_counters, where trace heads are counted in
+ * their gates rather than in d_r_dispatch, hot loops still become traces at
+ * -trace_threshold.
+ */
+
+#include "configure.h"
+#include "dr_api.h"
+#include "tools.h"
+
+#define NUM_ITERS 1000
+
+static volatile int num_traces;
+/* Side effects to keep the compiler from dropping or merging the loops. */
+static volatile int sum;
+
+static dr_emit_flags_t
+event_trace(void *drcontext, void *tag, instrlist_t *trace, bool translating)
+{
+    if (!translating)
+        dr_atomic_add32_return_sum(&num_traces, 1);
+    return DR_EMIT_DEFAULT;
+}
+
+static void
+event_exit(void)
+{
+    /* Each loop is entered NUM_ITERS times through its head's gate, far more than
+     * the -trace_threshold of 10 passed in the options.
+     */
+    if (num_traces > 0)
+        print("traces built\n");
+    else
+        print("ERROR: no traces built\n");
+}
+
+DR_EXPORT void
+dr_client_main(client_id_t id, int argc, const char *argv[])
+{
+    print("in dr_client_main\n");
+    dr_register_trace_event(event_trace);
+    dr_register_exit_event(event_exit);
+}
+
+static NOINLINE int
+callee(int i)
+{
+    return sum + i;
+}
+
+int
+main(void)
+{
+    int i, j;
+    dr_app_setup_and_start();
+    if (!dr_app_running_under_dynamorio())
+        print("ERROR: should be running under DynamoRIO\n");
+    for (i = 0; i < NUM_ITERS; i++) {
+        /* An inner loop and a call give the trace heads several sources. */
+        for (j = 0; j < i % 7; j++)
+            sum += j;
+        sum = callee(i);
+    }
+    dr_app_stop_and_cleanup();
+    print("all done\n");
+    return 0;
+}
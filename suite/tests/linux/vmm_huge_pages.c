@@ -0,0 +1,94 @@
+/* **********************************************************
+ * Copyright (c) 2023 Google, Inc.  All rights reserved.
+ * **********************************************************/
+
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of Google, Inc. nor the names of its contributors may be
+ *   used to endorse or promote products derived from this software without
+ *   specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL GOOGLE, INC. OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ */
+
+/* Smoke test for -vmm_huge_pages: DR must run normally with the option and the
+ * options it overrides.  Whether the advised regions end up huge-backed depends
+ * on the kernel's transparent huge page settings, so that is not checked here.
+ */
+
+#include "configure.h"
+#include "dr_api.h"
+#include "tools.h"
+
+#define NUM_ITERS 1000
+#define HUGE_PAGE_SIZE (2 * 1024 * 1024)
+
+/* Side effects to keep the compiler from dropping the loop. */
+static volatile int sum;
+
+static void
+check_option(const char *name, uint64 expect)
+{
+    uint64 val;
+    if (!dr_get_integer_option(name, &val))
+        print("ERROR: no option %s\n", name);
+    else if (val != expect)
+        print("ERROR: -%s is %d, expected %d\n", name, (int)val, (int)expect);
+}
+
+static void
+event_exit(void)
+{
+    print("in event_exit\n");
+}
+
+DR_EXPORT void
+dr_client_main(client_id_t id, int argc, const char *argv[])
+{
+    print("in dr_client_main\n");
+    check_option("vmm_huge_pages", 1);
+    /* The options -vmm_huge_pages overrides, as its help text says. */
+    check_option("guard_pages", 0);
+    check_option("heap_commit_increment", HUGE_PAGE_SIZE);
+    check_option("cache_commit_increment", HUGE_PAGE_SIZE);
+    dr_register_exit_event(event_exit);
+}
+
+static NOINLINE int
+callee(int i)
+{
+    return sum + i;
+}
+
+int
+main(int argc, char **argv)
+{
+    int i;
+    dr_app_setup_and_start();
+    if (!dr_app_running_under_dynamorio())
+        print("ERROR: should be running under DynamoRIO\n");
+    for (i = 0; i < NUM_ITERS; i++)
+        sum = callee(i);
+    dr_app_stop_and_cleanup();
+    print("all done\n");
+    return 0;
+}